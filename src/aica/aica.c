@@ -20,17 +20,19 @@
 #define MODULE aica_module
 
 #include <time.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include "dream.h"
 #include "dreamcast.h"
 #include "mem.h"
 #include "aica/aica.h"
 #include "armcore.h"
+#include "aica/armxlat.h"
 #include "aica/audio.h"
 #define MMIO_IMPL
 #include "aica.h"
 
-MMIO_REGION_READ_DEFFN( AICA0 )
-MMIO_REGION_READ_DEFFN( AICA1 )
 MMIO_REGION_READ_DEFSUBFNS(AICA0)
 MMIO_REGION_READ_DEFSUBFNS(AICA1)
 MMIO_REGION_READ_DEFSUBFNS(AICA2)
@@ -65,6 +67,30 @@ struct aica_state_struct {
 
 static struct aica_state_struct aica_state;
 
+/**
+ * Threaded mode: the ARM and mixer run on their own thread, up to
+ * aica_max_lag nanoseconds behind the SH4. aica_run_slice just queues the
+ * slice for the AICA thread, and any SH4-side access to the AICA (registers,
+ * wave memory or DMA) first waits for the queue to drain. As the SH4 runs
+ * each slice before the AICA does, the SH4 then sees exactly the state it
+ * would have in lockstep, so the two modes behave identically - only how far
+ * the audio output runs behind changes.
+ */
+#define AICA_THREAD_QUEUE_SIZE 16
+
+static uint32_t aica_max_lag = 0;
+static gboolean aica_thread_started = FALSE;
+static pthread_t aica_thread;
+static pthread_mutex_t aica_thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t aica_thread_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t aica_thread_done_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t aica_thread_queue[AICA_THREAD_QUEUE_SIZE];
+static unsigned int aica_thread_head = 0;
+/* Slices queued or running, and their total length */
+static volatile uint32_t aica_thread_count = 0;
+static uint32_t aica_thread_nanosecs = 0;
+static volatile gboolean aica_thread_stop_requested = FALSE;
+
 
 /**
  * Initialize the AICA subsystem. Note requires that 
@@ -74,11 +100,28 @@ void aica_init( void )
     register_io_regions( mmio_list_spu );
     MMIO_NOTRACE(AICA0);
     MMIO_NOTRACE(AICA1);
+    const char *lag = getenv("LXDREAM_AICA_LAG");
+    if( lag != NULL && *lag != '\0' ) {
+        aica_set_max_lag( strtoul(lag, NULL, 10) * 1000 );
+    }
+#ifdef ARM_TRANSLATOR
+    /* "0" for the interpreter only, "shadow" to check the translator against
+     * it */
+    const char *xlat = getenv("LXDREAM_ARM_TRANSLATOR");
+    if( xlat == NULL || *xlat == '\0' ) {
+        arm_xlat_enable( TRUE, FALSE );
+    } else if( strcmp(xlat, "shadow") == 0 ) {
+        arm_xlat_enable( TRUE, TRUE );
+    } else {
+        arm_xlat_enable( strtoul(xlat, NULL, 10) != 0, FALSE );
+    }
+#endif
     aica_reset();
 }
 
 void aica_reset( void )
 {
+    aica_sync();
     arm_reset();
     aica_state.time_of_day = 0x5bfc8900;
     aica_state.samples_done = 0;
@@ -93,7 +136,7 @@ void aica_start( void )
     audio_start_driver();
 }
 
-uint32_t aica_run_slice( uint32_t nanosecs )
+static void aica_run_arm_slice( uint32_t nanosecs )
 {
     /* Run arm instructions */
     int reset = MMIO_READ( AICA2, AICA_RESET );
@@ -110,16 +153,109 @@ uint32_t aica_run_slice( uint32_t nanosecs )
         aica_state.nanosecs_done -= 1000000000;
         aica_state.time_of_day++;
     }
+}
+
+static void *aica_thread_main( void *arg )
+{
+    pthread_mutex_lock( &aica_thread_mutex );
+    for(;;) {
+        while( aica_thread_count == 0 ) {
+            pthread_cond_wait( &aica_thread_work_cond, &aica_thread_mutex );
+        }
+        uint32_t nanosecs = aica_thread_queue[aica_thread_head];
+        pthread_mutex_unlock( &aica_thread_mutex );
+
+        aica_run_arm_slice( nanosecs );
+
+        pthread_mutex_lock( &aica_thread_mutex );
+        aica_thread_head = (aica_thread_head + 1) % AICA_THREAD_QUEUE_SIZE;
+        aica_thread_nanosecs -= nanosecs;
+        __atomic_sub_fetch( &aica_thread_count, 1, __ATOMIC_RELEASE );
+        pthread_cond_broadcast( &aica_thread_done_cond );
+    }
+    return NULL;
+}
+
+static gboolean aica_on_thread( void )
+{
+    return aica_thread_started && pthread_equal( pthread_self(), aica_thread );
+}
+
+void aica_set_max_lag( uint32_t nanosecs )
+{
+    aica_sync();
+    if( nanosecs != 0 && !aica_thread_started ) {
+        if( pthread_create( &aica_thread, NULL, aica_thread_main, NULL ) != 0 ) {
+            WARN( "Unable to start the AICA thread, running in lockstep" );
+            return;
+        }
+        pthread_detach( aica_thread );
+        aica_thread_started = TRUE;
+    }
+    aica_max_lag = nanosecs;
+}
+
+uint32_t aica_get_max_lag( void )
+{
+    return aica_max_lag;
+}
+
+void aica_sync( void )
+{
+    if( __atomic_load_n( &aica_thread_count, __ATOMIC_ACQUIRE ) == 0 || aica_on_thread() ) {
+        return;
+    }
+    pthread_mutex_lock( &aica_thread_mutex );
+    while( aica_thread_count != 0 ) {
+        pthread_cond_wait( &aica_thread_done_cond, &aica_thread_mutex );
+    }
+    pthread_mutex_unlock( &aica_thread_mutex );
+}
+
+void aica_request_stop( void )
+{
+    if( aica_on_thread() ) {
+        aica_thread_stop_requested = TRUE;
+    } else {
+        dreamcast_stop();
+    }
+}
+
+uint32_t aica_run_slice( uint32_t nanosecs )
+{
+    if( aica_max_lag == 0 ) {
+        aica_run_arm_slice( nanosecs );
+        return nanosecs;
+    }
+
+    pthread_mutex_lock( &aica_thread_mutex );
+    /* Always allow one slice to be outstanding, however small the lag */
+    while( aica_thread_count == AICA_THREAD_QUEUE_SIZE ||
+           (aica_thread_count != 0 && aica_thread_nanosecs + nanosecs > aica_max_lag) ) {
+        pthread_cond_wait( &aica_thread_done_cond, &aica_thread_mutex );
+    }
+    aica_thread_queue[(aica_thread_head + aica_thread_count) % AICA_THREAD_QUEUE_SIZE] = nanosecs;
+    aica_thread_nanosecs += nanosecs;
+    aica_thread_count++;
+    pthread_cond_signal( &aica_thread_work_cond );
+    pthread_mutex_unlock( &aica_thread_mutex );
+
+    if( aica_thread_stop_requested ) {
+        aica_thread_stop_requested = FALSE;
+        dreamcast_stop();
+    }
     return nanosecs;
 }
 
 void aica_stop( void )
 {
+    aica_sync();
     audio_stop_driver();
 }
 
 void aica_save_state( FILE *f )
 {
+    aica_sync();
     fwrite( &aica_state, sizeof(struct aica_state_struct), 1, f );
     arm_save_state( f );
     audio_save_state(f);
@@ -127,6 +263,7 @@ void aica_save_state( FILE *f )
 
 int aica_load_state( FILE *f )
 {
+    aica_sync();
     fread( &aica_state, sizeof(struct aica_state_struct), 1, f );
     arm_load_state( f );
     return audio_load_state(f);
@@ -196,9 +333,25 @@ void aica_enable( void )
  * 30
  */
 
+/* Note: the ARM also reaches the registers through these functions, in which
+ * case aica_sync() returns immediately */
+
+MMIO_REGION_READ_FN( AICA0, reg )
+{
+    aica_sync();
+    return MMIO_READ( AICA0, reg&0xFFF );
+}
+
+MMIO_REGION_READ_FN( AICA1, reg )
+{
+    aica_sync();
+    return MMIO_READ( AICA1, reg&0xFFF );
+}
+
 /* Write to channels 0-31 */
 MMIO_REGION_WRITE_FN( AICA0, reg, val )
 {
+    aica_sync();
     reg &= 0xFFF;
     MMIO_WRITE( AICA0, reg, val );
     aica_write_channel( reg >> 7, reg % 128, val );
@@ -208,6 +361,7 @@ MMIO_REGION_WRITE_FN( AICA0, reg, val )
 /* Write to channels 32-64 */
 MMIO_REGION_WRITE_FN( AICA1, reg, val )
 {
+    aica_sync();
     reg &= 0xFFF;
     MMIO_WRITE( AICA1, reg, val );
     aica_write_channel( (reg >> 7) + 32, reg % 128, val );
@@ -220,6 +374,7 @@ MMIO_REGION_WRITE_FN( AICA1, reg, val )
 MMIO_REGION_WRITE_FN( AICA2, reg, val )
 {
     uint32_t tmp;
+    aica_sync();
     reg &= 0xFFF;
     
     switch( reg ) {
@@ -252,6 +407,7 @@ MMIO_REGION_READ_FN( AICA2, reg )
     audio_channel_t channel;
     uint32_t channo;
     int32_t val;
+    aica_sync();
     reg &= 0xFFF;
     switch( reg ) {
     case AICA_CHANSTATE:
@@ -276,6 +432,7 @@ MMIO_REGION_READ_FN( AICA2, reg )
 MMIO_REGION_READ_FN( AICARTC, reg )
 {
     int32_t rv = 0;
+    aica_sync();
     reg &= 0xFFF;
     switch( reg ) {
     case AICA_RTCHI:
@@ -291,6 +448,7 @@ MMIO_REGION_READ_FN( AICARTC, reg )
 
 MMIO_REGION_WRITE_FN( AICARTC, reg, val )
 {
+    aica_sync();
     reg &= 0xFFF;
     switch( reg ) {
     case AICA_RTCEN:
@@ -71,6 +71,28 @@ void aica_enable( void );
 void aica_event( int event );
 void aica_write_channel( int channel, uint32_t addr, uint32_t val );
 
+/**
+ * Run the AICA on its own thread, allowing it to fall up to the given number
+ * of nanoseconds of emulated time behind the SH4 (at least one timeslice is
+ * always allowed). 0 runs it in lockstep with the SH4 on the same thread.
+ * Also set from LXDREAM_AICA_LAG (in microseconds) at startup.
+ */
+void aica_set_max_lag( uint32_t nanosecs );
+uint32_t aica_get_max_lag( void );
+
+/**
+ * Wait for the AICA thread to catch up with the SH4. Must be called before
+ * the SH4 side touches any AICA state, and does nothing when running in
+ * lockstep (or when called from the AICA thread itself).
+ */
+void aica_sync( void );
+
+/**
+ * Stop the system from ARM code (eg at a breakpoint). On the AICA thread, the
+ * stop is deferred to the next timeslice.
+ */
+void aica_request_stop( void );
+
 extern unsigned char aica_main_ram[];
 extern unsigned char aica_scratch_ram[];
 
@@ -23,12 +23,14 @@
 #include "mem.h"
 #include "aica/armcore.h"
 #include "aica/aica.h"
+#include "aica/armxlat.h"
 
 #define STM_R15_OFFSET 12
 
 struct arm_registers armr;
 
 void arm_set_mode( int mode );
+static void arm_check_interrupt( void );
 
 uint32_t arm_exceptions[][2] = {{ MODE_SVC, 0x00000000 },
         { MODE_UND, 0x00000004 },
@@ -89,6 +91,10 @@ int arm_get_breakpoint( uint32_t pc )
     return 0;
 }
 
+/* Instructions run past the end of the previous sample by a translated block,
+ * which are taken out of the current sample */
+static uint32_t arm_sample_overrun = 0;
+
 uint32_t arm_run_slice( uint32_t num_samples )
 {
     int i,j,k;
@@ -97,14 +103,31 @@ uint32_t arm_run_slice( uint32_t num_samples )
         return num_samples;
 
     for( i=0; i<num_samples; i++ ) {
-        for( j=0; j < CYCLES_PER_SAMPLE; j++ ) {
+        for( j=arm_sample_overrun; j < CYCLES_PER_SAMPLE; j++ ) {
+#ifdef ARM_TRANSLATOR
+            /* As with the SH4 translator, blocks only check the time on entry
+             * and may overrun the sample slightly */
+            if( arm_xlat_is_enabled() && arm_breakpoint_count == 0 ) {
+                arm_check_interrupt();
+                int count = arm_xlat_execute_block();
+                if( count < 0 ) {
+                    arm_sample_overrun = 0;
+                    return i;
+                } else if( count > 0 ) {
+                    j += count - 1;
+                    continue;
+                }
+            }
+#endif
             armr.icount++;
-            if( !arm_execute_instruction() )
+            if( !arm_execute_instruction() ) {
+                arm_sample_overrun = 0;
                 return i;
+            }
 #ifdef ENABLE_DEBUG_MODE
             for( k=0; k<arm_breakpoint_count; k++ ) {
                 if( arm_breakpoints[k].address == armr.r[15] ) {
-                    dreamcast_stop();
+                    aica_request_stop();
                     if( arm_breakpoints[k].type == BREAK_ONESHOT )
                         arm_clear_breakpoint( armr.r[15], BREAK_ONESHOT );
                     return i;
@@ -112,6 +135,7 @@ uint32_t arm_run_slice( uint32_t num_samples )
             }
 #endif	
         }
+        arm_sample_overrun = j - CYCLES_PER_SAMPLE;
 
         k = MMIO_READ( AICA2, AICA_TCR );
         uint8_t val = MMIO_READ( AICA2, AICA_TIMER );
@@ -136,6 +160,8 @@ void arm_save_state( FILE *f )
 int arm_load_state( FILE *f )
 {
     fread( &armr, sizeof(armr), 1, f );
+    arm_sample_overrun = 0;
+    arm_xlat_flush();
     return 0;
 }
 
@@ -148,6 +174,8 @@ void arm_reset( void )
     armr.cpsr = MODE_SVC | CPSR_I | CPSR_F;
     armr.r[15] = 0x00000000;
     armr.running = TRUE;
+    arm_sample_overrun = 0;
+    arm_xlat_flush();
 }
 
 #define SET_CPSR_CONTROL   0x00010000
@@ -364,12 +392,12 @@ void arm_set_mode( int targetMode )
 
 /* Page references are as per ARM DDI 0100E (June 2000) */
 
-#define MEM_READ_BYTE( addr ) arm_read_byte(addr)
-#define MEM_READ_WORD( addr ) arm_read_word(addr)
-#define MEM_READ_LONG( addr ) arm_read_long(addr)
-#define MEM_WRITE_BYTE( addr, val ) arm_write_byte(addr, val)
-#define MEM_WRITE_WORD( addr, val ) arm_write_word(addr, val)
-#define MEM_WRITE_LONG( addr, val ) arm_write_long(addr, val)
+#define MEM_READ_BYTE( addr ) arm_mem->read_byte(addr)
+#define MEM_READ_WORD( addr ) arm_mem->read_word(addr)
+#define MEM_READ_LONG( addr ) arm_mem->read_long(addr)
+#define MEM_WRITE_BYTE( addr, val ) arm_mem->write_byte(addr, val)
+#define MEM_WRITE_WORD( addr, val ) arm_mem->write_word(addr, val)
+#define MEM_WRITE_LONG( addr, val ) arm_mem->write_long(addr, val)
 
 
 #define IS_NOTBORROW( result, op1, op2 ) (op2 > op1 ? 0 : 1)
@@ -412,7 +440,7 @@ void arm_set_mode( int targetMode )
 #define SHIFT(ir) ((ir>>4)&0x07)
 #define DISP24(ir) ((ir&0x00FFFFFF))
 #define UNDEF(ir) do{ arm_raise_exception( EXC_UNDEFINED ); return TRUE; } while(0)
-#define UNIMP(ir) do{ PC-=4; ERROR( "Halted on unimplemented instruction at %08x, opcode = %04x", PC, ir ); dreamcast_stop(); return FALSE; }while(0)
+#define UNIMP(ir) do{ PC-=4; ERROR( "Halted on unimplemented instruction at %08x, opcode = %04x", PC, ir ); aica_request_stop(); return FALSE; }while(0)
 
 /**
  * Determine the value of the shift-operand for a data processing instruction,
@@ -757,14 +785,12 @@ static uint32_t arm_get_address3_operand( uint32_t ir )
     return addr;	
 }
 
-gboolean arm_execute_instruction( void ) 
+/**
+ * Take any pending interrupt that isn't masked.
+ */
+static void arm_check_interrupt( void )
 {
-    uint32_t pc;
-    uint32_t ir;
-    uint32_t operand, operand2, tmp, tmp2, cond;
-    int i;
-
-    tmp = armr.int_pending & (~armr.cpsr);
+    uint32_t tmp = armr.int_pending & (~armr.cpsr);
     if( tmp ) {
         if( tmp & CPSR_F ) {
             arm_raise_exception( EXC_FAST_IRQ );
@@ -772,10 +798,30 @@ gboolean arm_execute_instruction( void )
             arm_raise_exception( EXC_IRQ );
         }
     }
+}
 
-    ir = MEM_READ_LONG(PC);
-    pc = PC + 4;
-    PC = pc;
+gboolean arm_execute_instruction( void ) 
+{
+    uint32_t ir;
+
+    arm_check_interrupt();
+
+    /* Instruction fetches bypass arm_mem */
+    ir = arm_read_long(PC);
+    PC += 4;
+    return arm_execute_opcode( ir );
+}
+
+/**
+ * Execute a single instruction that has already been fetched, ie with PC
+ * pointing to the following instruction. This is also used by the translator
+ * for any instruction it doesn't handle itself.
+ */
+gboolean arm_execute_opcode( uint32_t ir )
+{
+    uint32_t pc = PC;
+    uint32_t operand, operand2, tmp, tmp2, cond;
+    int i;
 
     /** 
      * Check the condition bits first - if the condition fails return 
@@ -904,7 +950,7 @@ gboolean arm_execute_instruction( void )
                         UNIMP(ir);
                         break;
                     case 16: /* SWP */
-                        tmp = arm_read_long( RN(ir) );
+                        tmp = MEM_READ_LONG( RN(ir) );
                         switch( RN(ir) & 0x03 ) {
                         case 1:
                             tmp = ROTATE_RIGHT_LONG(tmp, 8);
@@ -916,12 +962,12 @@ gboolean arm_execute_instruction( void )
                             tmp = ROTATE_RIGHT_LONG(tmp, 24);
                             break;
                         }
-                        arm_write_long( RN(ir), RM(ir) );
+                        MEM_WRITE_LONG( RN(ir), RM(ir) );
                         LRD(ir) = tmp;
                         break;
                         case 20: /* SWPB */
-                            tmp = arm_read_byte( RN(ir) );
-                            arm_write_byte( RN(ir), RM(ir) );
+                            tmp = MEM_READ_BYTE( RN(ir) );
+                            MEM_WRITE_BYTE( RN(ir), RM(ir) );
                             LRD(ir) = tmp;
                             break;
                         default:
@@ -1192,10 +1238,10 @@ gboolean arm_execute_instruction( void )
             operand = arm_get_address_operand(ir);
             switch( (ir>>20)&0x17 ) {
             case 0: case 16: case 18: /* STR Rd, address */
-                arm_write_long( operand, RD(ir) );
+                MEM_WRITE_LONG( operand, RD(ir) );
                 break;
             case 1: case 17: case 19: /* LDR Rd, address */
-                LRD(ir) = arm_read_long(operand);
+                LRD(ir) = MEM_READ_LONG( operand);
                 break;
             case 2: /* STRT Rd, address */
                 arm_write_long_user( operand, RD(ir) );
@@ -1204,10 +1250,10 @@ gboolean arm_execute_instruction( void )
                 LRD(ir) = arm_read_long_user( operand );
                 break;
             case 4: case 20: case 22: /* STRB Rd, address */
-                arm_write_byte( operand, RD(ir) );
+                MEM_WRITE_BYTE( operand, RD(ir) );
                 break;
             case 5: case 21: case 23: /* LDRB Rd, address */
-                LRD(ir) = arm_read_byte( operand );
+                LRD(ir) = MEM_READ_BYTE( operand );
                 break;
             case 6: /* STRBT Rd, address */
                 arm_write_byte_user( operand, RD(ir) );
@@ -1231,12 +1277,12 @@ gboolean arm_execute_instruction( void )
                     switch( (ir & 0x01D00000) >> 20 ) {
                     case 0: /* STMDA */
                         if( ir & 0x8000 ) {
-                            arm_write_long( operand, armr.r[15]+8 );
+                            MEM_WRITE_LONG( operand, armr.r[15]+8 );
                             operand -= 4;
                         }
                         for( i=14; i>= 0; i-- ) {
                             if( (ir & (1<<i)) ) {
-                                arm_write_long( operand, armr.r[i] );
+                                MEM_WRITE_LONG( operand, armr.r[i] );
                                 operand -= 4;
                             }
                         }
@@ -1244,19 +1290,19 @@ gboolean arm_execute_instruction( void )
                     case 1: /* LDMDA */
                         for( i=15; i>= 0; i-- ) {
                             if( (ir & (1<<i)) ) {
-                                armr.r[i] = arm_read_long( operand );
+                                armr.r[i] = MEM_READ_LONG( operand );
                                 operand -= 4;
                             }
                         }
                         break;
                     case 4: /* STMDA (S) */
                         if( ir & 0x8000 ) {
-                            arm_write_long( operand, armr.r[15]+8 );
+                            MEM_WRITE_LONG( operand, armr.r[15]+8 );
                             operand -= 4;
                         }
                         for( i=14; i>= 0; i-- ) {
                             if( (ir & (1<<i)) ) {
-                                arm_write_long( operand, USER_R(i) );
+                                MEM_WRITE_LONG( operand, USER_R(i) );
                                 operand -= 4;
                             }
                         }
@@ -1265,7 +1311,7 @@ gboolean arm_execute_instruction( void )
                         if( (ir&0x00008000) ) { /* Load PC */
                             for( i=15; i>= 0; i-- ) {
                                 if( (ir & (1<<i)) ) {
-                                    armr.r[i] = arm_read_long( operand );
+                                    armr.r[i] = MEM_READ_LONG( operand );
                                     operand -= 4;
                                 }
                             }
@@ -1273,7 +1319,7 @@ gboolean arm_execute_instruction( void )
                         } else {
                             for( i=15; i>= 0; i-- ) {
                                 if( (ir & (1<<i)) ) {
-                                    USER_R(i) = arm_read_long( operand );
+                                    USER_R(i) = MEM_READ_LONG( operand );
                                     operand -= 4;
                                 }
                             }
@@ -1282,19 +1328,19 @@ gboolean arm_execute_instruction( void )
                     case 8: /* STMIA */
                         for( i=0; i< 15; i++ ) {
                             if( (ir & (1<<i)) ) {
-                                arm_write_long( operand, armr.r[i] );
+                                MEM_WRITE_LONG( operand, armr.r[i] );
                                 operand += 4;
                             }
                         }
                         if( ir & 0x8000 ) {
-                            arm_write_long( operand, armr.r[15]+8 );
+                            MEM_WRITE_LONG( operand, armr.r[15]+8 );
                             operand += 4;
                         }
                         break;
                     case 9: /* LDMIA */
                         for( i=0; i< 16; i++ ) {
                             if( (ir & (1<<i)) ) {
-                                armr.r[i] = arm_read_long( operand );
+                                armr.r[i] = MEM_READ_LONG( operand );
                                 operand += 4;
                             }
                         }
@@ -1302,12 +1348,12 @@ gboolean arm_execute_instruction( void )
                     case 12: /* STMIA (S) */
                         for( i=0; i< 15; i++ ) {
                             if( (ir & (1<<i)) ) {
-                                arm_write_long( operand, USER_R(i) );
+                                MEM_WRITE_LONG( operand, USER_R(i) );
                                 operand += 4;
                             }
                         }
                         if( ir & 0x8000 ) {
-                            arm_write_long( operand, armr.r[15]+8 );
+                            MEM_WRITE_LONG( operand, armr.r[15]+8 );
                             operand += 4;
                         }
                         break;
@@ -1315,7 +1361,7 @@ gboolean arm_execute_instruction( void )
                         if( (ir&0x00008000) ) { /* Load PC */
                             for( i=0; i < 16; i++ ) {
                                 if( (ir & (1<<i)) ) {
-                                    armr.r[i] = arm_read_long( operand );
+                                    armr.r[i] = MEM_READ_LONG( operand );
                                     operand += 4;
                                 }
                             }
@@ -1323,7 +1369,7 @@ gboolean arm_execute_instruction( void )
                         } else {
                             for( i=0; i < 16; i++ ) {
                                 if( (ir & (1<<i)) ) {
-                                    USER_R(i) = arm_read_long( operand );
+                                    USER_R(i) = MEM_READ_LONG( operand );
                                     operand += 4;
                                 }
                             }
@@ -1332,12 +1378,12 @@ gboolean arm_execute_instruction( void )
                     case 16: /* STMDB */
                         if( ir & 0x8000 ) {
                             operand -= 4;
-                            arm_write_long( operand, armr.r[15]+8 );
+                            MEM_WRITE_LONG( operand, armr.r[15]+8 );
                         }
                         for( i=14; i>= 0; i-- ) {
                             if( (ir & (1<<i)) ) {
                                 operand -= 4;
-                                arm_write_long( operand, armr.r[i] );
+                                MEM_WRITE_LONG( operand, armr.r[i] );
                             }
                         }
                         break;
@@ -1345,19 +1391,19 @@ gboolean arm_execute_instruction( void )
                         for( i=15; i>= 0; i-- ) {
                             if( (ir & (1<<i)) ) {
                                 operand -= 4;
-                                armr.r[i] = arm_read_long( operand );
+                                armr.r[i] = MEM_READ_LONG( operand );
                             }
                         }
                         break;
                     case 20: /* STMDB (S) */
                         if( ir & 0x8000 ) {
                             operand -= 4;
-                            arm_write_long( operand, armr.r[15]+8 );
+                            MEM_WRITE_LONG( operand, armr.r[15]+8 );
                         }
                         for( i=14; i>= 0; i-- ) {
                             if( (ir & (1<<i)) ) {
                                 operand -= 4;
-                                arm_write_long( operand, USER_R(i) );
+                                MEM_WRITE_LONG( operand, USER_R(i) );
                             }
                         }
                         break;
@@ -1366,7 +1412,7 @@ gboolean arm_execute_instruction( void )
                             for( i=15; i>= 0; i-- ) {
                                 if( (ir & (1<<i)) ) {
                                     operand -= 4;
-                                    armr.r[i] = arm_read_long( operand );
+                                    armr.r[i] = MEM_READ_LONG( operand );
                                 }
                             }
                             needRestore = TRUE;
@@ -1374,7 +1420,7 @@ gboolean arm_execute_instruction( void )
                             for( i=15; i>= 0; i-- ) {
                                 if( (ir & (1<<i)) ) {
                                     operand -= 4;
-                                    USER_R(i) = arm_read_long( operand );
+                                    USER_R(i) = MEM_READ_LONG( operand );
                                 }
                             }
                         }
@@ -1383,19 +1429,19 @@ gboolean arm_execute_instruction( void )
                         for( i=0; i< 15; i++ ) {
                             if( (ir & (1<<i)) ) {
                                 operand += 4;
-                                arm_write_long( operand, armr.r[i] );
+                                MEM_WRITE_LONG( operand, armr.r[i] );
                             }
                         }
                         if( ir & 0x8000 ) {
                             operand += 4;
-                            arm_write_long( operand, armr.r[15]+8 );
+                            MEM_WRITE_LONG( operand, armr.r[15]+8 );
                         }
                         break;
                     case 25: /* LDMIB */
                         for( i=0; i< 16; i++ ) {
                             if( (ir & (1<<i)) ) {
                                 operand += 4;
-                                armr.r[i] = arm_read_long( operand );
+                                armr.r[i] = MEM_READ_LONG( operand );
                             }
                         }
                         break;
@@ -1403,12 +1449,12 @@ gboolean arm_execute_instruction( void )
                         for( i=0; i< 15; i++ ) {
                             if( (ir & (1<<i)) ) {
                                 operand += 4;
-                                arm_write_long( operand, USER_R(i) );
+                                MEM_WRITE_LONG( operand, USER_R(i) );
                             }
                         }
                         if( ir & 0x8000 ) {
                             operand += 4;
-                            arm_write_long( operand, armr.r[15]+8 );
+                            MEM_WRITE_LONG( operand, armr.r[15]+8 );
                         }
                         break;
                     case 29: /* LDMIB (S) */
@@ -1416,7 +1462,7 @@ gboolean arm_execute_instruction( void )
                             for( i=0; i < 16; i++ ) {
                                 if( (ir & (1<<i)) ) {
                                     operand += 4;
-                                    armr.r[i] = arm_read_long( operand );
+                                    armr.r[i] = MEM_READ_LONG( operand );
                                 }
                             }
                             needRestore = TRUE;
@@ -1424,7 +1470,7 @@ gboolean arm_execute_instruction( void )
                             for( i=0; i < 16; i++ ) {
                                 if( (ir & (1<<i)) ) {
                                     operand += 4;
-                                    USER_R(i) = arm_read_long( operand );
+                                    USER_R(i) = MEM_READ_LONG( operand );
                                 }
                             }
                         }
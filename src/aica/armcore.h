@@ -92,10 +92,28 @@ uint32_t arm_run_slice( uint32_t nanosecs );
 void arm_save_state( FILE *f );
 int arm_load_state( FILE *f );
 gboolean arm_execute_instruction( void );
+gboolean arm_execute_opcode( uint32_t ir );
 void arm_set_breakpoint( uint32_t pc, breakpoint_type_t type );
 gboolean arm_clear_breakpoint( uint32_t pc, breakpoint_type_t type );
 int arm_get_breakpoint( uint32_t pc );
 
+/**
+ * Data memory accesses made by the ARM core (but not instruction fetches).
+ * Normally these are the arm_read_* / arm_write_* functions below, but the
+ * translator's shadow mode substitutes its own logging and checking versions.
+ */
+struct arm_mem_functions {
+    uint32_t (*read_long)( uint32_t addr );
+    uint32_t (*read_word)( uint32_t addr );
+    uint32_t (*read_byte)( uint32_t addr );
+    void (*write_long)( uint32_t addr, uint32_t val );
+    void (*write_word)( uint32_t addr, uint32_t val );
+    void (*write_byte)( uint32_t addr, uint32_t val );
+};
+
+extern struct arm_mem_functions arm_mem_default;
+extern struct arm_mem_functions *arm_mem;
+
 /* ARM Memory */
 uint32_t arm_read_long( uint32_t addr );
 uint32_t arm_read_word( uint32_t addr );
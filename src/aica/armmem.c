@@ -22,45 +22,60 @@
 #include "aica.h"
 #include "asic.h"
 #include "armcore.h"
+#include "armxlat.h"
 
 unsigned char aica_main_ram[2 MB];
 unsigned char aica_scratch_ram[8 KB];
 
 /*************** ARM memory access function blocks **************/
+/* These are the SH4's view of the AICA memory, so must sync with the AICA
+ * thread first */
 
 static int32_t FASTCALL ext_audioram_read_long( sh4addr_t addr )
 {
+    aica_sync();
     return *((int32_t *)(aica_main_ram + (addr&0x001FFFFF)));
 }
 static int32_t FASTCALL ext_audioram_read_word( sh4addr_t addr )
 {
+    aica_sync();
     return SIGNEXT16(*((int16_t *)(aica_main_ram + (addr&0x001FFFFF))));
 }
 static int32_t FASTCALL ext_audioram_read_byte( sh4addr_t addr )
 {
+    aica_sync();
     return SIGNEXT8(*((int16_t *)(aica_main_ram + (addr&0x001FFFFF))));
 }
 static void FASTCALL ext_audioram_write_long( sh4addr_t addr, uint32_t val )
 {
+    aica_sync();
+    arm_xlat_invalidate( addr&0x001FFFFF, 4 );
     *(uint32_t *)(aica_main_ram + (addr&0x001FFFFF)) = val;
     asic_g2_write_word();
 }
 static void FASTCALL ext_audioram_write_word( sh4addr_t addr, uint32_t val )
 {
+    aica_sync();
+    arm_xlat_invalidate( addr&0x001FFFFF, 2 );
     *(uint16_t *)(aica_main_ram + (addr&0x001FFFFF)) = (uint16_t)val;
     asic_g2_write_word();
 }
 static void FASTCALL ext_audioram_write_byte( sh4addr_t addr, uint32_t val )
 {
+    aica_sync();
+    arm_xlat_invalidate( addr&0x001FFFFF, 1 );
     *(uint8_t *)(aica_main_ram + (addr&0x001FFFFF)) = (uint8_t)val;
     asic_g2_write_word();
 }
 static void FASTCALL ext_audioram_read_burst( unsigned char *dest, sh4addr_t addr )
 {
+    aica_sync();
     memcpy( dest, aica_main_ram+(addr&0x001FFFFF), 32 );
 }
 static void FASTCALL ext_audioram_write_burst( sh4addr_t addr, unsigned char *src )
 {
+    aica_sync();
+    arm_xlat_invalidate( addr&0x001FFFFF, 32 );
     memcpy( aica_main_ram+(addr&0x001FFFFF), src, 32 );
 }
 
@@ -72,37 +87,45 @@ struct mem_region_fn mem_region_audioram = { ext_audioram_read_long, ext_audiora
 
 static int32_t FASTCALL ext_audioscratch_read_long( sh4addr_t addr )
 {
+    aica_sync();
     return *((int32_t *)(aica_scratch_ram + (addr&0x00001FFF)));
 }
 static int32_t FASTCALL ext_audioscratch_read_word( sh4addr_t addr )
 {
+    aica_sync();
     return SIGNEXT16(*((int16_t *)(aica_scratch_ram + (addr&0x00001FFF))));
 }
 static int32_t FASTCALL ext_audioscratch_read_byte( sh4addr_t addr )
 {
+    aica_sync();
     return SIGNEXT8(*((int16_t *)(aica_scratch_ram + (addr&0x00001FFF))));
 }
 static void FASTCALL ext_audioscratch_write_long( sh4addr_t addr, uint32_t val )
 {
+    aica_sync();
     *(uint32_t *)(aica_scratch_ram + (addr&0x00001FFF)) = val;
     asic_g2_write_word();
 }
 static void FASTCALL ext_audioscratch_write_word( sh4addr_t addr, uint32_t val )
 {
+    aica_sync();
     *(uint16_t *)(aica_scratch_ram + (addr&0x00001FFF)) = (uint16_t)val;
     asic_g2_write_word();
 }
 static void FASTCALL ext_audioscratch_write_byte( sh4addr_t addr, uint32_t val )
 {
+    aica_sync();
     *(uint8_t *)(aica_scratch_ram + (addr&0x00001FFF)) = (uint8_t)val;
     asic_g2_write_word();
 }
 static void FASTCALL ext_audioscratch_read_burst( unsigned char *dest, sh4addr_t addr )
 {
+    aica_sync();
     memcpy( dest, aica_scratch_ram+(addr&0x00001FFF), 32 );
 }
 static void FASTCALL ext_audioscratch_write_burst( sh4addr_t addr, unsigned char *src )
 {
+    aica_sync();
     memcpy( aica_scratch_ram+(addr&0x00001FFF), src, 32 );
 }
 
@@ -159,6 +182,7 @@ void arm_write_long( uint32_t addr, uint32_t value )
 {
     if( addr < 0x00200000 ) {
         /* Main sound ram */
+        arm_xlat_invalidate( addr, 4 );
         *(uint32_t *)(aica_main_ram + addr) = value;
     } else {
         switch( addr & 0xFFFFF000 ) {
@@ -205,6 +229,7 @@ uint32_t arm_combine_byte( uint32_t addr, uint32_t val, uint8_t byte )
 void arm_write_word( uint32_t addr, uint32_t value )
 {
 	if( addr < 0x00200000 ) {
+        arm_xlat_invalidate( addr, 2 );
         *(uint16_t *)(aica_main_ram + addr) = (uint16_t)value;
 	} else {
 		
@@ -214,6 +239,7 @@ void arm_write_byte( uint32_t addr, uint32_t value )
 {
     if( addr < 0x00200000 ) {
         /* Main sound ram */
+        arm_xlat_invalidate( addr, 1 );
         *(uint8_t *)(aica_main_ram + addr) = (uint8_t)value;
     } else {
         uint32_t tmp;
@@ -246,6 +272,11 @@ void arm_write_byte( uint32_t addr, uint32_t value )
     return;
 }
 
+struct arm_mem_functions arm_mem_default = { arm_read_long, arm_read_word, arm_read_byte,
+        arm_write_long, arm_write_word, arm_write_byte };
+
+struct arm_mem_functions *arm_mem = &arm_mem_default;
+
 /* User translations - TODO */
 
 uint32_t arm_read_long_user( uint32_t addr ) {
@@ -282,6 +313,7 @@ size_t arm_write_phys( uint32_t addr, unsigned char *buf, size_t length ) {
         if( addr+length > sizeof(aica_main_ram) ) {
             length = sizeof(aica_main_ram) - addr;
         }
+        arm_xlat_invalidate_range( addr, length );
         memcpy( &aica_main_ram[addr], buf, length );
         return length;
     } else {
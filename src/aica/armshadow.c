@@ -0,0 +1,281 @@
+/**
+ * $Id$
+ *
+ * ARM shadow execution - runs each translated block and then the interpreter
+ * over the same instructions, and checks that the results are the same.
+ *
+ * The block runs first, against the real memory, with every data access
+ * logged. The registers are then put back as they were, and the interpreter
+ * runs the same number of instructions with reads answered from the log and
+ * writes checked against it (but not performed). Instruction fetches aren't
+ * logged, as they don't go through arm_mem; instead the interpreter is given
+ * the block's instructions as they were before the block ran, in case it
+ * modified them.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "dream.h"
+#include "aica/armcore.h"
+#include "aica/armxlat.h"
+
+#ifdef ARM_TRANSLATOR
+
+typedef enum {
+    READ_LONG,
+    WRITE_LONG,
+    READ_WORD,
+    WRITE_WORD,
+    READ_BYTE,
+    WRITE_BYTE
+} MemOp;
+
+static char *memOpNames[] = { "read_long", "write_long", "read_word", "write_word",
+        "read_byte", "write_byte" };
+
+struct mem_log_entry {
+    MemOp op;
+    uint32_t addr;
+    uint32_t value;
+};
+
+#define MEM_LOG_SIZE 4096
+static struct mem_log_entry *mem_log = NULL;
+static uint32_t mem_log_posn, mem_log_size;
+static uint32_t mem_check_posn;
+
+static void log_mem_op( MemOp op, uint32_t addr, uint32_t value )
+{
+    if( mem_log_posn == mem_log_size ) {
+        struct mem_log_entry *tmp = realloc(mem_log, mem_log_size * sizeof(struct mem_log_entry) * 2);
+        assert( tmp != NULL );
+        mem_log_size *= 2;
+        mem_log = tmp;
+    }
+    mem_log[mem_log_posn].op = op;
+    mem_log[mem_log_posn].addr = addr;
+    mem_log[mem_log_posn].value = value;
+    mem_log_posn++;
+}
+
+static void print_mem_op( FILE *f, MemOp op, uint32_t addr, uint32_t value )
+{
+    if( op == WRITE_LONG || op == WRITE_WORD || op == WRITE_BYTE ) {
+        fprintf( f, "%s( %08X, %08X )\n", memOpNames[op], addr, value );
+    } else {
+        fprintf( f, "%s( %08X )\n", memOpNames[op], addr );
+    }
+}
+
+static uint32_t check_mem_op( MemOp op, uint32_t addr, uint32_t value )
+{
+    if( mem_check_posn >= mem_log_posn ) {
+        fprintf( stderr, "Unexpected interpreter memory operation: " );
+        print_mem_op(stderr, op, addr, value );
+        abort();
+    }
+    if( mem_log[mem_check_posn].op != op ||
+        mem_log[mem_check_posn].addr != addr ||
+        (( op == WRITE_LONG || op == WRITE_WORD || op == WRITE_BYTE ) &&
+           mem_log[mem_check_posn].value != value ) ) {
+        fprintf(stderr, "Memory operation mismatch. Translator: " );
+        print_mem_op(stderr, mem_log[mem_check_posn].op,
+                mem_log[mem_check_posn].addr, mem_log[mem_check_posn].value );
+        fprintf(stderr, "Emulator: ");
+        print_mem_op(stderr, op, addr, value );
+        abort();
+    }
+    return mem_log[mem_check_posn++].value;
+}
+
+static uint32_t log_read_long( uint32_t addr )
+{
+    uint32_t rv = arm_read_long(addr);
+    log_mem_op( READ_LONG, addr, rv );
+    return rv;
+}
+
+static uint32_t log_read_word( uint32_t addr )
+{
+    uint32_t rv = arm_read_word(addr);
+    log_mem_op( READ_WORD, addr, rv );
+    return rv;
+}
+
+static uint32_t log_read_byte( uint32_t addr )
+{
+    uint32_t rv = arm_read_byte(addr);
+    log_mem_op( READ_BYTE, addr, rv );
+    return rv;
+}
+
+static void log_write_long( uint32_t addr, uint32_t val )
+{
+    arm_write_long(addr, val);
+    log_mem_op( WRITE_LONG, addr, val );
+}
+
+static void log_write_word( uint32_t addr, uint32_t val )
+{
+    arm_write_word(addr, val);
+    log_mem_op( WRITE_WORD, addr, val );
+}
+
+static void log_write_byte( uint32_t addr, uint32_t val )
+{
+    arm_write_byte(addr, val);
+    log_mem_op( WRITE_BYTE, addr, val );
+}
+
+static uint32_t check_read_long( uint32_t addr )
+{
+    return check_mem_op( READ_LONG, addr, 0 );
+}
+
+static uint32_t check_read_word( uint32_t addr )
+{
+    return check_mem_op( READ_WORD, addr, 0 );
+}
+
+static uint32_t check_read_byte( uint32_t addr )
+{
+    return check_mem_op( READ_BYTE, addr, 0 );
+}
+
+static void check_write_long( uint32_t addr, uint32_t val )
+{
+    check_mem_op( WRITE_LONG, addr, val );
+}
+
+static void check_write_word( uint32_t addr, uint32_t val )
+{
+    check_mem_op( WRITE_WORD, addr, val );
+}
+
+static void check_write_byte( uint32_t addr, uint32_t val )
+{
+    check_mem_op( WRITE_BYTE, addr, val );
+}
+
+static struct arm_mem_functions log_fns = { log_read_long, log_read_word, log_read_byte,
+        log_write_long, log_write_word, log_write_byte };
+static struct arm_mem_functions check_fns = { check_read_long, check_read_word, check_read_byte,
+        check_write_long, check_write_word, check_write_byte };
+
+#define CHECK_REG(sym, name) if( xarmr->sym != earmr->sym ) { \
+    isgood = FALSE; fprintf( stderr, name "  Xlt = %08X, Emu = %08X\n", xarmr->sym, earmr->sym ); }
+
+#define CHECK_BANK(bank, name, count) for( unsigned i=0; i<count; i++ ) { \
+    if( xarmr->bank[i] != earmr->bank[i] ) { \
+        isgood = FALSE; \
+        fprintf( stderr, name "[%d]  Xlt = %08X, Emu = %08X\n", i, xarmr->bank[i], earmr->bank[i] ); } }
+
+/**
+ * Compare everything but shift_c (scratch space within an instruction) and
+ * icount (maintained outside both cores).
+ */
+static gboolean check_registers( struct arm_registers *xarmr, struct arm_registers *earmr )
+{
+    gboolean isgood = TRUE;
+    for( unsigned i=0; i<16; i++ ) {
+        if( xarmr->r[i] != earmr->r[i] ) {
+            isgood = FALSE;
+            fprintf( stderr, "R%d  Xlt = %08X, Emu = %08X\n", i, xarmr->r[i], earmr->r[i] );
+        }
+    }
+    CHECK_REG(cpsr, "CPSR");
+    CHECK_REG(spsr, "SPSR");
+    CHECK_BANK(user_r, "USER_R", 7);
+    CHECK_BANK(svc_r, "SVC_R", 3);
+    CHECK_BANK(abt_r, "ABT_R", 3);
+    CHECK_BANK(und_r, "UND_R", 3);
+    CHECK_BANK(irq_r, "IRQ_R", 3);
+    CHECK_BANK(fiq_r, "FIQ_R", 8);
+    CHECK_REG(c, "C");
+    CHECK_REG(n, "N");
+    CHECK_REG(z, "Z");
+    CHECK_REG(v, "V");
+    CHECK_REG(t, "T");
+    CHECK_REG(int_pending, "INT_PENDING");
+    CHECK_REG(running, "RUNNING");
+    return isgood;
+}
+
+int arm_shadow_execute_block( arm_xlat_code_t code, uint32_t startpc )
+{
+    struct arm_registers start_armr, xlt_armr;
+    struct arm_mem_functions *real_mem = arm_mem;
+    uint32_t code_copy[ARM_XLAT_MAX_BLOCK_INSTRUCTIONS];
+    int result, count, i;
+    gboolean halted = FALSE;
+
+    if( mem_log == NULL ) {
+        mem_log_size = MEM_LOG_SIZE;
+        mem_log = malloc( mem_log_size * sizeof(struct mem_log_entry) );
+        assert( mem_log != NULL );
+    }
+
+    for( i=0; i<ARM_XLAT_MAX_BLOCK_INSTRUCTIONS; i++ ) {
+        code_copy[i] = arm_read_long( startpc + (i<<2) );
+    }
+    memcpy( &start_armr, &armr, sizeof(armr) );
+    mem_log_posn = 0;
+    arm_mem = &log_fns;
+    result = code();
+
+    /* Save the end registers, and restore the state back to the start */
+    memcpy( &xlt_armr, &armr, sizeof(armr) );
+    memcpy( &armr, &start_armr, sizeof(armr) );
+
+    arm_mem = &check_fns;
+    mem_check_posn = 0;
+    count = result < 0 ? -result : result;
+    for( i=0; i<count && !halted; i++ ) {
+        uint32_t pc = armr.r[15];
+        uint32_t ir;
+        if( pc >= startpc && pc < startpc + sizeof(code_copy) && (pc&0x03) == 0 ) {
+            ir = code_copy[(pc - startpc)>>2];
+        } else {
+            ir = arm_read_long( pc );
+        }
+        armr.r[15] = pc + 4;
+        halted = !arm_execute_opcode( ir );
+    }
+    arm_mem = real_mem;
+
+    if( !check_registers( &xlt_armr, &armr ) || halted != (result < 0) || i != count ) {
+        if( halted != (result < 0) || i != count ) {
+            fprintf( stderr, "Xlt %s after %d instructions, Emu %s after %d\n",
+                     result < 0 ? "halted" : "exited", count, halted ? "halted" : "exited", i );
+        }
+        fprintf( stderr, "After executing block at %08X\n", startpc );
+        fprintf( stderr, "Translated block was:\n" );
+        arm_xlat_dump_block( startpc );
+        abort();
+    }
+    if( mem_check_posn < mem_log_posn ) {
+        fprintf( stderr, "Additional translator memory operations:\n" );
+        while( mem_check_posn < mem_log_posn ) {
+            print_mem_op( stderr, mem_log[mem_check_posn].op, mem_log[mem_check_posn].addr, mem_log[mem_check_posn].value );
+            mem_check_posn++;
+        }
+        abort();
+    }
+    return result;
+}
+
+#endif /* ARM_TRANSLATOR */
@@ -0,0 +1,725 @@
+/**
+ * $Id$
+ *
+ * ARM7 to x86-64 translator.
+ *
+ * Blocks are straight-line runs of up to ARM_XLAT_MAX_BLOCK_INSTRUCTIONS
+ * instructions, never crossing a page of wave RAM. The ARM registers stay in
+ * armr (addressed through RBP) rather than being allocated to host registers,
+ * which keeps every exit from a block trivial: the only state to recover is
+ * the PC and the number of instructions executed, which is returned in EAX
+ * (negated if the ARM halted).
+ *
+ * The common data processing, load/store and branch instructions are
+ * translated directly. Anything else is passed to arm_execute_opcode() in the
+ * interpreter, after which the block is left if the instruction changed the
+ * PC. Conditions, flags, and the order and width of memory accesses are kept
+ * exactly as the interpreter has them, so that the two can be checked against
+ * each other (see armshadow.c).
+ *
+ * The code cache has the same block header as the SH4 translation cache, so
+ * that xlat_disasm_block() works on it, but is a separate arena: the SH4
+ * cache is indexed by SH4 address, and may be in use on the SH4 thread while
+ * the AICA thread is translating.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "dream.h"
+#include "aica/armcore.h"
+#include "aica/armxlat.h"
+#include "aica/armdasm.h"
+#include "xlat/xltcache.h"
+#include "xlat/xlatdasm.h"
+#include "sh4/sh4core.h" /* for sh4r, used by the ABI's SH4 prologue */
+
+#ifdef ARM_TRANSLATOR
+
+/* The emitter writes through xlat_output, which belongs to the SH4
+ * translator, so the ARM translator has its own */
+#define xlat_output arm_xlat_output
+#include "xlat/x86/x86op.h"
+
+unsigned char *arm_xlat_output;
+
+#define ARM_XLAT_CACHE_SIZE (4 MB)
+/* Upper bound on the native code for a single block */
+#define ARM_XLAT_MAX_BLOCK_SIZE (16 KB)
+#define ARM_XLAT_LUT_ENTRIES (ARM_XLAT_PAGE_SIZE>>2)
+
+#define REG_OFFSET(reg) offsetof(struct arm_registers, r[reg])
+#define R_CPSR offsetof(struct arm_registers, cpsr)
+#define R_N offsetof(struct arm_registers, n)
+#define R_Z offsetof(struct arm_registers, z)
+#define R_C offsetof(struct arm_registers, c)
+#define R_V offsetof(struct arm_registers, v)
+#define R_INT_PENDING offsetof(struct arm_registers, int_pending)
+#define MEM_FN(fn) offsetof(struct arm_mem_functions, fn)
+
+#define SIGNEXT24(n) (((n)&0x00800000) ? ((n)|0xFF000000) : ((n)&0x00FFFFFF))
+
+struct arm_xlat_block {
+    uint32_t pc;      /* Address of the first ARM instruction */
+    uint32_t length;  /* Number of ARM instructions */
+    uint8_t *entry;   /* Entry point, after the block's exit code */
+    struct xlat_cache_block xlat;
+};
+
+void **arm_xlat_lut[ARM_XLAT_PAGES];
+
+static gboolean arm_xlat_enabled = FALSE;
+static gboolean arm_xlat_checking = FALSE;
+static uint8_t *arm_xlat_cache = NULL;
+static uint8_t *arm_xlat_cache_ptr = NULL;
+/* Exit code of the block being translated */
+static uint8_t *arm_xlat_exit_ptr;
+
+void arm_xlat_enable( gboolean enable, gboolean checking )
+{
+    if( enable && arm_xlat_cache == NULL ) {
+        arm_xlat_cache = mmap( NULL, ARM_XLAT_CACHE_SIZE, PROT_EXEC|PROT_READ|PROT_WRITE,
+                MAP_PRIVATE|MAP_ANON, -1, 0 );
+        if( arm_xlat_cache == MAP_FAILED ) {
+            WARN( "Unable to allocate the ARM translation cache, using the interpreter" );
+            arm_xlat_cache = NULL;
+            enable = FALSE;
+        }
+        arm_xlat_cache_ptr = arm_xlat_cache;
+    }
+    arm_xlat_enabled = enable;
+    arm_xlat_checking = enable && checking;
+    if( arm_xlat_checking ) {
+        INFO( "ARM translator running in shadow (checking) mode" );
+    }
+}
+
+gboolean arm_xlat_is_enabled( void )
+{
+    return arm_xlat_enabled;
+}
+
+void arm_xlat_flush( void )
+{
+    int i;
+    for( i=0; i<ARM_XLAT_PAGES; i++ ) {
+        if( arm_xlat_lut[i] != NULL ) {
+            free( arm_xlat_lut[i] );
+            arm_xlat_lut[i] = NULL;
+        }
+    }
+    arm_xlat_cache_ptr = arm_xlat_cache;
+}
+
+/**
+ * The code for invalidated blocks is left where it is until the next flush,
+ * so it's safe to invalidate the block that's currently running.
+ */
+void arm_xlat_invalidate_range( uint32_t addr, uint32_t length )
+{
+    uint32_t page, last;
+    if( length == 0 || addr >= ARM_XLAT_RAM_SIZE ) {
+        return;
+    }
+    last = addr + length - 1;
+    if( last >= ARM_XLAT_RAM_SIZE ) {
+        last = ARM_XLAT_RAM_SIZE - 1;
+    }
+    for( page = addr >> ARM_XLAT_PAGE_BITS; page <= (last >> ARM_XLAT_PAGE_BITS); page++ ) {
+        if( arm_xlat_lut[page] != NULL ) {
+            free( arm_xlat_lut[page] );
+            arm_xlat_lut[page] = NULL;
+        }
+    }
+}
+
+/******************************* Code emission ******************************/
+
+static void arm_xlat_call( void *fn )
+{
+    MOVP_immptr_rptr( fn, REG_RAX );
+    CALL_r32( REG_RAX );
+}
+
+/**
+ * Leave the block with the given result in EAX
+ */
+static void arm_xlat_exit( int32_t result )
+{
+    MOVL_imm32_r32( result, REG_EAX );
+    int32_t rel = arm_xlat_exit_ptr - xlat_output;
+    JMP_prerel( rel );
+}
+
+/**
+ * Emit a conditional forward jump.
+ * @return the location of the jump displacement, for arm_xlat_patch
+ */
+static uint8_t *arm_xlat_jcc_forward( int cc )
+{
+    JCC_cc_rel32( cc, 0 );
+    return xlat_output - 4;
+}
+
+/**
+ * Point a forward jump at the current output position.
+ */
+static void arm_xlat_patch( uint8_t *disp )
+{
+    *(int32_t *)disp = xlat_output - (disp + 4);
+}
+
+static void arm_xlat_exit_if( int cc, int32_t result )
+{
+    uint8_t *skip = arm_xlat_jcc_forward( cc ^ 1 );
+    arm_xlat_exit( result );
+    arm_xlat_patch( skip );
+}
+
+/**
+ * Set an ARM flag from an x86 condition, as 0 or 1 like the interpreter.
+ * Doesn't modify the x86 flags.
+ */
+static void arm_xlat_set_flag( int cc, uint32_t offset )
+{
+    MOVL_imm32_rbpdisp( 0, offset );
+    SETCCB_cc_rbpdisp( cc, offset );
+}
+
+/**
+ * Emit a check of the ARM condition code, with jumps (to be patched) for when
+ * it fails. The comparisons use the raw flag values, as the interpreter does.
+ * @return the number of jumps written to fail
+ */
+static int arm_xlat_condition( uint32_t cond, uint8_t **fail )
+{
+    static const uint32_t flags[4] = { R_Z, R_C, R_N, R_V };
+    uint8_t *pass;
+    int count = 0;
+
+    switch( cond ) {
+    case 0: case 2: case 4: case 6: /* EQ, CS, MI, VS */
+        CMPL_imms_rbpdisp( 0, flags[cond>>1] );
+        fail[count++] = arm_xlat_jcc_forward( X86_COND_E );
+        break;
+    case 1: case 3: case 5: case 7: /* NE, CC, PL, VC */
+        CMPL_imms_rbpdisp( 0, flags[cond>>1] );
+        fail[count++] = arm_xlat_jcc_forward( X86_COND_NE );
+        break;
+    case 8: /* HI */
+        CMPL_imms_rbpdisp( 0, R_C );
+        fail[count++] = arm_xlat_jcc_forward( X86_COND_E );
+        CMPL_imms_rbpdisp( 0, R_Z );
+        fail[count++] = arm_xlat_jcc_forward( X86_COND_NE );
+        break;
+    case 9: /* LS */
+        CMPL_imms_rbpdisp( 0, R_C );
+        pass = arm_xlat_jcc_forward( X86_COND_E );
+        CMPL_imms_rbpdisp( 0, R_Z );
+        fail[count++] = arm_xlat_jcc_forward( X86_COND_E );
+        arm_xlat_patch( pass );
+        break;
+    case 10: /* GE */
+        MOVL_rbpdisp_r32( R_N, REG_EAX );
+        CMPL_rbpdisp_r32( R_V, REG_EAX );
+        fail[count++] = arm_xlat_jcc_forward( X86_COND_NE );
+        break;
+    case 11: /* LT */
+        MOVL_rbpdisp_r32( R_N, REG_EAX );
+        CMPL_rbpdisp_r32( R_V, REG_EAX );
+        fail[count++] = arm_xlat_jcc_forward( X86_COND_E );
+        break;
+    case 12: /* GT */
+        CMPL_imms_rbpdisp( 0, R_Z );
+        fail[count++] = arm_xlat_jcc_forward( X86_COND_NE );
+        MOVL_rbpdisp_r32( R_N, REG_EAX );
+        CMPL_rbpdisp_r32( R_V, REG_EAX );
+        fail[count++] = arm_xlat_jcc_forward( X86_COND_NE );
+        break;
+    case 13: /* LE */
+        CMPL_imms_rbpdisp( 0, R_Z );
+        pass = arm_xlat_jcc_forward( X86_COND_NE );
+        MOVL_rbpdisp_r32( R_N, REG_EAX );
+        CMPL_rbpdisp_r32( R_V, REG_EAX );
+        fail[count++] = arm_xlat_jcc_forward( X86_COND_E );
+        arm_xlat_patch( pass );
+        break;
+    }
+    return count;
+}
+
+/**
+ * After a call out of the block, leave it if an interrupt has become pending.
+ */
+static void arm_xlat_check_interrupt( int count )
+{
+    MOVL_rbpdisp_r32( R_CPSR, REG_EAX );
+    NOTL_r32( REG_EAX );
+    ANDL_rbpdisp_r32( R_INT_PENDING, REG_EAX );
+    arm_xlat_exit_if( X86_COND_NE, count );
+}
+
+/**
+ * After a store, leave the block if it's been invalidated.
+ */
+static void arm_xlat_check_page( uint32_t pc, int count )
+{
+    MOVP_immptr_rptr( &arm_xlat_lut[pc>>ARM_XLAT_PAGE_BITS], REG_RAX );
+    MOVP_rptrdisp_rptr( REG_RAX, 0, REG_RAX );
+    TESTP_rptr_rptr( REG_RAX, REG_RAX );
+    arm_xlat_exit_if( X86_COND_E, count );
+}
+
+/**
+ * Load an ARM register, where R15 reads as the instruction address + 8.
+ */
+static void arm_xlat_load_reg( uint32_t pc, int reg, int x86reg )
+{
+    if( reg == 15 ) {
+        MOVL_imm32_r32( pc + 8, x86reg );
+    } else {
+        MOVL_rbpdisp_r32( REG_OFFSET(reg), x86reg );
+    }
+}
+
+/**
+ * @return TRUE if the data processing shifter operand is an immediate, or a
+ * register shifted by an immediate amount that the interpreter treats
+ * normally (ie not the LSR #32, ASR #32 and RRX encodings).
+ */
+static gboolean arm_xlat_operand_supported( uint32_t ir )
+{
+    if( ir & 0x02000000 ) {
+        return TRUE;
+    } else if( ir & 0x00000010 ) {
+        return FALSE; /* Shift by register */
+    } else {
+        return ((ir>>5)&0x03) == 0 || ((ir>>7)&0x1F) != 0;
+    }
+}
+
+/**
+ * @return the shifter carry out for the flag-setting logical operations: -1
+ * if C is left unchanged, 0 or 1 if it's known at translation time, or -2
+ * otherwise.
+ */
+static int arm_xlat_shifter_carry( uint32_t ir )
+{
+    if( ir & 0x02000000 ) {
+        uint32_t rot = (ir>>7)&0x1E;
+        uint32_t imm = ir&0xFF; /* ROTATE_RIGHT_LONG doesn't bracket its arguments */
+        if( rot == 0 ) {
+            return -1;
+        }
+        return ROTATE_RIGHT_LONG(imm, rot) >> 31;
+    } else if( (ir & 0x00000FF0) == 0 ) {
+        return -1; /* Plain Rm */
+    } else {
+        return -2;
+    }
+}
+
+static void arm_xlat_load_operand( uint32_t pc, uint32_t ir, int x86reg )
+{
+    if( ir & 0x02000000 ) {
+        uint32_t rot = (ir>>7)&0x1E;
+        uint32_t imm = ir&0xFF;
+        MOVL_imm32_r32( rot == 0 ? imm : ROTATE_RIGHT_LONG(imm, rot), x86reg );
+    } else {
+        uint32_t shift = (ir>>7)&0x1F;
+        arm_xlat_load_reg( pc, ir&0x0F, x86reg );
+        if( shift != 0 ) {
+            switch( (ir>>5)&0x03 ) {
+            case 0: SHLL_imm_r32( shift, x86reg ); break;
+            case 1: SHRL_imm_r32( shift, x86reg ); break;
+            case 2: SARL_imm_r32( shift, x86reg ); break;
+            case 3: RORL_imm_r32( shift, x86reg ); break;
+            }
+        }
+    }
+}
+
+/**
+ * Data processing instructions, other than ADC/SBC/RSC, the flag-setting
+ * additions (whose overflow the interpreter computes differently), and
+ * anything writing R15.
+ * @return FALSE if the instruction isn't handled
+ */
+static gboolean arm_xlat_data_processing( uint32_t pc, uint32_t ir )
+{
+    int opcode = (ir>>20)&0x1F;
+    int rd = (ir>>12)&0x0F;
+    int carry = -1;
+
+    if( !arm_xlat_operand_supported(ir) ) {
+        return FALSE;
+    }
+    switch( opcode ) {
+    case 0: case 2: case 4: case 6: case 8: case 24: case 26: case 28: case 30:
+    case 5: case 7:
+        if( rd == 15 ) {
+            return FALSE;
+        }
+        break;
+    case 21: /* CMP */
+        break;
+    case 1: case 3: case 25: case 27: case 29: case 31:
+        if( rd == 15 ) {
+            return FALSE;
+        }
+        /* fallthrough */
+    case 17: case 19: /* TST, TEQ */
+        carry = arm_xlat_shifter_carry(ir);
+        if( carry == -2 ) {
+            return FALSE;
+        }
+        break;
+    default:
+        return FALSE;
+    }
+
+    arm_xlat_load_operand( pc, ir, REG_ECX );
+    if( (opcode & 0x1A) != 0x1A ) { /* Everything but MOV and MVN */
+        arm_xlat_load_reg( pc, (ir>>16)&0x0F, REG_EAX );
+    }
+    switch( opcode ) {
+    case 0: case 1: case 17: /* AND, TST */
+        ANDL_r32_r32( REG_ECX, REG_EAX );
+        break;
+    case 2: case 3: case 19: /* EOR, TEQ */
+        XORL_r32_r32( REG_ECX, REG_EAX );
+        break;
+    case 4: case 5: case 21: /* SUB, CMP */
+        SUBL_r32_r32( REG_ECX, REG_EAX );
+        break;
+    case 6: case 7: /* RSB */
+        SUBL_r32_r32( REG_EAX, REG_ECX );
+        MOVL_r32_r32( REG_ECX, REG_EAX );
+        break;
+    case 8: /* ADD */
+        ADDL_r32_r32( REG_ECX, REG_EAX );
+        break;
+    case 24: case 25: /* ORR */
+        ORL_r32_r32( REG_ECX, REG_EAX );
+        break;
+    case 26: case 27: /* MOV */
+        MOVL_r32_r32( REG_ECX, REG_EAX );
+        TESTL_r32_r32( REG_EAX, REG_EAX );
+        break;
+    case 28: case 29: /* BIC */
+        NOTL_r32( REG_ECX );
+        ANDL_r32_r32( REG_ECX, REG_EAX );
+        break;
+    case 30: case 31: /* MVN */
+        NOTL_r32( REG_ECX );
+        MOVL_r32_r32( REG_ECX, REG_EAX );
+        TESTL_r32_r32( REG_EAX, REG_EAX );
+        break;
+    }
+    if( opcode < 16 || opcode > 23 ) {
+        MOVL_r32_rbpdisp( REG_EAX, REG_OFFSET(rd) );
+    }
+    if( ir & 0x00100000 ) {
+        arm_xlat_set_flag( X86_COND_S, R_N );
+        arm_xlat_set_flag( X86_COND_E, R_Z );
+        if( opcode == 5 || opcode == 7 || opcode == 21 ) {
+            arm_xlat_set_flag( X86_COND_AE, R_C );
+            arm_xlat_set_flag( X86_COND_O, R_V );
+        } else if( carry >= 0 ) {
+            MOVL_imm32_rbpdisp( carry, R_C );
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * LDR, STR, LDRB and STRB with an immediate offset.
+ * @return FALSE if the instruction isn't handled
+ */
+static gboolean arm_xlat_load_store( uint32_t pc, uint32_t ir, int count )
+{
+    int rd = (ir>>12)&0x0F;
+    int rn = (ir>>16)&0x0F;
+    uint32_t offset = ir&0xFFF;
+    gboolean pre = (ir & 0x01000000) != 0;
+    gboolean up = (ir & 0x00800000) != 0;
+    gboolean byte = (ir & 0x00400000) != 0;
+    gboolean writeback = (ir & 0x00200000) != 0;
+    gboolean load = (ir & 0x00100000) != 0;
+
+    if( (ir & 0x02000000) || /* Register offset */
+        (!pre && writeback) || /* LDRT/STRT */
+        (load && rd == 15) ||
+        (rn == 15 && (writeback || !pre)) ) {
+        return FALSE;
+    }
+
+    /* Address in EDI, with any base update done before the access and before
+     * reading Rd, as in the interpreter */
+    arm_xlat_load_reg( pc, rn, REG_EDI );
+    if( pre ) {
+        if( offset != 0 ) {
+            if( up ) {
+                ADDL_imms_r32( offset, REG_EDI );
+            } else {
+                SUBL_imms_r32( offset, REG_EDI );
+            }
+            if( writeback ) {
+                MOVL_r32_rbpdisp( REG_EDI, REG_OFFSET(rn) );
+            }
+        }
+    } else if( offset != 0 ) {
+        MOVL_r32_r32( REG_EDI, REG_EAX );
+        if( up ) {
+            ADDL_imms_r32( offset, REG_EAX );
+        } else {
+            SUBL_imms_r32( offset, REG_EAX );
+        }
+        MOVL_r32_rbpdisp( REG_EAX, REG_OFFSET(rn) );
+    }
+
+    MOVL_imm32_rbpdisp( pc + 4, REG_OFFSET(15) );
+    if( load ) {
+        CALL_r32disp( REG_RBX, byte ? MEM_FN(read_byte) : MEM_FN(read_long) );
+        MOVL_r32_rbpdisp( REG_EAX, REG_OFFSET(rd) );
+    } else {
+        arm_xlat_load_reg( pc, rd, REG_ESI );
+        CALL_r32disp( REG_RBX, byte ? MEM_FN(write_byte) : MEM_FN(write_long) );
+    }
+    arm_xlat_check_interrupt( count );
+    if( !load ) {
+        arm_xlat_check_page( pc, count );
+    }
+    return TRUE;
+}
+
+/**
+ * Pass the instruction to the interpreter, leaving the block if it halts,
+ * branches, or causes an interrupt or invalidation.
+ */
+static void arm_xlat_fallback( uint32_t pc, uint32_t ir, int count )
+{
+    MOVL_imm32_rbpdisp( pc + 4, REG_OFFSET(15) );
+    MOVL_imm32_r32( ir, REG_EDI );
+    arm_xlat_call( arm_execute_opcode );
+    TESTL_r32_r32( REG_EAX, REG_EAX );
+    arm_xlat_exit_if( X86_COND_E, -count );
+    CMPL_imms_rbpdisp( pc + 4, REG_OFFSET(15) );
+    arm_xlat_exit_if( X86_COND_NE, count );
+    arm_xlat_check_interrupt( count );
+    arm_xlat_check_page( pc, count );
+}
+
+/**
+ * @return TRUE if an instruction left to the interpreter is likely to
+ * branch, so that there's no point in translating past it.
+ */
+static gboolean arm_xlat_may_branch( uint32_t ir )
+{
+    switch( (ir>>26)&0x03 ) {
+    case 0:
+        return (ir & 0x0FFFFFF0) == 0x012FFF10 || /* BX */
+               ((ir>>12)&0x0F) == 15;
+    case 1:
+        return (ir & 0x00100000) && ((ir>>12)&0x0F) == 15;
+    case 2:
+        return (ir & 0x02000000) || (ir & 0x00108000) == 0x00108000;
+    default:
+        return TRUE; /* SWI */
+    }
+}
+
+/**
+ * Translate one instruction, the count'th in the block.
+ * @return TRUE if the instruction ends the block.
+ */
+static gboolean arm_xlat_instruction( uint32_t pc, uint32_t ir, int count )
+{
+    uint32_t cond = ir>>28;
+    uint8_t *fail[2];
+    int nfail, i;
+    gboolean end = FALSE;
+
+    if( cond == 15 ) { /* Undefined */
+        arm_xlat_fallback( pc, ir, count );
+        return TRUE;
+    }
+
+    nfail = arm_xlat_condition( cond, fail );
+    switch( (ir>>26)&0x03 ) {
+    case 0:
+        if( arm_xlat_data_processing( pc, ir ) ) {
+            break;
+        }
+        arm_xlat_fallback( pc, ir, count );
+        end = cond == 14 && arm_xlat_may_branch(ir);
+        break;
+    case 1:
+        if( arm_xlat_load_store( pc, ir, count ) ) {
+            break;
+        }
+        arm_xlat_fallback( pc, ir, count );
+        end = cond == 14 && arm_xlat_may_branch(ir);
+        break;
+    case 2:
+        if( ir & 0x02000000 ) { /* B, BL */
+            uint32_t target = pc + 8 + (SIGNEXT24(ir&0x00FFFFFF) << 2);
+            if( target < ARM_XLAT_RAM_SIZE ) {
+                if( ir & 0x01000000 ) {
+                    MOVL_imm32_rbpdisp( pc + 4, REG_OFFSET(14) );
+                }
+                MOVL_imm32_rbpdisp( target, REG_OFFSET(15) );
+                arm_xlat_exit( count );
+                end = TRUE;
+                break;
+            }
+        }
+        arm_xlat_fallback( pc, ir, count );
+        end = cond == 14 && arm_xlat_may_branch(ir);
+        break;
+    default:
+        arm_xlat_fallback( pc, ir, count );
+        end = cond == 14 && arm_xlat_may_branch(ir);
+        break;
+    }
+    for( i=0; i<nfail; i++ ) {
+        arm_xlat_patch( fail[i] );
+    }
+    return end;
+}
+
+static struct arm_xlat_block *arm_xlat_translate( uint32_t startpc )
+{
+    uint32_t pc = startpc;
+    int count = 0;
+    gboolean end = FALSE;
+
+    if( arm_xlat_cache_ptr + sizeof(struct arm_xlat_block) + ARM_XLAT_MAX_BLOCK_SIZE >
+        arm_xlat_cache + ARM_XLAT_CACHE_SIZE ) {
+        arm_xlat_flush();
+    }
+    void ***page = (void ***)&arm_xlat_lut[startpc>>ARM_XLAT_PAGE_BITS];
+    if( *page == NULL ) {
+        *page = calloc( ARM_XLAT_LUT_ENTRIES, sizeof(void *) );
+        assert( *page != NULL );
+    }
+
+    struct arm_xlat_block *block = (struct arm_xlat_block *)arm_xlat_cache_ptr;
+    xlat_output = block->xlat.code;
+
+    /* Shared exit, ahead of the entry point so that every exit is a backwards
+     * jump */
+    arm_xlat_exit_ptr = xlat_output;
+    ADDQ_imms_r64( 8, REG_RSP );
+    POP_r32( REG_RBX );
+    POP_r32( REG_RBP );
+    RET();
+
+    block->entry = xlat_output;
+    PUSH_r32( REG_RBP );
+    PUSH_r32( REG_RBX );
+    SUBQ_imms_r64( 8, REG_RSP ); /* Keep the stack 16-byte aligned for calls */
+    MOVP_immptr_rptr( &armr, REG_RBP );
+    MOVP_immptr_rptr( &arm_mem, REG_RBX );
+    MOVP_rptrdisp_rptr( REG_RBX, 0, REG_RBX );
+
+    while( !end && count < ARM_XLAT_MAX_BLOCK_INSTRUCTIONS ) {
+        uint32_t ir = arm_read_long( pc );
+        end = arm_xlat_instruction( pc, ir, ++count );
+        pc += 4;
+        if( (pc & (ARM_XLAT_PAGE_SIZE-1)) == 0 ) {
+            break;
+        }
+    }
+    /* Fall-through exit, also the target of a failed condition on the last
+     * instruction */
+    MOVL_imm32_rbpdisp( pc, REG_OFFSET(15) );
+    arm_xlat_exit( count );
+
+    block->pc = startpc;
+    block->length = count;
+    memset( &block->xlat, 0, sizeof(block->xlat) );
+    block->xlat.active = 1;
+    block->xlat.size = xlat_output - block->xlat.code;
+    assert( block->xlat.size <= ARM_XLAT_MAX_BLOCK_SIZE );
+    block->xlat.lut_entry = &(*page)[(startpc&(ARM_XLAT_PAGE_SIZE-1))>>2];
+    *block->xlat.lut_entry = block;
+    arm_xlat_cache_ptr = (uint8_t *)(((uintptr_t)xlat_output + 15) & ~(uintptr_t)15);
+    return block;
+}
+
+static struct arm_xlat_block *arm_xlat_lookup( uint32_t pc )
+{
+    void **page = arm_xlat_lut[pc>>ARM_XLAT_PAGE_BITS];
+    if( page == NULL ) {
+        return NULL;
+    }
+    return page[(pc&(ARM_XLAT_PAGE_SIZE-1))>>2];
+}
+
+void arm_xlat_dump_block( uint32_t pc )
+{
+    struct arm_xlat_block *block = NULL;
+    uint32_t addr;
+    int i;
+
+    if( pc < ARM_XLAT_RAM_SIZE && (pc & 0x03) == 0 ) {
+        block = arm_xlat_lookup( pc );
+    }
+    if( block == NULL ) {
+        fprintf( stderr, "** No translated block for address %08x **\n", pc );
+        return;
+    }
+    for( i=0, addr=pc; i<block->length; i++ ) {
+        char buf[256], op[256];
+        uint32_t next = arm_disasm_instruction( addr, buf, sizeof(buf), op );
+        fprintf( stderr, "%08X: %s  %s\n", addr, op, buf );
+        addr = next;
+    }
+    xlat_disasm_block( stderr, block->xlat.code );
+}
+
+int arm_xlat_execute_block( void )
+{
+    uint32_t pc = armr.r[15];
+    struct arm_xlat_block *block;
+    int result;
+
+    if( pc >= ARM_XLAT_RAM_SIZE || (pc & 0x03) != 0 ) {
+        return 0;
+    }
+    block = arm_xlat_lookup( pc );
+    if( block == NULL ) {
+        block = arm_xlat_translate( pc );
+    }
+
+    if( arm_xlat_checking ) {
+        result = arm_shadow_execute_block( (arm_xlat_code_t)block->entry, pc );
+    } else {
+        result = ((arm_xlat_code_t)block->entry)();
+    }
+    if( result < 0 ) {
+        armr.icount -= result;
+        return -1;
+    }
+    armr.icount += result;
+    return result;
+}
+
+#endif /* ARM_TRANSLATOR */
@@ -0,0 +1,124 @@
+/**
+ * $Id$
+ *
+ * ARM7 to x86-64 translator. Straight-line runs of ARM code in the AICA's
+ * wave RAM are translated into blocks of native code, with anything the
+ * translator doesn't handle directly passed back to the interpreter one
+ * instruction at a time.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef lxdream_armxlat_H
+#define lxdream_armxlat_H 1
+
+#include "lxdream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(SH4_TRANSLATOR) && defined(__x86_64__)
+#define ARM_TRANSLATOR 1
+#endif
+
+#ifdef ARM_TRANSLATOR
+
+/** Translated code is only ever taken from the 2MB of wave RAM */
+#define ARM_XLAT_RAM_SIZE 0x00200000
+#define ARM_XLAT_PAGE_BITS 12
+#define ARM_XLAT_PAGE_SIZE (1<<ARM_XLAT_PAGE_BITS)
+#define ARM_XLAT_PAGES (ARM_XLAT_RAM_SIZE>>ARM_XLAT_PAGE_BITS)
+
+/** Maximum number of ARM instructions in a block */
+#define ARM_XLAT_MAX_BLOCK_INSTRUCTIONS 32
+
+/**
+ * Per-page lookup tables from ARM PC to block, or NULL for pages that contain
+ * no translated code (so that writes to them don't need to invalidate
+ * anything).
+ */
+extern void **arm_xlat_lut[ARM_XLAT_PAGES];
+
+/**
+ * Enable or disable the translator. Checking mode runs each block through the
+ * interpreter as well and aborts if the results differ (see armshadow.c).
+ */
+void arm_xlat_enable( gboolean enable, gboolean checking );
+
+/**
+ * @return TRUE if the translator is enabled.
+ */
+gboolean arm_xlat_is_enabled( void );
+
+/**
+ * Translate (if necessary) and run the block at the current PC. Pending
+ * interrupts should already have been taken.
+ * @return the number of instructions executed, 0 if there's no block for the
+ * current PC (in which case the caller should interpret one instruction), or
+ * -1 if the ARM halted.
+ */
+int arm_xlat_execute_block( void );
+
+/**
+ * Discard all translated code.
+ */
+void arm_xlat_flush( void );
+
+/**
+ * Discard the translated code for any page overlapping the given range of
+ * wave RAM.
+ */
+void arm_xlat_invalidate_range( uint32_t addr, uint32_t length );
+
+/**
+ * Discard the translated code for the pages touched by a write of up to
+ * ARM_XLAT_PAGE_SIZE bytes to wave RAM. Cheap when the pages have no code.
+ */
+static inline void arm_xlat_invalidate( uint32_t addr, uint32_t length )
+{
+    uint32_t first = addr >> ARM_XLAT_PAGE_BITS;
+    uint32_t last = (addr + length - 1) >> ARM_XLAT_PAGE_BITS;
+    if( arm_xlat_lut[first] != NULL ||
+        (last < ARM_XLAT_PAGES && arm_xlat_lut[last] != NULL) ) {
+        arm_xlat_invalidate_range( addr, length );
+    }
+}
+
+/**
+ * Print the ARM code and translation of the block starting at pc to stderr.
+ */
+void arm_xlat_dump_block( uint32_t pc );
+
+typedef int (*arm_xlat_code_t)( void );
+
+/**
+ * Run a translated block, then run the interpreter over the same instructions
+ * from the same starting state, and abort if the results differ.
+ * @return the block's result
+ */
+int arm_shadow_execute_block( arm_xlat_code_t code, uint32_t startpc );
+
+#else
+
+#define arm_xlat_flush()
+#define arm_xlat_invalidate( addr, length )
+#define arm_xlat_invalidate_range( addr, length )
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !lxdream_armxlat_H */
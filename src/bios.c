@@ -21,6 +21,7 @@
 #include "syscall.h"
 #include "asic.h"
 #include "dreamcast.h"
+#include "xlat/xltcache.h"
 #include "bootstrap.h"
 #include "sh4/sh4.h"
 #include "drivers/cdrom/cdrom.h"
@@ -131,6 +132,7 @@ void bios_gdrom_run_command( gdrom_queue_entry_t cmd )
     case GD_CMD_PIOREAD:
     case GD_CMD_DMAREAD:
         ptr = mem_get_region( cmd->params.readcd.buffer );
+        xlat_invalidate_block( cmd->params.readcd.buffer, cmd->params.readcd.count * 2048 );
         status = gdrom_read_cd( cmd->params.readcd.lba,
                 cmd->params.readcd.count, 0x28, ptr, NULL );
         break;
@@ -270,6 +270,12 @@ typedef struct display_driver {
      */
     void (*print_info)( FILE *out );
 
+    /**
+     * Render the current PVR2 scene into the given buffer. Only set by drivers
+     * that render without GL - if NULL, the GL scene renderer is used.
+     */
+    void (*render_scene)( render_buffer_t buffer );
+
     struct display_capabilities capabilities;
 
 } *display_driver_t;
@@ -290,6 +296,7 @@ extern struct display_driver display_osx_driver;
 extern struct display_driver display_gl_driver;
 extern struct display_driver display_egl_driver;
 extern struct display_driver display_null_driver;
+extern struct display_driver display_soft_driver;
 
 /****************** Input methods **********************/
 
@@ -25,6 +25,7 @@
 #include "dream.h"
 #include "eventq.h"
 #include "mem.h"
+#include "mmio.h"
 #include "dreamcast.h"
 #ifdef __APPLE__
 #include <pthread.h>
@@ -84,7 +85,8 @@ extern struct mem_region_fn mem_region_pvr2yuv;
 extern struct mem_region_fn mem_region_pvr2vdma1;
 extern struct mem_region_fn mem_region_pvr2vdma2;
 
-unsigned char dc_main_ram[16 MB];
+/* Page-aligned so that code pages can be write-protected (see sdram.c) */
+unsigned char dc_main_ram[16 MB] __attribute__((aligned(LXDREAM_PAGE_SIZE)));
 unsigned char dc_boot_rom[2 MB];
 unsigned char dc_flash_ram[128 KB];
 
@@ -366,6 +368,7 @@ void dreamcast_shutdown()
         dreamcast_state = STATE_STOPPING;
     dreamcast_save_flash();
     vmulist_save_all();
+    sh4_shutdown();
 #ifdef ENABLE_SH4STATS
     sh4_stats_print(stdout);
 #endif
@@ -500,6 +503,7 @@ gboolean dreamcast_load_state( const gchar *filename )
     FILE *f = fopen( filename, "r" );
     if( f == NULL ) return FALSE;
 
+    aica_sync();
     module_count = dreamcast_read_save_state_header(f, error, sizeof(error));
     if( module_count <= 0 ) {
     	ERROR( error );
@@ -566,6 +570,8 @@ int dreamcast_save_state( const gchar *filename )
     f = fopen( filename, "w" );
     if( f == NULL )
         return errno;
+    /* Memory is saved before the AICA module, so sync up front */
+    aica_sync();
     strcpy( header.magic, DREAMCAST_SAVE_MAGIC );
     header.version = DREAMCAST_SAVE_VERSION;
     header.module_count = 0;
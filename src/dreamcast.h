@@ -35,6 +35,9 @@ extern "C" {
 #define XLAT_NEW_CACHE_SIZE 64 MB
 #define XLAT_TEMP_CACHE_SIZE 4 MB
 #define XLAT_OLD_CACHE_SIZE 16 MB
+/* Limits for adaptive sizing of the new cache (see xlat_cache_tick) */
+#define XLAT_NEW_CACHE_MIN_SIZE 16 MB
+#define XLAT_NEW_CACHE_MAX_SIZE 256 MB
 
 struct lxdream_config_group; // Forward declaration
 
@@ -93,6 +96,55 @@ gboolean dreamcast_load_fakebios();
 #define SCENE_SAVE_VERSION 0x00010000
 
 extern unsigned char dc_main_ram[];
+
+/**
+ * Enable/disable write-protection of main RAM pages containing translated
+ * code. When enabled, RAM writes no longer check the translation cache;
+ * instead the first write to a protected page faults, flushes the page's
+ * translations and unprotects it. This is a win unless the program keeps
+ * writing to pages it's also executing from, which shows up as a high fault
+ * count.
+ * @return FALSE if page protection isn't supported on this host.
+ */
+gboolean sdram_set_code_protection( gboolean enable );
+gboolean sdram_get_code_protection( void );
+void sdram_print_code_protection_stats( FILE *out );
+
+/**
+ * Called when an access through the host memory window faults, with a
+ * pointer to the faulting host PC and the SH4 address being accessed. 
+ * Returns TRUE if the PC has been redirected to code that will redo the
+ * access the slow way.
+ */
+typedef gboolean (*sdram_window_fault_fn_t)( uintptr_t *host_pc, uint32_t addr );
+
+/**
+ * Map main RAM into a reserved 4GB host address range, at each address it
+ * appears at in the SH4 address space with the MMU off. The rest of the
+ * range (and P4) is left inaccessible, so that host accesses to anything
+ * else fault and are passed to fault_fn. Stores through the window are only
+ * enabled while code protection is on.
+ * @return the base of the window, or NULL if it isn't supported on this host.
+ */
+void *sdram_init_window( sdram_window_fault_fn_t fault_fn );
+void *sdram_get_window( void );
+
+/**
+ * Switch the window between the untranslated layout and following the TLB
+ * (called by the MMU when address translation is turned on or off). While
+ * translated, U0 and P3 are empty except for pages added by 
+ * sdram_window_map. Turning it on again resets them to empty.
+ */
+void sdram_window_set_translated( gboolean translated );
+
+/**
+ * Map a (page-aligned) virtual address range to the physical addresses
+ * starting at addr, which are main RAM or else the range is just unmapped.
+ * Only has an effect while the window is translated. Writable mappings
+ * allow stores, subject to code protection.
+ */
+void sdram_window_map( sh4vma_t vma, sh4addr_t addr, uint32_t size, gboolean writable );
+void sdram_window_unmap( sh4vma_t vma, uint32_t size );
 extern unsigned char dc_boot_rom[];
 extern unsigned char dc_flash_ram[];
 
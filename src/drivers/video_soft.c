@@ -0,0 +1,203 @@
+/**
+ * $Id$
+ *
+ * Software rendering video driver - renders scenes on the CPU (see
+ * pvr2/softrender.c) into memory, with no video output. Intended for
+ * running headless on machines without GL.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <string.h>
+#include "display.h"
+#include "drivers/video_gl.h"
+#include "pvr2/pvr2.h"
+
+static gboolean video_soft_init( void );
+static void video_soft_shutdown( void );
+
+/**
+ * Render buffers are held as ARGB8888, top row first.
+ */
+struct soft_render_buffer {
+    struct render_buffer buffer;
+    uint32_t *pixels;
+};
+
+static render_buffer_t video_soft_create_render_buffer( uint32_t width, uint32_t height, GLuint tex_id )
+{
+    struct soft_render_buffer *buffer = g_malloc0( sizeof(struct soft_render_buffer) );
+    buffer->buffer.width = width;
+    buffer->buffer.height = height;
+    buffer->buffer.tex_id = 0; /* No GL, so no render-to-texture */
+    buffer->pixels = g_malloc0( width * height * sizeof(uint32_t) );
+    return &buffer->buffer;
+}
+
+static void video_soft_destroy_render_buffer( render_buffer_t buffer )
+{
+    struct soft_render_buffer *soft = (struct soft_render_buffer *)buffer;
+    g_free( soft->pixels );
+    g_free( soft );
+}
+
+static gboolean video_soft_set_render_target( render_buffer_t buffer )
+{
+    return TRUE;
+}
+
+static void video_soft_finish_render( render_buffer_t buffer )
+{
+}
+
+static void video_soft_render_scene( render_buffer_t buffer )
+{
+    struct soft_render_buffer *soft = (struct soft_render_buffer *)buffer;
+    pvr2_scene_render_soft( soft->pixels, buffer->width, buffer->height );
+}
+
+static void video_soft_display_render_buffer( render_buffer_t buffer )
+{
+}
+
+/**
+ * Copy the buffer out in the requested format, bottom row first (as for
+ * glReadPixels, which is what pvr2_render_buffer_copy_to_sh4 expects).
+ */
+static gboolean video_soft_read_render_buffer( unsigned char *target,
+                                               render_buffer_t buffer,
+                                               int rowstride, int format )
+{
+    struct soft_render_buffer *soft = (struct soft_render_buffer *)buffer;
+    uint32_t x, y;
+
+    for( y=0; y<buffer->height; y++ ) {
+        uint32_t *src = &soft->pixels[(buffer->height - y - 1) * buffer->width];
+        unsigned char *dest = target + y*rowstride;
+        for( x=0; x<buffer->width; x++ ) {
+            uint32_t p = src[x];
+            uint32_t a = p >> 24, r = (p >> 16) & 0xFF, g = (p >> 8) & 0xFF, b = p & 0xFF;
+            switch( format ) {
+            case COLFMT_BGRA1555:
+                ((uint16_t *)dest)[x] = ((a >> 7) << 15) | ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+                break;
+            case COLFMT_RGB565:
+                ((uint16_t *)dest)[x] = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+                break;
+            case COLFMT_BGRA4444:
+                ((uint16_t *)dest)[x] = ((a >> 4) << 12) | ((r >> 4) << 8) | ((g >> 4) << 4) | (b >> 4);
+                break;
+            case COLFMT_BGR888:
+                dest[x*3] = b;
+                dest[x*3+1] = g;
+                dest[x*3+2] = r;
+                break;
+            case COLFMT_RGB888:
+                dest[x*3] = r;
+                dest[x*3+1] = g;
+                dest[x*3+2] = b;
+                break;
+            case COLFMT_BGRA8888:
+            case COLFMT_BGR0888:
+                ((uint32_t *)dest)[x] = p;
+                break;
+            default:
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+static void video_soft_load_frame_buffer( frame_buffer_t frame,
+                                          render_buffer_t buffer )
+{
+    struct soft_render_buffer *soft = (struct soft_render_buffer *)buffer;
+    uint32_t x, y;
+
+    for( y=0; y<frame->height && y<buffer->height; y++ ) {
+        unsigned char *src = frame->data + y*frame->rowstride;
+        uint32_t *dest = &soft->pixels[(frame->inverted ? buffer->height - y - 1 : y) * buffer->width];
+        for( x=0; x<frame->width && x<buffer->width; x++ ) {
+            uint32_t p, a = 0xFF, r, g, b;
+            switch( frame->colour_format ) {
+            case COLFMT_BGRA1555:
+                p = ((uint16_t *)src)[x];
+                a = (p & 0x8000) ? 0xFF : 0;
+                r = ((p >> 10) & 0x1F) << 3;
+                g = ((p >> 5) & 0x1F) << 3;
+                b = (p & 0x1F) << 3;
+                break;
+            case COLFMT_RGB565:
+                p = ((uint16_t *)src)[x];
+                r = ((p >> 11) & 0x1F) << 3;
+                g = ((p >> 5) & 0x3F) << 2;
+                b = (p & 0x1F) << 3;
+                break;
+            case COLFMT_BGR888:
+                b = src[x*3];
+                g = src[x*3+1];
+                r = src[x*3+2];
+                break;
+            default:
+                p = ((uint32_t *)src)[x];
+                a = p >> 24;
+                r = (p >> 16) & 0xFF;
+                g = (p >> 8) & 0xFF;
+                b = p & 0xFF;
+                break;
+            }
+            dest[x] = (a << 24) | (r << 16) | (g << 8) | b;
+        }
+    }
+}
+
+static void video_soft_display_blank( uint32_t colour )
+{
+}
+
+static void video_soft_swap_buffers(void)
+{
+}
+
+struct display_driver display_soft_driver = {
+        "soft",
+        N_("Software renderer (no video output)"),
+        video_soft_init,
+        video_soft_shutdown,
+        NULL,
+        NULL,
+        NULL,
+        video_soft_create_render_buffer,
+        video_soft_destroy_render_buffer,
+        video_soft_set_render_target,
+        video_soft_finish_render,
+        video_soft_load_frame_buffer,
+        video_soft_display_render_buffer,
+        video_soft_display_blank,
+        video_soft_swap_buffers,
+        video_soft_read_render_buffer,
+        NULL,
+        NULL,
+        video_soft_render_scene };
+
+static gboolean video_soft_init( void )
+{
+    gl_vbo_fallback_init(&display_soft_driver);
+    return TRUE;
+}
+
+static void video_soft_shutdown( void )
+{
+    pvr2_scene_render_soft_shutdown();
+}
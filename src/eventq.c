@@ -6,6 +6,10 @@
  * there to be at least half a dozen or so continually scheduled events
  * (TMU and PVR2), peaking around 20+.
  *
+ * Pending events are kept in a linked list sorted by absolute time, so that
+ * nothing needs adjusting at the end of each slice. For the number of events
+ * we expect, this is faster than a heap (see test/testeventq -b).
+ *
  * Copyright (c) 2005 Nathan Keynes.
  *
  * This program is free software; you can redistribute it and/or modify
@@ -29,23 +33,20 @@
 #define LONG_SCAN_PERIOD 1000000000 /* 1 second */
 
 typedef struct event {
-    uint32_t id;
-    uint32_t seconds;
-    uint32_t nanosecs;
+    uint64_t when; /* Absolute time, valid if scheduled */
+    gboolean scheduled;
     event_func_t func;
-
     struct event *next;
 } *event_t;
 
 static struct event events[MAX_EVENT_ID];
+static event_t event_head;
 
 /**
- * Countdown to the next scan of the long-duration list (greater than 1 second).
+ * Absolute time at the start of the current slice. Event times are relative to
+ * this, so that they don't have to be adjusted at the end of every slice.
  */
-static int long_scan_time_remaining;
-
-static event_t event_head;
-static event_t long_event_head;
+static uint64_t event_time_base;
 
 void event_reset();
 void event_init();
@@ -56,6 +57,22 @@ int event_load_state( FILE * f );
 struct dreamcast_module eventq_module = { "EVENTQ", NULL, event_reset, NULL, event_run_slice,
         NULL, event_save_state, event_load_state };
 
+/**
+ * @return the given time relative to the start of the current slice. Overdue
+ * events are due immediately, and events too far in the future to fit are
+ * reported at the latest representable time.
+ */
+static uint32_t event_slice_time( uint64_t when )
+{
+    if( when <= event_time_base ) {
+        return 0;
+    } else if( when - event_time_base >= NOT_SCHEDULED ) {
+        return NOT_SCHEDULED-1;
+    } else {
+        return (uint32_t)(when - event_time_base);
+    }
+}
+
 static void event_update_pending( ) 
 {
     if( event_head == NULL ) {
@@ -65,7 +82,7 @@ static void event_update_pending( )
         sh4r.event_types &= (~PENDING_EVENT);
     } else {
         if( !(sh4r.event_types & PENDING_IRQ) ) {
-            sh4_set_event_pending(event_head->nanosecs);
+            sh4_set_event_pending(event_slice_time(event_head->when));
         }
         sh4r.event_types |= PENDING_EVENT;
     }
@@ -76,71 +93,51 @@ uint32_t event_get_next_time( )
     if( event_head == NULL ) {
         return NOT_SCHEDULED;
     } else {
-        return event_head->nanosecs;
-    }
-}
-
-/**
- * Add the event to the short queue.
- */
-static void event_enqueue( event_t event ) 
-{
-    if( event_head == NULL || event->nanosecs < event_head->nanosecs ) {
-        event->next = event_head;
-        event_head = event;
-        event_update_pending();
-    } else {
-        event_t cur = event_head;
-        event_t next = cur->next;
-        while( next != NULL && event->nanosecs >= next->nanosecs ) {
-            cur = next;
-            next = cur->next;
-        }
-        event->next = next;
-        cur->next = event;
+        return event_slice_time(event_head->when);
     }
 }
 
 static void event_dequeue( event_t event )
 {
-    if( event_head == NULL ) {
-        ERROR( "Empty event queue but should contain event %d", event->id );
-    } else if( event_head == event ) {
-        /* removing queue head */
-        event_head = event_head->next;
+    if( event_head == event ) {
+        event_head = event->next;
         event_update_pending();
     } else {
         event_t cur = event_head;
-        event_t next = cur->next;
-        while( next != NULL ) {
-            if( next == event ) {
-                cur->next = next->next;
+        while( cur != NULL ) {
+            if( cur->next == event ) {
+                cur->next = event->next;
                 break;
             }
-            cur = next;
-            next = cur->next;
+            cur = cur->next;
         }
     }
 }
 
-static void event_dequeue_long( event_t event ) 
+/**
+ * Add the event to the queue at the given absolute time, after any others
+ * due at the same time, replacing any existing schedule for it.
+ */
+static void event_enqueue( int eventid, uint64_t when )
 {
-    if( long_event_head == NULL ) {
-        ERROR( "Empty long event queue but should contain event %d", event->id );
-    } else if( long_event_head == event ) {
-        /* removing queue head */
-        long_event_head = long_event_head->next;
+    event_t event = &events[eventid];
+    if( event->scheduled ) {
+        event_dequeue( event );
+    }
+    event->when = when;
+    event->scheduled = TRUE;
+
+    if( event_head == NULL || when < event_head->when ) {
+        event->next = event_head;
+        event_head = event;
+        event_update_pending();
     } else {
-        event_t cur = long_event_head;
-        event_t next = cur->next;
-        while( next != NULL ) {
-            if( next == event ) {
-                cur->next = next->next;
-                break;
-            }
-            cur = next;
-            next = cur->next;
+        event_t cur = event_head;
+        while( cur->next != NULL && cur->next->when <= when ) {
+            cur = cur->next;
         }
+        event->next = cur->next;
+        cur->next = event;
     }
 }
 
@@ -151,68 +148,37 @@ void register_event_callback( int eventid, event_func_t func )
 
 void event_schedule( int eventid, uint32_t nanosecs )
 {
-    nanosecs += sh4r.slice_cycle;
-
-    event_t event = &events[eventid];
-
-    if( event->nanosecs != NOT_SCHEDULED ) {
-        /* Event is already scheduled. Remove it from the list first */
-        event_cancel(eventid);
-    }
-
-    event->id = eventid;
-    event->seconds = 0;
-    event->nanosecs = nanosecs;
-
-    event_enqueue( event );
+    event_enqueue( eventid, event_time_base + sh4r.slice_cycle + nanosecs );
 }
 
 void event_schedule_long( int eventid, uint32_t seconds, uint32_t nanosecs ) {
-    if( seconds == 0 ) {
-        event_schedule( eventid, nanosecs );
-    } else {
-        event_t event = &events[eventid];
-
-        if( event->nanosecs != NOT_SCHEDULED ) {
-            /* Event is already scheduled. Remove it from the list first */
-            event_cancel(eventid);
-        }
-
-        event->id = eventid;
-        event->seconds = seconds;
-        event->nanosecs = nanosecs + sh4r.slice_cycle + (LONG_SCAN_PERIOD - long_scan_time_remaining);
-        event->next = long_event_head;
-        long_event_head = event;
-    }
-
+    event_enqueue( eventid, event_time_base + sh4r.slice_cycle +
+            ((uint64_t)seconds) * LONG_SCAN_PERIOD + nanosecs );
 }
 
 void event_cancel( int eventid )
 {
     event_t event = &events[eventid];
-    if( event->nanosecs == NOT_SCHEDULED ) {
-        return; /* not scheduled */
-    } else {
-        event->nanosecs = NOT_SCHEDULED;
-        if( event->seconds != 0 ) { /* long term event */
-            event_dequeue_long( event );
-        } else {
-            event_dequeue( event );
-        }
+    if( event->scheduled ) {
+        event->scheduled = FALSE;
+        event_dequeue( event );
     }
 }
 
 
 void event_execute()
 {
+    event_t event;
+    uint64_t now = event_time_base + sh4r.slice_cycle;
+
     /* Loop in case we missed some or got a couple scheduled for the same time */
-    while( event_head != NULL && event_head->nanosecs <= sh4r.slice_cycle ) {
-        event_t event = event_head;
-        event_head = event->next;
-        event->nanosecs = NOT_SCHEDULED;
+    while( event_head != NULL && event_head->when <= now ) {
         // Note: Make sure the internal state is consistent before calling the
         // user function, as it will (quite likely) enqueue another event.
-        event->func( event->id );
+        event = event_head;
+        event_head = event->next;
+        event->scheduled = FALSE;
+        event->func( event - events );
     }
 
     event_update_pending();
@@ -227,18 +193,15 @@ void event_init()
 {
     int i;
     for( i=0; i<MAX_EVENT_ID; i++ ) {
-        events[i].id = i;
-        events[i].nanosecs = NOT_SCHEDULED;
+        events[i].scheduled = FALSE;
         if( i < 96 ) {
             events[i].func = event_asic_callback;
         } else {
             events[i].func = NULL;
         }
-        events[i].next = NULL;
     }
     event_head = NULL;
-    long_event_head = NULL;
-    long_scan_time_remaining = LONG_SCAN_PERIOD;
+    event_time_base = 0;
 }
 
 
@@ -247,95 +210,111 @@ void event_reset()
 {
     int i;
     event_head = NULL;
-    long_event_head = NULL;
-    long_scan_time_remaining = LONG_SCAN_PERIOD;
+    event_time_base = 0;
     for( i=0; i<MAX_EVENT_ID; i++ ) {
-        events[i].nanosecs = NOT_SCHEDULED;
+        events[i].scheduled = FALSE;
     }
 }
 
+/**
+ * The saved state keeps the format of the original linked-list queue: the
+ * heads of the short and long queues, the countdown to the next scan of the
+ * long queue, then for each event its id, whole seconds remaining (long
+ * queue only), nanoseconds and the id of the next event in its queue. Long
+ * events become due at the scan that takes their seconds to zero, plus their
+ * nanoseconds.
+ */
 void event_save_state( FILE *f )
 {
-    int32_t id, i;
-    id = event_head == NULL ? -1 : event_head->id;
+    int32_t short_queue[MAX_EVENT_ID], long_queue[MAX_EVENT_ID], next[MAX_EVENT_ID];
+    int32_t short_count = 0, long_count = 0, id, i;
+    uint32_t seconds[MAX_EVENT_ID], nanosecs[MAX_EVENT_ID];
+    int long_scan_time_remaining = LONG_SCAN_PERIOD;
+    event_t event;
+
+    for( i=0; i<MAX_EVENT_ID; i++ ) {
+        seconds[i] = 0;
+        nanosecs[i] = NOT_SCHEDULED;
+        next[i] = -1;
+    }
+    /* Both queues are in time order, as the list is */
+    for( event = event_head; event != NULL; event = event->next ) {
+        uint64_t when = event->when <= event_time_base ? 0 : event->when - event_time_base;
+        i = event - events;
+        if( when < long_scan_time_remaining ) {
+            nanosecs[i] = (uint32_t)when;
+            short_queue[short_count++] = i;
+        } else {
+            when -= long_scan_time_remaining;
+            seconds[i] = (uint32_t)(when / LONG_SCAN_PERIOD) + 1;
+            nanosecs[i] = (uint32_t)(when % LONG_SCAN_PERIOD);
+            long_queue[long_count++] = i;
+        }
+    }
+    for( i=1; i<short_count; i++ ) {
+        next[short_queue[i-1]] = short_queue[i];
+    }
+    for( i=1; i<long_count; i++ ) {
+        next[long_queue[i-1]] = long_queue[i];
+    }
+
+    id = short_count == 0 ? -1 : short_queue[0];
     fwrite( &id, sizeof(id), 1, f );
-    id = long_event_head == NULL ? -1 : long_event_head->id;
+    id = long_count == 0 ? -1 : long_queue[0];
     fwrite( &id, sizeof(id), 1, f );
     fwrite( &long_scan_time_remaining, sizeof(long_scan_time_remaining), 1, f );
     for( i=0; i<MAX_EVENT_ID; i++ ) {
-        fwrite( &events[i].id, sizeof(uint32_t), 3, f ); /* First 3 words from structure */
-        id = events[i].next == NULL ? -1 : events[i].next->id;
-        fwrite( &id, sizeof(id), 1, f );
+        uint32_t words[3] = { i, seconds[i], nanosecs[i] };
+        fwrite( words, sizeof(uint32_t), 3, f );
+        fwrite( &next[i], sizeof(int32_t), 1, f );
     }
 }
 
 int event_load_state( FILE *f )
 {
-    int32_t id, i;
-    fread( &id, sizeof(id), 1, f );
-    event_head = id == -1 ? NULL : &events[id];
-    fread( &id, sizeof(id), 1, f );
-    long_event_head = id == -1 ? NULL : &events[id];
+    int32_t short_head, long_head, id, i;
+    int32_t next[MAX_EVENT_ID];
+    uint32_t seconds[MAX_EVENT_ID], nanosecs[MAX_EVENT_ID];
+    int long_scan_time_remaining;
+
+    fread( &short_head, sizeof(short_head), 1, f );
+    fread( &long_head, sizeof(long_head), 1, f );
     fread( &long_scan_time_remaining, sizeof(long_scan_time_remaining), 1, f );
     for( i=0; i<MAX_EVENT_ID; i++ ) {
-        fread( &events[i].id, sizeof(uint32_t), 3, f );
-        fread( &id, sizeof(id), 1, f );
-        events[i].next = id == -1 ? NULL : &events[id];
+        uint32_t words[3];
+        fread( words, sizeof(uint32_t), 3, f );
+        fread( &next[i], sizeof(int32_t), 1, f );
+        seconds[i] = words[1];
+        nanosecs[i] = words[2];
     }
-    return 0;
-}
 
-/**
- * Scan all entries in the long queue, decrementing each by 1 second. Entries
- * that are now < 1 second are moved to the short queue.
- */
-static void event_scan_long()
-{
-    while( long_event_head != NULL && --long_event_head->seconds == 0 ) {
-        event_t event = long_event_head;
-        long_event_head = event->next;
-        event_enqueue(event);
+    event_reset();
+    /* Queue the short events in list order first, so that events due at the
+     * same time keep their relative order */
+    for( i=0, id=short_head; id >= 0 && id < MAX_EVENT_ID && i < MAX_EVENT_ID; i++, id = next[id] ) {
+        if( nanosecs[id] != NOT_SCHEDULED && !events[id].scheduled ) {
+            event_enqueue( id, nanosecs[id] );
+        }
     }
-
-    if( long_event_head != NULL ) {
-        event_t last = long_event_head;
-        event_t cur = last->next;
-        while( cur != NULL ) {
-            if( --cur->seconds == 0 ) {
-                last->next = cur->next;
-                event_enqueue(cur);
+    for( i=0; i<MAX_EVENT_ID; i++ ) {
+        if( nanosecs[i] != NOT_SCHEDULED && !events[i].scheduled ) {
+            if( seconds[i] == 0 ) {
+                event_enqueue( i, nanosecs[i] );
             } else {
-                last = cur;
+                event_enqueue( i, ((uint64_t)long_scan_time_remaining) +
+                        ((uint64_t)(seconds[i]-1)) * LONG_SCAN_PERIOD + nanosecs[i] );
             }
-            cur = last->next;
         }
     }
+    return 0;
 }
 
 /**
- * Decrement the event time on all pending events by the supplied nanoseconds.
- * It may or may not be faster to wrap around instead, but this has the benefit
- * of simplicity.
+ * Advance the current time to the end of the slice.
  */
 uint32_t event_run_slice( uint32_t nanosecs )
 {
-    event_t event = event_head;
-    while( event != NULL ) {
-        if( event->nanosecs <= nanosecs ) {
-            event->nanosecs = 0;
-        } else {
-            event->nanosecs -= nanosecs;
-        }
-        event = event->next;
-    }
-
-    long_scan_time_remaining -= nanosecs;
-    if( long_scan_time_remaining <= 0 ) {
-        long_scan_time_remaining += LONG_SCAN_PERIOD;
-        event_scan_long();
-    }
-
+    event_time_base += nanosecs;
     event_update_pending();
     return nanosecs;
 }
-
@@ -84,6 +84,7 @@ void event_init();
 #define EVENT_TMU1 98
 #define EVENT_TMU2 99
 #define EVENT_GUNPOS 100
+#define EVENT_SH4_SAMPLE 101
 
 #define EVENT_ENDTIMESLICE 127
 #ifdef __cplusplus
@@ -29,6 +29,7 @@
 #include "mem.h"
 #include "bootstrap.h"
 #include "dreamcast.h"
+#include "xlat/xltcache.h"
 #include "config.h"
 #include "loader.h"
 #include "drivers/cdrom/cdrom.h"
@@ -261,6 +262,7 @@ static gboolean file_load_elf( const gchar *filename, int fd, ERROR *err )
         if( phdr.p_type == PT_LOAD ) {
             lseek( fd, phdr.p_offset, SEEK_SET );
             sh4ptr_t target = mem_get_region( phdr.p_vaddr );
+            xlat_invalidate_block( phdr.p_vaddr, phdr.p_memsz );
             read( fd, target, phdr.p_filesz );
             if( phdr.p_memsz > phdr.p_filesz ) {
                 memset( target + phdr.p_filesz, 0, phdr.p_memsz - phdr.p_filesz );
@@ -324,6 +326,7 @@ static gboolean file_load_binary( const gchar *filename, int fd, ERROR *err )
     }
 
     sh4ptr_t target = mem_get_region( BINARY_LOAD_ADDR );
+    xlat_invalidate_block( BINARY_LOAD_ADDR, st.st_size );
     if( read( fd, target, st.st_size ) != st.st_size ) {
         SET_ERROR( err, LX_ERR_FILE_IOERROR, "Error reading binary file '%s' (%s)", filename, strerror(errno) );
         return FALSE;
@@ -41,10 +41,12 @@
 #include "maple/maple.h"
 #include "pvr2/glutil.h"
 #include "sh4/sh4.h"
+#include "sh4/sampler.h"
 #include "vmu/vmulist.h"
 #include "profiler.h"
 
 #define GL_INFO_OPT 1
+#define SH4_SAMPLE_OPT 2
 
 char *option_list = "a:A:bc:e:dfg:G:hHl:m:npPt:T:uvV:xX?";
 struct option longopts[] = {
@@ -69,6 +71,7 @@ struct option longopts[] = {
         { "video", required_argument, NULL, 'V' },
         { "version", no_argument, NULL, 'v' }, 
         { "sh4-profile-blocks", no_argument, NULL, 'P' },
+        { "sh4-sample", required_argument, NULL, SH4_SAMPLE_OPT },
         { NULL, 0, 0, 0 } };
 char *aica_program = NULL;
 char *display_driver_name = NULL;
@@ -76,6 +79,7 @@ char *audio_driver_name = NULL;
 char *trace_regions = NULL;
 char *sh4_gdb_port = NULL;
 char *arm_gdb_port = NULL;
+char *sh4_sample_file = NULL;
 gboolean start_immediately = FALSE;
 gboolean no_start = FALSE;
 gboolean headless = FALSE;
@@ -111,6 +115,7 @@ static void print_usage()
     printf( "   -m, --multiplier=SCALE %s\n", _("Set the SH4 multiplier (1.0 = fullspeed)") );
     printf( "   -n                     %s\n", _("Don't start running immediately") );
     printf( "   -p                     %s\n", _("Start running immediately on startup") );
+    printf( "   --sh4-sample=FILE      %s\n", _("Sample SH4 code, writing collapsed stacks to FILE") );
     printf( "   -t, --run-time=SECONDS %s\n", _("Run for the specified number of seconds") );
     printf( "   -T, --trace=REGIONS    %s\n", _("Output trace information for the named regions") );
     printf( "   -u, --unsafe           %s\n", _("Allow unsafe dcload syscalls") );
@@ -237,6 +242,9 @@ int main (int argc, char *argv[])
         case GL_INFO_OPT:
             print_glinfo = TRUE;
             break;
+        case SH4_SAMPLE_OPT:
+            sh4_sample_file = optarg;
+            break;
         }
     }
 
@@ -308,9 +316,10 @@ int main (int argc, char *argv[])
 
     audio_init_driver( audio_driver_name );
 
-    headless = display_driver_name != NULL && strcasecmp( display_driver_name, "null" ) == 0;
+    headless = display_driver_name != NULL && (strcasecmp( display_driver_name, "null" ) == 0 ||
+            strcasecmp( display_driver_name, "soft" ) == 0);
     if( headless ) {
-        display_set_driver( &display_null_driver );
+        display_set_driver( get_display_driver_by_name(display_driver_name) );
     } else {
         gui_init(show_debugger, show_fullscreen);
 
@@ -386,6 +395,12 @@ int main (int argc, char *argv[])
 
     sh4_set_core( sh4_core );
     sh4_set_profile_blocks( sh4_profile_blocks );
+    if( sh4_sample_file != NULL ) {
+        const char *hz = getenv("LXDREAM_SH4_SAMPLE_HZ");
+        const char *depth = getenv("LXDREAM_SH4_SAMPLE_DEPTH");
+        sh4_sampler_init( sh4_sample_file, hz == NULL ? 0 : strtoul(hz, NULL, 10),
+                          depth == NULL ? 0 : strtoul(depth, NULL, 10) );
+    }
 
     /* If requested, start the gdb server immediately before we go into the main
      * loop.
@@ -35,6 +35,7 @@
 #include "mem.h"
 #include "mmio.h"
 #include "dreamcast.h"
+#include "xlat/xltcache.h"
 
 #ifndef PAGE_SIZE
 #define PAGE_SIZE 4096
@@ -327,6 +328,7 @@ int mem_load_block( const gchar *file, uint32_t start, uint32_t length )
         len = 4096 - (addr & 0x0FFF);
         if( len > (length-total) ) 
             len = (length-total);
+        xlat_invalidate_block( addr, len );
         if( fread( region, len, 1, f ) != 1 ) {
             ERROR( "Unexpected error reading: %d (%s)", len, strerror(errno) );
             break;
@@ -416,6 +418,18 @@ sh4ptr_t mem_get_region_by_name( const char *name )
     return NULL;
 }
 
+gboolean mem_get_phys_address( void *ptr, sh4addr_t *addr )
+{
+    int i;
+    for( i=0; i<num_mem_rgns; i++ ) {
+        if( (sh4ptr_t)ptr >= mem_rgn[i].mem && (sh4ptr_t)ptr < mem_rgn[i].mem + mem_rgn[i].size ) {
+            *addr = mem_rgn[i].base + ((sh4ptr_t)ptr - mem_rgn[i].mem);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
 void register_io_region( struct mmio_region *io )
 {
     int i;
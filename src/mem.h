@@ -110,6 +110,12 @@ gboolean mem_load_rom( void *output, const gchar *filename, uint32_t size, uint3
 void *mem_alloc_pages( int n );
 sh4ptr_t mem_get_region( uint32_t addr );
 sh4ptr_t mem_get_region_by_name( const char *name );
+/**
+ * Reverse of mem_get_region - find the physical address of a host pointer into
+ * one of the memory regions.
+ * @return TRUE if the pointer is within a region, otherwise FALSE.
+ */
+gboolean mem_get_phys_address( void *ptr, sh4addr_t *addr );
 gboolean mem_has_page( uint32_t addr );
 int mem_load_block( const gchar *filename, uint32_t base, uint32_t size );
 int mem_save_block( const gchar *filename, uint32_t base, uint32_t size );
@@ -33,13 +33,10 @@
 #ifdef APPLE_BUILD
 #include "OpenGL/CGLCurrent.h"
 #include "OpenGL/CGLMacro.h"
-#include <dispatch/dispatch.h>
 
 static CGLContextObj CGL_MACRO_CONTEXT;
 #endif
 
-#define IS_NONEMPTY_TILE_LIST(p) (IS_TILE_PTR(p) && ((*((uint32_t *)(pvr2_main_ram+(p))) >> 28) != 0x0F))
-
 int pvr2_poly_depthmode[8] = { GL_NEVER, GL_LESS, GL_EQUAL, GL_LEQUAL,
         GL_GREATER, GL_NOTEQUAL, GL_GEQUAL, 
         GL_ALWAYS };
@@ -111,118 +108,33 @@ static void drawrect2d( uint32_t tile_bounds[], float z )
 #endif
 }
 
-/*
- * Load textures for all polygons in the scene.
- * If LXDREAM_TEX_THREADS>1 and APPLE_BUILD, we parallelize address/ID lookup
- * across a small GCD thread pool and then apply GL work on the main thread.
- * GL calls remain serialized on the current context.
+/**
+ * Load textures for all polygons in the scene. Misses are queued, decoded in
+ * parallel, and then uploaded together (see texcache_load_deferred).
  */
 static void pvr2_scene_load_textures()
 {
+    int i;
     texcache_begin_scene( MMIO_READ( PVR2, RENDER_PALETTE ) & 0x03,
                          (MMIO_READ( PVR2, RENDER_TEXSIZE ) & 0x003F) << 5 );
 
-    int total = pvr2_scene.poly_count;
-#if defined(APPLE_BUILD)
-    int threads = 1;
-    {
-        const char *env = getenv("LXDREAM_TEX_THREADS");
-        if( env != NULL ) {
-            int v = atoi(env);
-            if( v >= 1 && v <= 8 ) threads = v;
-        }
-    }
-    if( threads <= 1 || total < 256 ) {
-        int i;
-        for( i=0; i<total; i++ ) {
-            struct polygon_struct *poly = &pvr2_scene.poly_array[i];
-            if( POLY1_TEXTURED(poly->context[0]) ) {
-                poly->tex_id = texcache_get_texture( poly->context[1], poly->context[2] );
-                if( poly->mod_vertex_index != -1 ) {
-                    if( pvr2_scene.shadow_mode == SHADOW_FULL ) {
-                        poly->mod_tex_id = texcache_get_texture( poly->context[3], poly->context[4] );
-                    } else {
-                        poly->mod_tex_id = poly->tex_id;
-                    }
-                }
-            } else {
-                poly->tex_id = 0;
-                poly->mod_tex_id = 0;
-            }
-        }
-    } else {
-        /*
-         * Parallelize by partitioning polygons; we still call texcache_get_texture
-         * which ultimately does GL uploads. To keep GL serialized to the active
-         * context, we enqueue per-partition work onto the main queue.
-         */
-        int chunk = (total + threads - 1)/threads;
-        __block int remaining = threads;
-        dispatch_group_t group = dispatch_group_create();
-        for( int t=0; t<threads; t++ ) {
-            int start = t*chunk;
-            int end = start + chunk;
-            if( start >= total ) break;
-            if( end > total ) end = total;
-            dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
-                /* Batch GL work for this chunk into a single main-thread sync to reduce overhead */
-                typedef struct { struct polygon_struct *poly; uint32_t c1,c2,c3,c4; int mod_index; } TexReq;
-                int req_cap = end - start;
-                if( req_cap < 1 ) req_cap = 1;
-                TexReq *req = (TexReq *)malloc(sizeof(TexReq) * (size_t)req_cap);
-                int req_count = 0;
-                for( int i=start; i<end; i++ ) {
-                    struct polygon_struct *poly = &pvr2_scene.poly_array[i];
-                    if( POLY1_TEXTURED(poly->context[0]) ) {
-                        TexReq r; r.poly = poly; r.c1 = poly->context[1]; r.c2 = poly->context[2];
-                        r.c3 = poly->context[3]; r.c4 = poly->context[4]; r.mod_index = poly->mod_vertex_index;
-                        req[req_count++] = r;
-                    } else {
-                        poly->tex_id = 0;
-                        poly->mod_tex_id = 0;
-                    }
-                }
-                if( req_count > 0 ) {
-                    dispatch_sync(dispatch_get_main_queue(), ^{
-                        for( int j=0; j<req_count; j++ ) {
-                            struct polygon_struct *poly = req[j].poly;
-                            poly->tex_id = texcache_get_texture( req[j].c1, req[j].c2 );
-                            if( req[j].mod_index != -1 ) {
-                                if( pvr2_scene.shadow_mode == SHADOW_FULL ) {
-                                    poly->mod_tex_id = texcache_get_texture( req[j].c3, req[j].c4 );
-                                } else {
-                                    poly->mod_tex_id = poly->tex_id;
-                                }
-                            }
-                        }
-                    });
+    for( i=0; i<pvr2_scene.poly_count; i++ ) {
+        struct polygon_struct *poly = &pvr2_scene.poly_array[i];
+        if( POLY1_TEXTURED(poly->context[0]) ) {
+            poly->tex_id = texcache_get_texture_deferred( poly->context[1], poly->context[2] );
+            if( poly->mod_vertex_index != -1 ) {
+                if( pvr2_scene.shadow_mode == SHADOW_FULL ) {
+                    poly->mod_tex_id = texcache_get_texture_deferred( poly->context[3], poly->context[4] );
+                } else {
+                    poly->mod_tex_id = poly->tex_id;
                 }
-                free(req);
-            });
-        }
-        dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
-    }
-#else
-    {
-        int i;
-        for( i=0; i<total; i++ ) {
-            struct polygon_struct *poly = &pvr2_scene.poly_array[i];
-            if( POLY1_TEXTURED(poly->context[0]) ) {
-                poly->tex_id = texcache_get_texture( poly->context[1], poly->context[2] );
-                if( poly->mod_vertex_index != -1 ) {
-                    if( pvr2_scene.shadow_mode == SHADOW_FULL ) {
-                        poly->mod_tex_id = texcache_get_texture( poly->context[3], poly->context[4] );
-                    } else {
-                        poly->mod_tex_id = poly->tex_id;
-                    }
-                }
-            } else {
-                poly->tex_id = 0;
-                poly->mod_tex_id = 0;
             }
+        } else {
+            poly->tex_id = 0;
+            poly->mod_tex_id = 0;
         }
     }
-#endif
+    texcache_load_deferred();
 }
 
 
@@ -236,7 +148,7 @@ void pvr2_setup_gl_context()
     CGL_MACRO_CONTEXT = CGLGetCurrentContext();
 #endif
     gls_init();
-    texcache_gl_init(); // Allocate texture IDs
+    texcache_gl_init(); // Palette texture
 
     /* Global settings */
     glDisable( GL_CULL_FACE );
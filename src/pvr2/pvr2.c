@@ -667,12 +667,17 @@ void pvr2_draw_frame()
     } else if( now_ms - stats_last_ms >= 2000 ) {
         extern uint64_t pvr2_texcache_bytes_uploaded_consume(void);
         uint64_t up_bytes = pvr2_texcache_bytes_uploaded_consume();
-        fprintf(stderr, "[mxdream] fps=%u presents=%u pace=%s divisor=%d qdepth=%d/%d uploads=%lluKB/2s\n",
+        uint64_t decode_us = pvr2_texcache_decode_us_consume();
+        uint32_t reval_hits, reval_misses;
+        pvr2_texcache_revalidate_consume( &reval_hits, &reval_misses );
+        fprintf(stderr, "[mxdream] fps=%u presents=%u pace=%s divisor=%d qdepth=%d/%d uploads=%lluKB/2s decode=%llums/2s reval_hits=%u reval_misses=%u\n",
                 stats_frames, stats_presents,
                 (pace_mode==PACE_60?"60":(pace_mode==PACE_30?"30":"auto")),
                 present_divisor,
                 present_q_count, present_queue_capacity(),
-                (unsigned long long)(up_bytes/1024ULL));
+                (unsigned long long)(up_bytes/1024ULL),
+                (unsigned long long)(decode_us/1000ULL),
+                reval_hits, reval_misses);
         stats_frames = 0;
         stats_presents = 0;
         stats_last_ms = now_ms;
@@ -791,7 +796,11 @@ MMIO_REGION_WRITE_FN( PVR2, reg, val )
         pvr2_scene_read();
         render_buffer_t buffer = pvr2_next_render_buffer();
         if( buffer != NULL ) {
-            pvr2_scene_render( buffer );
+            if( display_driver->render_scene != NULL ) {
+                display_driver->render_scene( buffer );
+            } else {
+                pvr2_scene_render( buffer );
+            }
             if( buffer->address < PVR2_RAM_BASE ) {
                 // Flush immediately - optimize this later. Otherwise this gets
                 // complicated very quickly trying to second-guess how it's
@@ -176,6 +176,13 @@ void pvr2_vram64_write_stride( sh4addr_t dest, unsigned char *src, uint32_t line
  */
 void pvr2_vram64_read( unsigned char *dest, sh4addr_t src, uint32_t length );
 
+/**
+ * Compute a 64-bit hash of a region of the interleaved memory address space
+ * (aka 64-bit address space), for detecting whether its contents have
+ * changed. The region is rounded out to 64-bit alignment.
+ */
+uint64_t pvr2_vram64_hash( sh4addr_t src, uint32_t length );
+
 /**
  * Read a twiddled image from interleaved memory address space (aka 64-bit address
  * space), writing the image to the destination buffer in detwiddled format.
@@ -297,6 +304,29 @@ void render_backplane( uint32_t *polygon, uint32_t width, uint32_t height, uint3
 void render_autosort_tile( pvraddr_t tile_entry, int render_mode );
 
 struct polygon_struct;
+
+/**
+ * Depth-sort the triangles in a tile list (back to front, in the same way
+ * as render_autosort_tile), and pass each in turn to the supplied function.
+ * Doesn't touch any GL state.
+ */
+void sort_tile_triangles( pvraddr_t tile_entry,
+                          void (*render_triangle)( struct polygon_struct *poly, int index, void *data ),
+                          void *data );
+
+/**
+ * Render the current scene on the CPU (without GL) into an array of
+ * ARGB8888 pixels, top row first. The scene must already have been read
+ * with pvr2_scene_read().
+ */
+void pvr2_scene_render_soft( uint32_t *pixels, uint32_t width, uint32_t height );
+
+/**
+ * Release the software renderer's worker threads. The next render starts a
+ * new pool (re-reading LXDREAM_SOFT_THREADS).
+ */
+void pvr2_scene_render_soft_shutdown( void );
+
 void gl_render_triangle( struct polygon_struct *poly, int index );
 
 void gl_render_tilelist( pvraddr_t tile_entry, gboolean set_depth );
@@ -363,11 +393,16 @@ void texcache_flush( void );
 void texcache_invalidate_palette(void);
 
 /**
- * Evict all textures contained in the page identified by a texture address.
+ * Flag all textures contained in the page identified by a texture address
+ * as possibly modified. Each is re-hashed when next used, and reloaded only
+ * if its contents have actually changed.
  */
 void texcache_invalidate_page( uint32_t texture_addr );
 /** Return and reset rolling bytes uploaded counter (since last call) */
 uint64_t pvr2_texcache_bytes_uploaded_consume(void);
+/** Return and reset rolling counts of re-hashed textures found unchanged (hits) and changed (misses) */
+void pvr2_texcache_revalidate_consume( uint32_t *hits, uint32_t *misses );
+uint64_t pvr2_texcache_decode_us_consume(void);
 /** Mark a VRAM region [addr, addr+length) as dirty for selective invalidation */
 void texcache_mark_region_dirty(uint32_t addr, uint32_t length);
 
@@ -388,11 +423,37 @@ void texcache_begin_scene( uint32_t palette_mode, uint32_t stride_width );
  * bound. Otherwise obtain an unused texture ID and set it up appropriately.
  */
 GLuint texcache_get_texture( uint32_t poly2_word, uint32_t texture_word );
+
+/**
+ * As texcache_get_texture, but on a miss the texture is only queued for
+ * loading - the returned ID has no contents until the next call to
+ * texcache_load_deferred().
+ */
+GLuint texcache_get_texture_deferred( uint32_t poly2_word, uint32_t texture_word );
+
+/**
+ * Load all textures queued by texcache_get_texture_deferred(). Decoding is
+ * done in parallel on a thread pool (LXDREAM_TEX_THREADS threads, default one
+ * per CPU), followed by the GL uploads on the calling thread.
+ */
+void texcache_load_deferred( void );
 /* Palette GL texture id (1024x1 strip) for binding on texture unit 1 */
 GLuint texcache_get_palette_gltex(void);
 
 render_buffer_t texcache_get_render_buffer( uint32_t texture_addr, int mode, int width, int height );
 
+/**
+ * Decode the largest level of a texture to ARGB8888 (0xAARRGGBB) on the CPU,
+ * independently of the GL texture cache. Palette textures are looked up in
+ * the current palette RAM. Safe to call from multiple threads at once.
+ * @param out width*height pixels (width*width for mip-mapped textures)
+ * @param palette_mode palette format, as for texcache_begin_scene
+ * @param stride_width stride for stride textures, as for texcache_begin_scene
+ * @return FALSE if the texture format isn't supported (bumpmaps).
+ */
+gboolean texcache_decode_texture_argb( uint32_t *out, uint32_t texture_word, int width, int height,
+                                       uint32_t palette_mode, uint32_t stride_width );
+
 void pvr2_check_palette_changed(void);
 
 int pvr2_render_save_scene( const gchar *filename );
@@ -452,6 +513,7 @@ extern int pvr2_render_colour_format[8];
 #define NO_POINTER          0x80000000
 #define IS_TILE_PTR(p)      ( ((p)&NO_POINTER) == 0 )
 #define IS_LAST_SEGMENT(s)  (((s)->control) & SEGMENT_END)
+#define IS_NONEMPTY_TILE_LIST(p) (IS_TILE_PTR(p) && ((*((uint32_t *)(pvr2_main_ram+(p))) >> 28) != 0x0F))
 
 struct tile_segment {
     uint32_t control;
@@ -20,6 +20,7 @@
 #include <errno.h>
 #include "sh4/sh4core.h"
 #include "pvr2.h"
+#include "pvr2/texdecode.h"
 #include "asic.h"
 #include "dream.h"
 
@@ -358,97 +359,6 @@ void pvr2_vram64_read_stride( unsigned char *dest, uint32_t dest_line_bytes, sh4
 }
 
 
-/**
- * @param dest Destination image buffer
- * @param banks Source data expressed as two bank pointers
- * @param offset Offset into banks[0] specifying where the next byte
- *  to read is (0..3)
- * @param x1,y1 Destination coordinates
- * @param width Width of current destination block
- * @param stride Total width of image (ie stride) in bytes
- */
-
-static void pvr2_vram64_detwiddle_4( uint8_t *dest, uint8_t *banks[2], int offset,
-                                     int x1, int y1, int width, int stride )
-{
-    if( width == 2 ) {
-        x1 = x1 >> 1;
-        uint8_t t1 = *banks[offset<4?0:1]++;
-        uint8_t t2 = *banks[offset<3?0:1]++;
-        dest[y1*stride + x1] = (t1 & 0x0F) | (t2<<4);
-        dest[(y1+1)*stride + x1] = (t1>>4) | (t2&0xF0);
-    } else if( width == 4 ) {
-        pvr2_vram64_detwiddle_4( dest, banks, offset, x1, y1, 2, stride );
-        pvr2_vram64_detwiddle_4( dest, banks, offset+2, x1, y1+2, 2, stride );
-        pvr2_vram64_detwiddle_4( dest, banks, offset+4, x1+2, y1, 2, stride );
-        pvr2_vram64_detwiddle_4( dest, banks, offset+6, x1+2, y1+2, 2, stride );
-
-    } else {
-        int subdivide = width >> 1;
-        pvr2_vram64_detwiddle_4( dest, banks, offset, x1, y1, subdivide, stride );
-        pvr2_vram64_detwiddle_4( dest, banks, offset, x1, y1+subdivide, subdivide, stride );
-        pvr2_vram64_detwiddle_4( dest, banks, offset, x1+subdivide, y1, subdivide, stride );
-        pvr2_vram64_detwiddle_4( dest, banks, offset, x1+subdivide, y1+subdivide, subdivide, stride );
-    }
-}
-
-/**
- * @param dest Destination image buffer
- * @param banks Source data expressed as two bank pointers
- * @param offset Offset into banks[0] specifying where the next byte
- *  to read is (0..3)
- * @param x1,y1 Destination coordinates
- * @param width Width of current destination block
- * @param stride Total width of image (ie stride)
- */
-
-static void pvr2_vram64_detwiddle_8( uint8_t *dest, uint8_t *banks[2], int offset,
-                                     int x1, int y1, int width, int stride )
-{
-    if( width == 2 ) {
-        dest[y1*stride + x1] = *banks[0]++;
-        dest[(y1+1)*stride + x1] = *banks[offset<3?0:1]++;
-        dest[y1*stride + x1 + 1] = *banks[offset<2?0:1]++;
-        dest[(y1+1)*stride + x1 + 1] = *banks[offset==0?0:1]++;
-        uint8_t *tmp = banks[0]; /* swap banks */
-        banks[0] = banks[1];
-        banks[1] = tmp;
-    } else {
-        int subdivide = width >> 1;
-        pvr2_vram64_detwiddle_8( dest, banks, offset, x1, y1, subdivide, stride );
-        pvr2_vram64_detwiddle_8( dest, banks, offset, x1, y1+subdivide, subdivide, stride );
-        pvr2_vram64_detwiddle_8( dest, banks, offset, x1+subdivide, y1, subdivide, stride );
-        pvr2_vram64_detwiddle_8( dest, banks, offset, x1+subdivide, y1+subdivide, subdivide, stride );
-    }
-}
-
-/**
- * @param dest Destination image buffer
- * @param banks Source data expressed as two bank pointers
- * @param offset Offset into banks[0] specifying where the next word
- *  to read is (0 or 1)
- * @param x1,y1 Destination coordinates
- * @param width Width of current destination block
- * @param stride Total width of image (ie stride)
- */
-
-static void pvr2_vram64_detwiddle_16( uint16_t *dest, uint16_t *banks[2], int offset,
-                                      int x1, int y1, int width, int stride )
-{
-    if( width == 2 ) {
-        dest[y1*stride + x1] = *banks[0]++;
-        dest[(y1+1)*stride + x1] = *banks[offset]++;
-        dest[y1*stride + x1 + 1] = *banks[1]++;
-        dest[(y1+1)*stride + x1 + 1] = *banks[offset^1]++;
-    } else {
-        int subdivide = width >> 1;
-        pvr2_vram64_detwiddle_16( dest, banks, offset, x1, y1, subdivide, stride );
-        pvr2_vram64_detwiddle_16( dest, banks, offset, x1, y1+subdivide, subdivide, stride );
-        pvr2_vram64_detwiddle_16( dest, banks, offset, x1+subdivide, y1, subdivide, stride );
-        pvr2_vram64_detwiddle_16( dest, banks, offset, x1+subdivide, y1+subdivide, subdivide, stride );
-    }
-}
-
 /**
  * Read an image from 64-bit vram stored as twiddled 4-bit pixels. The
  * image is written out to the destination in detwiddled form.
@@ -459,37 +369,7 @@ static void pvr2_vram64_detwiddle_16( uint16_t *dest, uint16_t *banks[2], int of
  */
 void pvr2_vram64_read_twiddled_4( unsigned char *dest, sh4addr_t srcaddr, uint32_t width, uint32_t height )
 {
-    int offset_flag = (srcaddr & 0x07);
-    uint8_t *banks[2];
-    uint8_t *wdest = (uint8_t*)dest;
-    uint32_t stride = width >> 1;
-    int i;
-
-    srcaddr = srcaddr & 0x7FFFF8;
-
-    banks[0] = (uint8_t *)(pvr2_main_ram + (srcaddr>>1));
-    banks[1] = banks[0] + 0x400000;
-    if( offset_flag & 0x04 ) { // If source is not 64-bit aligned, swap the banks
-        uint8_t *tmp = banks[0];
-        banks[0] = banks[1];
-        banks[1] = tmp + 4;
-        offset_flag &= 0x03;
-    }
-    banks[0] += offset_flag;
-
-    if( width > height ) {
-        for( i=0; i<width; i+=height ) {
-            pvr2_vram64_detwiddle_4( wdest, banks, offset_flag, i, 0, height, stride );
-        }
-    } else if( height > width ) {
-        for( i=0; i<height; i+=width ) {
-            pvr2_vram64_detwiddle_4( wdest, banks, offset_flag, 0, i, width, stride );
-        }
-    } else if( width == 1 ) {
-        *wdest = *banks[0];
-    } else {
-        pvr2_vram64_detwiddle_4( wdest, banks, offset_flag, 0, 0, width, stride );
-    }
+    texdecode->read_twiddled_4( dest, pvr2_main_ram, srcaddr, width, height );
 }
 
 /**
@@ -502,36 +382,7 @@ void pvr2_vram64_read_twiddled_4( unsigned char *dest, sh4addr_t srcaddr, uint32
  */
 void pvr2_vram64_read_twiddled_8( unsigned char *dest, sh4addr_t srcaddr, uint32_t width, uint32_t height )
 {
-    int offset_flag = (srcaddr & 0x07);
-    uint8_t *banks[2];
-    uint8_t *wdest = (uint8_t*)dest;
-    int i;
-
-    srcaddr = srcaddr & 0x7FFFF8;
-
-    banks[0] = (uint8_t *)(pvr2_main_ram + (srcaddr>>1));
-    banks[1] = banks[0] + 0x400000;
-    if( offset_flag & 0x04 ) { // If source is not 64-bit aligned, swap the banks
-        uint8_t *tmp = banks[0];
-        banks[0] = banks[1];
-        banks[1] = tmp + 4;
-        offset_flag &= 0x03;
-    }
-    banks[0] += offset_flag;
-
-    if( width > height ) {
-        for( i=0; i<width; i+=height ) {
-            pvr2_vram64_detwiddle_8( wdest, banks, offset_flag, i, 0, height, width );
-        }
-    } else if( height > width ) {
-        for( i=0; i<height; i+=width ) {
-            pvr2_vram64_detwiddle_8( wdest, banks, offset_flag, 0, i, width, width );
-        }
-    } else if( width == 1 ) {
-        *wdest = *banks[0];
-    } else {
-        pvr2_vram64_detwiddle_8( wdest, banks, offset_flag, 0, 0, width, width );
-    }
+    texdecode->read_twiddled_8( dest, pvr2_main_ram, srcaddr, width, height );
 }
 
 /**
@@ -542,38 +393,9 @@ void pvr2_vram64_read_twiddled_8( unsigned char *dest, sh4addr_t srcaddr, uint32
  * @param width image width (must be a power of 2)
  * @param height image height (must be a power of 2)
  */
-void pvr2_vram64_read_twiddled_16( unsigned char *dest, sh4addr_t srcaddr, uint32_t width, uint32_t height ) {
-    int offset_flag = (srcaddr & 0x06) >> 1;
-    uint16_t *banks[2];
-    uint16_t *wdest = (uint16_t*)dest;
-    int i;
-
-    srcaddr = srcaddr & 0x7FFFF8;
-
-    banks[0] = (uint16_t *)(pvr2_main_ram + (srcaddr>>1));
-    banks[1] = banks[0] + 0x200000;
-    if( offset_flag & 0x02 ) { // If source is not 64-bit aligned, swap the banks
-        uint16_t *tmp = banks[0];
-        banks[0] = banks[1];
-        banks[1] = tmp + 2;
-        offset_flag &= 0x01;
-    }
-    banks[0] += offset_flag;
-
-
-    if( width > height ) {
-        for( i=0; i<width; i+=height ) {
-            pvr2_vram64_detwiddle_16( wdest, banks, offset_flag, i, 0, height, width );
-        }
-    } else if( height > width ) {
-        for( i=0; i<height; i+=width ) {
-            pvr2_vram64_detwiddle_16( wdest, banks, offset_flag, 0, i, width, width );
-        }
-    } else if( width == 1 ) {
-        *wdest = *banks[0];
-    } else {
-        pvr2_vram64_detwiddle_16( wdest, banks, offset_flag, 0, 0, width, width );
-    }
+void pvr2_vram64_read_twiddled_16( unsigned char *dest, sh4addr_t srcaddr, uint32_t width, uint32_t height )
+{
+    texdecode->read_twiddled_16( dest, pvr2_main_ram, srcaddr, width, height );
 }
 
 static void pvr2_vram_write_invert( sh4addr_t destaddr, unsigned char *src, uint32_t src_size, 
@@ -683,6 +505,67 @@ void pvr2_vram64_read( unsigned char *dest, sh4addr_t srcaddr, uint32_t length )
     }
 }
 
+#define VRAM_HASH_PRIME1 0x9E3779B185EBCA87ULL
+#define VRAM_HASH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define VRAM_HASH_PRIME3 0x165667B19E3779F9ULL
+
+static inline uint64_t pvr2_vram_hash_round( uint64_t acc, uint64_t val )
+{
+    acc += val * VRAM_HASH_PRIME2;
+    acc = (acc << 31) | (acc >> 33);
+    return acc * VRAM_HASH_PRIME1;
+}
+
+/**
+ * Hash a region of the 64-bit address space. The region is widened to
+ * 64-bit alignment, which makes it a single contiguous run in each bank, so
+ * each bank is hashed in place (two lanes apiece) rather than copied out.
+ */
+uint64_t pvr2_vram64_hash( sh4addr_t srcaddr, uint32_t length )
+{
+    uint64_t acc[4] = { VRAM_HASH_PRIME1, VRAM_HASH_PRIME2, VRAM_HASH_PRIME3, 0 };
+    uint32_t endaddr, bank_bytes, i;
+    unsigned char *banks[2];
+    uint64_t hash;
+
+    srcaddr = srcaddr & 0x7FFFFF;
+    endaddr = (srcaddr + length + 7) & 0xFFFFFFF8;
+    srcaddr = srcaddr & 0x7FFFF8;
+    if( endaddr > 0x800000 )
+        endaddr = 0x800000;
+    bank_bytes = (endaddr - srcaddr) >> 1;
+
+    banks[0] = pvr2_main_ram + (srcaddr>>1);
+    banks[1] = banks[0] + 0x400000;
+
+    for( i=0; i+16 <= bank_bytes; i+=16 ) {
+        uint64_t val[4];
+        memcpy( &val[0], banks[0] + i, 16 );
+        memcpy( &val[2], banks[1] + i, 16 );
+        acc[0] = pvr2_vram_hash_round( acc[0], val[0] );
+        acc[1] = pvr2_vram_hash_round( acc[1], val[1] );
+        acc[2] = pvr2_vram_hash_round( acc[2], val[2] );
+        acc[3] = pvr2_vram_hash_round( acc[3], val[3] );
+    }
+    for( ; i < bank_bytes; i+=4 ) {
+        uint32_t val[2];
+        memcpy( &val[0], banks[0] + i, 4 );
+        memcpy( &val[1], banks[1] + i, 4 );
+        acc[0] = pvr2_vram_hash_round( acc[0], val[0] );
+        acc[2] = pvr2_vram_hash_round( acc[2], val[1] );
+    }
+
+    hash = ((acc[0] << 1) | (acc[0] >> 63)) + ((acc[1] << 7) | (acc[1] >> 57)) +
+           ((acc[2] << 12) | (acc[2] >> 52)) + ((acc[3] << 18) | (acc[3] >> 46));
+    hash += bank_bytes;
+    hash ^= hash >> 33;
+    hash *= VRAM_HASH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= VRAM_HASH_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
 void pvr2_vram64_dump_file( sh4addr_t addr, uint32_t length, gchar *filename )
 {
     uint32_t tmp[length>>2];
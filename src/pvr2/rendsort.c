@@ -167,14 +167,6 @@ int sort_extract_triangles( pvraddr_t tile_entry, struct sort_triangle *triangle
 
 }
 
-void sort_render_triangles( struct sort_triangle **triangles, int num_triangles )
-{
-    int i;
-    for( i=0; i<num_triangles; i++ ) {
-        gl_render_triangle(triangles[i]->poly, triangles[i]->triangle_num);
-    }
-}
-
 static int sort_triangle_compare( const void *a, const void *b ) 
 {
     const struct sort_triangle *tri1 = a;
@@ -259,6 +251,38 @@ static void sort_triangles( struct sort_triangle **triangles, int num_triangles,
     }
 } 
 
+void sort_tile_triangles( pvraddr_t tile_entry,
+                          void (*render_triangle)( struct polygon_struct *poly, int index, void *data ),
+                          void *data )
+{
+    int num_triangles = sort_count_triangles(tile_entry);
+    if( num_triangles == 0 ) {
+        return; /* nothing to do */
+    } else {
+        int i;
+        struct sort_triangle triangles[num_triangles+1];
+        struct sort_triangle *triangle_order[num_triangles+1];
+        triangles[num_triangles].poly = (void *)SENTINEL;
+        for( i=0; i<num_triangles; i++ ) {
+            triangle_order[i] = &triangles[i];
+        }
+        int extracted_triangles = sort_extract_triangles(tile_entry, triangles);
+        assert( extracted_triangles <= num_triangles );
+        if( extracted_triangles > 1 ) {
+            sort_triangles( triangle_order, extracted_triangles, triangle_order );
+        }
+        for( i=0; i<extracted_triangles; i++ ) {
+            render_triangle( triangle_order[i]->poly, triangle_order[i]->triangle_num, data );
+        }
+        assert( triangles[num_triangles].poly == (void *)SENTINEL );
+    }
+}
+
+static void gl_render_sorted_triangle( struct polygon_struct *poly, int index, void *data )
+{
+    gl_render_triangle( poly, index );
+}
+
 void render_autosort_tile( pvraddr_t tile_entry, int render_mode ) 
 {
     const char *sort_en = getenv("LXDREAM_SORT_OPAQUE");
@@ -275,19 +299,8 @@ void render_autosort_tile( pvraddr_t tile_entry, int render_mode )
         glDepthFunc(GL_GEQUAL);
         gl_render_tilelist(tile_entry, FALSE);
     } else { /* Ooh boy here we go... */
-        int i;
-        struct sort_triangle triangles[num_triangles+1];
-        struct sort_triangle *triangle_order[num_triangles+1];
-        triangles[num_triangles].poly = (void *)SENTINEL;
-        for( i=0; i<num_triangles; i++ ) {
-            triangle_order[i] = &triangles[i];
-        }
-        int extracted_triangles = sort_extract_triangles(tile_entry, triangles);
-        assert( extracted_triangles <= num_triangles );
-        sort_triangles( triangle_order, extracted_triangles, triangle_order );
         glDepthMask(GL_FALSE);
         glDepthFunc(GL_GEQUAL);
-        sort_render_triangles(triangle_order, extracted_triangles);
-        assert( triangles[num_triangles].poly == (void *)SENTINEL );
+        sort_tile_triangles( tile_entry, gl_render_sorted_triangle, NULL );
     }
 }
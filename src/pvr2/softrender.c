@@ -0,0 +1,907 @@
+/**
+ * $Id$
+ *
+ * Software renderer for PVR2 scenes, for hosts without usable GL. Works
+ * directly from pvr2_scene, in the same way as the hardware: the screen is
+ * split into 32x32 tiles, and each tile is rendered independently (with its
+ * own depth and stencil buffers) from the segment's tile lists. Tiles are
+ * distributed across a pool of worker threads.
+ *
+ * The output for a given scene doesn't depend on the number of threads, as
+ * every pixel is only ever touched by the thread rendering its tile, in the
+ * same order. Rasterization uses fixed-point edge functions with a top-left
+ * fill rule, so triangles sharing an edge never both draw the same pixel.
+ *
+ * Passes are the same as for the GL renderer (background, opaque,
+ * punch-through, translucent), with the differences that:
+ *   - Modifier volumes are tested against the depth of the opaque polygons
+ *     rather than against an empty depth buffer.
+ *   - Textures are bilinear-filtered from the top mip level only.
+ *   - Flat shading applies to all colours (as on the PVR2).
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include "lxdream.h"
+#include "display.h"
+#include "tpool.h"
+#include "pvr2/pvr2.h"
+#include "pvr2/pvr2mmio.h"
+#include "pvr2/scene.h"
+#include "pvr2/tileiter.h"
+
+#define TILE_SIZE 32
+#define TILE_PIXELS (TILE_SIZE*TILE_SIZE)
+
+/** Rasterization is done in fixed point with 4 bits of sub-pixel precision */
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_HALF (1<<(SUBPIXEL_BITS-1))
+/** Vertex coordinates are clamped to +/- this before rasterization */
+#define MAX_COORD 32768.0f
+
+#define DEPTH_NEVER   0
+#define DEPTH_GEQUAL  6
+#define DEPTH_ALWAYS  7
+
+/* Stencil bit 1 is set where an opaque modifier volume applies (as for the
+ * GL renderer); bit 0 is used while processing each volume */
+#define STENCIL_ANY -1
+#define STENCIL_CLEAR 0
+#define STENCIL_SET 2
+
+struct soft_texture {
+    uint32_t texture_word;
+    uint32_t size_bits; /* Size fields from the poly2 word */
+    int width, height;
+    uint32_t *pixels;   /* Top level as ARGB8888, or NULL if not supported */
+    gboolean used;
+};
+
+/**
+ * Scene-wide state, shared (read-only) by the tile workers
+ */
+static struct {
+    uint32_t *pixels;
+    uint32_t width, height;
+    uint32_t tiles_x, tiles_y;
+    uint32_t clip_bounds[4];
+    float alpha_ref;
+
+    /* Open-addressed hash table of the scene's textures. Texture ids are
+     * (slot+1), or 0 for none */
+    struct soft_texture *textures;
+    uint32_t texture_mask;
+    uint32_t *decode_list;
+    uint32_t decode_count;
+    /* Texture ids for each polygon in pvr2_scene.poly_array, normal then
+     * modified (the polygons' own tex_id fields belong to the GL renderer) */
+    uint32_t *poly_tex_ids;
+
+    /* Segments for each tile, in list order */
+    int *tile_first_segment;
+    int *segment_next;
+} soft_scene;
+
+static tpool_t soft_pool = NULL;
+
+struct soft_tile {
+    uint32_t x0, y0;      /* Position of the tile in the buffer */
+    uint32_t bounds[4];   /* Current clip rectangle x1,x2,y1,y2 (absolute) */
+    uint32_t colour[TILE_PIXELS];
+    float depth[TILE_PIXELS];
+    uint8_t stencil[TILE_PIXELS];
+};
+
+/**
+ * Per-draw render state, the equivalent of the GL context setup
+ */
+struct soft_draw {
+    uint32_t poly1, poly2;
+    struct soft_texture *tex;
+    int depth_mode;         /* PVR2 depth compare mode */
+    gboolean depth_write;
+    gboolean blend;
+    gboolean depth_only;
+    float alpha_ref;
+    int stencil;            /* STENCIL_ANY, STENCIL_CLEAR, or STENCIL_SET */
+};
+
+/**
+ * Triangle setup: edge functions in fixed point, evaluated at pixel centres.
+ * Edge i is opposite vertex i, and is positive inside the triangle.
+ */
+struct soft_triangle {
+    int x1, x2, y1, y2;     /* Pixel bounds, clipped to the tile */
+    int64_t edge[3];        /* Edge values at (x1,y1) */
+    int64_t step_x[3], step_y[3];
+    int64_t bias[3];        /* 0 if the edge owns pixels exactly on it, else 1 */
+    float inv_area;
+};
+
+/****************************** Textures *******************************/
+
+static inline uint32_t soft_texture_hash( uint32_t texture_word, uint32_t size_bits )
+{
+    uint32_t h = (texture_word ^ (size_bits << 26)) * 0x9E3779B1;
+    return h ^ (h >> 15);
+}
+
+/**
+ * Find (or add) the texture for the given poly2/texture words.
+ * @return the texture id (slot+1)
+ */
+static uint32_t soft_texture_lookup( uint32_t poly2, uint32_t texture_word )
+{
+    uint32_t size_bits = poly2 & 0x3F;
+    uint32_t slot = soft_texture_hash( texture_word, size_bits ) & soft_scene.texture_mask;
+    for(;;) {
+        struct soft_texture *tex = &soft_scene.textures[slot];
+        if( !tex->used ) {
+            tex->used = TRUE;
+            tex->texture_word = texture_word;
+            tex->size_bits = size_bits;
+            tex->width = POLY2_TEX_WIDTH(poly2);
+            tex->height = PVR2_TEX_IS_MIPMAPPED(texture_word) ? tex->width : POLY2_TEX_HEIGHT(poly2);
+            tex->pixels = NULL;
+            soft_scene.decode_list[soft_scene.decode_count++] = slot;
+            return slot+1;
+        } else if( tex->texture_word == texture_word && tex->size_bits == size_bits ) {
+            return slot+1;
+        }
+        slot = (slot+1) & soft_scene.texture_mask;
+    }
+}
+
+static void soft_decode_texture( void *data, unsigned index )
+{
+    struct soft_texture *tex = &soft_scene.textures[soft_scene.decode_list[index]];
+    uint32_t palette_mode = MMIO_READ( PVR2, RENDER_PALETTE ) & 0x03;
+    uint32_t stride = (MMIO_READ( PVR2, RENDER_TEXSIZE ) & 0x003F) << 5;
+    uint32_t *pixels = g_malloc( tex->width * tex->height * sizeof(uint32_t) );
+    if( texcache_decode_texture_argb( pixels, tex->texture_word, tex->width, tex->height,
+                                      palette_mode, stride ) ) {
+        tex->pixels = pixels;
+    } else {
+        g_free( pixels );
+    }
+}
+
+/**
+ * Assign texture ids to all polygons in the scene, and decode the textures
+ * (in parallel).
+ */
+static void soft_load_textures( void )
+{
+    uint32_t i, count = 0, size = 16;
+    for( i=0; i<pvr2_scene.poly_count; i++ ) {
+        if( POLY1_TEXTURED(pvr2_scene.poly_array[i].context[0]) ) {
+            count += pvr2_scene.poly_array[i].mod_vertex_index == -1 ? 1 : 2;
+        }
+    }
+    while( size < count * 2 ) {
+        size <<= 1;
+    }
+    soft_scene.textures = g_malloc0( size * sizeof(struct soft_texture) );
+    soft_scene.texture_mask = size-1;
+    soft_scene.decode_list = g_malloc( size * sizeof(uint32_t) );
+    soft_scene.decode_count = 0;
+    soft_scene.poly_tex_ids = g_malloc0( pvr2_scene.poly_count * 2 * sizeof(uint32_t) );
+
+    for( i=0; i<pvr2_scene.poly_count; i++ ) {
+        struct polygon_struct *poly = &pvr2_scene.poly_array[i];
+        uint32_t *tex_ids = &soft_scene.poly_tex_ids[i*2];
+        if( POLY1_TEXTURED(poly->context[0]) ) {
+            tex_ids[0] = soft_texture_lookup( poly->context[1], poly->context[2] );
+            if( poly->mod_vertex_index != -1 ) {
+                if( pvr2_scene.shadow_mode == SHADOW_FULL ) {
+                    tex_ids[1] = soft_texture_lookup( poly->context[3], poly->context[4] );
+                } else {
+                    tex_ids[1] = tex_ids[0];
+                }
+            }
+        }
+    }
+
+    tpool_run( soft_pool, soft_scene.decode_count, soft_decode_texture, NULL );
+}
+
+static void soft_free_textures( void )
+{
+    uint32_t i;
+    for( i=0; i<soft_scene.decode_count; i++ ) {
+        g_free( soft_scene.textures[soft_scene.decode_list[i]].pixels );
+    }
+    g_free( soft_scene.textures );
+    g_free( soft_scene.decode_list );
+    g_free( soft_scene.poly_tex_ids );
+    soft_scene.textures = NULL;
+    soft_scene.decode_list = NULL;
+    soft_scene.poly_tex_ids = NULL;
+}
+
+static inline int soft_wrap( int i, int size, gboolean clamp, gboolean mirror )
+{
+    if( clamp ) {
+        return i < 0 ? 0 : (i >= size ? size-1 : i);
+    } else if( mirror ) {
+        i &= (size<<1)-1;
+        return i < size ? i : (size<<1)-1-i;
+    } else {
+        return i & (size-1);
+    }
+}
+
+static inline void soft_unpack_argb( uint32_t p, float out[4] )
+{
+    out[0] = (float)((p >> 16) & 0xFF) * (1.0f/255.0f);
+    out[1] = (float)((p >> 8) & 0xFF) * (1.0f/255.0f);
+    out[2] = (float)(p & 0xFF) * (1.0f/255.0f);
+    out[3] = (float)(p >> 24) * (1.0f/255.0f);
+}
+
+/**
+ * Bilinear texture sample (as GL_LINEAR), with the wrap modes from the
+ * poly2 word. Result is RGBA.
+ */
+static void soft_sample_texture( const struct soft_texture *tex, uint32_t poly2,
+                                 float u, float v, float out[4] )
+{
+    float fu = u * tex->width - 0.5f;
+    float fv = v * tex->height - 0.5f;
+    float t00[4], t01[4], t10[4], t11[4];
+    int i;
+
+    /* Keep the integer conversion in range (and NaNs out of it) */
+    if( !(fu > -16777216.0f) ) fu = -16777216.0f; else if( fu > 16777216.0f ) fu = 16777216.0f;
+    if( !(fv > -16777216.0f) ) fv = -16777216.0f; else if( fv > 16777216.0f ) fv = 16777216.0f;
+
+    float bu = floorf(fu), bv = floorf(fv);
+    float au = fu - bu, av = fv - bv;
+    int iu = (int)bu, iv = (int)bv;
+    gboolean clamp_u = POLY2_TEX_CLAMP_U(poly2), mirror_u = POLY2_TEX_MIRROR_U(poly2);
+    gboolean clamp_v = POLY2_TEX_CLAMP_V(poly2), mirror_v = POLY2_TEX_MIRROR_V(poly2);
+    int u0 = soft_wrap( iu, tex->width, clamp_u, mirror_u );
+    int u1 = soft_wrap( iu+1, tex->width, clamp_u, mirror_u );
+    int v0 = soft_wrap( iv, tex->height, clamp_v, mirror_v ) * tex->width;
+    int v1 = soft_wrap( iv+1, tex->height, clamp_v, mirror_v ) * tex->width;
+
+    soft_unpack_argb( tex->pixels[v0+u0], t00 );
+    soft_unpack_argb( tex->pixels[v0+u1], t01 );
+    soft_unpack_argb( tex->pixels[v1+u0], t10 );
+    soft_unpack_argb( tex->pixels[v1+u1], t11 );
+    for( i=0; i<4; i++ ) {
+        float top = t00[i] + (t01[i] - t00[i]) * au;
+        float bottom = t10[i] + (t11[i] - t10[i]) * au;
+        out[i] = top + (bottom - top) * av;
+    }
+    if( !POLY2_TEX_ALPHA_ENABLE(poly2) ) {
+        out[3] = 1.0f;
+    }
+}
+
+/**************************** Rasterization *****************************/
+
+static inline int64_t soft_fixed_coord( float f )
+{
+    if( !(f > -MAX_COORD) ) {
+        f = -MAX_COORD;
+    } else if( f > MAX_COORD ) {
+        f = MAX_COORD;
+    }
+    return (int64_t)lrintf( f * (1<<SUBPIXEL_BITS) );
+}
+
+/**
+ * Setup the edge functions for a triangle, clipped to the given bounds.
+ * @return FALSE if the triangle has no area or lies outside the bounds.
+ */
+static gboolean soft_setup_triangle( struct soft_triangle *tri, const struct vertex_struct *v0,
+                                     const struct vertex_struct *v1, const struct vertex_struct *v2,
+                                     const uint32_t bounds[4] )
+{
+    int64_t x[3] = { soft_fixed_coord(v0->x), soft_fixed_coord(v1->x), soft_fixed_coord(v2->x) };
+    int64_t y[3] = { soft_fixed_coord(v0->y), soft_fixed_coord(v1->y), soft_fixed_coord(v2->y) };
+    int64_t minx = MIN(x[0], MIN(x[1], x[2])), maxx = MAX(x[0], MAX(x[1], x[2]));
+    int64_t miny = MIN(y[0], MIN(y[1], y[2])), maxy = MAX(y[0], MAX(y[1], y[2]));
+    int64_t area, px, py;
+    int i;
+
+    tri->x1 = MAX( (int64_t)bounds[0], minx >> SUBPIXEL_BITS );
+    tri->x2 = MIN( (int64_t)bounds[1], (maxx >> SUBPIXEL_BITS) + 1 );
+    tri->y1 = MAX( (int64_t)bounds[2], miny >> SUBPIXEL_BITS );
+    tri->y2 = MIN( (int64_t)bounds[3], (maxy >> SUBPIXEL_BITS) + 1 );
+    if( tri->x1 >= tri->x2 || tri->y1 >= tri->y2 ) {
+        return FALSE;
+    }
+
+    area = (x[1]-x[0])*(y[2]-y[0]) - (y[1]-y[0])*(x[2]-x[0]);
+    if( area == 0 ) {
+        return FALSE;
+    }
+
+    px = ((int64_t)tri->x1 << SUBPIXEL_BITS) + SUBPIXEL_HALF;
+    py = ((int64_t)tri->y1 << SUBPIXEL_BITS) + SUBPIXEL_HALF;
+    for( i=0; i<3; i++ ) {
+        int a = (i+1)%3, b = (i+2)%3;
+        int64_t dx = x[b] - x[a], dy = y[b] - y[a];
+        int64_t edge = dx*(py - y[a]) - dy*(px - x[a]);
+        int64_t step_x = -dy, step_y = dx;
+        if( area < 0 ) {
+            edge = -edge;
+            step_x = -step_x;
+            step_y = -step_y;
+        }
+        tri->edge[i] = edge;
+        tri->step_x[i] = step_x * (1 << SUBPIXEL_BITS);
+        tri->step_y[i] = step_y * (1 << SUBPIXEL_BITS);
+        tri->bias[i] = (step_x > 0 || (step_x == 0 && step_y > 0)) ? 0 : 1;
+    }
+    tri->inv_area = 1.0f / (float)(area < 0 ? -area : area);
+    return TRUE;
+}
+
+/**
+ * Depth values are 1/w (ie the value originally supplied to the TA), which
+ * is linear in screen space and increases towards the viewer.
+ */
+static inline float soft_vertex_depth( const struct vertex_struct *v )
+{
+    return v->z == 0 ? 0 : 1.0f / v->z;
+}
+
+static inline gboolean soft_depth_test( int mode, float z, float d )
+{
+    switch( mode ) {
+    case 0: return FALSE;
+    case 1: return z < d;
+    case 2: return z == d;
+    case 3: return z <= d;
+    case 4: return z > d;
+    case 5: return z != d;
+    case 6: return z >= d;
+    default: return TRUE;
+    }
+}
+
+static inline uint32_t soft_pack_channel( float f )
+{
+    if( !(f > 0.0f) ) {
+        return 0;
+    } else if( f >= 1.0f ) {
+        return 255;
+    }
+    return (uint32_t)(f * 255.0f + 0.5f);
+}
+
+/**
+ * Compute a blend factor (per the PVR2 src/dest blend field, which is
+ * interpreted the same way as the GL equivalents in pvr2_poly_srcblend and
+ * pvr2_poly_dstblend).
+ */
+static inline void soft_blend_factor( int mode, gboolean is_src, const float src[4],
+                                      const float dst[4], float out[4] )
+{
+    const float *other = is_src ? dst : src;
+    int i;
+    switch( mode ) {
+    case 0: out[0] = out[1] = out[2] = out[3] = 0.0f; break;
+    case 1: out[0] = out[1] = out[2] = out[3] = 1.0f; break;
+    case 2: for( i=0; i<4; i++ ) out[i] = other[i]; break;
+    case 3: for( i=0; i<4; i++ ) out[i] = 1.0f - other[i]; break;
+    case 4: out[0] = out[1] = out[2] = out[3] = src[3]; break;
+    case 5: out[0] = out[1] = out[2] = out[3] = 1.0f - src[3]; break;
+    case 6: out[0] = out[1] = out[2] = out[3] = dst[3]; break;
+    default: out[0] = out[1] = out[2] = out[3] = 1.0f - dst[3]; break;
+    }
+}
+
+/**
+ * Rasterize and shade one triangle into the tile, following the same
+ * shading model as the GL fragment shader (see shaders.glsl).
+ */
+static void soft_draw_triangle( struct soft_tile *tile, const struct soft_draw *draw,
+                                const struct vertex_struct *v0, const struct vertex_struct *v1,
+                                const struct vertex_struct *v2 )
+{
+    struct soft_triangle tri;
+    const struct vertex_struct *v[3] = { v0, v1, v2 };
+    float k[3], flat_rgba[4] = { 0 }, flat_offset[4] = { 0 };
+    const float *fog_colour = NULL;
+    gboolean perspective, flat = !POLY1_GOURAUD_SHADED(draw->poly1);
+    int tex_mode = (int)v2->tex_mode;
+    int x, y, i;
+
+    if( !soft_setup_triangle( &tri, v0, v1, v2, tile->bounds ) ) {
+        return;
+    }
+    for( i=0; i<3; i++ ) {
+        k[i] = soft_vertex_depth( v[i] );
+    }
+    perspective = k[0] > 0 && k[1] > 0 && k[2] > 0;
+    if( flat ) {
+        memcpy( flat_rgba, v2->rgba, sizeof(flat_rgba) );
+        memcpy( flat_offset, v2->offset_rgba, sizeof(flat_offset) );
+    }
+    switch( POLY2_FOG_MODE(draw->poly2) ) {
+    case PVR2_POLY_FOG_LOOKUP: fog_colour = pvr2_scene.fog_lut_colour; break;
+    case PVR2_POLY_FOG_VERTEX: fog_colour = pvr2_scene.fog_vert_colour; break;
+    }
+
+    int64_t row[3] = { tri.edge[0], tri.edge[1], tri.edge[2] };
+    for( y = tri.y1; y < tri.y2; y++ ) {
+        int64_t e[3] = { row[0], row[1], row[2] };
+        int idx = (y - tile->y0) * TILE_SIZE + (tri.x1 - tile->x0);
+        for( x = tri.x1; x < tri.x2; x++, idx++,
+             e[0] += tri.step_x[0], e[1] += tri.step_x[1], e[2] += tri.step_x[2] ) {
+            if( e[0] < tri.bias[0] || e[1] < tri.bias[1] || e[2] < tri.bias[2] ) {
+                continue;
+            }
+            if( draw->stencil != STENCIL_ANY && (tile->stencil[idx] & 0x02) != draw->stencil ) {
+                continue;
+            }
+
+            float b[3] = { (float)e[0] * tri.inv_area, (float)e[1] * tri.inv_area,
+                           (float)e[2] * tri.inv_area };
+            float z = b[0]*k[0] + b[1]*k[1] + b[2]*k[2];
+            if( !soft_depth_test( draw->depth_mode, z, tile->depth[idx] ) ) {
+                continue;
+            }
+            if( draw->depth_only ) {
+                if( draw->depth_write ) {
+                    tile->depth[idx] = z;
+                }
+                continue;
+            }
+
+            /* Perspective-correct interpolation weights */
+            float w[3];
+            if( perspective ) {
+                float q = 1.0f / z;
+                for( i=0; i<3; i++ ) {
+                    w[i] = b[i] * k[i] * q;
+                }
+            } else {
+                w[0] = b[0]; w[1] = b[1]; w[2] = b[2];
+            }
+
+            float rgba[4], offset[4], tex[4] = { 1.0f, 1.0f, 1.0f, 1.0f }, frag[4];
+            if( flat ) {
+                memcpy( rgba, flat_rgba, sizeof(rgba) );
+                memcpy( offset, flat_offset, sizeof(offset) );
+            } else {
+                for( i=0; i<4; i++ ) {
+                    rgba[i] = w[0]*v0->rgba[i] + w[1]*v1->rgba[i] + w[2]*v2->rgba[i];
+                    offset[i] = w[0]*v0->offset_rgba[i] + w[1]*v1->offset_rgba[i] + w[2]*v2->offset_rgba[i];
+                }
+            }
+            if( tex_mode != 2 && draw->tex != NULL && draw->tex->pixels != NULL ) {
+                float u = w[0]*v0->u + w[1]*v1->u + w[2]*v2->u;
+                float tv = w[0]*v0->v + w[1]*v1->v + w[2]*v2->v;
+                soft_sample_texture( draw->tex, draw->poly2, u, tv, tex );
+            }
+
+            if( tex_mode == 0 ) {
+                for( i=0; i<3; i++ ) {
+                    frag[i] = rgba[i] * tex[i] + offset[i];
+                }
+                frag[3] = rgba[3] * tex[3];
+            } else if( tex_mode >= 2 ) {
+                memcpy( frag, rgba, sizeof(frag) );
+            } else {
+                for( i=0; i<3; i++ ) {
+                    frag[i] = rgba[i] + (tex[i] - rgba[i]) * tex[3] + offset[i];
+                }
+                frag[3] = rgba[3];
+            }
+            if( frag[3] < draw->alpha_ref ) {
+                continue;
+            }
+            if( fog_colour != NULL ) {
+                float f = offset[3] < 0 ? -offset[3] : offset[3];
+                for( i=0; i<3; i++ ) {
+                    frag[i] = frag[i] + (fog_colour[i] - frag[i]) * f;
+                }
+            }
+            for( i=0; i<4; i++ ) {
+                frag[i] = frag[i] < 0.0f ? 0.0f : (frag[i] > 1.0f ? 1.0f : frag[i]);
+            }
+
+            if( draw->blend ) {
+                float dst[4], sf[4], df[4];
+                soft_unpack_argb( tile->colour[idx], dst );
+                soft_blend_factor( draw->poly2 >> 29, TRUE, frag, dst, sf );
+                soft_blend_factor( (draw->poly2 >> 26) & 0x07, FALSE, frag, dst, df );
+                for( i=0; i<4; i++ ) {
+                    frag[i] = frag[i]*sf[i] + dst[i]*df[i];
+                }
+            }
+            tile->colour[idx] = (soft_pack_channel(frag[3]) << 24) | (soft_pack_channel(frag[0]) << 16) |
+                    (soft_pack_channel(frag[1]) << 8) | soft_pack_channel(frag[2]);
+            if( draw->depth_write ) {
+                tile->depth[idx] = z;
+            }
+        }
+        for( i=0; i<3; i++ ) {
+            row[i] += tri.step_y[i];
+        }
+    }
+}
+
+/**
+ * Toggle stencil bit 0 wherever the triangle lies in front of the current
+ * depth.
+ */
+static void soft_draw_volume_triangle( struct soft_tile *tile, const struct vertex_struct *v0,
+                                       const struct vertex_struct *v1, const struct vertex_struct *v2 )
+{
+    struct soft_triangle tri;
+    float k[3] = { soft_vertex_depth(v0), soft_vertex_depth(v1), soft_vertex_depth(v2) };
+    int x, y, i;
+
+    if( !soft_setup_triangle( &tri, v0, v1, v2, tile->bounds ) ) {
+        return;
+    }
+    int64_t row[3] = { tri.edge[0], tri.edge[1], tri.edge[2] };
+    for( y = tri.y1; y < tri.y2; y++ ) {
+        int64_t e[3] = { row[0], row[1], row[2] };
+        int idx = (y - tile->y0) * TILE_SIZE + (tri.x1 - tile->x0);
+        for( x = tri.x1; x < tri.x2; x++, idx++,
+             e[0] += tri.step_x[0], e[1] += tri.step_x[1], e[2] += tri.step_x[2] ) {
+            if( e[0] >= tri.bias[0] && e[1] >= tri.bias[1] && e[2] >= tri.bias[2] ) {
+                float z = ((float)e[0]*k[0] + (float)e[1]*k[1] + (float)e[2]*k[2]) * tri.inv_area;
+                if( z > tile->depth[idx] ) {
+                    tile->stencil[idx] ^= 0x01;
+                }
+            }
+        }
+        for( i=0; i<3; i++ ) {
+            row[i] += tri.step_y[i];
+        }
+    }
+}
+
+/******************************* Polygons ********************************/
+
+static void soft_draw_strips( struct soft_tile *tile, const struct soft_draw *draw,
+                              struct polygon_struct *poly, gboolean modified )
+{
+    do {
+        struct vertex_struct *v = &pvr2_scene.vertex_array[modified ? poly->mod_vertex_index : poly->vertex_index];
+        unsigned i;
+        for( i=0; i+2 < poly->vertex_count; i++ ) {
+            soft_draw_triangle( tile, draw, &v[i], &v[i+1], &v[i+2] );
+        }
+        poly = poly->sub_next;
+    } while( poly != NULL );
+}
+
+/**
+ * @return the texture for the polygon (or its modified version), or NULL if
+ * it isn't textured
+ */
+static inline struct soft_texture *soft_get_texture( struct polygon_struct *poly, gboolean modified )
+{
+    uint32_t tex_id = soft_scene.poly_tex_ids[(poly - pvr2_scene.poly_array)*2 + (modified ? 1 : 0)];
+    return tex_id == 0 ? NULL : &soft_scene.textures[tex_id-1];
+}
+
+/**
+ * Render a polygon (and any modified version of it), as gl_render_poly.
+ * @param pass Template for the draw state: depth_mode < 0 uses the polygon's
+ * own depth mode, and depth_write == TRUE uses the polygon's depth write flag.
+ */
+static void soft_render_poly( struct soft_tile *tile, const struct soft_draw *pass,
+                              struct polygon_struct *poly )
+{
+    struct soft_draw draw = *pass;
+    if( poly->vertex_count == 0 )
+        return; /* Culled */
+
+    draw.poly1 = poly->context[0];
+    draw.poly2 = poly->context[1];
+    draw.tex = soft_get_texture( poly, FALSE );
+    if( pass->depth_mode < 0 ) {
+        draw.depth_mode = poly->context[0] >> 29;
+    }
+    draw.depth_write = pass->depth_write && POLY1_DEPTH_WRITE(poly->context[0]);
+
+    if( poly->mod_vertex_index == -1 || draw.depth_only ) {
+        draw.stencil = STENCIL_ANY;
+        soft_draw_strips( tile, &draw, poly, FALSE );
+    } else {
+        draw.stencil = STENCIL_CLEAR;
+        soft_draw_strips( tile, &draw, poly, FALSE );
+        if( pvr2_scene.shadow_mode == SHADOW_FULL ) {
+            draw.poly2 = poly->context[3];
+            draw.tex = soft_get_texture( poly, TRUE );
+        }
+        draw.stencil = STENCIL_SET;
+        soft_draw_strips( tile, &draw, poly, TRUE );
+    }
+}
+
+static void soft_render_tilelist( struct soft_tile *tile, const struct soft_draw *pass,
+                                  pvraddr_t tile_entry )
+{
+    tileentryiter list;
+
+    FOREACH_TILEENTRY(list, tile_entry) {
+        struct polygon_struct *poly = pvr2_scene.buf_to_poly_map[TILEENTRYITER_POLYADDR(list)];
+        if( poly != NULL ) {
+            do {
+                soft_render_poly( tile, pass, poly );
+                poly = poly->next;
+            } while( list.strip_count-- > 0 );
+        }
+    }
+}
+
+/**
+ * Apply the end-of-volume update to the tile stencil (see
+ * gl_render_modifier_polygon for the truth tables).
+ */
+static void soft_flush_volume( struct soft_tile *tile, uint32_t volume_mode )
+{
+    uint32_t x, y;
+    for( y = tile->bounds[2]; y < tile->bounds[3]; y++ ) {
+        uint8_t *s = &tile->stencil[(y - tile->y0) * TILE_SIZE + (tile->bounds[0] - tile->x0)];
+        for( x = tile->bounds[0]; x < tile->bounds[1]; x++, s++ ) {
+            if( volume_mode == PVR2_VOLUME_REGION0 ) {
+                *s = (*s == 0x02) ? 0x02 : 0;
+            } else {
+                *s = (*s == 0x02) ? 0 : 0x02;
+            }
+        }
+    }
+}
+
+static void soft_render_modifier_tilelist( struct soft_tile *tile, pvraddr_t tile_entry )
+{
+    tileentryiter list;
+
+    FOREACH_TILEENTRY(list, tile_entry ) {
+        struct polygon_struct *poly = pvr2_scene.buf_to_poly_map[TILEENTRYITER_POLYADDR(list)];
+        if( poly != NULL ) {
+            do {
+                if( poly->vertex_count != 0 ) {
+                    struct polygon_struct *sub = poly;
+                    uint32_t volume_mode = POLY1_VOLUME_MODE(poly->context[0]);
+                    do {
+                        struct vertex_struct *v = &pvr2_scene.vertex_array[sub->vertex_index];
+                        unsigned i;
+                        for( i=0; i+2 < sub->vertex_count; i++ ) {
+                            soft_draw_volume_triangle( tile, &v[i], &v[i+1], &v[i+2] );
+                        }
+                        sub = sub->sub_next;
+                    } while( sub != NULL );
+                    if( volume_mode == PVR2_VOLUME_REGION0 || volume_mode == PVR2_VOLUME_REGION1 ) {
+                        soft_flush_volume( tile, volume_mode );
+                    }
+                }
+                poly = poly->next;
+            } while( list.strip_count-- > 0 );
+        }
+    }
+}
+
+struct soft_sort_context {
+    struct soft_tile *tile;
+    struct soft_draw draw;
+};
+
+static void soft_render_sorted_triangle( struct polygon_struct *poly, int index, void *data )
+{
+    struct soft_sort_context *ctx = (struct soft_sort_context *)data;
+    struct vertex_struct *v = &pvr2_scene.vertex_array[poly->vertex_index + index];
+    ctx->draw.poly1 = poly->context[0];
+    ctx->draw.poly2 = poly->context[1];
+    ctx->draw.tex = soft_get_texture( poly, FALSE );
+    soft_draw_triangle( ctx->tile, &ctx->draw, &v[0], &v[1], &v[2] );
+}
+
+/********************************* Tiles *********************************/
+
+static gboolean soft_clip_bounds( uint32_t *tile, const uint32_t *clip )
+{
+    if( tile[0] < clip[0] ) tile[0] = clip[0];
+    if( tile[1] > clip[1] ) tile[1] = clip[1];
+    if( tile[2] < clip[2] ) tile[2] = clip[2];
+    if( tile[3] > clip[3] ) tile[3] = clip[3];
+    return tile[0] < tile[1] && tile[2] < tile[3];
+}
+
+static inline struct tile_segment *soft_segment( int index )
+{
+    return index == -1 ? NULL : &pvr2_scene.segment_list[index];
+}
+
+#define FOREACH_TILE_SEGMENT(segment, first) \
+    for( segment = soft_segment(first); segment != NULL; \
+         segment = soft_segment(soft_scene.segment_next[segment - pvr2_scene.segment_list]) )
+
+static void soft_render_tile( void *data, unsigned index )
+{
+    struct soft_tile *tile = g_malloc( sizeof(struct soft_tile) );
+    struct tile_segment *segment;
+    uint32_t buffer_bounds[4] = { 0, soft_scene.width, 0, soft_scene.height };
+    int first = soft_scene.tile_first_segment[index];
+    uint32_t y;
+
+    tile->x0 = (index % soft_scene.tiles_x) * TILE_SIZE;
+    tile->y0 = (index / soft_scene.tiles_x) * TILE_SIZE;
+    tile->bounds[0] = tile->x0;
+    tile->bounds[1] = tile->x0 + TILE_SIZE;
+    tile->bounds[2] = tile->y0;
+    tile->bounds[3] = tile->y0 + TILE_SIZE;
+    soft_clip_bounds( tile->bounds, buffer_bounds );
+    memset( tile->colour, 0, sizeof(tile->colour) );
+    memset( tile->depth, 0, sizeof(tile->depth) );
+    memset( tile->stencil, 0, sizeof(tile->stencil) );
+    uint32_t out_bounds[4] = { tile->bounds[0], tile->bounds[1], tile->bounds[2], tile->bounds[3] };
+
+    /* Background: no depth test or blending, and isn't clipped */
+    struct soft_draw pass = { 0, 0, NULL, DEPTH_ALWAYS, FALSE, FALSE, FALSE, 0.0f, STENCIL_ANY };
+    soft_render_poly( tile, &pass, pvr2_scene.bkgnd_poly );
+
+    if( first != -1 && soft_clip_bounds( tile->bounds, soft_scene.clip_bounds ) ) {
+        /* Opaque modifier volumes, tested against the opaque depth */
+        if( pvr2_scene.shadow_mode != SHADOW_NONE ) {
+            gboolean have_volumes = FALSE;
+            FOREACH_TILE_SEGMENT(segment, first) {
+                if( IS_NONEMPTY_TILE_LIST(segment->opaquemod_ptr) ) {
+                    have_volumes = TRUE;
+                }
+            }
+            if( have_volumes ) {
+                struct soft_draw depth_pass = { 0, 0, NULL, -1, TRUE, FALSE, TRUE, 0.0f, STENCIL_ANY };
+                FOREACH_TILE_SEGMENT(segment, first) {
+                    soft_render_tilelist( tile, &depth_pass, segment->opaque_ptr );
+                }
+                FOREACH_TILE_SEGMENT(segment, first) {
+                    if( IS_NONEMPTY_TILE_LIST(segment->opaquemod_ptr) ) {
+                        soft_render_modifier_tilelist( tile, segment->opaquemod_ptr );
+                    }
+                }
+                memset( tile->depth, 0, sizeof(tile->depth) );
+            }
+        }
+
+        /* Opaque: no blending, polygon depth mode + writes */
+        struct soft_draw opaque_pass = { 0, 0, NULL, -1, TRUE, FALSE, FALSE, 0.0f, STENCIL_ANY };
+        FOREACH_TILE_SEGMENT(segment, first) {
+            soft_render_tilelist( tile, &opaque_pass, segment->opaque_ptr );
+        }
+
+        /* Punch-through: alpha test, GEQUAL */
+        struct soft_draw punch_pass = { 0, 0, NULL, DEPTH_GEQUAL, TRUE, FALSE, FALSE,
+                soft_scene.alpha_ref, STENCIL_ANY };
+        FOREACH_TILE_SEGMENT(segment, first) {
+            soft_render_tilelist( tile, &punch_pass, segment->punchout_ptr );
+        }
+
+        /* Translucent: blending, no depth writes, sorted unless disabled */
+        struct soft_draw trans_pass = { 0, 0, NULL, -1, FALSE, TRUE, FALSE, 0.0f, STENCIL_ANY };
+        FOREACH_TILE_SEGMENT(segment, first) {
+            if( IS_NONEMPTY_TILE_LIST(segment->trans_ptr) ) {
+                if( pvr2_scene.sort_mode == SORT_NEVER ||
+                        (pvr2_scene.sort_mode == SORT_TILEFLAG && (segment->control&SEGMENT_SORT_TRANS)) ) {
+                    soft_render_tilelist( tile, &trans_pass, segment->trans_ptr );
+                } else {
+                    struct soft_sort_context ctx = { tile, trans_pass };
+                    ctx.draw.depth_mode = DEPTH_GEQUAL;
+                    sort_tile_triangles( segment->trans_ptr, soft_render_sorted_triangle, &ctx );
+                }
+            }
+        }
+    }
+
+    for( y = out_bounds[2]; y < out_bounds[3]; y++ ) {
+        memcpy( &soft_scene.pixels[y*soft_scene.width + out_bounds[0]],
+                &tile->colour[(y - tile->y0)*TILE_SIZE + (out_bounds[0] - tile->x0)],
+                (out_bounds[1] - out_bounds[0]) * sizeof(uint32_t) );
+    }
+    g_free( tile );
+}
+
+/**
+ * Build the per-tile segment chains. Each tile is rendered by a single
+ * worker, so tiles with several segments (ie multiple passes) are still
+ * rendered in list order.
+ */
+static void soft_build_tile_segments( void )
+{
+    uint32_t tiles = soft_scene.tiles_x * soft_scene.tiles_y, count = 0, i;
+    struct tile_segment *segment = pvr2_scene.segment_list;
+    int *last;
+
+    do {
+        count++;
+    } while( !IS_LAST_SEGMENT(segment++) );
+
+    soft_scene.tile_first_segment = g_malloc( tiles * sizeof(int) );
+    soft_scene.segment_next = g_malloc( count * sizeof(int) );
+    last = g_malloc( tiles * sizeof(int) );
+    for( i=0; i<tiles; i++ ) {
+        soft_scene.tile_first_segment[i] = last[i] = -1;
+    }
+    for( i=0; i<count; i++ ) {
+        uint32_t control = pvr2_scene.segment_list[i].control;
+        uint32_t tilex = SEGMENT_X(control), tiley = SEGMENT_Y(control);
+        soft_scene.segment_next[i] = -1;
+        if( tilex < soft_scene.tiles_x && tiley < soft_scene.tiles_y ) {
+            uint32_t tile = tiley * soft_scene.tiles_x + tilex;
+            if( last[tile] == -1 ) {
+                soft_scene.tile_first_segment[tile] = i;
+            } else {
+                soft_scene.segment_next[last[tile]] = i;
+            }
+            last[tile] = i;
+        }
+    }
+    g_free( last );
+}
+
+void pvr2_scene_render_soft( uint32_t *pixels, uint32_t width, uint32_t height )
+{
+    struct timeval start_tv, tex_tv, end_tv;
+    int i;
+
+    gettimeofday( &start_tv, NULL );
+    if( soft_pool == NULL ) {
+        const char *env = getenv("LXDREAM_SOFT_THREADS");
+        int threads = env == NULL ? 0 : atoi(env);
+        soft_pool = tpool_new( threads < 0 ? 0 : threads );
+        INFO( "Software renderer using %d threads", tpool_get_threads(soft_pool) );
+    }
+
+    soft_scene.pixels = pixels;
+    soft_scene.width = width;
+    soft_scene.height = height;
+    soft_scene.tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    soft_scene.tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    soft_scene.alpha_ref = ((float)(MMIO_READ(PVR2, RENDER_ALPHA_REF)&0xFF)+1)/256.0;
+    for( i=0; i<4; i++ ) {
+        soft_scene.clip_bounds[i] = (uint32_t)pvr2_scene.bounds[i];
+    }
+
+    soft_load_textures();
+    gettimeofday( &tex_tv, NULL );
+    uint32_t ms = (tex_tv.tv_sec - start_tv.tv_sec) * 1000 +
+    (tex_tv.tv_usec - start_tv.tv_usec)/1000;
+    DEBUG( "Texture decode in %dms (%d textures)", ms, soft_scene.decode_count );
+
+    soft_build_tile_segments();
+    tpool_run( soft_pool, soft_scene.tiles_x * soft_scene.tiles_y, soft_render_tile, NULL );
+
+    g_free( soft_scene.tile_first_segment );
+    g_free( soft_scene.segment_next );
+    soft_free_textures();
+    pvr2_scene_finished();
+
+    gettimeofday( &end_tv, NULL );
+    ms = (end_tv.tv_sec - tex_tv.tv_sec) * 1000 +
+    (end_tv.tv_usec - tex_tv.tv_usec)/1000;
+    DEBUG( "Scene render in %dms", ms );
+}
+
+void pvr2_scene_render_soft_shutdown( void )
+{
+    if( soft_pool != NULL ) {
+        tpool_destroy( soft_pool );
+        soft_pool = NULL;
+    }
+}
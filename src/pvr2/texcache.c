@@ -20,50 +20,64 @@
 
 #include <assert.h>
 #include <string.h>
+#include <sys/time.h>
 #include "pvr2/pvr2.h"
 #include "pvr2/pvr2mmio.h"
+#include "pvr2/texdecode.h"
 #include "pvr2/glutil.h"
 #include "profiler.h"
 #include "drivers/gl_state.h"
+#include "tpool.h"
 
-/** Specifies the maximum number of OpenGL
- * textures we're willing to have open at a time. If more are
- * needed, textures will be evicted in LRU order.
+/**
+ * Default limit on the total size of the textures we're willing to have in
+ * GL memory at a time, in MB (overridden by LXDREAM_TEX_BUDGET_MB). Beyond
+ * this, textures will be evicted in LRU order.
  */
-#define MAX_TEXTURES 256
+#define DEFAULT_TEXTURE_BUDGET_MB 128
+
+#define INITIAL_HASH_BUCKETS 256
 
 /**
  * Data structure:
  *
- * Main operations:
- *    find entry by texture_addr
- *    add new entry
- *    move entry to tail of lru list
- *    remove entry
+ * Each cached texture is an entry on three intrusive lists:
+ *    the hash chain for its (texture word, poly2 word) key, for lookup
+ *    the chain for the page containing its texture address, for invalidation
+ *    the LRU list, least recently used first, for eviction
+ * so lookup, insert and eviction are all O(1).
  */
 
-typedef signed short texcache_entry_index;
-#define EMPTY_ENTRY -1
-
-static texcache_entry_index texcache_free_ptr = 0;
-static GLuint texcache_free_list[MAX_TEXTURES];
-
 typedef struct texcache_entry {
     uint32_t texture_addr;
     uint32_t poly2_mode, tex_mode;
     GLuint texture_id;
     render_buffer_t buffer;
-    texcache_entry_index next;
-    uint32_t lru_count;
+    struct texcache_entry *hash_next, **hash_pprev;
+    struct texcache_entry *page_next, **page_pprev;
+    struct texcache_entry *lru_next, *lru_prev;
+    uint32_t scene; /* last scene the texture was used in */
+    uint32_t size_bytes; /* GL memory used, all levels */
     /* Hazard tracking */
-    uint32_t size_bytes;
     uint32_t page_start;
     uint32_t page_end;
+    uint64_t content_hash; /* hash of the source bytes when last loaded */
+    gboolean dirty; /* source pages written since, re-hash before use */
 } *texcache_entry_t;
 
-static texcache_entry_index texcache_page_lookup[PVR2_RAM_PAGES];
-static uint32_t texcache_ref_counter;
-static struct texcache_entry texcache_active_list[MAX_TEXTURES];
+static texcache_entry_t texcache_page_lookup[PVR2_RAM_PAGES];
+static texcache_entry_t *texcache_hash_table = NULL;
+static uint32_t texcache_hash_mask;
+static texcache_entry_t texcache_lru_head = NULL; /* next to be evicted */
+static texcache_entry_t texcache_lru_tail = NULL;
+static uint32_t texcache_entry_count;
+static uint64_t texcache_total_bytes;
+static uint64_t texcache_budget_bytes;
+static uint32_t texcache_scene_serial;
+/* Texture ids of evicted entries, deleted on the GL thread at the next scene */
+static GLuint *texcache_release_ids = NULL;
+static int texcache_release_count = 0;
+static int texcache_release_size = 0;
 static uint32_t texcache_palette_mode;
 static uint32_t texcache_stride_width;
 static gboolean texcache_have_palette_shader;
@@ -78,6 +92,14 @@ uint64_t pvr2_texcache_bytes_uploaded_consume(void) {
     texcache_bytes_uploaded_2s = 0;
     return v;
 }
+static uint32_t texcache_revalidate_hits_2s = 0; /* dirty but unchanged, kept */
+static uint32_t texcache_revalidate_misses_2s = 0; /* dirty and changed, reloaded */
+void pvr2_texcache_revalidate_consume( uint32_t *hits, uint32_t *misses ) {
+    *hits = texcache_revalidate_hits_2s;
+    *misses = texcache_revalidate_misses_2s;
+    texcache_revalidate_hits_2s = 0;
+    texcache_revalidate_misses_2s = 0;
+}
 /* Per-page dirty flags (VRAM pages of 4KB) */
 static unsigned char tex_page_dirty[PVR2_RAM_PAGES];
 static gboolean hazard_tracking_enabled = FALSE;
@@ -118,25 +140,28 @@ void texcache_mark_region_dirty(uint32_t addr, uint32_t length)
 void texcache_init( )
 {
     int i;
+    INFO( "Texture decoding using %s kernels", texdecode_init()->name );
     for( i=0; i<PVR2_RAM_PAGES; i++ ) {
-        texcache_page_lookup[i] = EMPTY_ENTRY;
+        texcache_page_lookup[i] = NULL;
         tex_page_dirty[i] = 0;
     }
-    for( i=0; i<MAX_TEXTURES; i++ ) {
-        texcache_free_list[i] = i;
-        texcache_active_list[i].texture_addr = -1;
-        texcache_active_list[i].buffer = NULL;
-        texcache_active_list[i].next = EMPTY_ENTRY;
-        texcache_active_list[i].size_bytes = 0;
-        texcache_active_list[i].page_start = 0;
-        texcache_active_list[i].page_end = 0;
-    }
-    texcache_free_ptr = 0;
-    texcache_ref_counter = 0;
+    texcache_hash_table = g_malloc0( INITIAL_HASH_BUCKETS * sizeof(texcache_entry_t) );
+    texcache_hash_mask = INITIAL_HASH_BUCKETS - 1;
+    texcache_lru_head = texcache_lru_tail = NULL;
+    texcache_entry_count = 0;
+    texcache_total_bytes = 0;
+    texcache_scene_serial = 0;
     texcache_palette_mode = -1;
     texcache_stride_width = 0;
     const char *hz = getenv("LXDREAM_TEX_HAZARD");
     hazard_tracking_enabled = (hz && atoi(hz) != 0) ? TRUE : FALSE;
+    const char *budget = getenv("LXDREAM_TEX_BUDGET_MB");
+    int budget_mb = budget == NULL ? 0 : atoi(budget);
+    if( budget_mb <= 0 ) {
+        budget_mb = DEFAULT_TEXTURE_BUDGET_MB;
+    }
+    texcache_budget_bytes = ((uint64_t)budget_mb) << 20;
+    INFO( "Texture cache budget %dMB", budget_mb );
 }
 
 static inline gboolean texcache_force_cpu_deindex(void)
@@ -156,39 +181,42 @@ void texcache_release_render_buffer( render_buffer_t buffer )
     pvr2_destroy_render_buffer(buffer);
 }
 
+static void texcache_evict( texcache_entry_t entry );
+
 /**
- * Flush all textures from the cache, returning them to the free list.
+ * Flush all textures from the cache. Their texture ids are deleted at the
+ * next scene, so this is safe to call away from the GL thread.
  */
 void texcache_flush( )
 {
     int i;
     /* clear structures */
     for( i=0; i<PVR2_RAM_PAGES; i++ ) {
-        texcache_page_lookup[i] = EMPTY_ENTRY;
         tex_page_dirty[i] = 0;
     }
-    for( i=0; i<MAX_TEXTURES; i++ ) {
-        texcache_free_list[i] = i;
-        texcache_active_list[i].next = EMPTY_ENTRY;
-        texcache_active_list[i].texture_addr = -1;
-        if( texcache_active_list[i].buffer != NULL ) {
-            texcache_release_render_buffer(texcache_active_list[i].buffer);
-            texcache_active_list[i].buffer = NULL;
-        }
+    while( texcache_lru_head != NULL ) {
+        texcache_evict( texcache_lru_head );
     }
-    texcache_free_ptr = 0;
-    texcache_ref_counter = 0;
 }
 
 /**
- * Setup the initial texture ids (must be called after the GL context is
- * prepared)
+ * Delete the texture ids of all entries evicted since the last call. Must be
+ * called on the GL thread.
  */
-void texcache_gl_init( )
+static void texcache_delete_released_textures( void )
 {
-    int i;
-    GLuint texids[MAX_TEXTURES];
+    if( texcache_release_count != 0 ) {
+        glDeleteTextures( texcache_release_count, texcache_release_ids );
+        texcache_release_count = 0;
+    }
+}
 
+/**
+ * Setup the palette texture, if supported (must be called after the GL
+ * context is prepared). Texture ids are allocated as textures are loaded.
+ */
+void texcache_gl_init( )
+{
     if( display_driver->capabilities.has_sl ) {
         texcache_have_palette_shader = TRUE;
         texcache_palette_valid = FALSE;
@@ -206,10 +234,6 @@ void texcache_gl_init( )
         texcache_have_palette_shader = FALSE;
     }
 
-    glGenTextures( MAX_TEXTURES, texids );
-    for( i=0; i<MAX_TEXTURES; i++ ) {
-        texcache_active_list[i].texture_id = texids[i];
-    }
     INFO( "Texcache initialized (%s, %s)", (texcache_have_palette_shader ? "Palette shader" : "No palette support"),
             (display_driver->capabilities.has_bgra ? "BGRA" : "RGBA") );
 }
@@ -221,96 +245,135 @@ void texcache_gl_init( )
  */    
 void texcache_gl_shutdown( )
 {
-    GLuint texids[MAX_TEXTURES];
-    int i;
     texcache_flush();
+    texcache_delete_released_textures();
 
     if( texcache_have_palette_shader ) {
         glDeleteTextures( 1, &texcache_palette_texid );
         texcache_palette_texid = -1;
     }
+}
+
+static inline uint32_t texcache_hash_bucket( uint32_t poly2_word, uint32_t texture_word )
+{
+    uint32_t hash = texture_word * 0x9E3779B1 + poly2_word * 0x85EBCA77;
+    return (hash ^ (hash >> 16)) & texcache_hash_mask;
+}
 
-    for( i=0; i<MAX_TEXTURES; i++ ) {
-        texids[i] = texcache_active_list[i].texture_id;
-        texcache_active_list[i].texture_id = -1;
+/**
+ * Double the number of hash buckets, and rechain all entries.
+ */
+static void texcache_grow_hash_table( void )
+{
+    uint32_t old_buckets = texcache_hash_mask + 1;
+    texcache_entry_t *old_table = texcache_hash_table;
+    uint32_t i;
+
+    texcache_hash_table = g_malloc0( old_buckets * 2 * sizeof(texcache_entry_t) );
+    texcache_hash_mask = old_buckets * 2 - 1;
+    for( i=0; i<old_buckets; i++ ) {
+        texcache_entry_t entry = old_table[i];
+        while( entry != NULL ) {
+            texcache_entry_t next = entry->hash_next;
+            texcache_entry_t *bucket = &texcache_hash_table[texcache_hash_bucket(entry->poly2_mode, entry->tex_mode)];
+            entry->hash_next = *bucket;
+            entry->hash_pprev = bucket;
+            if( *bucket != NULL ) {
+                (*bucket)->hash_pprev = &entry->hash_next;
+            }
+            *bucket = entry;
+            entry = next;
+        }
     }
-    glDeleteTextures( MAX_TEXTURES, texids );
+    g_free( old_table );
 }
 
-static void texcache_evict( int slot )
+static inline void texcache_lru_unlink( texcache_entry_t entry )
 {
-    /* Remove the selected slot from the lookup table */
-    assert( texcache_active_list[slot].texture_addr != -1 );
-    uint32_t evict_page = texcache_active_list[slot].texture_addr >> 12;
-    texcache_entry_index replace_next = texcache_active_list[slot].next;
-    texcache_active_list[slot].texture_addr = -1;
-    texcache_active_list[slot].next = EMPTY_ENTRY; /* Just for safety */
-    if( texcache_active_list[slot].buffer != NULL ) {
-        texcache_release_render_buffer(texcache_active_list[slot].buffer);
-        texcache_active_list[slot].buffer = NULL;
-    }
-    if( texcache_page_lookup[evict_page] == slot ) {
-        texcache_page_lookup[evict_page] = replace_next;
+    if( entry->lru_prev == NULL ) {
+        texcache_lru_head = entry->lru_next;
     } else {
-        texcache_entry_index idx = texcache_page_lookup[evict_page];
-        texcache_entry_index next;
-        do {
-            next = texcache_active_list[idx].next;
-            if( next == slot ) {
-                assert( idx != replace_next );
-                texcache_active_list[idx].next = replace_next;
-                break;
-            }
-            idx = next;
-        } while( next != EMPTY_ENTRY );
+        entry->lru_prev->lru_next = entry->lru_next;
     }
+    if( entry->lru_next == NULL ) {
+        texcache_lru_tail = entry->lru_prev;
+    } else {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    }
+}
+
+static inline void texcache_lru_append( texcache_entry_t entry )
+{
+    entry->lru_next = NULL;
+    entry->lru_prev = texcache_lru_tail;
+    if( texcache_lru_tail == NULL ) {
+        texcache_lru_head = entry;
+    } else {
+        texcache_lru_tail->lru_next = entry;
+    }
+    texcache_lru_tail = entry;
 }
 
 /**
- * Evict a single texture from the cache.
- * @return the slot of the evicted texture.
+ * Remove an entry from the cache and free it. The texture id is queued for
+ * deletion rather than deleted immediately, as this may be called away from
+ * the GL thread.
  */
-static texcache_entry_index texcache_evict_lru( void )
+static void texcache_evict( texcache_entry_t entry )
 {
-    /* Full table scan - take over the entry with the lowest lru value */
-    texcache_entry_index slot = 0;
-    int lru_value = texcache_active_list[0].lru_count;
-    int i;
-    for( i=1; i<MAX_TEXTURES; i++ ) {
-        /* FIXME: account for rollover */
-        if( texcache_active_list[i].lru_count < lru_value ) {
-            slot = i;
-            lru_value = texcache_active_list[i].lru_count;
-        }
+    *entry->hash_pprev = entry->hash_next;
+    if( entry->hash_next != NULL ) {
+        entry->hash_next->hash_pprev = entry->hash_pprev;
+    }
+    *entry->page_pprev = entry->page_next;
+    if( entry->page_next != NULL ) {
+        entry->page_next->page_pprev = entry->page_pprev;
+    }
+    texcache_lru_unlink( entry );
+    if( entry->buffer != NULL ) {
+        texcache_release_render_buffer(entry->buffer);
     }
-    texcache_evict(slot);
 
-    return slot;
+    if( texcache_release_count == texcache_release_size ) {
+        texcache_release_size = texcache_release_size == 0 ? 64 : texcache_release_size*2;
+        texcache_release_ids = g_realloc( texcache_release_ids, texcache_release_size * sizeof(GLuint) );
+    }
+    texcache_release_ids[texcache_release_count++] = entry->texture_id;
+    texcache_total_bytes -= entry->size_bytes;
+    texcache_entry_count--;
+    g_free( entry );
 }
 
 /**
- * Evict all textures contained in the page identified by a texture address.
+ * Evict least recently used textures until we're within the memory budget.
+ * Textures used in the current scene are never evicted (they may be about
+ * to be drawn, or still waiting to be uploaded), so a single large scene
+ * can temporarily exceed the budget.
+ */
+static void texcache_enforce_budget( void )
+{
+    while( texcache_total_bytes > texcache_budget_bytes && texcache_lru_head != NULL &&
+            texcache_lru_head->scene != texcache_scene_serial ) {
+        texcache_evict( texcache_lru_head );
+    }
+}
+
+/**
+ * Flag all textures contained in the page identified by a texture address as
+ * dirty. They stay in the cache, and are re-hashed the next time they're
+ * looked up - games frequently rewrite textures with identical data, and
+ * there's no point reloading those.
  */
 void texcache_invalidate_page( uint32_t texture_addr ) {
     uint32_t texture_page = texture_addr >> 12;
-    texcache_entry_index idx = texcache_page_lookup[texture_page];
-    if( idx == EMPTY_ENTRY )
-        return;
-    assert( texcache_free_ptr >= 0 );
-    do {
-        texcache_entry_t entry = &texcache_active_list[idx];
-        entry->texture_addr = -1;
+    texcache_entry_t entry;
+    for( entry = texcache_page_lookup[texture_page]; entry != NULL; entry = entry->page_next ) {
         if( entry->buffer != NULL ) {
             texcache_release_render_buffer(entry->buffer);
             entry->buffer = NULL;
         }
-        /* release entry */
-        texcache_free_ptr--;
-        texcache_free_list[texcache_free_ptr] = idx;
-        idx = entry->next;
-        entry->next = EMPTY_ENTRY;
-    } while( idx != EMPTY_ENTRY );
-    texcache_page_lookup[texture_page] = EMPTY_ENTRY;
+        entry->dirty = TRUE;
+    }
 }
 
 /**
@@ -397,14 +460,13 @@ void texcache_invalidate_palette( )
     if( texcache_have_palette_shader ) {
         texcache_palette_valid = FALSE;
     } else {
-        int i;
-        for( i=0; i<MAX_TEXTURES; i++ ) {
-            if( texcache_active_list[i].texture_addr != -1 &&
-                    PVR2_TEX_IS_PALETTE(texcache_active_list[i].tex_mode) ) {
-                texcache_evict( i );
-                texcache_free_ptr--;
-                texcache_free_list[texcache_free_ptr] = i;
+        texcache_entry_t entry = texcache_lru_head;
+        while( entry != NULL ) {
+            texcache_entry_t next = entry->lru_next;
+            if( PVR2_TEX_IS_PALETTE(entry->tex_mode) ) {
+                texcache_evict( entry );
             }
+            entry = next;
         }
     }
 }
@@ -414,20 +476,21 @@ void texcache_invalidate_palette( )
  */
 void texcache_invalidate_stride( )
 {
-    int i;
-    for( i=0; i<MAX_TEXTURES; i++ ) {
-        if( texcache_active_list[i].texture_addr != -1 &&
-                PVR2_TEX_IS_STRIDE(texcache_active_list[i].tex_mode) ) {
-            texcache_evict( i );
-            texcache_free_ptr--;
-            texcache_free_list[texcache_free_ptr] = i;
+    texcache_entry_t entry = texcache_lru_head;
+    while( entry != NULL ) {
+        texcache_entry_t next = entry->lru_next;
+        if( PVR2_TEX_IS_STRIDE(entry->tex_mode) ) {
+            texcache_evict( entry );
         }
+        entry = next;
     }
 }
 
 void texcache_begin_scene( uint32_t palette_mode, uint32_t stride )
 {
     gboolean format_changed = FALSE;
+    texcache_scene_serial++;
+    texcache_delete_released_textures();
     if( palette_mode != texcache_palette_mode ) {
         texcache_invalidate_palette();
         format_changed = TRUE;
@@ -442,60 +505,8 @@ void texcache_begin_scene( uint32_t palette_mode, uint32_t stride )
         texcache_load_palette_texture(format_changed);
 }
 
-static void decode_pal8_to_32( uint32_t *out, uint8_t *in, int inbytes, uint32_t *pal )
-{
-    int i;
-    for( i=0; i<inbytes; i++ ) {
-        *out++ = pal[*in++];
-    }
-}
-
-static void decode_pal8_to_16( uint16_t *out, uint8_t *in, int inbytes, uint32_t *pal )
-{
-    int i;
-    for( i=0; i<inbytes; i++ ) {
-        *out++ = (uint16_t)pal[*in++];
-    }
-}
-
-static void decode_pal4_to_32( uint32_t *out, uint8_t *in, int inbytes, uint32_t *pal )
-{
-    int i;
-    for( i=0; i<inbytes; i++ ) {
-        *out++ = pal[*in & 0x0F];
-        *out++ = pal[(*in >> 4)];
-        in++;
-    }
-}
-
-static void decode_pal4_to_pal8( uint8_t *out, uint8_t *in, int inbytes )
-{
-    int i;
-    for( i=0; i<inbytes; i++ ) {
-        *out++ = (uint8_t)(*in & 0x0F);
-        *out++ = (uint8_t)(*in >> 4);
-        in++;
-    }
-}
-
-
-
-static void decode_pal4_to_16( uint16_t *out, uint8_t *in, int inbytes, uint32_t *pal )
-{
-    int i;
-    for( i=0; i<inbytes; i++ ) {
-        *out++ = (uint16_t)pal[*in & 0x0F];
-        *out++ = (uint16_t)pal[(*in >> 4)];
-        in++;
-    }
-}
-
 #define VQ_CODEBOOK_SIZE 2048 /* 256 entries * 4 pixels per quad * 2 byte pixels */
 
-struct vq_codebook {
-    uint16_t quad[256][4];
-};
-
 static void vq_get_codebook( struct vq_codebook *codebook, 
                              uint16_t *input )
 {
@@ -510,22 +521,6 @@ static void vq_get_codebook( struct vq_codebook *codebook,
     }
 }    
 
-static void vq_decode( uint16_t *output, unsigned char *input, int width, int height, 
-                       struct vq_codebook *codebook ) {
-    int i,j;
-
-    uint8_t *c = (uint8_t *)input;
-    for( j=0; j<height; j+=2 ) {
-        for( i=0; i<width; i+=2 ) {
-            uint8_t code = *c++;
-            output[i + j*width] = codebook->quad[code][0];
-            output[i + 1 + j*width] = codebook->quad[code][1];
-            output[i + (j+1)*width] = codebook->quad[code][2];
-            output[i + 1 + (j+1)*width] = codebook->quad[code][3];
-        }
-    }
-}
-
 static inline uint32_t yuv_to_rgb32( float y, float u, float v )
 {
     u -= 128;
@@ -564,11 +559,114 @@ static void yuv_decode( uint32_t *output, uint32_t *input, int width, int height
 }
 
 /**
- * Load texture data from the given address and parameters into the currently
- * bound OpenGL texture.
+ * Compute the offset from the start of a mip-mapped texture's data (after the
+ * codebook, for VQ textures) to its largest level - the levels are stored
+ * smallest first.
+ * @param last_level set to the number of the smallest (1x1) level
+ */
+static uint32_t texcache_mipmap_offset( int width, int mode, int *last_level )
+{
+    int tex_format = mode & PVR2_TEX_FORMAT_MASK;
+    uint32_t src_offset = 0;
+    int level = 0;
+    while( (1<<level) < width ) {
+        level++;
+        src_offset += ((width>>level)*(width>>level));
+    }
+    if( width != 1 ) {
+        src_offset += 3;
+    }
+    if( PVR2_TEX_IS_COMPRESSED(mode) ) {
+        src_offset >>= 2;
+    } else if( tex_format == PVR2_TEX_FORMAT_IDX4 ) {
+        src_offset >>= 1;
+    } else if( tex_format == PVR2_TEX_FORMAT_YUV422 ) {
+        src_offset <<= 1;
+    } else if( tex_format != PVR2_TEX_FORMAT_IDX8 ) {
+        src_offset <<= 1; /* 16-bit formats */
+    }
+    *last_level = level;
+    return src_offset;
+}
+
+/**
+ * @return the number of bytes of vram (from the texture address) that the
+ * texture is decoded from, including any mipmaps and VQ codebook.
  */
-static void texcache_load_texture( uint32_t texture_addr, int width, int height,
-                                   int mode ) {
+static uint32_t texcache_source_size( uint32_t poly2_word, uint32_t mode )
+{
+    int tex_format = mode & PVR2_TEX_FORMAT_MASK;
+    unsigned width = POLY2_TEX_WIDTH(poly2_word);
+    unsigned height = POLY2_TEX_HEIGHT(poly2_word);
+    uint32_t size;
+    int last_level;
+
+    if( PVR2_TEX_IS_STRIDE(mode) && tex_format != PVR2_TEX_FORMAT_IDX4 &&
+            tex_format != PVR2_TEX_FORMAT_IDX8 ) {
+        return (texcache_stride_width * height) << 1;
+    }
+    if( PVR2_TEX_IS_MIPMAPPED(mode) ) {
+        height = width;
+    }
+    size = width * height;
+    if( PVR2_TEX_IS_COMPRESSED(mode) ) {
+        size >>= 2;
+    } else if( tex_format == PVR2_TEX_FORMAT_IDX4 ) {
+        size >>= 1;
+    } else if( tex_format != PVR2_TEX_FORMAT_IDX8 ) {
+        size <<= 1; /* 16-bit formats */
+    }
+    if( PVR2_TEX_IS_MIPMAPPED(mode) ) {
+        size += texcache_mipmap_offset( width, mode, &last_level );
+    }
+    if( PVR2_TEX_IS_COMPRESSED(mode) ) {
+        size += VQ_CODEBOOK_SIZE;
+    }
+    return size;
+}
+
+/**
+ * A texture miss, decoded into system memory ready for upload. Decoding only
+ * touches VRAM, the palette and the staging buffer, so any number of these
+ * can be decoded concurrently; the upload must be done on the GL thread.
+ */
+struct texcache_staging {
+    texcache_entry_t entry;
+    GLuint texture_id;
+    uint32_t poly2_word;
+    uint32_t texture_word;
+    uint32_t texture_addr;
+    int width, height;
+
+    /* Filled in by texcache_decode_texture */
+    GLint intFormat, format, type;
+    GLint min_filter, max_filter;
+    int bpp_shift;
+    int num_levels; /* 0 if the texture couldn't be decoded */
+    struct {
+        uint32_t offset;
+        int width, height;
+    } level[11];
+    unsigned char *data;
+};
+
+/**
+ * Decode texture data from the staging entry's address and parameters into
+ * its data buffer in the GL upload format given by intFormat/format/type,
+ * detwiddling/uncompressing/deindexing as required. Safe to call from any
+ * thread.
+ * @param palette_mode palette format, as for texcache_begin_scene
+ * @param stride_width stride for stride textures, as for texcache_begin_scene
+ * @param shader_deindex leave indexed textures as 8-bit indexes
+ * @param all_levels decode every mip level, rather than just the largest
+ */
+static void texcache_decode_levels( struct texcache_staging *st, uint32_t palette_mode,
+                                    uint32_t stride_width, gboolean shader_deindex,
+                                    gboolean all_levels )
+{
+    uint32_t texture_addr = st->texture_addr;
+    int width = st->width, height = st->height;
+    int mode = st->texture_word;
     int bpp_shift = 1; /* bytes per (output) pixel as a power of 2 */
     GLint intFormat = GL_RGBA, format, type;
     int tex_format = mode & PVR2_TEX_FORMAT_MASK;
@@ -577,11 +675,14 @@ static void texcache_load_texture( uint32_t texture_addr, int width, int height,
     GLint max_filter = GL_LINEAR;
     GLint mipmapfilter = GL_LINEAR_MIPMAP_LINEAR;
 
+    st->num_levels = 0;
+    st->data = NULL;
+
     /* Decode the format parameters */
     switch( tex_format ) {
     case PVR2_TEX_FORMAT_IDX4:
     case PVR2_TEX_FORMAT_IDX8:
-        if( texcache_have_palette_shader && !texcache_force_cpu_deindex() ) {
+        if( shader_deindex ) {
             /* Upload index as single-channel so shader can read .r reliably */
 #ifdef GL_RED
             intFormat = GL_RED;
@@ -598,7 +699,7 @@ static void texcache_load_texture( uint32_t texture_addr, int width, int height,
             /* For indexed-colour modes, we need to lookup the palette control
              * word to determine the de-indexed texture format.
              */
-            switch( texcache_palette_mode ) {
+            switch( palette_mode ) {
             case 0: /* ARGB1555 */
                 format = GL_BGRA;
                 type = GL_UNSIGNED_SHORT_1_5_5_5_REV;
@@ -650,25 +751,31 @@ static void texcache_load_texture( uint32_t texture_addr, int width, int height,
             return;
     }
 
+    st->intFormat = intFormat;
+    st->format = format;
+    st->type = type;
+    st->bpp_shift = bpp_shift;
+    st->max_filter = max_filter;
+
     if( PVR2_TEX_IS_STRIDE(mode) && tex_format != PVR2_TEX_FORMAT_IDX4 &&
             tex_format != PVR2_TEX_FORMAT_IDX8 ) {
         /* Stride textures cannot be mip-mapped, compressed, indexed or twiddled */
-        unsigned char data[(width*height) << bpp_shift];
+        st->data = g_malloc( (width*height) << bpp_shift );
         if( tex_format == PVR2_TEX_FORMAT_YUV422 ) {
-            unsigned char tmp[(width*height)<<1];
-            pvr2_vram64_read_stride( tmp, width<<1, texture_addr, texcache_stride_width<<1, height );
-            yuv_decode( (uint32_t *)data, (uint32_t *)tmp, width, height );
+            unsigned char *tmp = g_malloc( (width*height)<<1 );
+            pvr2_vram64_read_stride( tmp, width<<1, texture_addr, stride_width<<1, height );
+            yuv_decode( (uint32_t *)st->data, (uint32_t *)tmp, width, height );
+            g_free( tmp );
         } else {
-            pvr2_vram64_read_stride( data, width<<bpp_shift, texture_addr, texcache_stride_width<<bpp_shift, height );
+            pvr2_vram64_read_stride( st->data, width<<bpp_shift, texture_addr, stride_width<<bpp_shift, height );
         }
-        os_signpost_id_t sid_up0 = profiler_begin("tex_upload_stride");
-        glTexImage2DBGRA( 0, intFormat, width, height, format, type, data, FALSE );
-        profiler_end("tex_upload_stride", sid_up0);
-        texcache_bytes_uploaded_2s += ((uint64_t)width * (uint64_t)height) << bpp_shift;
-        gl_state_cache_tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
-        gl_state_cache_tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, max_filter);
+        st->min_filter = min_filter;
+        st->level[0].offset = 0;
+        st->level[0].width = width;
+        st->level[0].height = height;
+        st->num_levels = 1;
         return;
-    } 
+    }
 
     if( PVR2_TEX_IS_COMPRESSED(mode) ) {
         uint16_t tmp[VQ_CODEBOOK_SIZE];
@@ -679,74 +786,64 @@ static void texcache_load_texture( uint32_t texture_addr, int width, int height,
 
     int level=0, last_level = 0, mip_width = width, mip_height = height, src_bytes, dest_bytes;
     if( PVR2_TEX_IS_MIPMAPPED(mode) ) {
-        uint32_t src_offset = 0;
         min_filter = mipmapfilter;
         mip_height = height = width;
-        while( (1<<last_level) < width ) {
-            last_level++;
-            src_offset += ((width>>last_level)*(width>>last_level));
+        texture_addr += texcache_mipmap_offset( width, mode, &last_level );
+        if( !all_levels ) {
+            last_level = 0;
         }
-        if( width != 1 ) {
-            src_offset += 3;
-        }
-        if( PVR2_TEX_IS_COMPRESSED(mode) ) {
-            src_offset >>= 2;
-        } else if( tex_format == PVR2_TEX_FORMAT_IDX4 ) {
-            src_offset >>= 1;
-        } else if( tex_format == PVR2_TEX_FORMAT_YUV422 ) {
-            src_offset <<= 1;
-        } else if( tex_format != PVR2_TEX_FORMAT_IDX8 ) {
-            src_offset <<= bpp_shift;
-        }
-        texture_addr += src_offset;
     }
+    st->min_filter = min_filter;
 
-
+    /* Size the staging buffer for all levels. The 1x1 level is stored
+     * within a 2x2 block, so it takes up the same space as the 2x2 level.
+     */
+    uint32_t total_bytes = 0;
     dest_bytes = (mip_width * mip_height) << bpp_shift;
-    src_bytes = dest_bytes; // Modes will change this (below)
+    for( level=0; level <= last_level; level++ ) {
+        total_bytes += (dest_bytes >> (level<<1)) > (4<<bpp_shift) ?
+                (dest_bytes >> (level<<1)) : (4<<bpp_shift);
+    }
+    st->data = g_malloc( total_bytes );
+    unsigned char *tmp = g_malloc( (mip_width * mip_height) << 1 );
+    uint32_t offset = 0;
 
-    /* Ensure byte-aligned rows for paletted/indexed and other narrow formats */
-    GLint prev_unpack_alignment = 4;
-    glGetIntegerv(GL_UNPACK_ALIGNMENT, &prev_unpack_alignment);
-    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    src_bytes = dest_bytes; // Modes will change this (below)
 
     for( level=0; level<= last_level; level++ ) {
-        unsigned char data[dest_bytes];
+        unsigned char *data = st->data + offset;
         /* load data from image, detwiddling/uncompressing as required */
         if( tex_format == PVR2_TEX_FORMAT_IDX8 ) {
-            if( texcache_have_palette_shader ) {
+            if( shader_deindex ) {
                 pvr2_vram64_read_twiddled_8( data, texture_addr, mip_width, mip_height );
             } else {
                 src_bytes = (mip_width * mip_height);
                 int bank = (mode >> 25) &0x03;
                 uint32_t *palette = ((uint32_t *)mmio_region_PVR2PAL.mem) + (bank<<8);
-                unsigned char tmp[src_bytes];
                 pvr2_vram64_read_twiddled_8( tmp, texture_addr, mip_width, mip_height );
                 if( bpp_shift == 2 ) {
-                    decode_pal8_to_32( (uint32_t *)data, tmp, src_bytes, palette );
+                    texdecode->pal8_to_32( (uint32_t *)data, tmp, src_bytes, palette );
                 } else {
-                    decode_pal8_to_16( (uint16_t *)data, tmp, src_bytes, palette );
+                    texdecode->pal8_to_16( (uint16_t *)data, tmp, src_bytes, palette );
                 }
             }
         } else if( tex_format == PVR2_TEX_FORMAT_IDX4 ) {
             src_bytes = (mip_width * mip_height) >> 1;
-            unsigned char tmp[src_bytes];
-            if( texcache_have_palette_shader ) {
+            if( shader_deindex ) {
                 pvr2_vram64_read_twiddled_4( tmp, texture_addr, mip_width, mip_height );
-                decode_pal4_to_pal8( data, tmp, src_bytes );
+                texdecode->pal4_to_pal8( data, tmp, src_bytes );
             } else {
                 int bank = (mode >>21 ) & 0x3F;
                 uint32_t *palette = ((uint32_t *)mmio_region_PVR2PAL.mem) + (bank<<4);
                 pvr2_vram64_read_twiddled_4( tmp, texture_addr, mip_width, mip_height );
                 if( bpp_shift == 2 ) {
-                    decode_pal4_to_32( (uint32_t *)data, tmp, src_bytes, palette );
+                    texdecode->pal4_to_32( (uint32_t *)data, tmp, src_bytes, palette );
                 } else {
-                    decode_pal4_to_16( (uint16_t *)data, tmp, src_bytes, palette );
+                    texdecode->pal4_to_16( (uint16_t *)data, tmp, src_bytes, palette );
                 }
             }
         } else if( tex_format == PVR2_TEX_FORMAT_YUV422 ) {
             src_bytes = ((mip_width*mip_height)<<1);
-            unsigned char tmp[src_bytes];
             if( PVR2_TEX_IS_TWIDDLED(mode) ) {
                 pvr2_vram64_read_twiddled_16( tmp, texture_addr, mip_width, mip_height );
             } else {
@@ -755,31 +852,27 @@ static void texcache_load_texture( uint32_t texture_addr, int width, int height,
             yuv_decode( (uint32_t *)data, (uint32_t *)tmp, mip_width, mip_height );
         } else if( PVR2_TEX_IS_COMPRESSED(mode) ) {
             src_bytes = ((mip_width*mip_height) >> 2);
-            unsigned char tmp[src_bytes];
             if( PVR2_TEX_IS_TWIDDLED(mode) ) {
                 pvr2_vram64_read_twiddled_8( tmp, texture_addr, mip_width>>1, mip_height>>1 );
             } else {
                 pvr2_vram64_read( tmp, texture_addr, src_bytes );
             }
-            vq_decode( (uint16_t *)data, tmp, mip_width, mip_height, &codebook );
+            texdecode->vq_decode( (uint16_t *)data, tmp, mip_width, mip_height, &codebook );
         } else if( PVR2_TEX_IS_TWIDDLED(mode) ) {
             pvr2_vram64_read_twiddled_16( data, texture_addr, mip_width, mip_height );
         } else {
             pvr2_vram64_read( data, texture_addr, src_bytes );
         }
 
-        /* Pass to GL */
         if( level == last_level && level != 0 ) { /* 1x1 stored within a 2x2 */
-            os_signpost_id_t sid_up1 = profiler_begin("tex_upload_1x1");
-            glTexImage2DBGRA( level, intFormat, 1, 1, format, type,
-                    data + (3 << bpp_shift), FALSE );
-            profiler_end("tex_upload_1x1", sid_up1);
-            texcache_bytes_uploaded_2s += (1ULL << bpp_shift);
+            st->level[level].offset = offset + (3 << bpp_shift);
+            st->level[level].width = 1;
+            st->level[level].height = 1;
         } else {
-            os_signpost_id_t sid_up = profiler_begin("tex_upload");
-            glTexImage2DBGRA( level, intFormat, mip_width, mip_height, format, type, data, FALSE );
-            profiler_end("tex_upload", sid_up);
-            texcache_bytes_uploaded_2s += ((uint64_t)mip_width * (uint64_t)mip_height) << bpp_shift;
+            st->level[level].offset = offset;
+            st->level[level].width = mip_width;
+            st->level[level].height = mip_height;
+            offset += dest_bytes;
             if( mip_width > 2 ) {
                 mip_width >>= 1;
                 mip_height >>= 1;
@@ -789,65 +882,189 @@ static void texcache_load_texture( uint32_t texture_addr, int width, int height,
             texture_addr -= src_bytes;
         }
     }
+    g_free( tmp );
+    st->num_levels = last_level + 1;
+}
 
-    gl_state_cache_tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
-    gl_state_cache_tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, max_filter);
+/**
+ * Decode all levels of the staging entry's texture for upload, with the
+ * current scene's palette and stride settings.
+ */
+static void texcache_decode_texture( struct texcache_staging *st )
+{
+    texcache_decode_levels( st, texcache_palette_mode, texcache_stride_width,
+            texcache_have_palette_shader && !texcache_force_cpu_deindex(), TRUE );
+}
+
+/**
+ * Upload a decoded texture to its GL texture and set its parameters, then
+ * release the staging buffer. Must be called on the GL thread.
+ */
+static void texcache_upload_texture( struct texcache_staging *st )
+{
+    uint32_t size_bytes = 0;
+    int level;
+
+    gl_state_cache_bind_texture( GL_TEXTURE_2D, st->texture_id );
+    glGetError();
+    if( st->num_levels != 0 ) {
+        /* Ensure byte-aligned rows for paletted/indexed and other narrow formats */
+        GLint prev_unpack_alignment = 4;
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &prev_unpack_alignment);
+        glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+
+        os_signpost_id_t sid_up = profiler_begin("tex_upload");
+        for( level=0; level < st->num_levels; level++ ) {
+            glTexImage2DBGRA( level, st->intFormat, st->level[level].width, st->level[level].height,
+                    st->format, st->type, st->data + st->level[level].offset, FALSE );
+            size_bytes += (st->level[level].width * st->level[level].height) << st->bpp_shift;
+        }
+        texcache_bytes_uploaded_2s += size_bytes;
+        profiler_end("tex_upload", sid_up);
 
-    /* Restore previous pixel store alignment */
-    glPixelStorei(GL_UNPACK_ALIGNMENT, prev_unpack_alignment);
+        gl_state_cache_tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, st->min_filter);
+        gl_state_cache_tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, st->max_filter);
+
+        /* Restore previous pixel store alignment */
+        glPixelStorei(GL_UNPACK_ALIGNMENT, prev_unpack_alignment);
+    }
+    g_free( st->data );
+    st->data = NULL;
+    texcache_total_bytes += size_bytes;
+    texcache_total_bytes -= st->entry->size_bytes;
+    st->entry->size_bytes = size_bytes;
+    texcache_enforce_budget();
+    INFO( "Loaded texture %d: %x %dx%d %x (%x)", st->texture_id, st->texture_addr, st->width, st->height,
+            st->texture_word, glGetError() );
+
+    /* Set texture parameters from the poly2 word */
+    if( POLY2_TEX_CLAMP_U(st->poly2_word) ) {
+        gl_state_cache_tex_parameter_i( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    } else if( POLY2_TEX_MIRROR_U(st->poly2_word) ) {
+        gl_state_cache_tex_parameter_i( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT );
+    } else {
+        gl_state_cache_tex_parameter_i( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+    }
+    if( POLY2_TEX_CLAMP_V(st->poly2_word) ) {
+        gl_state_cache_tex_parameter_i( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    } else if( POLY2_TEX_MIRROR_V(st->poly2_word) ) {
+        gl_state_cache_tex_parameter_i( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT );
+    } else {
+        gl_state_cache_tex_parameter_i( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+    }
 }
 
-static int texcache_find_texture_slot( uint32_t poly2_masked_word, uint32_t texture_word )
+static texcache_entry_t texcache_find_entry( uint32_t poly2_masked_word, uint32_t texture_word )
 {
-    uint32_t texture_addr = (texture_word & 0x000FFFFF)<<3;
-    uint32_t texture_page = texture_addr >> 12;
-    texcache_entry_index idx = texcache_page_lookup[texture_page];
-    while( idx != EMPTY_ENTRY ) {
-        texcache_entry_t entry = &texcache_active_list[idx];
+    texcache_entry_t entry = texcache_hash_table[texcache_hash_bucket(poly2_masked_word, texture_word)];
+    while( entry != NULL ) {
         if( entry->tex_mode == texture_word &&
                 entry->poly2_mode == poly2_masked_word ) {
-            entry->lru_count = texcache_ref_counter++;
-            return idx;
+            texcache_lru_unlink( entry );
+            texcache_lru_append( entry );
+            entry->scene = texcache_scene_serial;
+            return entry;
         }
-        idx = entry->next;
+        entry = entry->hash_next;
     }
-    return -1;
+    return NULL;
 }
 
-static int texcache_alloc_texture_slot( uint32_t poly2_word, uint32_t texture_word )
+/**
+ * Create a new entry for the texture, first evicting as needed to get back
+ * within the memory budget.
+ */
+static texcache_entry_t texcache_alloc_entry( uint32_t poly2_word, uint32_t texture_word )
 {
     uint32_t texture_addr = (texture_word & 0x000FFFFF)<<3;
-    uint32_t texture_page = texture_addr >> 12;
-    texcache_entry_index slot = 0;
+    texcache_entry_t *bucket, *page;
 
-    if( texcache_free_ptr < MAX_TEXTURES ) {
-        slot = texcache_free_list[texcache_free_ptr++];
-    } else {
-        slot = texcache_evict_lru();
-    }
+    texcache_enforce_budget();
 
     /* Construct new entry */
-    assert( texcache_active_list[slot].texture_addr == -1 );
-    texcache_active_list[slot].texture_addr = texture_addr;
-    texcache_active_list[slot].tex_mode = texture_word;
-    texcache_active_list[slot].poly2_mode = poly2_word;
-    texcache_active_list[slot].lru_count = texcache_ref_counter++;
-
-    /* Add entry to the lookup table */
-    int next = texcache_page_lookup[texture_page];
-    if( next == slot ) {
-        int i;
-        fprintf( stderr, "Active list: " );
-        for( i=0; i<MAX_TEXTURES; i++ ) {
-            fprintf( stderr, "%d, ", texcache_active_list[i].next );
-        }
-        fprintf( stderr, "\n" );
-        assert( next != slot );
+    texcache_entry_t entry = g_malloc0( sizeof(struct texcache_entry) );
+    entry->texture_addr = texture_addr;
+    entry->tex_mode = texture_word;
+    entry->poly2_mode = poly2_word;
+    entry->scene = texcache_scene_serial;
+    glGenTextures( 1, &entry->texture_id );
+
+    /* Add entry to the lookup tables */
+    if( ++texcache_entry_count > texcache_hash_mask + 1 ) {
+        texcache_grow_hash_table();
+    }
+    bucket = &texcache_hash_table[texcache_hash_bucket(poly2_word, texture_word)];
+    entry->hash_next = *bucket;
+    entry->hash_pprev = bucket;
+    if( *bucket != NULL ) {
+        (*bucket)->hash_pprev = &entry->hash_next;
+    }
+    *bucket = entry;
 
+    page = &texcache_page_lookup[texture_addr >> 12];
+    entry->page_next = *page;
+    entry->page_pprev = page;
+    if( *page != NULL ) {
+        (*page)->page_pprev = &entry->page_next;
     }
-    texcache_active_list[slot].next = next;
-    texcache_page_lookup[texture_page] = slot;
-    return slot;
+    *page = entry;
+
+    texcache_lru_append( entry );
+    return entry;
+}
+
+/**
+ * Find or create the cache entry for the given texture. On a miss, the
+ * entry is set up and st is filled in with the parameters needed to
+ * decode and upload the texture. A dirty hit is re-hashed, and treated as a
+ * miss (reloading into the same entry) only if the source has changed.
+ * @return TRUE if the texture needs to be loaded.
+ */
+static gboolean texcache_lookup_texture( uint32_t poly2_word, uint32_t texture_word,
+                                         struct texcache_staging *st )
+{
+    poly2_word &= 0x000F803F; /* Get just the texture-relevant bits */
+    uint32_t texture_lookup = texture_word;
+    if( PVR2_TEX_IS_PALETTE(texture_lookup) ) {
+        texture_lookup &= 0xF81FFFFF; /* Mask out the bank bits */
+    }
+    uint32_t texture_addr = (texture_word & 0x000FFFFF)<<3;
+    uint32_t source_size;
+    texcache_entry_t entry = texcache_find_entry( poly2_word, texture_lookup );
+    if( entry != NULL ) {
+        st->texture_id = entry->texture_id;
+        if( !entry->dirty ) {
+            return FALSE;
+        }
+        entry->dirty = FALSE;
+        source_size = texcache_source_size( poly2_word, texture_word );
+        uint64_t hash = pvr2_vram64_hash( texture_addr, source_size );
+        if( hash == entry->content_hash ) {
+            texcache_revalidate_hits_2s++;
+            return FALSE;
+        }
+        texcache_revalidate_misses_2s++;
+        entry->content_hash = hash;
+    } else {
+        entry = texcache_alloc_entry( poly2_word, texture_lookup );
+        source_size = texcache_source_size( poly2_word, texture_word );
+        entry->content_hash = pvr2_vram64_hash( texture_addr, source_size );
+    }
+
+    unsigned width = POLY2_TEX_WIDTH(poly2_word);
+    unsigned height = POLY2_TEX_HEIGHT(poly2_word);
+    entry->page_start = (texture_addr >> 12);
+    entry->page_end = ((texture_addr + source_size + 0xFFF) >> 12);
+
+    st->entry = entry;
+    st->texture_id = entry->texture_id;
+    st->poly2_word = poly2_word;
+    st->texture_word = texture_word;
+    st->texture_addr = texture_addr;
+    st->width = width;
+    st->height = height;
+    st->data = NULL;
+    return TRUE;
 }
 
 /**
@@ -862,52 +1079,151 @@ static int texcache_alloc_texture_slot( uint32_t poly2_word, uint32_t texture_wo
  */
 GLuint texcache_get_texture( uint32_t poly2_word, uint32_t texture_word )
 {
+    struct texcache_staging st;
+
     /* Apply any pending page-based invalidations at texture fetch time */
     texcache_invalidate_dirty_ranges();
-    poly2_word &= 0x000F803F; /* Get just the texture-relevant bits */
-    uint32_t texture_lookup = texture_word;
-    if( PVR2_TEX_IS_PALETTE(texture_lookup) ) {
-        texture_lookup &= 0xF81FFFFF; /* Mask out the bank bits */
+    if( texcache_lookup_texture( poly2_word, texture_word, &st ) ) {
+        texcache_decode_texture( &st );
+        texcache_upload_texture( &st );
     }
-    int slot = texcache_find_texture_slot( poly2_word, texture_lookup );
+    return st.texture_id;
+}
 
-    if( slot == -1 ) {
-        /* Not found - check the free list */
-        slot = texcache_alloc_texture_slot( poly2_word, texture_lookup );
-        
-        /* Construct the GL texture */
-        uint32_t texture_addr = (texture_word & 0x000FFFFF)<<3;
-        unsigned width = POLY2_TEX_WIDTH(poly2_word);
-        unsigned height = POLY2_TEX_HEIGHT(poly2_word);
-        texcache_active_list[slot].size_bytes = width * height; /* approx, refined in load */
-        texcache_active_list[slot].page_start = (texture_addr >> 12);
-        texcache_active_list[slot].page_end = ((texture_addr + texcache_active_list[slot].size_bytes + 0xFFF) >> 12);
-
-        gl_state_cache_bind_texture( GL_TEXTURE_2D, texcache_active_list[slot].texture_id );
-        glGetError();
-        texcache_load_texture( texture_addr, width, height, texture_word );
-        /* refine size from format if needed? left as todo */
-        INFO( "Loaded texture %d: %x %dx%d %x (%x)", texcache_active_list[slot].texture_id, texture_addr, width, height, texture_word,
-                glGetError() );
-
-        /* Set texture parameters from the poly2 word */
-        if( POLY2_TEX_CLAMP_U(poly2_word) ) {
-            gl_state_cache_tex_parameter_i( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-        } else if( POLY2_TEX_MIRROR_U(poly2_word) ) {
-            gl_state_cache_tex_parameter_i( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT );
-        } else {
-            gl_state_cache_tex_parameter_i( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+/**
+ * Textures missed by texcache_get_texture_deferred(), in request order.
+ */
+static struct texcache_staging *texcache_pending = NULL;
+static int texcache_pending_count = 0;
+static int texcache_pending_size = 0;
+static tpool_t texcache_decode_pool = NULL;
+static uint64_t texcache_decode_us_2s = 0; /* rolling bucket, reset by pvr2 stats */
+
+uint64_t pvr2_texcache_decode_us_consume(void)
+{
+    uint64_t v = texcache_decode_us_2s;
+    texcache_decode_us_2s = 0;
+    return v;
+}
+
+GLuint texcache_get_texture_deferred( uint32_t poly2_word, uint32_t texture_word )
+{
+    struct texcache_staging st;
+
+    texcache_invalidate_dirty_ranges();
+    if( texcache_lookup_texture( poly2_word, texture_word, &st ) ) {
+        if( texcache_pending_count == texcache_pending_size ) {
+            texcache_pending_size = texcache_pending_size == 0 ? 64 : texcache_pending_size*2;
+            texcache_pending = g_realloc( texcache_pending,
+                    texcache_pending_size * sizeof(struct texcache_staging) );
         }
-        if( POLY2_TEX_CLAMP_V(poly2_word) ) {
-            gl_state_cache_tex_parameter_i( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-        } else if( POLY2_TEX_MIRROR_V(poly2_word) ) {
-            gl_state_cache_tex_parameter_i( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT );
-        } else {
-            gl_state_cache_tex_parameter_i( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+        texcache_pending[texcache_pending_count++] = st;
+    }
+    return st.texture_id;
+}
+
+static void texcache_decode_pending( void *data, unsigned index )
+{
+    texcache_decode_texture( &texcache_pending[index] );
+}
+
+void texcache_load_deferred( void )
+{
+    struct timeval start_tv, end_tv;
+    int i;
+
+    if( texcache_pending_count == 0 ) {
+        return;
+    }
+    if( texcache_decode_pool == NULL ) {
+        const char *env = getenv("LXDREAM_TEX_THREADS");
+        int threads = env == NULL ? 0 : atoi(env);
+        texcache_decode_pool = tpool_new( threads < 0 ? 0 : threads );
+        INFO( "Texture decode using %d threads", tpool_get_threads(texcache_decode_pool) );
+    }
+
+    /* Decode everything in parallel, then upload in request order - if a
+     * slot was reused within the batch, the last request wins just as it
+     * would when loading serially.
+     */
+    texcache_force_cpu_deindex(); /* Read the setting before the workers do */
+    gettimeofday( &start_tv, NULL );
+    tpool_run( texcache_decode_pool, texcache_pending_count, texcache_decode_pending, NULL );
+    gettimeofday( &end_tv, NULL );
+    uint32_t us = (end_tv.tv_sec - start_tv.tv_sec) * 1000000 +
+            (end_tv.tv_usec - start_tv.tv_usec);
+    texcache_decode_us_2s += us;
+    DEBUG( "Texture decode in %dus (%d textures)", us, texcache_pending_count );
+
+    for( i=0; i<texcache_pending_count; i++ ) {
+        texcache_upload_texture( &texcache_pending[i] );
+    }
+    texcache_pending_count = 0;
+}
+
+/**
+ * Expand 16-bit texels in the given GL packed format (as chosen by
+ * texcache_decode_levels) to ARGB8888.
+ */
+static void texcache_expand_to_argb( uint32_t *out, uint16_t *in, int count, GLint type )
+{
+    int i;
+    for( i=0; i<count; i++ ) {
+        uint32_t p = in[i], a, r, g, b;
+        switch( type ) {
+        case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+            a = (p & 0x8000) ? 0xFF : 0;
+            r = (p >> 10) & 0x1F; r = (r << 3) | (r >> 2);
+            g = (p >> 5) & 0x1F;  g = (g << 3) | (g >> 2);
+            b = p & 0x1F;         b = (b << 3) | (b >> 2);
+            break;
+        case GL_UNSIGNED_SHORT_5_6_5:
+            a = 0xFF;
+            r = (p >> 11) & 0x1F; r = (r << 3) | (r >> 2);
+            g = (p >> 5) & 0x3F;  g = (g << 2) | (g >> 4);
+            b = p & 0x1F;         b = (b << 3) | (b >> 2);
+            break;
+        default: /* GL_UNSIGNED_SHORT_4_4_4_4_REV */
+            a = (p >> 12) & 0x0F; a |= (a << 4);
+            r = (p >> 8) & 0x0F;  r |= (r << 4);
+            g = (p >> 4) & 0x0F;  g |= (g << 4);
+            b = p & 0x0F;         b |= (b << 4);
+            break;
         }
+        out[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+gboolean texcache_decode_texture_argb( uint32_t *out, uint32_t texture_word, int width, int height,
+                                       uint32_t palette_mode, uint32_t stride_width )
+{
+    struct texcache_staging st;
+    int count, i;
+
+    st.texture_word = texture_word;
+    st.texture_addr = (texture_word & 0x000FFFFF)<<3;
+    st.width = width;
+    st.height = height;
+    texcache_decode_levels( &st, palette_mode, stride_width, FALSE, FALSE );
+    if( st.num_levels == 0 ) {
+        return FALSE;
     }
 
-    return texcache_active_list[slot].texture_id;
+    count = st.level[0].width * st.level[0].height;
+    if( st.bpp_shift == 1 ) {
+        texcache_expand_to_argb( out, (uint16_t *)st.data, count, st.type );
+    } else if( st.format == GL_BGRA ) {
+        memcpy( out, st.data, count * sizeof(uint32_t) );
+    } else {
+        /* yuv_decode produces RGBA byte order */
+        uint32_t *in = (uint32_t *)st.data;
+        for( i=0; i<count; i++ ) {
+            uint32_t p = in[i];
+            out[i] = (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+        }
+    }
+    g_free( st.data );
+    return TRUE;
 }
 
 #if 0
@@ -955,67 +1271,63 @@ render_buffer_t texcache_get_render_buffer( uint32_t texture_addr, int mode, int
 #endif
 
 /**
- * Check the integrity of the texcache. Verifies that every cache slot
- * appears exactly once on either the free list or one page list. For 
- * active slots, the texture address must also match the page it appears on.
- * 
+ * Check the integrity of the texcache. Verifies that every entry on the LRU
+ * list can be found through both the hash table and its page list, and that
+ * the entry count and total size match.
  */
 void texcache_integrity_check()
 {
-    int i;
-    int slot_found[MAX_TEXTURES];
-
-    memset( slot_found, 0, sizeof(slot_found) );
-
-    /* Check entries on the free list */
-    for( i= texcache_free_ptr; i< MAX_TEXTURES; i++ ) {
-        int slot = texcache_free_list[i];
-        assert( slot_found[slot] == 0 );
-        assert( texcache_active_list[slot].next == EMPTY_ENTRY );
-        slot_found[slot] = 1;
-    }
-
-    /* Check entries on the active lists */
-    for( i=0; i< PVR2_RAM_PAGES; i++ ) {
-        int slot = texcache_page_lookup[i];
-        while( slot != EMPTY_ENTRY ) {
-            assert( slot_found[slot] == 0 );
-            assert( (texcache_active_list[slot].texture_addr >> 12) == i );
-            slot_found[slot] = 2;
-            slot = texcache_active_list[slot].next;
+    texcache_entry_t entry, found;
+    uint32_t count = 0;
+    uint64_t total_bytes = 0;
+
+    assert( texcache_lru_head == NULL || texcache_lru_head->lru_prev == NULL );
+    for( entry = texcache_lru_head; entry != NULL; entry = entry->lru_next ) {
+        assert( entry->lru_next != NULL || entry == texcache_lru_tail );
+        assert( entry->lru_next == NULL || entry->lru_next->lru_prev == entry );
+
+        found = texcache_hash_table[texcache_hash_bucket(entry->poly2_mode, entry->tex_mode)];
+        while( found != NULL && found != entry ) {
+            found = found->hash_next;
         }
-    }
+        assert( found == entry );
 
-    /* Make sure we didn't miss any entries */
-    for( i=0; i<MAX_TEXTURES; i++ ) {
-        assert( slot_found[i] != 0 );
+        found = texcache_page_lookup[entry->texture_addr >> 12];
+        while( found != NULL && found != entry ) {
+            found = found->page_next;
+        }
+        assert( found == entry );
+
+        count++;
+        total_bytes += entry->size_bytes;
     }
+    assert( count == texcache_entry_count );
+    assert( total_bytes == texcache_total_bytes );
 }
 
 /**
- * Dump the contents of the texture cache
+ * Dump the contents of the texture cache, least recently used first
  */
 void texcache_dump()
 {
-    unsigned i;
+    texcache_entry_t entry;
     GLboolean boolresult;
-    for( i=0; i< PVR2_RAM_PAGES; i++ ) {
-        int slot = texcache_page_lookup[i];
-        while( slot != EMPTY_ENTRY ) {
-            fprintf( stderr, "%-3d: %08X %dx%d (%08X %08X) %s\n", slot,
-                    texcache_active_list[slot].texture_addr,
-                    POLY2_TEX_WIDTH(texcache_active_list[slot].poly2_mode),
-                    POLY2_TEX_HEIGHT(texcache_active_list[slot].poly2_mode),
-                    texcache_active_list[slot].poly2_mode,
-                    texcache_active_list[slot].tex_mode,
+    fprintf( stderr, "%d textures, %lluKB\n", texcache_entry_count,
+             (unsigned long long)(texcache_total_bytes >> 10) );
+    for( entry = texcache_lru_head; entry != NULL; entry = entry->lru_next ) {
+        fprintf( stderr, "%-3d: %08X %dx%d (%08X %08X) %dKB %s\n", entry->texture_id,
+                entry->texture_addr,
+                POLY2_TEX_WIDTH(entry->poly2_mode),
+                POLY2_TEX_HEIGHT(entry->poly2_mode),
+                entry->poly2_mode,
+                entry->tex_mode,
+                entry->size_bytes >> 10,
 #ifdef HAVE_OPENGL_TEX_RESIDENT
-                    (glAreTexturesResident(1, &texcache_active_list[slot].texture_id, &boolresult) ? "[RESIDENT]" : "[NOT RESIDENT]")
+                (glAreTexturesResident(1, &entry->texture_id, &boolresult) ? "[RESIDENT]" : "[NOT RESIDENT]")
 #else
-                    ""
+                ""
 #endif
-                    );
-            slot = texcache_active_list[slot].next;
-        }
+                );
     }
 }
 
@@ -1026,7 +1338,7 @@ void texcache_print_idx4( uint32_t texture_addr, int width )
     unsigned char tmp[src_bytes];
     unsigned char data[width*width];
     pvr2_vram64_read_twiddled_4( tmp, texture_addr, width, width );
-    decode_pal4_to_pal8( data, tmp, src_bytes );
+    texdecode->pal4_to_pal8( data, tmp, src_bytes );
     for( y=0; y<width; y++ ) {
         for( x=0; x<width; x++ ) {
             printf( "%1x", data[y*width+x] );
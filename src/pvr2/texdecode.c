@@ -0,0 +1,970 @@
+/**
+ * $Id$
+ *
+ * Texture decoding kernels - reference C versions, plus SSE2/AVX2 (x86) and
+ * NEON (AArch64) versions selected at runtime.
+ *
+ * Twiddled textures are stored in Morton order (with y in the low bit) in
+ * the 64-bit view of vram, ie alternating 32-bit words from the two banks.
+ * The reference versions walk the image recursively, a pixel at a time. The
+ * SIMD versions instead copy each 32x32 block's run of the stream out of
+ * the two banks into a linear buffer, and then detwiddle 4x4 pixel cells
+ * (16 consecutive stream pixels) with a fixed shuffle:
+ *
+ *     stream index:  0  2  8 10     row 0
+ *                    1  3  9 11     row 1
+ *                    4  6 12 14     row 2
+ *                    5  7 13 15     row 3
+ *
+ * Cells are themselves laid out in Morton order within the block, so two
+ * consecutive cells form a 4x8 column. Images smaller than 8 pixels in
+ * either dimension go through the reference versions.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "pvr2/texdecode.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#define HAVE_TEXDECODE_X86 1
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define HAVE_TEXDECODE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define BANK_SIZE 0x400000 /* Offset of bank 1 from bank 0 in the 32-bit view */
+#define MAX_BLOCK 32       /* Largest square block detwiddled in one go */
+#define MIN_SIMD_SIZE 8    /* Smallest dimension handled by the SIMD paths */
+
+/************************** Reference versions ****************************/
+
+/**
+ * @param dest Destination image buffer
+ * @param banks Source data expressed as two bank pointers
+ * @param offset Offset into banks[0] specifying where the next byte
+ *  to read is (0..3)
+ * @param x1,y1 Destination coordinates
+ * @param width Width of current destination block
+ * @param stride Total width of image (ie stride) in bytes
+ */
+static void detwiddle_4_scalar( uint8_t *dest, const uint8_t *banks[2], int offset,
+                                int x1, int y1, int width, int stride )
+{
+    if( width == 2 ) {
+        x1 = x1 >> 1;
+        uint8_t t1 = *banks[offset<4?0:1]++;
+        uint8_t t2 = *banks[offset<3?0:1]++;
+        dest[y1*stride + x1] = (t1 & 0x0F) | (t2<<4);
+        dest[(y1+1)*stride + x1] = (t1>>4) | (t2&0xF0);
+    } else if( width == 4 ) {
+        detwiddle_4_scalar( dest, banks, offset, x1, y1, 2, stride );
+        detwiddle_4_scalar( dest, banks, offset+2, x1, y1+2, 2, stride );
+        detwiddle_4_scalar( dest, banks, offset+4, x1+2, y1, 2, stride );
+        detwiddle_4_scalar( dest, banks, offset+6, x1+2, y1+2, 2, stride );
+
+    } else {
+        int subdivide = width >> 1;
+        detwiddle_4_scalar( dest, banks, offset, x1, y1, subdivide, stride );
+        detwiddle_4_scalar( dest, banks, offset, x1, y1+subdivide, subdivide, stride );
+        detwiddle_4_scalar( dest, banks, offset, x1+subdivide, y1, subdivide, stride );
+        detwiddle_4_scalar( dest, banks, offset, x1+subdivide, y1+subdivide, subdivide, stride );
+    }
+}
+
+/**
+ * @param dest Destination image buffer
+ * @param banks Source data expressed as two bank pointers
+ * @param offset Offset into banks[0] specifying where the next byte
+ *  to read is (0..3)
+ * @param x1,y1 Destination coordinates
+ * @param width Width of current destination block
+ * @param stride Total width of image (ie stride)
+ */
+static void detwiddle_8_scalar( uint8_t *dest, const uint8_t *banks[2], int offset,
+                                int x1, int y1, int width, int stride )
+{
+    if( width == 2 ) {
+        dest[y1*stride + x1] = *banks[0]++;
+        dest[(y1+1)*stride + x1] = *banks[offset<3?0:1]++;
+        dest[y1*stride + x1 + 1] = *banks[offset<2?0:1]++;
+        dest[(y1+1)*stride + x1 + 1] = *banks[offset==0?0:1]++;
+        const uint8_t *tmp = banks[0]; /* swap banks */
+        banks[0] = banks[1];
+        banks[1] = tmp;
+    } else {
+        int subdivide = width >> 1;
+        detwiddle_8_scalar( dest, banks, offset, x1, y1, subdivide, stride );
+        detwiddle_8_scalar( dest, banks, offset, x1, y1+subdivide, subdivide, stride );
+        detwiddle_8_scalar( dest, banks, offset, x1+subdivide, y1, subdivide, stride );
+        detwiddle_8_scalar( dest, banks, offset, x1+subdivide, y1+subdivide, subdivide, stride );
+    }
+}
+
+/**
+ * @param dest Destination image buffer
+ * @param banks Source data expressed as two bank pointers
+ * @param offset Offset into banks[0] specifying where the next word
+ *  to read is (0 or 1)
+ * @param x1,y1 Destination coordinates
+ * @param width Width of current destination block
+ * @param stride Total width of image (ie stride)
+ */
+static void detwiddle_16_scalar( uint16_t *dest, const uint16_t *banks[2], int offset,
+                                 int x1, int y1, int width, int stride )
+{
+    if( width == 2 ) {
+        dest[y1*stride + x1] = *banks[0]++;
+        dest[(y1+1)*stride + x1] = *banks[offset]++;
+        dest[y1*stride + x1 + 1] = *banks[1]++;
+        dest[(y1+1)*stride + x1 + 1] = *banks[offset^1]++;
+    } else {
+        int subdivide = width >> 1;
+        detwiddle_16_scalar( dest, banks, offset, x1, y1, subdivide, stride );
+        detwiddle_16_scalar( dest, banks, offset, x1, y1+subdivide, subdivide, stride );
+        detwiddle_16_scalar( dest, banks, offset, x1+subdivide, y1, subdivide, stride );
+        detwiddle_16_scalar( dest, banks, offset, x1+subdivide, y1+subdivide, subdivide, stride );
+    }
+}
+
+static void read_twiddled_4_scalar( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                                    uint32_t width, uint32_t height )
+{
+    int offset_flag = (srcaddr & 0x07);
+    const uint8_t *banks[2];
+    uint32_t stride = width >> 1;
+    int i;
+
+    srcaddr = srcaddr & 0x7FFFF8;
+
+    banks[0] = vram + (srcaddr>>1);
+    banks[1] = banks[0] + BANK_SIZE;
+    if( offset_flag & 0x04 ) { // If source is not 64-bit aligned, swap the banks
+        const uint8_t *tmp = banks[0];
+        banks[0] = banks[1];
+        banks[1] = tmp + 4;
+        offset_flag &= 0x03;
+    }
+    banks[0] += offset_flag;
+
+    if( width > height ) {
+        for( i=0; i<width; i+=height ) {
+            detwiddle_4_scalar( dest, banks, offset_flag, i, 0, height, stride );
+        }
+    } else if( height > width ) {
+        for( i=0; i<height; i+=width ) {
+            detwiddle_4_scalar( dest, banks, offset_flag, 0, i, width, stride );
+        }
+    } else if( width == 1 ) {
+        *dest = *banks[0];
+    } else {
+        detwiddle_4_scalar( dest, banks, offset_flag, 0, 0, width, stride );
+    }
+}
+
+static void read_twiddled_8_scalar( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                                    uint32_t width, uint32_t height )
+{
+    int offset_flag = (srcaddr & 0x07);
+    const uint8_t *banks[2];
+    int i;
+
+    srcaddr = srcaddr & 0x7FFFF8;
+
+    banks[0] = vram + (srcaddr>>1);
+    banks[1] = banks[0] + BANK_SIZE;
+    if( offset_flag & 0x04 ) { // If source is not 64-bit aligned, swap the banks
+        const uint8_t *tmp = banks[0];
+        banks[0] = banks[1];
+        banks[1] = tmp + 4;
+        offset_flag &= 0x03;
+    }
+    banks[0] += offset_flag;
+
+    if( width > height ) {
+        for( i=0; i<width; i+=height ) {
+            detwiddle_8_scalar( dest, banks, offset_flag, i, 0, height, width );
+        }
+    } else if( height > width ) {
+        for( i=0; i<height; i+=width ) {
+            detwiddle_8_scalar( dest, banks, offset_flag, 0, i, width, width );
+        }
+    } else if( width == 1 ) {
+        *dest = *banks[0];
+    } else {
+        detwiddle_8_scalar( dest, banks, offset_flag, 0, 0, width, width );
+    }
+}
+
+static void read_twiddled_16_scalar( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                                     uint32_t width, uint32_t height )
+{
+    int offset_flag = (srcaddr & 0x06) >> 1;
+    const uint16_t *banks[2];
+    uint16_t *wdest = (uint16_t*)dest;
+    int i;
+
+    srcaddr = srcaddr & 0x7FFFF8;
+
+    banks[0] = (const uint16_t *)(vram + (srcaddr>>1));
+    banks[1] = banks[0] + (BANK_SIZE>>1);
+    if( offset_flag & 0x02 ) { // If source is not 64-bit aligned, swap the banks
+        const uint16_t *tmp = banks[0];
+        banks[0] = banks[1];
+        banks[1] = tmp + 2;
+        offset_flag &= 0x01;
+    }
+    banks[0] += offset_flag;
+
+    if( width > height ) {
+        for( i=0; i<width; i+=height ) {
+            detwiddle_16_scalar( wdest, banks, offset_flag, i, 0, height, width );
+        }
+    } else if( height > width ) {
+        for( i=0; i<height; i+=width ) {
+            detwiddle_16_scalar( wdest, banks, offset_flag, 0, i, width, width );
+        }
+    } else if( width == 1 ) {
+        *wdest = *banks[0];
+    } else {
+        detwiddle_16_scalar( wdest, banks, offset_flag, 0, 0, width, width );
+    }
+}
+
+static void vq_decode_scalar( uint16_t *output, const uint8_t *input, int width, int height,
+                              const struct vq_codebook *codebook )
+{
+    int i,j;
+
+    const uint8_t *c = input;
+    for( j=0; j<height; j+=2 ) {
+        for( i=0; i<width; i+=2 ) {
+            uint8_t code = *c++;
+            output[i + j*width] = codebook->quad[code][0];
+            output[i + 1 + j*width] = codebook->quad[code][1];
+            output[i + (j+1)*width] = codebook->quad[code][2];
+            output[i + 1 + (j+1)*width] = codebook->quad[code][3];
+        }
+    }
+}
+
+static void pal8_to_32_scalar( uint32_t *out, const uint8_t *in, int inbytes, const uint32_t *pal )
+{
+    int i;
+    for( i=0; i<inbytes; i++ ) {
+        *out++ = pal[*in++];
+    }
+}
+
+static void pal8_to_16_scalar( uint16_t *out, const uint8_t *in, int inbytes, const uint32_t *pal )
+{
+    int i;
+    for( i=0; i<inbytes; i++ ) {
+        *out++ = (uint16_t)pal[*in++];
+    }
+}
+
+static void pal4_to_32_scalar( uint32_t *out, const uint8_t *in, int inbytes, const uint32_t *pal )
+{
+    int i;
+    for( i=0; i<inbytes; i++ ) {
+        *out++ = pal[*in & 0x0F];
+        *out++ = pal[(*in >> 4)];
+        in++;
+    }
+}
+
+static void pal4_to_16_scalar( uint16_t *out, const uint8_t *in, int inbytes, const uint32_t *pal )
+{
+    int i;
+    for( i=0; i<inbytes; i++ ) {
+        *out++ = (uint16_t)pal[*in & 0x0F];
+        *out++ = (uint16_t)pal[(*in >> 4)];
+        in++;
+    }
+}
+
+static void pal4_to_pal8_scalar( uint8_t *out, const uint8_t *in, int inbytes )
+{
+    int i;
+    for( i=0; i<inbytes; i++ ) {
+        *out++ = (uint8_t)(*in & 0x0F);
+        *out++ = (uint8_t)(*in >> 4);
+        in++;
+    }
+}
+
+static const struct texdecode_ops texdecode_scalar = {
+        "scalar",
+        read_twiddled_4_scalar, read_twiddled_8_scalar, read_twiddled_16_scalar,
+        vq_decode_scalar,
+        pal8_to_32_scalar, pal8_to_16_scalar, pal4_to_32_scalar, pal4_to_16_scalar,
+        pal4_to_pal8_scalar };
+
+const struct texdecode_ops *texdecode = &texdecode_scalar;
+
+/************************ Block-based detwiddling *************************/
+
+/**
+ * Copy groups of 64-bit words from the two banks into a linear buffer.
+ */
+typedef void (*linearize_fn_t)( uint8_t *dest, const uint8_t *bank0, const uint8_t *bank1,
+                                uint32_t groups );
+
+/**
+ * Detwiddle a size x size block from a linear stream.
+ * @param dest top-left of the block in the destination image
+ * @param stride destination row length in bytes
+ */
+typedef void (*detwiddle_fn_t)( uint8_t *dest, uint32_t stride, const uint8_t *src, uint32_t size );
+
+/**
+ * Extract the even-numbered bits of v, ie the y coordinate of a Morton index
+ * (and the x coordinate of index>>1).
+ */
+static inline uint32_t morton_even_bits( uint32_t v )
+{
+    v &= 0x55555555;
+    v = (v | (v >> 1)) & 0x33333333;
+    v = (v | (v >> 2)) & 0x0F0F0F0F;
+    v = (v | (v >> 4)) & 0x00FF00FF;
+    v = (v | (v >> 8)) & 0x0000FFFF;
+    return v;
+}
+
+static void linearize_scalar( uint8_t *dest, const uint8_t *bank0, const uint8_t *bank1,
+                              uint32_t groups )
+{
+    while( groups-- > 0 ) {
+        memcpy( dest, bank0, 4 );
+        memcpy( dest+4, bank1, 4 );
+        dest += 8;
+        bank0 += 4;
+        bank1 += 4;
+    }
+}
+
+/**
+ * Common driver for the SIMD twiddled readers: walk the image in square
+ * blocks of up to MAX_BLOCK pixels (in stream order), linearizing and then
+ * detwiddling each. Width and height must both be at least MIN_SIMD_SIZE.
+ */
+static void read_twiddled_blocks( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                                  uint32_t width, uint32_t height, int bits,
+                                  linearize_fn_t linearize, detwiddle_fn_t detwiddle )
+{
+    uint8_t buf[((MAX_BLOCK*MAX_BLOCK*16)>>3) + 16] __attribute__((aligned(32)));
+    uint32_t size = width < height ? width : height;
+    uint32_t block = size < MAX_BLOCK ? size : MAX_BLOCK;
+    uint32_t block_bytes = (block*block*bits) >> 3;
+    uint32_t blocks_per_square = (size/block) * (size/block);
+    uint32_t squares = (width > height ? width : height) / size;
+    uint32_t stride = (width*bits) >> 3;
+    const uint8_t *bank0 = vram + ((srcaddr & 0x7FFFF8) >> 1);
+    uint32_t pos = srcaddr & 0x07; /* Stream position relative to bank0 */
+    uint32_t sq, j;
+
+    for( sq=0; sq<squares; sq++ ) {
+        uint32_t sx = width > height ? sq*size : 0;
+        uint32_t sy = width > height ? 0 : sq*size;
+        for( j=0; j<blocks_per_square; j++ ) {
+            uint32_t x = sx + morton_even_bits(j>>1)*block;
+            uint32_t y = sy + morton_even_bits(j)*block;
+            uint32_t group = pos >> 3, skip = pos & 0x07;
+            linearize( buf, bank0 + (group<<2), bank0 + BANK_SIZE + (group<<2),
+                       (skip + block_bytes + 7) >> 3 );
+            detwiddle( dest + y*stride + ((x*bits)>>3), stride, buf + skip, block );
+            pos += block_bytes;
+        }
+    }
+}
+
+/******************************* SSE2/AVX2 ********************************/
+
+#ifdef HAVE_TEXDECODE_X86
+
+TARGET_SSE2 static void linearize_sse2( uint8_t *dest, const uint8_t *bank0, const uint8_t *bank1,
+                                        uint32_t groups )
+{
+    for( ; groups >= 4; groups -= 4 ) {
+        __m128i a = _mm_loadu_si128( (const __m128i *)bank0 );
+        __m128i b = _mm_loadu_si128( (const __m128i *)bank1 );
+        _mm_storeu_si128( (__m128i *)dest, _mm_unpacklo_epi32( a, b ) );
+        _mm_storeu_si128( (__m128i *)(dest+16), _mm_unpackhi_epi32( a, b ) );
+        dest += 32;
+        bank0 += 16;
+        bank1 += 16;
+    }
+    linearize_scalar( dest, bank0, bank1, groups );
+}
+
+/**
+ * Detwiddle one cell of 8-bit pixels, returning rows 0..3 in 32-bit lanes 0..3.
+ */
+TARGET_SSE2 static inline __m128i detwiddle_cell_8_sse2( __m128i v )
+{
+    __m128i even = _mm_and_si128( v, _mm_set1_epi16(0x00FF) );
+    __m128i odd = _mm_srli_epi16( v, 8 );
+    __m128i p = _mm_packus_epi16( even, odd ); /* 0 2 4 6 8 10 12 14 1 3 5 ... */
+    p = _mm_shufflelo_epi16( p, _MM_SHUFFLE(3,1,2,0) );
+    p = _mm_shufflehi_epi16( p, _MM_SHUFFLE(3,1,2,0) );
+    return _mm_shuffle_epi32( p, _MM_SHUFFLE(3,1,2,0) );
+}
+
+/**
+ * Sort the 16-bit lanes of v into even lanes then odd lanes
+ */
+TARGET_SSE2 static inline __m128i unzip_16_sse2( __m128i v )
+{
+    v = _mm_shufflelo_epi16( v, _MM_SHUFFLE(3,1,2,0) );
+    v = _mm_shufflehi_epi16( v, _MM_SHUFFLE(3,1,2,0) );
+    return _mm_shuffle_epi32( v, _MM_SHUFFLE(3,1,2,0) );
+}
+
+/**
+ * Pack pairs of 4-bit pixels (one per byte) in each 16-bit lane into the low
+ * byte of the lane, low nibble first.
+ */
+TARGET_SSE2 static inline __m128i pack_nibbles_sse2( __m128i v )
+{
+    return _mm_or_si128( _mm_and_si128( v, _mm_set1_epi16(0x000F) ),
+                         _mm_and_si128( _mm_srli_epi16( v, 4 ), _mm_set1_epi16(0x00F0) ) );
+}
+
+TARGET_SSE2 static inline void store_rows_32_sse2( uint8_t *dest, uint32_t stride, __m128i rows )
+{
+    *(uint32_t *)dest = _mm_cvtsi128_si32( rows );
+    *(uint32_t *)(dest + stride) = _mm_cvtsi128_si32( _mm_srli_si128( rows, 4 ) );
+    *(uint32_t *)(dest + 2*stride) = _mm_cvtsi128_si32( _mm_srli_si128( rows, 8 ) );
+    *(uint32_t *)(dest + 3*stride) = _mm_cvtsi128_si32( _mm_srli_si128( rows, 12 ) );
+}
+
+TARGET_SSE2 static void detwiddle_4_sse2( uint8_t *dest, uint32_t stride, const uint8_t *src, uint32_t size )
+{
+    uint32_t cells = (size*size) >> 4, c;
+    for( c=0; c<cells; c+=2 ) {
+        uint8_t *d = dest + (morton_even_bits(c)<<2)*stride + (morton_even_bits(c>>1)<<1);
+        __m128i v = _mm_loadu_si128( (const __m128i *)(src + (c<<3)) );
+        __m128i lo = _mm_and_si128( v, _mm_set1_epi8(0x0F) );
+        __m128i hi = _mm_and_si128( _mm_srli_epi16( v, 4 ), _mm_set1_epi8(0x0F) );
+        __m128i a = detwiddle_cell_8_sse2( _mm_unpacklo_epi8( lo, hi ) );
+        __m128i b = detwiddle_cell_8_sse2( _mm_unpackhi_epi8( lo, hi ) );
+        __m128i rows = _mm_packus_epi16( pack_nibbles_sse2(a), pack_nibbles_sse2(b) );
+        *(uint16_t *)d = _mm_extract_epi16( rows, 0 );
+        *(uint16_t *)(d + stride) = _mm_extract_epi16( rows, 1 );
+        *(uint16_t *)(d + 2*stride) = _mm_extract_epi16( rows, 2 );
+        *(uint16_t *)(d + 3*stride) = _mm_extract_epi16( rows, 3 );
+        *(uint16_t *)(d + 4*stride) = _mm_extract_epi16( rows, 4 );
+        *(uint16_t *)(d + 5*stride) = _mm_extract_epi16( rows, 5 );
+        *(uint16_t *)(d + 6*stride) = _mm_extract_epi16( rows, 6 );
+        *(uint16_t *)(d + 7*stride) = _mm_extract_epi16( rows, 7 );
+    }
+}
+
+TARGET_SSE2 static void detwiddle_8_sse2( uint8_t *dest, uint32_t stride, const uint8_t *src, uint32_t size )
+{
+    uint32_t cells = (size*size) >> 4, c;
+    for( c=0; c<cells; c++ ) {
+        uint8_t *d = dest + (morton_even_bits(c)<<2)*stride + (morton_even_bits(c>>1)<<2);
+        __m128i v = _mm_loadu_si128( (const __m128i *)(src + (c<<4)) );
+        store_rows_32_sse2( d, stride, detwiddle_cell_8_sse2( v ) );
+    }
+}
+
+TARGET_SSE2 static void detwiddle_16_sse2( uint8_t *dest, uint32_t stride, const uint8_t *src, uint32_t size )
+{
+    uint32_t cells = (size*size) >> 4, c;
+    for( c=0; c<cells; c++ ) {
+        uint8_t *d = dest + (morton_even_bits(c)<<2)*stride + (morton_even_bits(c>>1)<<3);
+        __m128i a = unzip_16_sse2( _mm_loadu_si128( (const __m128i *)(src + (c<<5)) ) );
+        __m128i b = unzip_16_sse2( _mm_loadu_si128( (const __m128i *)(src + (c<<5) + 16) ) );
+        __m128i r02 = _mm_unpacklo_epi32( a, b );
+        __m128i r13 = _mm_unpackhi_epi32( a, b );
+        _mm_storel_epi64( (__m128i *)d, r02 );
+        _mm_storel_epi64( (__m128i *)(d + stride), r13 );
+        _mm_storel_epi64( (__m128i *)(d + 2*stride), _mm_unpackhi_epi64( r02, r02 ) );
+        _mm_storel_epi64( (__m128i *)(d + 3*stride), _mm_unpackhi_epi64( r13, r13 ) );
+    }
+}
+
+static void read_twiddled_4_sse2( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                                  uint32_t width, uint32_t height )
+{
+    /* The reference version doesn't treat the stream linearly when it starts
+     * part-way through a 32-bit word, so leave those to it. */
+    if( width < MIN_SIMD_SIZE || height < MIN_SIMD_SIZE || (srcaddr & 0x03) != 0 ) {
+        read_twiddled_4_scalar( dest, vram, srcaddr, width, height );
+    } else {
+        read_twiddled_blocks( dest, vram, srcaddr, width, height, 4, linearize_sse2, detwiddle_4_sse2 );
+    }
+}
+
+static void read_twiddled_8_sse2( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                                  uint32_t width, uint32_t height )
+{
+    if( width < MIN_SIMD_SIZE || height < MIN_SIMD_SIZE ) {
+        read_twiddled_8_scalar( dest, vram, srcaddr, width, height );
+    } else {
+        read_twiddled_blocks( dest, vram, srcaddr, width, height, 8, linearize_sse2, detwiddle_8_sse2 );
+    }
+}
+
+static void read_twiddled_16_sse2( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                                   uint32_t width, uint32_t height )
+{
+    if( width < MIN_SIMD_SIZE || height < MIN_SIMD_SIZE ) {
+        read_twiddled_16_scalar( dest, vram, srcaddr, width, height );
+    } else {
+        read_twiddled_blocks( dest, vram, srcaddr, width, height, 16, linearize_sse2, detwiddle_16_sse2 );
+    }
+}
+
+/**
+ * Each codebook entry is 64 bits: the top pair of pixels in the low 32 bits,
+ * the bottom pair in the high 32 bits. Four codes give a row pair of 8 pixels.
+ */
+TARGET_SSE2 static void vq_decode_sse2( uint16_t *output, const uint8_t *input, int width, int height,
+                                        const struct vq_codebook *codebook )
+{
+    int i, j;
+    if( width < 8 ) {
+        vq_decode_scalar( output, input, width, height, codebook );
+        return;
+    }
+    for( j=0; j<height; j+=2 ) {
+        uint16_t *top = output + j*width;
+        uint16_t *bottom = top + width;
+        for( i=0; i<width; i+=8 ) {
+            __m128i x = _mm_unpacklo_epi64( _mm_loadl_epi64( (const __m128i *)codebook->quad[input[0]] ),
+                                            _mm_loadl_epi64( (const __m128i *)codebook->quad[input[1]] ) );
+            __m128i y = _mm_unpacklo_epi64( _mm_loadl_epi64( (const __m128i *)codebook->quad[input[2]] ),
+                                            _mm_loadl_epi64( (const __m128i *)codebook->quad[input[3]] ) );
+            input += 4;
+            __m128 xf = _mm_castsi128_ps(x), yf = _mm_castsi128_ps(y);
+            _mm_storeu_si128( (__m128i *)(top + i), _mm_castps_si128( _mm_shuffle_ps( xf, yf, _MM_SHUFFLE(2,0,2,0) ) ) );
+            _mm_storeu_si128( (__m128i *)(bottom + i), _mm_castps_si128( _mm_shuffle_ps( xf, yf, _MM_SHUFFLE(3,1,3,1) ) ) );
+        }
+    }
+}
+
+TARGET_SSE2 static void pal4_to_pal8_sse2( uint8_t *out, const uint8_t *in, int inbytes )
+{
+    int i;
+    for( i=0; i+16 <= inbytes; i+=16 ) {
+        __m128i v = _mm_loadu_si128( (const __m128i *)(in + i) );
+        __m128i lo = _mm_and_si128( v, _mm_set1_epi8(0x0F) );
+        __m128i hi = _mm_and_si128( _mm_srli_epi16( v, 4 ), _mm_set1_epi8(0x0F) );
+        _mm_storeu_si128( (__m128i *)(out + 2*i), _mm_unpacklo_epi8( lo, hi ) );
+        _mm_storeu_si128( (__m128i *)(out + 2*i + 16), _mm_unpackhi_epi8( lo, hi ) );
+    }
+    pal4_to_pal8_scalar( out + 2*i, in + i, inbytes - i );
+}
+
+/* There's no gather before AVX2, so the SSE2 palette lookups are the
+ * reference versions. */
+static const struct texdecode_ops texdecode_sse2 = {
+        "sse2",
+        read_twiddled_4_sse2, read_twiddled_8_sse2, read_twiddled_16_sse2,
+        vq_decode_sse2,
+        pal8_to_32_scalar, pal8_to_16_scalar, pal4_to_32_scalar, pal4_to_16_scalar,
+        pal4_to_pal8_sse2 };
+
+TARGET_AVX2 static void linearize_avx2( uint8_t *dest, const uint8_t *bank0, const uint8_t *bank1,
+                                        uint32_t groups )
+{
+    for( ; groups >= 8; groups -= 8 ) {
+        __m256i a = _mm256_loadu_si256( (const __m256i *)bank0 );
+        __m256i b = _mm256_loadu_si256( (const __m256i *)bank1 );
+        __m256i lo = _mm256_unpacklo_epi32( a, b );
+        __m256i hi = _mm256_unpackhi_epi32( a, b );
+        _mm256_storeu_si256( (__m256i *)dest, _mm256_permute2x128_si256( lo, hi, 0x20 ) );
+        _mm256_storeu_si256( (__m256i *)(dest+32), _mm256_permute2x128_si256( lo, hi, 0x31 ) );
+        dest += 64;
+        bank0 += 32;
+        bank1 += 32;
+    }
+    linearize_sse2( dest, bank0, bank1, groups );
+}
+
+/* Two cells (a 4x8 column) at a time, one per 128-bit lane */
+TARGET_AVX2 static void detwiddle_8_avx2( uint8_t *dest, uint32_t stride, const uint8_t *src, uint32_t size )
+{
+    const __m256i shuf = _mm256_setr_epi8( 0, 2, 8, 10, 1, 3, 9, 11, 4, 6, 12, 14, 5, 7, 13, 15,
+                                           0, 2, 8, 10, 1, 3, 9, 11, 4, 6, 12, 14, 5, 7, 13, 15 );
+    uint32_t cells = (size*size) >> 4, c;
+    for( c=0; c<cells; c+=2 ) {
+        uint8_t *d = dest + (morton_even_bits(c)<<2)*stride + (morton_even_bits(c>>1)<<2);
+        __m256i v = _mm256_shuffle_epi8( _mm256_loadu_si256( (const __m256i *)(src + (c<<4)) ), shuf );
+        store_rows_32_sse2( d, stride, _mm256_castsi256_si128( v ) );
+        store_rows_32_sse2( d + 4*stride, stride, _mm256_extracti128_si256( v, 1 ) );
+    }
+}
+
+TARGET_AVX2 static void detwiddle_16_avx2( uint8_t *dest, uint32_t stride, const uint8_t *src, uint32_t size )
+{
+    const __m256i shuf = _mm256_setr_epi8( 0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15,
+                                           0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15 );
+    uint32_t cells = (size*size) >> 4, c;
+    for( c=0; c<cells; c+=2 ) {
+        uint8_t *d = dest + (morton_even_bits(c)<<2)*stride + (morton_even_bits(c>>1)<<3);
+        __m256i p = _mm256_loadu_si256( (const __m256i *)(src + (c<<5)) );
+        __m256i q = _mm256_loadu_si256( (const __m256i *)(src + (c<<5) + 32) );
+        __m256i a = _mm256_shuffle_epi8( _mm256_permute2x128_si256( p, q, 0x20 ), shuf );
+        __m256i b = _mm256_shuffle_epi8( _mm256_permute2x128_si256( p, q, 0x31 ), shuf );
+        __m256i r02 = _mm256_unpacklo_epi32( a, b ); /* rows 0,2 | 4,6 */
+        __m256i r13 = _mm256_unpackhi_epi32( a, b ); /* rows 1,3 | 5,7 */
+        __m128i r02lo = _mm256_castsi256_si128( r02 ), r02hi = _mm256_extracti128_si256( r02, 1 );
+        __m128i r13lo = _mm256_castsi256_si128( r13 ), r13hi = _mm256_extracti128_si256( r13, 1 );
+        _mm_storel_epi64( (__m128i *)d, r02lo );
+        _mm_storel_epi64( (__m128i *)(d + stride), r13lo );
+        _mm_storel_epi64( (__m128i *)(d + 2*stride), _mm_unpackhi_epi64( r02lo, r02lo ) );
+        _mm_storel_epi64( (__m128i *)(d + 3*stride), _mm_unpackhi_epi64( r13lo, r13lo ) );
+        _mm_storel_epi64( (__m128i *)(d + 4*stride), r02hi );
+        _mm_storel_epi64( (__m128i *)(d + 5*stride), r13hi );
+        _mm_storel_epi64( (__m128i *)(d + 6*stride), _mm_unpackhi_epi64( r02hi, r02hi ) );
+        _mm_storel_epi64( (__m128i *)(d + 7*stride), _mm_unpackhi_epi64( r13hi, r13hi ) );
+    }
+}
+
+static void read_twiddled_8_avx2( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                                  uint32_t width, uint32_t height )
+{
+    if( width < MIN_SIMD_SIZE || height < MIN_SIMD_SIZE ) {
+        read_twiddled_8_scalar( dest, vram, srcaddr, width, height );
+    } else {
+        read_twiddled_blocks( dest, vram, srcaddr, width, height, 8, linearize_avx2, detwiddle_8_avx2 );
+    }
+}
+
+static void read_twiddled_16_avx2( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                                   uint32_t width, uint32_t height )
+{
+    if( width < MIN_SIMD_SIZE || height < MIN_SIMD_SIZE ) {
+        read_twiddled_16_scalar( dest, vram, srcaddr, width, height );
+    } else {
+        read_twiddled_blocks( dest, vram, srcaddr, width, height, 16, linearize_avx2, detwiddle_16_avx2 );
+    }
+}
+
+TARGET_AVX2 static void pal8_to_32_avx2( uint32_t *out, const uint8_t *in, int inbytes, const uint32_t *pal )
+{
+    int i;
+    for( i=0; i+8 <= inbytes; i+=8 ) {
+        __m256i idx = _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i *)(in + i) ) );
+        _mm256_storeu_si256( (__m256i *)(out + i), _mm256_i32gather_epi32( (const int *)pal, idx, 4 ) );
+    }
+    pal8_to_32_scalar( out + i, in + i, inbytes - i, pal );
+}
+
+/**
+ * Look up 16 indexes (bytes) and store the low halves of the entries
+ */
+TARGET_AVX2 static inline void gather_16_avx2( uint16_t *out, __m128i idx, const uint32_t *pal )
+{
+    const __m256i mask = _mm256_set1_epi32( 0xFFFF );
+    __m256i a = _mm256_i32gather_epi32( (const int *)pal, _mm256_cvtepu8_epi32( idx ), 4 );
+    __m256i b = _mm256_i32gather_epi32( (const int *)pal, _mm256_cvtepu8_epi32( _mm_srli_si128( idx, 8 ) ), 4 );
+    __m256i p = _mm256_packus_epi32( _mm256_and_si256( a, mask ), _mm256_and_si256( b, mask ) );
+    _mm256_storeu_si256( (__m256i *)out, _mm256_permute4x64_epi64( p, _MM_SHUFFLE(3,1,2,0) ) );
+}
+
+TARGET_AVX2 static inline __m128i unpack_nibbles_lo_avx2( __m128i v )
+{
+    __m128i lo = _mm_and_si128( v, _mm_set1_epi8(0x0F) );
+    __m128i hi = _mm_and_si128( _mm_srli_epi16( v, 4 ), _mm_set1_epi8(0x0F) );
+    return _mm_unpacklo_epi8( lo, hi );
+}
+
+TARGET_AVX2 static void pal8_to_16_avx2( uint16_t *out, const uint8_t *in, int inbytes, const uint32_t *pal )
+{
+    int i;
+    for( i=0; i+16 <= inbytes; i+=16 ) {
+        gather_16_avx2( out + i, _mm_loadu_si128( (const __m128i *)(in + i) ), pal );
+    }
+    pal8_to_16_scalar( out + i, in + i, inbytes - i, pal );
+}
+
+TARGET_AVX2 static void pal4_to_32_avx2( uint32_t *out, const uint8_t *in, int inbytes, const uint32_t *pal )
+{
+    int i;
+    for( i=0; i+8 <= inbytes; i+=8 ) {
+        __m128i idx = unpack_nibbles_lo_avx2( _mm_loadl_epi64( (const __m128i *)(in + i) ) );
+        _mm256_storeu_si256( (__m256i *)(out + 2*i),
+                _mm256_i32gather_epi32( (const int *)pal, _mm256_cvtepu8_epi32( idx ), 4 ) );
+        _mm256_storeu_si256( (__m256i *)(out + 2*i + 8),
+                _mm256_i32gather_epi32( (const int *)pal, _mm256_cvtepu8_epi32( _mm_srli_si128( idx, 8 ) ), 4 ) );
+    }
+    pal4_to_32_scalar( out + 2*i, in + i, inbytes - i, pal );
+}
+
+TARGET_AVX2 static void pal4_to_16_avx2( uint16_t *out, const uint8_t *in, int inbytes, const uint32_t *pal )
+{
+    int i;
+    for( i=0; i+8 <= inbytes; i+=8 ) {
+        gather_16_avx2( out + 2*i, unpack_nibbles_lo_avx2( _mm_loadl_epi64( (const __m128i *)(in + i) ) ), pal );
+    }
+    pal4_to_16_scalar( out + 2*i, in + i, inbytes - i, pal );
+}
+
+/* The 4-bit detwiddle only has 8 bytes per cell, and VQ needs a 64-bit load
+ * per code either way, so those stay with the SSE2 versions. */
+static const struct texdecode_ops texdecode_avx2 = {
+        "avx2",
+        read_twiddled_4_sse2, read_twiddled_8_avx2, read_twiddled_16_avx2,
+        vq_decode_sse2,
+        pal8_to_32_avx2, pal8_to_16_avx2, pal4_to_32_avx2, pal4_to_16_avx2,
+        pal4_to_pal8_sse2 };
+
+#endif /* HAVE_TEXDECODE_X86 */
+
+/********************************* NEON ***********************************/
+
+#ifdef HAVE_TEXDECODE_NEON
+
+static void linearize_neon( uint8_t *dest, const uint8_t *bank0, const uint8_t *bank1,
+                            uint32_t groups )
+{
+    for( ; groups >= 4; groups -= 4 ) {
+        uint32x4x2_t z = vzipq_u32( vld1q_u32( (const uint32_t *)bank0 ),
+                                    vld1q_u32( (const uint32_t *)bank1 ) );
+        vst1q_u32( (uint32_t *)dest, z.val[0] );
+        vst1q_u32( (uint32_t *)(dest+16), z.val[1] );
+        dest += 32;
+        bank0 += 16;
+        bank1 += 16;
+    }
+    linearize_scalar( dest, bank0, bank1, groups );
+}
+
+static const uint8_t detwiddle_cell_8_shuf[16] = { 0, 2, 8, 10, 1, 3, 9, 11, 4, 6, 12, 14, 5, 7, 13, 15 };
+static const uint8_t unzip_16_shuf[16] = { 0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15 };
+
+static inline void store_rows_32_neon( uint8_t *dest, uint32_t stride, uint8x16_t rows )
+{
+    uint32x4_t r = vreinterpretq_u32_u8( rows );
+    vst1q_lane_u32( (uint32_t *)dest, r, 0 );
+    vst1q_lane_u32( (uint32_t *)(dest + stride), r, 1 );
+    vst1q_lane_u32( (uint32_t *)(dest + 2*stride), r, 2 );
+    vst1q_lane_u32( (uint32_t *)(dest + 3*stride), r, 3 );
+}
+
+static void detwiddle_4_neon( uint8_t *dest, uint32_t stride, const uint8_t *src, uint32_t size )
+{
+    const uint8x16_t shuf = vld1q_u8( detwiddle_cell_8_shuf );
+    uint32_t cells = (size*size) >> 4, c;
+    for( c=0; c<cells; c+=2 ) {
+        uint8_t *d = dest + (morton_even_bits(c)<<2)*stride + (morton_even_bits(c>>1)<<1);
+        uint8x16_t v = vld1q_u8( src + (c<<3) );
+        uint8x16x2_t z = vzipq_u8( vandq_u8( v, vdupq_n_u8(0x0F) ), vshrq_n_u8( v, 4 ) );
+        uint16x8_t a = vreinterpretq_u16_u8( vqtbl1q_u8( z.val[0], shuf ) );
+        uint16x8_t b = vreinterpretq_u16_u8( vqtbl1q_u8( z.val[1], shuf ) );
+        /* Each 16-bit lane holds two pixels: combine into one byte */
+        a = vorrq_u16( vandq_u16( a, vdupq_n_u16(0x000F) ), vandq_u16( vshrq_n_u16( a, 4 ), vdupq_n_u16(0x00F0) ) );
+        b = vorrq_u16( vandq_u16( b, vdupq_n_u16(0x000F) ), vandq_u16( vshrq_n_u16( b, 4 ), vdupq_n_u16(0x00F0) ) );
+        uint16x8_t rows = vreinterpretq_u16_u8( vcombine_u8( vmovn_u16( a ), vmovn_u16( b ) ) );
+        vst1q_lane_u16( (uint16_t *)d, rows, 0 );
+        vst1q_lane_u16( (uint16_t *)(d + stride), rows, 1 );
+        vst1q_lane_u16( (uint16_t *)(d + 2*stride), rows, 2 );
+        vst1q_lane_u16( (uint16_t *)(d + 3*stride), rows, 3 );
+        vst1q_lane_u16( (uint16_t *)(d + 4*stride), rows, 4 );
+        vst1q_lane_u16( (uint16_t *)(d + 5*stride), rows, 5 );
+        vst1q_lane_u16( (uint16_t *)(d + 6*stride), rows, 6 );
+        vst1q_lane_u16( (uint16_t *)(d + 7*stride), rows, 7 );
+    }
+}
+
+static void detwiddle_8_neon( uint8_t *dest, uint32_t stride, const uint8_t *src, uint32_t size )
+{
+    const uint8x16_t shuf = vld1q_u8( detwiddle_cell_8_shuf );
+    uint32_t cells = (size*size) >> 4, c;
+    for( c=0; c<cells; c++ ) {
+        uint8_t *d = dest + (morton_even_bits(c)<<2)*stride + (morton_even_bits(c>>1)<<2);
+        store_rows_32_neon( d, stride, vqtbl1q_u8( vld1q_u8( src + (c<<4) ), shuf ) );
+    }
+}
+
+static void detwiddle_16_neon( uint8_t *dest, uint32_t stride, const uint8_t *src, uint32_t size )
+{
+    const uint8x16_t shuf = vld1q_u8( unzip_16_shuf );
+    uint32_t cells = (size*size) >> 4, c;
+    for( c=0; c<cells; c++ ) {
+        uint8_t *d = dest + (morton_even_bits(c)<<2)*stride + (morton_even_bits(c>>1)<<3);
+        uint32x4_t a = vreinterpretq_u32_u8( vqtbl1q_u8( vld1q_u8( src + (c<<5) ), shuf ) );
+        uint32x4_t b = vreinterpretq_u32_u8( vqtbl1q_u8( vld1q_u8( src + (c<<5) + 16 ), shuf ) );
+        uint32x4x2_t z = vzipq_u32( a, b ); /* rows 0,2 and 1,3 */
+        vst1_u32( (uint32_t *)d, vget_low_u32( z.val[0] ) );
+        vst1_u32( (uint32_t *)(d + stride), vget_low_u32( z.val[1] ) );
+        vst1_u32( (uint32_t *)(d + 2*stride), vget_high_u32( z.val[0] ) );
+        vst1_u32( (uint32_t *)(d + 3*stride), vget_high_u32( z.val[1] ) );
+    }
+}
+
+static void read_twiddled_4_neon( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                                  uint32_t width, uint32_t height )
+{
+    if( width < MIN_SIMD_SIZE || height < MIN_SIMD_SIZE || (srcaddr & 0x03) != 0 ) {
+        read_twiddled_4_scalar( dest, vram, srcaddr, width, height );
+    } else {
+        read_twiddled_blocks( dest, vram, srcaddr, width, height, 4, linearize_neon, detwiddle_4_neon );
+    }
+}
+
+static void read_twiddled_8_neon( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                                  uint32_t width, uint32_t height )
+{
+    if( width < MIN_SIMD_SIZE || height < MIN_SIMD_SIZE ) {
+        read_twiddled_8_scalar( dest, vram, srcaddr, width, height );
+    } else {
+        read_twiddled_blocks( dest, vram, srcaddr, width, height, 8, linearize_neon, detwiddle_8_neon );
+    }
+}
+
+static void read_twiddled_16_neon( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                                   uint32_t width, uint32_t height )
+{
+    if( width < MIN_SIMD_SIZE || height < MIN_SIMD_SIZE ) {
+        read_twiddled_16_scalar( dest, vram, srcaddr, width, height );
+    } else {
+        read_twiddled_blocks( dest, vram, srcaddr, width, height, 16, linearize_neon, detwiddle_16_neon );
+    }
+}
+
+static void vq_decode_neon( uint16_t *output, const uint8_t *input, int width, int height,
+                            const struct vq_codebook *codebook )
+{
+    int i, j;
+    if( width < 8 ) {
+        vq_decode_scalar( output, input, width, height, codebook );
+        return;
+    }
+    for( j=0; j<height; j+=2 ) {
+        uint16_t *top = output + j*width;
+        uint16_t *bottom = top + width;
+        for( i=0; i<width; i+=8 ) {
+            uint32x4_t x = vreinterpretq_u32_u16( vcombine_u16( vld1_u16( codebook->quad[input[0]] ),
+                                                                vld1_u16( codebook->quad[input[1]] ) ) );
+            uint32x4_t y = vreinterpretq_u32_u16( vcombine_u16( vld1_u16( codebook->quad[input[2]] ),
+                                                                vld1_u16( codebook->quad[input[3]] ) ) );
+            uint32x4x2_t u = vuzpq_u32( x, y );
+            input += 4;
+            vst1q_u32( (uint32_t *)(top + i), u.val[0] );
+            vst1q_u32( (uint32_t *)(bottom + i), u.val[1] );
+        }
+    }
+}
+
+/* With only 16 palette entries, 4-bit lookups can be done as byte-table
+ * lookups on each byte of the entries, then interleaved back together. */
+static void pal4_to_32_neon( uint32_t *out, const uint8_t *in, int inbytes, const uint32_t *pal )
+{
+    uint8x16x4_t planes = vld4q_u8( (const uint8_t *)pal );
+    int i;
+    for( i=0; i+8 <= inbytes; i+=8 ) {
+        uint8x8_t v = vld1_u8( in + i );
+        uint8x8x2_t z = vzip_u8( vand_u8( v, vdup_n_u8(0x0F) ), vshr_n_u8( v, 4 ) );
+        uint8x16_t idx = vcombine_u8( z.val[0], z.val[1] );
+        uint8x16x4_t r;
+        r.val[0] = vqtbl1q_u8( planes.val[0], idx );
+        r.val[1] = vqtbl1q_u8( planes.val[1], idx );
+        r.val[2] = vqtbl1q_u8( planes.val[2], idx );
+        r.val[3] = vqtbl1q_u8( planes.val[3], idx );
+        vst4q_u8( (uint8_t *)(out + 2*i), r );
+    }
+    pal4_to_32_scalar( out + 2*i, in + i, inbytes - i, pal );
+}
+
+static void pal4_to_16_neon( uint16_t *out, const uint8_t *in, int inbytes, const uint32_t *pal )
+{
+    uint8x16x4_t planes = vld4q_u8( (const uint8_t *)pal );
+    int i;
+    for( i=0; i+8 <= inbytes; i+=8 ) {
+        uint8x8_t v = vld1_u8( in + i );
+        uint8x8x2_t z = vzip_u8( vand_u8( v, vdup_n_u8(0x0F) ), vshr_n_u8( v, 4 ) );
+        uint8x16_t idx = vcombine_u8( z.val[0], z.val[1] );
+        uint8x16x2_t r;
+        r.val[0] = vqtbl1q_u8( planes.val[0], idx );
+        r.val[1] = vqtbl1q_u8( planes.val[1], idx );
+        vst2q_u8( (uint8_t *)(out + 2*i), r );
+    }
+    pal4_to_16_scalar( out + 2*i, in + i, inbytes - i, pal );
+}
+
+static void pal4_to_pal8_neon( uint8_t *out, const uint8_t *in, int inbytes )
+{
+    int i;
+    for( i=0; i+16 <= inbytes; i+=16 ) {
+        uint8x16_t v = vld1q_u8( in + i );
+        uint8x16x2_t z = vzipq_u8( vandq_u8( v, vdupq_n_u8(0x0F) ), vshrq_n_u8( v, 4 ) );
+        vst1q_u8( out + 2*i, z.val[0] );
+        vst1q_u8( out + 2*i + 16, z.val[1] );
+    }
+    pal4_to_pal8_scalar( out + 2*i, in + i, inbytes - i );
+}
+
+/* No gather, and 256 entries are too many for table lookups, so the 8-bit
+ * palette lookups are the reference versions. */
+static const struct texdecode_ops texdecode_neon = {
+        "neon",
+        read_twiddled_4_neon, read_twiddled_8_neon, read_twiddled_16_neon,
+        vq_decode_neon,
+        pal8_to_32_scalar, pal8_to_16_scalar, pal4_to_32_neon, pal4_to_16_neon,
+        pal4_to_pal8_neon };
+
+#endif /* HAVE_TEXDECODE_NEON */
+
+/******************************* Dispatch *********************************/
+
+const struct texdecode_ops *texdecode_get_impl( const char *name )
+{
+    if( strcmp( name, texdecode_scalar.name ) == 0 ) {
+        return &texdecode_scalar;
+    }
+#ifdef HAVE_TEXDECODE_X86
+    __builtin_cpu_init();
+    if( strcmp( name, texdecode_sse2.name ) == 0 && __builtin_cpu_supports("sse2") ) {
+        return &texdecode_sse2;
+    }
+    if( strcmp( name, texdecode_avx2.name ) == 0 && __builtin_cpu_supports("avx2") ) {
+        return &texdecode_avx2;
+    }
+#endif
+#ifdef HAVE_TEXDECODE_NEON
+    if( strcmp( name, texdecode_neon.name ) == 0 ) {
+        return &texdecode_neon;
+    }
+#endif
+    return NULL;
+}
+
+const struct texdecode_ops *texdecode_init( void )
+{
+    static const char *preferred[] = { "avx2", "sse2", "neon", "scalar" };
+    const struct texdecode_ops *ops = NULL;
+    const char *env = getenv("LXDREAM_TEX_SIMD");
+    int i;
+
+    if( env != NULL ) {
+        ops = texdecode_get_impl( env );
+    }
+    for( i=0; ops == NULL; i++ ) {
+        ops = texdecode_get_impl( preferred[i] );
+    }
+    texdecode = ops;
+    return ops;
+}
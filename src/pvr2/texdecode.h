@@ -0,0 +1,96 @@
+/**
+ * $Id$
+ *
+ * Texture decoding kernels (detwiddling, VQ and palette expansion). Each
+ * kernel has a plain C reference version, plus SIMD versions for the host
+ * CPU where available; the implementation is chosen at runtime.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef lxdream_texdecode_H
+#define lxdream_texdecode_H 1
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct vq_codebook {
+    uint16_t quad[256][4];
+};
+
+/**
+ * A complete set of decoding kernels. All implementations produce
+ * bit-identical output.
+ */
+struct texdecode_ops {
+    const char *name;
+
+    /**
+     * Read an image stored as twiddled 4/8/16-bit pixels in the 64-bit
+     * interleaved view of vram, and write it out in detwiddled form.
+     * @param vram base of video ram (the 32-bit view)
+     * @param srcaddr source address in the 64-bit address space
+     * @param width image width (must be a power of 2)
+     * @param height image height (must be a power of 2)
+     */
+    void (*read_twiddled_4)( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                             uint32_t width, uint32_t height );
+    void (*read_twiddled_8)( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                             uint32_t width, uint32_t height );
+    void (*read_twiddled_16)( uint8_t *dest, const uint8_t *vram, uint32_t srcaddr,
+                              uint32_t width, uint32_t height );
+
+    /**
+     * Expand VQ codes (one per 2x2 quad, in raster order) into 16-bit pixels.
+     */
+    void (*vq_decode)( uint16_t *output, const uint8_t *input, int width, int height,
+                       const struct vq_codebook *codebook );
+
+    /**
+     * Look up 8-bit or 4-bit (two per byte, low nibble first) palette
+     * indexes. The 16-bit versions take the low half of each palette entry.
+     */
+    void (*pal8_to_32)( uint32_t *out, const uint8_t *in, int inbytes, const uint32_t *pal );
+    void (*pal8_to_16)( uint16_t *out, const uint8_t *in, int inbytes, const uint32_t *pal );
+    void (*pal4_to_32)( uint32_t *out, const uint8_t *in, int inbytes, const uint32_t *pal );
+    void (*pal4_to_16)( uint16_t *out, const uint8_t *in, int inbytes, const uint32_t *pal );
+    void (*pal4_to_pal8)( uint8_t *out, const uint8_t *in, int inbytes );
+};
+
+/**
+ * Kernels in use. Defaults to the reference versions until texdecode_init()
+ * is called.
+ */
+extern const struct texdecode_ops *texdecode;
+
+/**
+ * Select the fastest implementation supported by the host, or the one named
+ * by LXDREAM_TEX_SIMD (scalar, sse2, avx2 or neon) if it's available.
+ * @return the selected implementation
+ */
+const struct texdecode_ops *texdecode_init( void );
+
+/**
+ * @return the named implementation, or NULL if it isn't compiled in or isn't
+ * supported by the host CPU.
+ */
+const struct texdecode_ops *texdecode_get_impl( const char *name );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !lxdream_texdecode_H */
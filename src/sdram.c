@@ -19,9 +19,74 @@
 
 #include "lxdream.h"
 #include "mem.h"
+#include "mmio.h"
 #include "dreamcast.h"
 #include "xlat/xltcache.h"
 #include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#define SDRAM_SIZE (16 MB)
+#define SDRAM_PAGES (SDRAM_SIZE >> LXDREAM_PAGE_BITS)
+/* Main RAM is mirrored 4 times from 0x0C000000 */
+#define SDRAM_BASE 0x0C000000
+#define SDRAM_MIRRORS 4
+#define IS_SDRAM_ADDR(addr) (((addr)&0x1C000000) == SDRAM_BASE)
+
+/* The host window covers the full 32-bit SH4 address space. Main RAM appears
+ * at each of its mirrors in every 512MB area other than P4 (which is left
+ * unmapped, along with everything that isn't main RAM). While the MMU is
+ * translating addresses, U0 and P3 instead follow the UTLB (see
+ * sdram_window_map) */
+#if SIZEOF_VOID_P == 8 && defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define SDRAM_WINDOW_SUPPORTED 1
+#define SDRAM_WINDOW_SIZE (((size_t)1)<<32)
+#define SDRAM_WINDOW_AREAS 7
+#define SDRAM_WINDOW_AREA_SIZE (((size_t)1)<<29)
+#define SDRAM_WINDOW_PAGES (1<<(32-LXDREAM_PAGE_BITS))
+/* Areas which are translated by the MMU when it's on (U0 and P3) */
+#define IS_TRANSLATED_AREA(area) ((area) < 4 || (area) == 6)
+/* Maximum number of writable TLB mappings of a single RAM page - any more
+ * are mapped read-only */
+#define SDRAM_WINDOW_ALIASES 4
+#define SDRAM_NO_ALIAS 0xFFFFFFFF
+#define SDRAM_VPAGE_WRITABLE 0x8000
+#ifdef __APPLE__
+#include <sys/ucontext.h>
+#define CONTEXT_PC(ctx) (((ucontext_t *)(ctx))->uc_mcontext->__ss.__rip)
+#else
+#include <ucontext.h>
+#define CONTEXT_PC(ctx) (((ucontext_t *)(ctx))->uc_mcontext.gregs[REG_RIP])
+#endif
+#endif
+
+/* TRUE if pages holding translated code are write-protected, in which case
+ * writes don't need to check for code themselves */
+static gboolean sdram_code_protection = FALSE;
+static uint8_t sdram_code_page[SDRAM_PAGES];
+static struct sigaction sdram_old_segv_action;
+static gboolean sdram_fault_handler_installed = FALSE;
+static uint8_t *sdram_window = NULL;
+static sdram_window_fault_fn_t sdram_window_fault_fn = NULL;
+#ifdef SDRAM_WINDOW_SUPPORTED
+static int sdram_window_fd = -1;
+static gboolean sdram_window_translated = FALSE;
+/* For each window page in a translated area: 0 if unmapped, otherwise 
+ * the RAM page number + 1, and SDRAM_VPAGE_WRITABLE if it's in 
+ * sdram_window_alias */
+static uint16_t *sdram_window_vpage = NULL;
+/* Writable window pages mapping each RAM page, while translated */
+static uint32_t sdram_window_alias[SDRAM_PAGES][SDRAM_WINDOW_ALIASES];
+#endif
+static struct {
+    uint64_t faults;    /* Writes to protected pages */
+    uint64_t protects;  /* Pages protected */
+} sdram_code_stats;
 
 
 static int32_t FASTCALL ext_sdram_read_long( sh4addr_t addr )
@@ -39,17 +104,23 @@ static int32_t FASTCALL ext_sdram_read_byte( sh4addr_t addr )
 static void FASTCALL ext_sdram_write_long( sh4addr_t addr, uint32_t val )
 {
     *(uint32_t *)(dc_main_ram + (addr&0x00FFFFFF)) = val;
-    xlat_invalidate_long(addr);
+    if( !sdram_code_protection ) {
+        xlat_invalidate_long(addr);
+    }
 }
 static void FASTCALL ext_sdram_write_word( sh4addr_t addr, uint32_t val )
 {
     *(uint16_t *)(dc_main_ram + (addr&0x00FFFFFF)) = (uint16_t)val;
-    xlat_invalidate_word(addr);
+    if( !sdram_code_protection ) {
+        xlat_invalidate_word(addr);
+    }
 }
 static void FASTCALL ext_sdram_write_byte( sh4addr_t addr, uint32_t val )
 {
     *(uint8_t *)(dc_main_ram + (addr&0x00FFFFFF)) = (uint8_t)val;
-    xlat_invalidate_word(addr);
+    if( !sdram_code_protection ) {
+        xlat_invalidate_word(addr);
+    }
 }
 static void FASTCALL ext_sdram_read_burst( unsigned char *dest, sh4addr_t addr )
 {
@@ -64,3 +135,469 @@ struct mem_region_fn mem_region_sdram = { ext_sdram_read_long, ext_sdram_write_l
         ext_sdram_read_word, ext_sdram_write_word, 
         ext_sdram_read_byte, ext_sdram_write_byte, 
         ext_sdram_read_burst, ext_sdram_write_burst }; 
+
+#ifdef SDRAM_WINDOW_SUPPORTED
+/**
+ * Apply the given protection to (part of) main RAM at every one of its
+ * addresses in the host window
+ */
+static void sdram_window_protect( uint32_t offset, size_t size, int prot )
+{
+    int area, i;
+    uint32_t page;
+    if( sdram_window != NULL ) {
+        for( area=0; area<SDRAM_WINDOW_AREAS; area++ ) {
+            if( sdram_window_translated && IS_TRANSLATED_AREA(area) ) {
+                continue;
+            }
+            for( i=0; i<SDRAM_MIRRORS; i++ ) {
+                mprotect( sdram_window + (((size_t)area)<<29) + SDRAM_BASE + (i<<24) + offset, size, prot );
+            }
+        }
+        if( sdram_window_translated ) {
+            for( page = offset>>LXDREAM_PAGE_BITS; page < (offset+size)>>LXDREAM_PAGE_BITS; page++ ) {
+                for( i=0; i<SDRAM_WINDOW_ALIASES; i++ ) {
+                    if( sdram_window_alias[page][i] != SDRAM_NO_ALIAS ) {
+                        mprotect( sdram_window + (((size_t)sdram_window_alias[page][i])<<LXDREAM_PAGE_BITS),
+                                  LXDREAM_PAGE_SIZE, prot );
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Stores through the window are only allowed while code pages are
+ * write-protected, as nothing else would catch writes to translated code.
+ */
+static void sdram_window_protect_all( void )
+{
+    uint32_t page;
+    if( sdram_code_protection ) {
+        sdram_window_protect( 0, SDRAM_SIZE, PROT_READ|PROT_WRITE );
+        for( page=0; page<SDRAM_PAGES; page++ ) {
+            if( sdram_code_page[page] ) {
+                sdram_window_protect( page<<LXDREAM_PAGE_BITS, LXDREAM_PAGE_SIZE, PROT_READ );
+            }
+        }
+    } else {
+        sdram_window_protect( 0, SDRAM_SIZE, PROT_READ );
+    }
+}
+#else
+#define sdram_window_protect(offset,size,prot)
+#define sdram_window_protect_all()
+#endif
+
+static void sdram_protect_page( uint32_t page )
+{
+    if( !sdram_code_page[page] ) {
+        sdram_code_page[page] = 1;
+        sdram_code_stats.protects++;
+        mprotect( dc_main_ram + (page<<LXDREAM_PAGE_BITS), LXDREAM_PAGE_SIZE, PROT_READ );
+        sdram_window_protect( page<<LXDREAM_PAGE_BITS, LXDREAM_PAGE_SIZE, PROT_READ );
+    }
+}
+
+static void sdram_unprotect_page( uint32_t page )
+{
+    if( sdram_code_page[page] ) {
+        sdram_code_page[page] = 0;
+        mprotect( dc_main_ram + (page<<LXDREAM_PAGE_BITS), LXDREAM_PAGE_SIZE, PROT_READ|PROT_WRITE );
+        if( sdram_code_protection ) {
+            sdram_window_protect( page<<LXDREAM_PAGE_BITS, LXDREAM_PAGE_SIZE, PROT_READ|PROT_WRITE );
+        }
+    }
+}
+
+/**
+ * Discard every translation from the page (at each mirror address) and make
+ * it writable again. A page is never left writable while it still holds
+ * translations, as writes to it would then go unnoticed.
+ */
+static void sdram_flush_code_page( uint32_t page )
+{
+    sh4addr_t page_addr = SDRAM_BASE + (page<<LXDREAM_PAGE_BITS);
+    int i;
+    /* Unprotect first, so the invalidations below don't come back here */
+    sdram_unprotect_page( page );
+    for( i=0; i<SDRAM_MIRRORS; i++ ) {
+        xlat_invalidate_block( page_addr + (i<<24), LXDREAM_PAGE_SIZE );
+    }
+}
+
+static void sdram_watch_add_range( sh4addr_t start, sh4addr_t end )
+{
+    if( IS_SDRAM_ADDR(start) && end > start ) {
+        uint32_t page = (start&0x00FFFFFF)>>LXDREAM_PAGE_BITS;
+        uint32_t count = (((start&(LXDREAM_PAGE_SIZE-1)) + (end-start) + LXDREAM_PAGE_SIZE-1)>>LXDREAM_PAGE_BITS);
+        for( ; count != 0; page = (page+1)&(SDRAM_PAGES-1), count-- ) {
+            sdram_protect_page( page );
+        }
+    }
+}
+
+static void sdram_watch_invalidate_range( sh4addr_t start, size_t bytes )
+{
+    if( IS_SDRAM_ADDR(start) && bytes != 0 ) {
+        uint32_t page = (start&0x00FFFFFF)>>LXDREAM_PAGE_BITS;
+        uint32_t count = (((start&(LXDREAM_PAGE_SIZE-1)) + bytes + LXDREAM_PAGE_SIZE-1)>>LXDREAM_PAGE_BITS);
+        if( count > SDRAM_PAGES ) {
+            count = SDRAM_PAGES;
+        }
+        /* The range may only cover part of a page, and the cache only
+         * discards translations overlapping the range itself */
+        for( ; count != 0; page = (page+1)&(SDRAM_PAGES-1), count-- ) {
+            if( sdram_code_page[page] ) {
+                sdram_flush_code_page( page );
+            }
+        }
+    }
+}
+
+static void sdram_watch_flush( void )
+{
+    uint32_t page;
+    for( page = 0; page < SDRAM_PAGES; page++ ) {
+        sdram_unprotect_page( page );
+    }
+}
+
+static struct xlat_source_watch sdram_code_watch = {
+        sdram_watch_add_range, sdram_watch_invalidate_range, sdram_watch_flush };
+
+/**
+ * Return the main RAM offset of a fault address in the host window, or -1 if
+ * it isn't a main RAM address.
+ */
+static uintptr_t sdram_window_offset( void *fault_addr )
+{
+#ifdef SDRAM_WINDOW_SUPPORTED
+    uintptr_t addr = ((uintptr_t)fault_addr) - (uintptr_t)sdram_window;
+    if( sdram_window != NULL && addr < SDRAM_WINDOW_SIZE ) {
+        if( sdram_window_translated && IS_TRANSLATED_AREA(addr>>29) ) {
+            uint16_t vpage = sdram_window_vpage[addr>>LXDREAM_PAGE_BITS];
+            if( vpage != 0 ) {
+                return (((vpage & ~SDRAM_VPAGE_WRITABLE) - 1) << LXDREAM_PAGE_BITS) | 
+                    (addr & (LXDREAM_PAGE_SIZE-1));
+            }
+        } else if( IS_SDRAM_ADDR(addr) ) {
+            return addr & (SDRAM_SIZE-1);
+        }
+    }
+#endif
+    return (uintptr_t)-1;
+}
+
+/**
+ * SIGSEGV handler for writes to protected code pages: flush the translations
+ * from the page (at every mirror address) and let the write go through.
+ * Any other fault in the host window is given to the translator to redirect
+ * to its slow path. Anything else is passed on to the previous handler.
+ * Nothing on this path (including the translation cache and the target's
+ * unlink functions) may take a lock, as locks aren't async-signal-safe.
+ */
+static void sdram_code_fault( int signo, siginfo_t *info, void *context )
+{
+    uintptr_t offset = ((uintptr_t)info->si_addr) - (uintptr_t)dc_main_ram;
+    if( offset >= SDRAM_SIZE && sdram_code_protection ) {
+        offset = sdram_window_offset( info->si_addr );
+    }
+    if( offset < SDRAM_SIZE && sdram_code_page[offset>>LXDREAM_PAGE_BITS] ) {
+        sdram_code_stats.faults++;
+        sdram_flush_code_page( offset>>LXDREAM_PAGE_BITS );
+#ifdef SDRAM_WINDOW_SUPPORTED
+    } else if( sdram_window_fault_fn != NULL &&
+               ((uintptr_t)info->si_addr) - (uintptr_t)sdram_window < SDRAM_WINDOW_SIZE &&
+               sdram_window_fault_fn( (uintptr_t *)&CONTEXT_PC(context),
+                                      (uint32_t)(((uintptr_t)info->si_addr) - (uintptr_t)sdram_window) ) ) {
+        /* Translator has redirected the access */
+#endif
+    } else if( sdram_old_segv_action.sa_flags & SA_SIGINFO ) {
+        sdram_old_segv_action.sa_sigaction( signo, info, context );
+    } else if( sdram_old_segv_action.sa_handler != SIG_IGN &&
+               sdram_old_segv_action.sa_handler != SIG_DFL ) {
+        sdram_old_segv_action.sa_handler( signo );
+    } else {
+        /* Fall back to the default action when the access is retried */
+        signal( signo, SIG_DFL );
+    }
+}
+
+static gboolean sdram_check_page_size( const char *what )
+{
+    if( sysconf(_SC_PAGESIZE) != LXDREAM_PAGE_SIZE ||
+        (((uintptr_t)dc_main_ram) & (LXDREAM_PAGE_SIZE-1)) != 0 ) {
+        WARN( "%s is not supported with %ld-byte host pages", what,
+              sysconf(_SC_PAGESIZE) );
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void sdram_install_fault_handler( gboolean install )
+{
+    if( install && !sdram_fault_handler_installed ) {
+        struct sigaction sa;
+        sa.sa_sigaction = sdram_code_fault;
+        sigemptyset( &sa.sa_mask );
+        sa.sa_flags = SA_SIGINFO|SA_NODEFER;
+        sigaction( SIGSEGV, &sa, &sdram_old_segv_action );
+        sdram_fault_handler_installed = TRUE;
+    } else if( !install && sdram_fault_handler_installed ) {
+        sigaction( SIGSEGV, &sdram_old_segv_action, NULL );
+        sdram_fault_handler_installed = FALSE;
+    }
+}
+
+gboolean sdram_set_code_protection( gboolean enable )
+{
+    if( enable == sdram_code_protection ) {
+        return TRUE;
+    }
+    if( enable ) {
+        if( !sdram_check_page_size( "Code page protection" ) ) {
+            return FALSE;
+        }
+        sdram_install_fault_handler( TRUE );
+        /* Anything translated before now hasn't been protected */
+        xlat_flush_cache();
+        sdram_code_protection = TRUE;
+        xlat_set_source_watch( &sdram_code_watch );
+        sdram_window_protect_all();
+    } else {
+        xlat_set_source_watch( NULL );
+        sdram_code_protection = FALSE;
+        sdram_watch_flush();
+        /* Writes will check for code again from here on, so nothing stale
+         * can be left behind. Translated stores through the window will
+         * fault and fall back to the slow path */
+        sdram_window_protect_all();
+        sdram_install_fault_handler( sdram_window != NULL );
+    }
+    return TRUE;
+}
+
+gboolean sdram_get_code_protection( void )
+{
+    return sdram_code_protection;
+}
+
+void sdram_print_code_protection_stats( FILE *out )
+{
+    fprintf( out, "[JIT] code page protection: %lld pages protected, %lld write faults\n",
+             (long long int)sdram_code_stats.protects, (long long int)sdram_code_stats.faults );
+}
+
+void *sdram_init_window( sdram_window_fault_fn_t fault_fn )
+{
+#ifdef SDRAM_WINDOW_SUPPORTED
+    char name[64];
+    uint8_t *window;
+    int fd, area, i;
+
+    if( sdram_window != NULL ) {
+        sdram_window_fault_fn = fault_fn;
+        return sdram_window;
+    }
+    if( !sdram_check_page_size( "Host-mapped memory" ) ) {
+        return NULL;
+    }
+
+    /* Move main RAM into a shared memory object so that it can be mapped at
+     * more than one address, keeping the same host address for it */
+    snprintf( name, sizeof(name), "/lxdream-sdram-%d", (int)getpid() );
+    fd = shm_open( name, O_RDWR|O_CREAT|O_EXCL, 0600 );
+    if( fd == -1 ) {
+        WARN( "Unable to create shared memory for main RAM (%s)", strerror(errno) );
+        return NULL;
+    }
+    shm_unlink( name );
+    if( ftruncate( fd, SDRAM_SIZE ) != 0 ||
+        pwrite( fd, dc_main_ram, SDRAM_SIZE, 0 ) != SDRAM_SIZE ) {
+        WARN( "Unable to initialize shared memory for main RAM (%s)", strerror(errno) );
+        close(fd);
+        return NULL;
+    }
+
+    window = mmap( NULL, SDRAM_WINDOW_SIZE, PROT_NONE, MAP_PRIVATE|MAP_ANON|MAP_NORESERVE, -1, 0 );
+    if( window == MAP_FAILED ) {
+        WARN( "Unable to reserve host memory window (%s)", strerror(errno) );
+        close(fd);
+        return NULL;
+    }
+    for( area=0; area<SDRAM_WINDOW_AREAS; area++ ) {
+        for( i=0; i<SDRAM_MIRRORS; i++ ) {
+            if( mmap( window + (((size_t)area)<<29) + SDRAM_BASE + (i<<24), SDRAM_SIZE, PROT_READ,
+                      MAP_SHARED|MAP_FIXED, fd, 0 ) == MAP_FAILED ) {
+                WARN( "Unable to map main RAM into host memory window (%s)", strerror(errno) );
+                munmap( window, SDRAM_WINDOW_SIZE );
+                close(fd);
+                return NULL;
+            }
+        }
+    }
+    if( mmap( dc_main_ram, SDRAM_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, fd, 0 ) == MAP_FAILED ) {
+        FATAL( "Unable to remap main RAM (%s)", strerror(errno) );
+    }
+    /* Kept open for mapping pages for the TLB */
+    sdram_window_fd = fd;
+
+    sdram_window = window;
+    sdram_window_fault_fn = fault_fn;
+    /* Code pages protected before now need re-protecting in the new mapping */
+    for( i=0; i<SDRAM_PAGES; i++ ) {
+        if( sdram_code_page[i] ) {
+            mprotect( dc_main_ram + (i<<LXDREAM_PAGE_BITS), LXDREAM_PAGE_SIZE, PROT_READ );
+        }
+    }
+    sdram_window_protect_all();
+    sdram_install_fault_handler( TRUE );
+    return window;
+#else
+    return NULL;
+#endif
+}
+
+void *sdram_get_window( void )
+{
+    return sdram_window;
+}
+
+#ifdef SDRAM_WINDOW_SUPPORTED
+/**
+ * Replace part of the window with inaccessible memory
+ */
+static void sdram_window_clear( size_t offset, size_t size )
+{
+    if( mmap( sdram_window + offset, size, PROT_NONE, MAP_PRIVATE|MAP_ANON|MAP_NORESERVE|MAP_FIXED,
+              -1, 0 ) == MAP_FAILED ) {
+        FATAL( "Unable to unmap host memory window (%s)", strerror(errno) );
+    }
+}
+
+/**
+ * Drop the record of any TLB mappings in the given range of the window.
+ * @return TRUE if anything was mapped.
+ */
+static gboolean sdram_window_forget( sh4vma_t vma, uint32_t size )
+{
+    uint32_t vpage = vma >> LXDREAM_PAGE_BITS;
+    uint32_t end = vpage + (size >> LXDREAM_PAGE_BITS);
+    gboolean mapped = FALSE;
+    int i;
+
+    for( ; vpage != end; vpage++ ) {
+        uint16_t ent = sdram_window_vpage[vpage];
+        if( ent != 0 ) {
+            if( ent & SDRAM_VPAGE_WRITABLE ) {
+                uint32_t *alias = sdram_window_alias[(ent & ~SDRAM_VPAGE_WRITABLE) - 1];
+                for( i=0; i<SDRAM_WINDOW_ALIASES; i++ ) {
+                    if( alias[i] == vpage ) {
+                        alias[i] = SDRAM_NO_ALIAS;
+                        break;
+                    }
+                }
+            }
+            sdram_window_vpage[vpage] = 0;
+            mapped = TRUE;
+        }
+    }
+    return mapped;
+}
+
+static gboolean sdram_window_add_alias( uint32_t page, uint32_t vpage )
+{
+    int i;
+    for( i=0; i<SDRAM_WINDOW_ALIASES; i++ ) {
+        if( sdram_window_alias[page][i] == SDRAM_NO_ALIAS ) {
+            sdram_window_alias[page][i] = vpage;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+#endif
+
+void sdram_window_set_translated( gboolean translated )
+{
+#ifdef SDRAM_WINDOW_SUPPORTED
+    int area, i;
+
+    if( sdram_window == NULL || (!translated && !sdram_window_translated) ) {
+        return;
+    }
+    for( area=0; area<SDRAM_WINDOW_AREAS; area++ ) {
+        if( IS_TRANSLATED_AREA(area) ) {
+            sdram_window_clear( ((size_t)area)<<29, SDRAM_WINDOW_AREA_SIZE );
+        }
+    }
+    memset( sdram_window_alias, 0xFF, sizeof(sdram_window_alias) );
+    if( translated ) {
+        if( sdram_window_vpage == NULL ) {
+            sdram_window_vpage = calloc( SDRAM_WINDOW_PAGES, sizeof(uint16_t) );
+            assert( sdram_window_vpage != NULL );
+        } else {
+            memset( sdram_window_vpage, 0, SDRAM_WINDOW_PAGES * sizeof(uint16_t) );
+        }
+    } else {
+        for( area=0; area<SDRAM_WINDOW_AREAS; area++ ) {
+            if( IS_TRANSLATED_AREA(area) ) {
+                for( i=0; i<SDRAM_MIRRORS; i++ ) {
+                    if( mmap( sdram_window + (((size_t)area)<<29) + SDRAM_BASE + (i<<24), SDRAM_SIZE, PROT_READ,
+                              MAP_SHARED|MAP_FIXED, sdram_window_fd, 0 ) == MAP_FAILED ) {
+                        FATAL( "Unable to map main RAM into host memory window (%s)", strerror(errno) );
+                    }
+                }
+            }
+        }
+    }
+    sdram_window_translated = translated;
+    if( !translated ) {
+        sdram_window_protect_all();
+    }
+#endif
+}
+
+void sdram_window_map( sh4vma_t vma, sh4addr_t addr, uint32_t size, gboolean writable )
+{
+#ifdef SDRAM_WINDOW_SUPPORTED
+    uint32_t offset = addr & (SDRAM_SIZE-1);
+    uint32_t i, npages = size >> LXDREAM_PAGE_BITS;
+
+    if( !sdram_window_translated ) {
+        return;
+    }
+    if( !IS_SDRAM_ADDR(addr) ) {
+        sdram_window_unmap( vma, size );
+        return;
+    }
+    sdram_window_forget( vma, size );
+    if( mmap( sdram_window + vma, size, PROT_READ, MAP_SHARED|MAP_FIXED, 
+              sdram_window_fd, offset ) == MAP_FAILED ) {
+        FATAL( "Unable to map main RAM into host memory window (%s)", strerror(errno) );
+    }
+    for( i=0; i<npages; i++ ) {
+        uint32_t vpage = (vma >> LXDREAM_PAGE_BITS) + i;
+        uint32_t page = (offset >> LXDREAM_PAGE_BITS) + i;
+        sdram_window_vpage[vpage] = page + 1;
+        if( writable && sdram_window_add_alias( page, vpage ) ) {
+            sdram_window_vpage[vpage] |= SDRAM_VPAGE_WRITABLE;
+            if( sdram_code_protection && !sdram_code_page[page] ) {
+                mprotect( sdram_window + (((size_t)vpage)<<LXDREAM_PAGE_BITS), LXDREAM_PAGE_SIZE, 
+                          PROT_READ|PROT_WRITE );
+            }
+        }
+    }
+#endif
+}
+
+void sdram_window_unmap( sh4vma_t vma, uint32_t size )
+{
+#ifdef SDRAM_WINDOW_SUPPORTED
+    if( sdram_window_translated && sdram_window_forget( vma, size ) ) {
+        sdram_window_clear( vma, size );
+    }
+#endif
+}
@@ -50,6 +50,7 @@ static struct utlb_page_entry *mmu_utlb_pages;
 static uint32_t mmu_lrui;
 static uint32_t mmu_asid; // current asid
 static struct utlb_default_regions *mmu_user_storequeue_regions;
+static struct utlb_hash mmu_utlb_hash; /* Only maintained while the TLB is enabled */
 
 /* Structures for 1K page handling */
 static struct utlb_1k_entry *mmu_utlb_1k_pages;
@@ -71,6 +72,7 @@ static gboolean mmu_utlb_map_pages( mem_region_fn_t priv_page, mem_region_fn_t u
 static void mmu_utlb_remap_pages( gboolean remap_priv, gboolean remap_user, int entryNo );
 static gboolean mmu_utlb_unmap_pages( gboolean unmap_priv, gboolean unmap_user, sh4addr_t start_addr, int npages );
 static gboolean mmu_ext_page_remapped( sh4addr_t page, mem_region_fn_t fn, void *user_data );
+static void mmu_utlb_window_update( sh4addr_t start_addr, int npages );
 static void mmu_utlb_1k_init();
 static struct utlb_1k_entry *mmu_utlb_1k_alloc();
 static void mmu_utlb_1k_free( struct utlb_1k_entry *entry );
@@ -438,8 +440,12 @@ static void mmu_set_tlb_enabled( int tlb_on )
         /* Default SQ prefetch goes to TLB miss (?) */
         mmu_register_mem_region( 0xE0000000, 0xE4000000, &p4_region_storequeue_miss );
         mmu_register_user_mem_region( 0xE0000000, 0xE4000000, mmu_user_storequeue_regions->tlb_miss );
+        utlb_hash_init( &mmu_utlb_hash );
+        sdram_window_set_translated( TRUE );
         mmu_utlb_register_all();
     } else {
+        utlb_hash_init( &mmu_utlb_hash );
+        sdram_window_set_translated( FALSE );
         for( i=0, ptr = sh4_address_space; i<7; i++, ptr += LXDREAM_PAGE_TABLE_ENTRIES ) {
             memcpy( ptr, sh4_ext_address_space, sizeof(mem_region_fn_t) * LXDREAM_PAGE_TABLE_ENTRIES );
         }
@@ -639,6 +645,9 @@ static gboolean mmu_utlb_map_pages( mem_region_fn_t priv_page, mem_region_fn_t u
         }
     }
 
+    if( priv_page != NULL && (start_addr & 0xFC000000) != 0xE0000000 ) {
+        mmu_utlb_window_update( start_addr, npages );
+    }
     return mapping_ok;
 }
 
@@ -754,10 +763,49 @@ static gboolean mmu_utlb_unmap_pages( gboolean unmap_priv, gboolean unmap_user,
             }            
         }
     }
+
+    if( unmap_priv && (start_addr & 0xFC000000) != 0xE0000000 ) {
+        mmu_utlb_window_update( start_addr, npages );
+    }
     
     return unmapping_ok;
 }
 
+/**
+ * Bring the host memory window (if any) into line with the privileged page
+ * table over the given range, after pages have been mapped or unmapped. 
+ * Pages belonging to a single UTLB entry are mapped directly if they're
+ * main RAM, and writable if the entry is writable and dirty. Anything else
+ * (misses, multi-hits, 1K pages and other memory) is left out, so that 
+ * translated accesses fault and go the slow way.
+ */
+static void mmu_utlb_window_update( sh4addr_t start_addr, int npages )
+{
+    mem_region_fn_t *ptr;
+    int i, j;
+
+    if( sdram_get_window() == NULL ) {
+        return;
+    }
+    if( npages == 0 ) { /* 1K page - the whole 4K page is affected */
+        start_addr &= MASK_4K;
+        npages = 1;
+    }
+    ptr = &sh4_address_space[start_addr >> 12];
+    for( i=0; i<npages; i=j ) {
+        mem_region_fn_t fn = ptr[i];
+        sh4vma_t vma = start_addr + (i<<12);
+        for( j=i+1; j<npages && ptr[j] == fn; j++ );
+        if( fn >= &mmu_utlb_pages[0].fn && fn < &mmu_utlb_pages[UTLB_ENTRY_COUNT].fn ) {
+            struct utlb_entry *ent = &mmu_utlb[((struct utlb_page_entry *)fn) - &mmu_utlb_pages[0]];
+            sdram_window_map( vma, (ent->ppn & ent->mask) | (vma & ~ent->mask), (j-i)<<12,
+                              (ent->flags & (TLB_WRITABLE|TLB_DIRTY)) == (TLB_WRITABLE|TLB_DIRTY) );
+        } else {
+            sdram_window_unmap( vma, (j-i)<<12 );
+        }
+    }
+}
+
 static void mmu_utlb_insert_entry( int entry )
 {
     struct utlb_entry *ent = &mmu_utlb[entry];
@@ -766,6 +814,10 @@ static void mmu_utlb_insert_entry( int entry )
     sh4addr_t start_addr = ent->vpn & ent->mask;
     int npages = get_tlb_size_pages(ent->flags);
 
+    if( ent->flags & TLB_VALID ) {
+        utlb_hash_insert( &mmu_utlb_hash, mmu_utlb, entry );
+    }
+
     if( (start_addr & 0xFC000000) == 0xE0000000 ) {
         /* Store queue mappings are a bit different - normal access is fixed to
          * the store queue register block, and we only map prefetches through
@@ -825,6 +877,8 @@ static void mmu_utlb_remove_entry( int entry )
     gboolean unmap_user;
     int npages = get_tlb_size_pages(ent->flags);
     
+    utlb_hash_remove( &mmu_utlb_hash, entry );
+
     if( (ent->flags & TLB_SHARE) || ent->asid == mmu_asid ) {
         unmap_user = TRUE;
     } else if( IS_SV_ENABLED() ) {
@@ -897,6 +951,29 @@ int mmu_utlb_entry_for_vpn( uint32_t vpn )
 }
 
 
+/**
+ * Check whether a faulting access to addr through the host memory window
+ * could go through the window if retried, ie the page is currently a TLB
+ * miss or is mapped to main RAM by the UTLB. Otherwise the access is never
+ * going to be direct (at least not until the TLB changes).
+ */
+gboolean mmu_is_window_fault_transient( sh4vma_t addr )
+{
+    mem_region_fn_t fn;
+
+    if( !IS_TLB_ENABLED() || (addr >= 0x80000000 && addr < 0xC0000000) || addr >= 0xE0000000 ) {
+        return FALSE;
+    }
+    fn = sh4_address_space[addr>>12];
+    if( fn == &mem_region_tlb_miss ) {
+        return TRUE;
+    } else if( fn >= &mmu_utlb_pages[0].fn && fn < &mmu_utlb_pages[UTLB_ENTRY_COUNT].fn ) {
+        struct utlb_entry *ent = &mmu_utlb[((struct utlb_page_entry *)fn) - &mmu_utlb_pages[0]];
+        return (ent->ppn & 0x1C000000) == 0x0C000000;
+    }
+    return FALSE;
+}
+
 /**
  * Perform the actual utlb lookup w/ asid matching.
  * Possible utcomes are:
@@ -908,25 +985,12 @@ int mmu_utlb_entry_for_vpn( uint32_t vpn )
  */
 static inline int mmu_utlb_lookup_vpn_asid( uint32_t vpn )
 {
-    int result = -1;
-    unsigned int i;
-
     mmu_urc++;
     if( mmu_urc == mmu_urb || mmu_urc == 0x40 ) {
         mmu_urc = 0;
     }
 
-    for( i = 0; i < UTLB_ENTRY_COUNT; i++ ) {
-        if( (mmu_utlb[i].flags & TLB_VALID) &&
-                ((mmu_utlb[i].flags & TLB_SHARE) || mmu_asid == mmu_utlb[i].asid) &&
-                ((mmu_utlb[i].vpn ^ vpn) & mmu_utlb[i].mask) == 0 ) {
-            if( result != -1 ) {
-                return -2;
-            }
-            result = i;
-        }
-    }
-    return result;
+    return utlb_hash_lookup( &mmu_utlb_hash, mmu_utlb, vpn, mmu_asid, TRUE );
 }
 
 /**
@@ -940,25 +1004,12 @@ static inline int mmu_utlb_lookup_vpn_asid( uint32_t vpn )
  */
 static inline int mmu_utlb_lookup_vpn( uint32_t vpn )
 {
-    int result = -1;
-    unsigned int i;
-
     mmu_urc++;
     if( mmu_urc == mmu_urb || mmu_urc == 0x40 ) {
         mmu_urc = 0;
     }
 
-    for( i = 0; i < UTLB_ENTRY_COUNT; i++ ) {
-        if( (mmu_utlb[i].flags & TLB_VALID) &&
-                ((mmu_utlb[i].vpn ^ vpn) & mmu_utlb[i].mask) == 0 ) {
-            if( result != -1 ) {
-                return -2;
-            }
-            result = i;
-        }
-    }
-
-    return result;
+    return utlb_hash_lookup( &mmu_utlb_hash, mmu_utlb, vpn, 0, FALSE );
 }
 
 /**
@@ -100,6 +100,41 @@ struct utlb_1k_entry {
     unsigned char code[TLB_FUNC_SIZE*18];
 };
 
+/**
+ * Lookup index over the UTLB, so that a TLB miss doesn't have to compare
+ * against all 64 entries. Entries are chained from a hash of their page
+ * number, with a separate set of chains for each page-size class (1K and 4K
+ * entries share the 4K class), so a lookup probes at most one chain per
+ * class that currently has entries. The index is keyed on the VPN only
+ * (SV-mode lookups ignore the ASID), so ASID/SHARE matching is done while
+ * walking the chain.
+ */
+#define UTLB_HASH_BITS 7
+#define UTLB_HASH_SIZE (1<<UTLB_HASH_BITS)
+#define UTLB_HASH_CLASSES 3 /* 1K/4K, 64K, 1M */
+
+struct utlb_hash {
+    int8_t head[UTLB_HASH_CLASSES][UTLB_HASH_SIZE];
+    int8_t next[UTLB_ENTRY_COUNT];
+    uint16_t bucket[UTLB_ENTRY_COUNT];
+    uint8_t class_count[UTLB_HASH_CLASSES];
+    uint64_t entries;  /* Bitmask of entries present in the index */
+};
+
+void utlb_hash_init( struct utlb_hash *hash );
+void utlb_hash_insert( struct utlb_hash *hash, struct utlb_entry *utlb, int entry );
+void utlb_hash_remove( struct utlb_hash *hash, int entry );
+
+/**
+ * Find the valid UTLB entry matching vpn, with the same semantics as a
+ * linear scan of the UTLB.
+ * @param match_asid if TRUE, only entries that are shared or have the given
+ * asid will match.
+ * @return the entry number, -1 for no match, or -2 for a multi-hit.
+ */
+int utlb_hash_lookup( struct utlb_hash *hash, struct utlb_entry *utlb, 
+                      sh4vma_t vpn, uint32_t asid, gboolean match_asid );
+
 struct utlb_default_regions {
     mem_region_fn_t tlb_miss;
     mem_region_fn_t tlb_prot;
@@ -116,6 +151,7 @@ sh4addr_t FASTCALL mmu_vma_to_phys_disasm( sh4vma_t vma );
 mem_region_fn_t FASTCALL mmu_get_region_for_vma_read( sh4vma_t *addr );
 mem_region_fn_t FASTCALL mmu_get_region_for_vma_write( sh4vma_t *addr );
 mem_region_fn_t FASTCALL mmu_get_region_for_vma_prefetch( sh4vma_t *addr );
+gboolean mmu_is_window_fault_transient( sh4vma_t addr );
 
 /* Translator provided helpers */
 void mmu_utlb_init_vtable( struct utlb_entry *ent, struct utlb_page_entry *page, gboolean writable ); 
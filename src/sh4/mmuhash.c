@@ -0,0 +1,109 @@
+/**
+ * $Id$
+ *
+ * UTLB lookup index. Keeps the TLB miss path from having to do a linear
+ * scan of the full UTLB on every lookup.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <string.h>
+#include <assert.h>
+#include "mem.h"
+#include "sh4/mmu.h"
+
+#define UTLB_HASH(vpn,shift) ((((vpn)>>(shift)) * 0x9E3779B1) >> (32-UTLB_HASH_BITS))
+
+static const int utlb_hash_shift[UTLB_HASH_CLASSES] = { 12, 16, 20 };
+
+static inline int utlb_hash_class( struct utlb_entry *ent )
+{
+    switch( ent->flags & TLB_SIZE_MASK ) {
+    case TLB_SIZE_64K: return 1;
+    case TLB_SIZE_1M: return 2;
+    default: return 0;
+    }
+}
+
+void utlb_hash_init( struct utlb_hash *hash )
+{
+    memset( hash->head, 0xFF, sizeof(hash->head) );
+    memset( hash->next, 0xFF, sizeof(hash->next) );
+    memset( hash->class_count, 0, sizeof(hash->class_count) );
+    hash->entries = 0;
+}
+
+void utlb_hash_insert( struct utlb_hash *hash, struct utlb_entry *utlb, int entry )
+{
+    uint64_t bit = ((uint64_t)1) << entry;
+    struct utlb_entry *ent = &utlb[entry];
+    int cls = utlb_hash_class(ent);
+    unsigned int bucket = UTLB_HASH(ent->vpn, utlb_hash_shift[cls]);
+
+    if( hash->entries & bit ) {
+        return; /* Already present */
+    }
+    hash->entries |= bit;
+    hash->class_count[cls]++;
+    hash->bucket[entry] = (cls << UTLB_HASH_BITS) | bucket;
+    hash->next[entry] = hash->head[cls][bucket];
+    hash->head[cls][bucket] = entry;
+}
+
+void utlb_hash_remove( struct utlb_hash *hash, int entry )
+{
+    uint64_t bit = ((uint64_t)1) << entry;
+    int cls = hash->bucket[entry] >> UTLB_HASH_BITS;
+    int8_t *p;
+
+    if( (hash->entries & bit) == 0 ) {
+        return;
+    }
+    hash->entries &= ~bit;
+    hash->class_count[cls]--;
+    for( p = &hash->head[cls][hash->bucket[entry] & (UTLB_HASH_SIZE-1)]; *p != entry; p = &hash->next[*p] ) {
+        assert( *p != -1 );
+    }
+    *p = hash->next[entry];
+    hash->next[entry] = -1;
+}
+
+static inline gboolean utlb_hash_match( struct utlb_entry *ent, sh4vma_t vpn, 
+                                        uint32_t asid, gboolean match_asid )
+{
+    return (ent->flags & TLB_VALID) &&
+        (!match_asid || (ent->flags & TLB_SHARE) || asid == ent->asid) &&
+        ((ent->vpn ^ vpn) & ent->mask) == 0;
+}
+
+int utlb_hash_lookup( struct utlb_hash *hash, struct utlb_entry *utlb, 
+                      sh4vma_t vpn, uint32_t asid, gboolean match_asid )
+{
+    int result = -1;
+    int cls, i;
+
+    for( cls = 0; cls < UTLB_HASH_CLASSES; cls++ ) {
+        if( hash->class_count[cls] == 0 ) {
+            continue;
+        }
+        for( i = hash->head[cls][UTLB_HASH(vpn, utlb_hash_shift[cls])]; i != -1; i = hash->next[i] ) {
+            if( utlb_hash_match( &utlb[i], vpn, asid, match_asid ) ) {
+                if( result != -1 ) {
+                    return -2;
+                }
+                result = i;
+            }
+        }
+    }
+    return result;
+}
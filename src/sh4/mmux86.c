@@ -49,6 +49,7 @@ void mmu_utlb_init_vtable( struct utlb_entry *ent, struct utlb_page_entry *page,
     int inc = writable ? 1 : 2; 
     int i;
     
+    sh4_translate_lock();
     xlat_output = page->code;
     if( (ppn & 0x1FFFFFFF) >= 0x1C000000 ) {
         /* SH4 control region */
@@ -76,6 +77,7 @@ void mmu_utlb_init_vtable( struct utlb_entry *ent, struct utlb_page_entry *page,
             JMP_r32disp(REG_CALLPTR, (((uintptr_t)out) - ((uintptr_t)&page->fn)) );    // 3
         }
     }
+    sh4_translate_unlock();
     
     page->fn.prefetch = unmapped_prefetch; // FIXME
 }
@@ -86,6 +88,7 @@ void mmu_utlb_init_storequeue_vtable( struct utlb_entry *ent, struct utlb_page_e
     uint32_t vpn = ent->vpn & mask;
     uint32_t ppn = ent->ppn & mask;
 
+    sh4_translate_lock();
     xlat_output = page->code;
 
     memcpy( page, &p4_region_storequeue, sizeof(struct mem_region_fn) );
@@ -95,10 +98,12 @@ void mmu_utlb_init_storequeue_vtable( struct utlb_entry *ent, struct utlb_page_e
     ADDL_imms_r32( ppn-vpn, REG_ARG1 );
     int rel = ((uint8_t *)ccn_storequeue_prefetch_tlb) - xlat_output;
     JMP_prerel( rel );
+    sh4_translate_unlock();
 }
 
 void mmu_utlb_1k_init_vtable( struct utlb_1k_entry *entry )
 {
+    sh4_translate_lock();
     xlat_output = entry->code;
     int i;
     uint8_t **out = (uint8_t **)&entry->fn;
@@ -121,5 +126,5 @@ void mmu_utlb_1k_init_vtable( struct utlb_1k_entry *entry )
         XLAT( (uintptr_t)&entry->user_subpages[0], REG_CALLPTR );
         JMP_r32disp(REG_CALLPTR, (((uintptr_t)out) - ((uintptr_t)&entry->user_fn)) );    // 3
     }
-
+    sh4_translate_unlock();
 }
@@ -0,0 +1,273 @@
+/**
+ * $Id$
+ *
+ * Sampling profiler for guest (SH4) code.
+ *
+ * Samples are taken from an eventq timer, so they're only ever taken between
+ * instructions (or between blocks under the translator), at which point
+ * sh4r.pc is exact in either core and no native-to-SH4 PC recovery is needed.
+ *
+ * SH4 code doesn't keep a frame chain, so the call stack is reconstructed
+ * heuristically: PR is taken as the caller if it's a return address into a
+ * different function, followed by any return addresses into further functions
+ * found in the first few words of the stack. A word is accepted as a return
+ * address if the instruction two slots before it (ie before the delay slot)
+ * is a BSR, BSRF or JSR. This will occasionally pick up a stale return
+ * address, but is cheap and needs no cooperation from the cores.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+
+#include "lxdream.h"
+#include "mem.h"
+#include "eventq.h"
+#include "sh4/sh4.h"
+#include "sh4/sh4core.h"
+#include "sh4/sh4dasm.h"
+#include "sh4/mmu.h"
+#include "sh4/sampler.h"
+
+/** Number of words above the stack pointer searched for return addresses */
+#define SAMPLER_STACK_SCAN_WORDS 64
+#define SAMPLER_MAX_FRAME_NAME 128
+
+static gchar *sampler_filename = NULL;
+static uint32_t sampler_period = 0;
+static unsigned int sampler_depth = SH4_SAMPLER_DEFAULT_DEPTH;
+static GHashTable *sampler_stacks = NULL;
+static uint64_t sampler_count = 0;
+
+static void sampler_event_callback( int eventid )
+{
+    sh4_sampler_sample();
+    event_schedule( EVENT_SH4_SAMPLE, sampler_period );
+}
+
+void sh4_sampler_init( const char *filename, uint32_t hz, unsigned int depth )
+{
+    if( hz == 0 ) {
+        hz = SH4_SAMPLER_DEFAULT_HZ;
+    }
+    if( depth == 0 ) {
+        depth = SH4_SAMPLER_DEFAULT_DEPTH;
+    } else if( depth > SH4_SAMPLER_MAX_DEPTH ) {
+        depth = SH4_SAMPLER_MAX_DEPTH;
+    }
+    g_free( sampler_filename );
+    sampler_filename = g_strdup(filename);
+    sampler_period = 1000000000 / hz;
+    if( sampler_period == 0 ) {
+        sampler_period = 1;
+    }
+    sampler_depth = depth;
+    if( sampler_stacks == NULL ) {
+        sampler_stacks = g_hash_table_new_full( g_str_hash, g_str_equal, g_free, NULL );
+    }
+    register_event_callback( EVENT_SH4_SAMPLE, sampler_event_callback );
+    INFO( "Sampling SH4 at %dHz, writing profile to %s", hz, filename );
+}
+
+gboolean sh4_sampler_is_enabled( void )
+{
+    return sampler_filename != NULL;
+}
+
+void sh4_sampler_start( void )
+{
+    if( sampler_filename != NULL ) {
+        event_schedule( EVENT_SH4_SAMPLE, sampler_period );
+    } else {
+        /* May have been scheduled by a state saved while sampling */
+        event_cancel( EVENT_SH4_SAMPLE );
+    }
+}
+
+/**
+ * Read a word of guest memory without side effects, ie only from RAM/ROM.
+ * @return FALSE if the address isn't backed by memory.
+ */
+static gboolean sampler_read( sh4vma_t vma, void *value, size_t size )
+{
+    if( vma & (size-1) ) {
+        return FALSE;
+    }
+    sh4addr_t addr = mmu_vma_to_phys_disasm( vma );
+    if( addr == MMU_VMA_ERROR ) {
+        return FALSE;
+    }
+    sh4ptr_t region = mem_get_region( addr );
+    if( region == NULL ) {
+        return FALSE;
+    }
+    memcpy( value, region, size );
+    return TRUE;
+}
+
+/**
+ * @return TRUE if addr looks like a return address, ie follows a call and its
+ * delay slot.
+ */
+static gboolean sampler_is_return_address( sh4vma_t addr )
+{
+    uint16_t ir;
+    if( !sampler_read( addr - 4, &ir, sizeof(ir) ) ) {
+        return FALSE;
+    }
+    return (ir & 0xF000) == 0xB000 || /* BSR disp */
+           (ir & 0xF0FF) == 0x0003 || /* BSRF Rn */
+           (ir & 0xF0FF) == 0x400B;   /* JSR @Rn */
+}
+
+static const char *sampler_symbol( sh4vma_t addr )
+{
+    uint32_t offset;
+    return sh4_disasm_find_symbol( addr, &offset );
+}
+
+/**
+ * @return TRUE if the two addresses are in the same function (or are the same
+ * address, when they aren't covered by a symbol).
+ */
+static gboolean sampler_same_function( sh4vma_t a, const char *a_sym, sh4vma_t b, const char *b_sym )
+{
+    if( a_sym != NULL || b_sym != NULL ) {
+        return a_sym == b_sym;
+    }
+    return a == b;
+}
+
+/**
+ * @return TRUE if the function containing addr is already in the stack. Such
+ * an address is far more likely to be a stale return address left on the
+ * stack than genuine recursion, so it's dropped.
+ */
+static gboolean sampler_in_stack( sh4vma_t addr, const char *sym, sh4vma_t *frames,
+                                  const char **syms, unsigned int count )
+{
+    unsigned int i;
+    for( i=0; i<count; i++ ) {
+        if( sampler_same_function( addr, sym, frames[i], syms[i] ) ) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static void sampler_append_frame( GString *stack, sh4vma_t addr, const char *sym )
+{
+    if( stack->len != 0 ) {
+        g_string_append_c( stack, ';' );
+    }
+    if( sym != NULL ) {
+        g_string_append( stack, sym );
+    } else {
+        g_string_append_printf( stack, "%08x", addr );
+    }
+}
+
+void sh4_sampler_sample( void )
+{
+    sh4vma_t frames[SH4_SAMPLER_MAX_DEPTH];
+    const char *syms[SH4_SAMPLER_MAX_DEPTH];
+    unsigned int count = 0, i;
+
+    frames[0] = sh4r.pc;
+    syms[0] = sampler_symbol( sh4r.pc );
+    count = 1;
+
+    if( count < sampler_depth && sampler_is_return_address(sh4r.pr) ) {
+        const char *sym = sampler_symbol( sh4r.pr );
+        if( !sampler_in_stack( sh4r.pr, sym, frames, syms, count ) ) {
+            frames[count] = sh4r.pr;
+            syms[count++] = sym;
+        }
+    }
+
+    sh4vma_t sp = sh4r.r[15];
+    for( i=0; i<SAMPLER_STACK_SCAN_WORDS && count < sampler_depth; i++ ) {
+        uint32_t value;
+        if( !sampler_read( sp + (i<<2), &value, sizeof(value) ) ) {
+            break;
+        }
+        if( sampler_is_return_address(value) ) {
+            const char *sym = sampler_symbol( value );
+            if( !sampler_in_stack( value, sym, frames, syms, count ) ) {
+                frames[count] = value;
+                syms[count++] = sym;
+            }
+        }
+    }
+
+    /* Collapsed stacks are outermost-first */
+    GString *stack = g_string_sized_new( SAMPLER_MAX_FRAME_NAME );
+    for( i=count; i-- > 0; ) {
+        sampler_append_frame( stack, frames[i], syms[i] );
+    }
+    if( sh4r.sh4_state != SH4_STATE_RUNNING ) {
+        g_string_append( stack, ";[sleep]" );
+    }
+
+    /* If the stack is already present, the table keeps the existing key and
+     * frees the new one */
+    guint old = GPOINTER_TO_UINT( g_hash_table_lookup( sampler_stacks, stack->str ) );
+    g_hash_table_insert( sampler_stacks, g_string_free( stack, FALSE ), GUINT_TO_POINTER(old+1) );
+    sampler_count++;
+}
+
+static void sampler_collect_key( gpointer key, gpointer value, gpointer user_data )
+{
+    const char ***next = (const char ***)user_data;
+    *(*next)++ = key;
+}
+
+static int sampler_compare_keys( const void *a, const void *b )
+{
+    return strcmp( *(const char **)a, *(const char **)b );
+}
+
+void sh4_sampler_write( FILE *out )
+{
+    if( sampler_stacks == NULL ) {
+        return;
+    }
+    /* Sort the stacks so that the output is stable between runs */
+    guint size = g_hash_table_size( sampler_stacks ), i;
+    const char **keys = g_new( const char *, size+1 );
+    const char **next = keys;
+    g_hash_table_foreach( sampler_stacks, sampler_collect_key, &next );
+    qsort( keys, size, sizeof(const char *), sampler_compare_keys );
+    for( i=0; i<size; i++ ) {
+        fprintf( out, "%s %u\n", keys[i], GPOINTER_TO_UINT(g_hash_table_lookup(sampler_stacks, keys[i])) );
+    }
+    g_free( keys );
+}
+
+void sh4_sampler_save( void )
+{
+    if( sampler_filename == NULL ) {
+        return;
+    }
+    FILE *f = fopen( sampler_filename, "w" );
+    if( f == NULL ) {
+        WARN( "Unable to write SH4 profile to %s: %s", sampler_filename, strerror(errno) );
+    } else {
+        sh4_sampler_write( f );
+        fclose( f );
+        INFO( "Wrote %" G_GUINT64_FORMAT " SH4 samples to %s", sampler_count, sampler_filename );
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ * $Id$
+ *
+ * Sampling profiler for guest (SH4) code. At a fixed rate of emulated time,
+ * the current PC and a shallow call stack are recorded, and the totals are
+ * written out in the "collapsed stack" format used by flame graph tools:
+ *
+ *     outer;caller;leaf <count>
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef lxdream_sampler_H
+#define lxdream_sampler_H 1
+
+#include <stdio.h>
+#include "lxdream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SH4_SAMPLER_DEFAULT_HZ 1000
+#define SH4_SAMPLER_DEFAULT_DEPTH 8
+#define SH4_SAMPLER_MAX_DEPTH 32
+
+/**
+ * Enable the sampler. Samples are taken while the SH4 is running, and the
+ * profile is (re)written to the given file each time it stops.
+ * @param filename output file for the collapsed stacks
+ * @param hz samples per second of emulated time (0 for the default)
+ * @param depth maximum number of frames recorded per sample, including the
+ * current function (0 for the default).
+ */
+void sh4_sampler_init( const char *filename, uint32_t hz, unsigned int depth );
+
+/**
+ * @return TRUE if the sampler has been enabled.
+ */
+gboolean sh4_sampler_is_enabled( void );
+
+/**
+ * Schedule the next sample if the sampler is enabled, or cancel any sample
+ * event restored from a saved state if not. Called when the SH4 starts
+ * running, as a reset or state load may have changed the event queue.
+ */
+void sh4_sampler_start( void );
+
+/**
+ * Record a sample of the current SH4 state.
+ */
+void sh4_sampler_sample( void );
+
+/**
+ * Write the collapsed stacks for all samples so far to the given stream.
+ */
+void sh4_sampler_write( FILE *out );
+
+/**
+ * Write the profile to the file given to sh4_sampler_init, if enabled.
+ */
+void sh4_sampler_save( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !lxdream_sampler_H */
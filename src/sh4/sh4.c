@@ -19,6 +19,8 @@
 
 #define MODULE sh4_module
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include <setjmp.h>
 #include <assert.h>
 #include "lxdream.h"
@@ -32,14 +34,13 @@
 #include "sh4/mmu.h"
 #include "sh4/sh4core.h"
 #include "sh4/sh4dasm.h"
+#include "sh4/sh4ir.h"
 #include "sh4/sh4mmio.h"
 #include "sh4/sh4stat.h"
 #include "sh4/sh4trans.h"
+#include "sh4/sampler.h"
 #include "xlat/xltcache.h"
-
-#ifndef M_PI
-#define M_PI        3.14159265358979323846264338327950288
-#endif
+#include "xlat/xltperf.h"
 
 void sh4_init( void );
 void sh4_poweron_reset( void );
@@ -168,13 +169,65 @@ void sh4_set_core( sh4core_t core )
     if( core != SH4_INTERPRET ) {
         sh4_translate_init();
         sh4_use_translator = TRUE;
+        const char *reg_cache = getenv("LXDREAM_JIT_REGCACHE");
+        if( reg_cache != NULL && strcmp(reg_cache, "0") == 0 ) {
+            sh4_translate_set_reg_cache( FALSE );
+        }
+        const char *ir = getenv("LXDREAM_JIT_IR");
+        if( ir != NULL && strcmp(ir, "0") == 0 ) {
+            sh4_translate_set_ir( FALSE );
+        }
+        const char *idle_skip = getenv("LXDREAM_JIT_IDLE_SKIP");
+        if( idle_skip != NULL && strcmp(idle_skip, "0") == 0 ) {
+            sh4_translate_set_idle_skip( FALSE );
+        }
+        const char *perf_map = getenv("LXDREAM_JIT_PERF_MAP");
+        gboolean want_perf_map = perf_map != NULL && *perf_map != '\0' && strcmp(perf_map, "0") != 0;
+        const char *jitdump_dir = getenv("LXDREAM_JIT_JITDUMP");
+        if( jitdump_dir != NULL && *jitdump_dir == '\0' ) {
+            jitdump_dir = NULL;
+        }
+        if( want_perf_map || jitdump_dir != NULL ) {
+            sh4_translate_init_perf( want_perf_map, jitdump_dir );
+        }
         if( core == SH4_SHADOW ) {
             sh4_shadow_init();
+        } else {
+            const char *window = getenv("LXDREAM_JIT_FASTMEM");
+            if( window == NULL || strcmp(window, "0") != 0 ) {
+                sh4_translate_set_mem_window( TRUE );
+            }
+            const char *cache_file = getenv("LXDREAM_JIT_CACHE");
+            if( cache_file != NULL && *cache_file != '\0' ) {
+                sh4_translate_init_persistent_cache( cache_file );
+            }
+            const char *traces = getenv("LXDREAM_JIT_TRACES");
+            if( traces != NULL && *traces != '\0' && strcmp(traces, "0") != 0 ) {
+                sh4_translate_set_traces( TRUE );
+            }
+            const char *tier = getenv("LXDREAM_JIT_TIER_THRESHOLD");
+            if( tier != NULL && *tier != '\0' ) {
+                sh4_translate_set_tier_threshold( strtoul(tier, NULL, 10) );
+            }
+            const char *protect = getenv("LXDREAM_JIT_PROTECT");
+            if( protect != NULL && *protect != '\0' && strcmp(protect, "0") != 0 ) {
+                sdram_set_code_protection( TRUE );
+            }
+            const char *async = getenv("LXDREAM_JIT_ASYNC");
+            if( async != NULL && *async != '\0' && strcmp(async, "0") != 0 ) {
+                sh4_translate_set_async( TRUE );
+            }
         }
     } else {
         sh4_use_translator = FALSE;
     }
 #endif
+    if( !sh4_use_translator ) {
+        const char *threaded = getenv("LXDREAM_INTERP_THREADED");
+        sh4_set_threaded_interpreter( threaded == NULL || strcmp(threaded, "0") != 0 );
+    } else {
+        sh4_set_threaded_interpreter( FALSE );
+    }
 }
 
 gboolean sh4_translate_is_enabled()
@@ -209,6 +262,7 @@ void sh4_init(void)
 void sh4_start(void)
 {
     sh4_starting = TRUE;
+    sh4_sampler_start();
 }
 
 void sh4_poweron_reset(void)
@@ -252,9 +306,32 @@ void sh4_stop(void)
 #ifdef SH4_TRANSLATOR
         if( sh4_profile_blocks ) {
             sh4_translate_dump_cache_by_activity(30);
+            xlat_print_cache_stats( stderr );
+            sh4_ir_print_stats( stderr );
+            sh4_translate_print_idle_stats( stderr );
+            sh4_translate_print_mem_window_stats( stderr );
+            if( sh4_translate_get_tier_threshold() != 0 ) {
+                sh4_translate_print_tier_stats( stderr );
+            }
+            if( sh4_translate_get_async() ) {
+                sh4_translate_print_async_stats( stderr );
+            }
         }
+        if( sdram_get_code_protection() ) {
+            sdram_print_code_protection_stats( stderr );
+        }
+        sh4_translate_save_persistent_cache();
+        xlat_perf_flush();
 #endif
     }
+    sh4_sampler_save();
+}
+
+void sh4_shutdown( void )
+{
+#ifdef SH4_TRANSLATOR
+    sh4_translate_shutdown();
+#endif
 }
 
 /**
@@ -361,6 +438,7 @@ int sh4_load_state( FILE * f )
     if(	sh4_use_translator ) {
         xlat_flush_cache();
     }
+    sh4_predecode_flush();
     fread( &sh4r, offsetof(struct sh4_registers, xlat_sh4_mode), 1, f );
     sh4r.xlat_sh4_mode = (sh4r.sr & SR_MD) | (sh4r.fpscr & (FPSCR_SZ|FPSCR_PR));
     MMU_load_state( f );
@@ -607,13 +685,6 @@ void FASTCALL signsat48( void )
         sh4r.mac = 0x00007FFFFFFFFFFFLL;
 }
 
-void FASTCALL sh4_fsca( uint32_t anglei, float *fr )
-{
-    float angle = (((float)(anglei&0xFFFF))/65536.0) * 2 * M_PI;
-    *fr++ = cosf(angle);
-    *fr = sinf(angle);
-}
-
 /**
  * Enter sleep mode (eg by executing a SLEEP instruction).
  * Sets sh4_state appropriately and ensures any stopping peripheral modules
@@ -682,23 +753,6 @@ uint32_t sh4_sleep_run_slice( uint32_t nanosecs )
 }
 
 
-/**
- * Compute the matrix tranform of fv given the matrix xf.
- * Both fv and xf are word-swapped as per the sh4r.fr banks
- */
-void FASTCALL sh4_ftrv( float *target )
-{
-    float fv[4] = { target[1], target[0], target[3], target[2] };
-    target[1] = sh4r.fr[1][1] * fv[0] + sh4r.fr[1][5]*fv[1] +
-    sh4r.fr[1][9]*fv[2] + sh4r.fr[1][13]*fv[3];
-    target[0] = sh4r.fr[1][0] * fv[0] + sh4r.fr[1][4]*fv[1] +
-    sh4r.fr[1][8]*fv[2] + sh4r.fr[1][12]*fv[3];
-    target[3] = sh4r.fr[1][3] * fv[0] + sh4r.fr[1][7]*fv[1] +
-    sh4r.fr[1][11]*fv[2] + sh4r.fr[1][15]*fv[3];
-    target[2] = sh4r.fr[1][2] * fv[0] + sh4r.fr[1][6]*fv[1] +
-    sh4r.fr[1][10]*fv[2] + sh4r.fr[1][14]*fv[3];
-}
-
 gboolean sh4_has_page( sh4vma_t vma )
 {
     sh4addr_t addr = mmu_vma_to_phys_disasm(vma);
@@ -145,6 +145,11 @@ void sh4_set_breakpoint( uint32_t pc, breakpoint_type_t type );
 gboolean sh4_clear_breakpoint( uint32_t pc, breakpoint_type_t type );
 int sh4_get_breakpoint( uint32_t pc );
 
+/**
+ * Release any resources held by the SH4 core, on exit
+ */
+void sh4_shutdown( void );
+
 /** Dump current SH4 core state (for crashdump purposes) */
 void sh4_crashdump();
 
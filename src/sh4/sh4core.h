@@ -178,12 +178,29 @@ uint32_t PMM_run_slice( uint32_t );
 uint32_t sh4_translate_run_slice(uint32_t);
 uint32_t sh4_emulate_run_slice(uint32_t);
 
+/**
+ * Select the threaded-code interpreter for sh4_emulate_run_slice, which runs
+ * from pre-decoded copies of the code pages (except when breakpoints are set).
+ * Otherwise every instruction is fully decoded each time it's executed.
+ */
+void sh4_set_threaded_interpreter( gboolean enable );
+gboolean sh4_is_threaded_interpreter( void );
+
+/**
+ * Discard all pre-decoded code, eg after memory has been replaced wholesale.
+ */
+void sh4_predecode_flush( void );
+
 /* SH4 instruction support methods */
 mem_region_fn_t FASTCALL sh7750_decode_address( sh4addr_t address );
 void FASTCALL sh7750_decode_address_copy( sh4addr_t address, mem_region_fn_t result );
 void FASTCALL sh4_sleep( void );
 void FASTCALL sh4_fsca( uint32_t angle, float *fr );
 void FASTCALL sh4_ftrv( float *fv );
+/* FSCA results indexed by the low 16 bits of FPUL, as (cos,sin) pairs in
+ * the same order as sh4r.fr. Filled in by sh4_fsca_init_table */
+extern float sh4_fsca_table[65536][2];
+void sh4_fsca_init_table( void );
 uint32_t FASTCALL sh4_read_sr(void);
 void FASTCALL sh4_write_sr(uint32_t val);
 void FASTCALL sh4_write_fpscr(uint32_t val);
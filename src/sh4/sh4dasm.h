@@ -31,6 +31,13 @@ uint32_t sh4_disasm_instruction( uint32_t pc, char *buf, int len, char * );
 void sh4_disasm_region( FILE *f, int from, int to );
 const char *sh4_disasm_get_symbol( sh4addr_t addr );
 
+/**
+ * Find the symbol whose extent contains the given address.
+ * @param offset receives the offset of addr from the start of the symbol
+ * @return the symbol name, or NULL if no symbol contains addr.
+ */
+const char *sh4_disasm_find_symbol( sh4addr_t addr, uint32_t *offset );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,71 @@
+/**
+ * $Id$
+ * 
+ * SH4 opcode decode table, generated by gendec from sh4.def (sh4decode.in)
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef lxdream_sh4decode_H
+#define lxdream_sh4decode_H 1
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SH4_DECODE_MAX_OPERANDS 4
+
+/**
+ * Operand descriptor: the operand value is
+ *   ((ir >> bit_shift) & ((1<<bit_count)-1)) << left_shift
+ * sign-extended from bit_count bits first if is_signed.
+ */
+struct sh4_decode_operand {
+    const char *name;
+    int bit_shift;
+    int bit_count;
+    int left_shift;
+    int is_signed;
+};
+
+struct sh4_decode_rule {
+    const char *format;
+    int operand_count;
+    struct sh4_decode_operand operands[SH4_DECODE_MAX_OPERANDS];
+};
+
+/**
+ * Index into sh4_decode_rules for every opcode, in sh4.def order. Undefined
+ * opcodes map to the last entry (SH4_DECODE_UNDEF).
+ */
+extern const uint16_t sh4_decode_table[65536];
+extern const struct sh4_decode_rule sh4_decode_rules[];
+extern const unsigned int sh4_decode_rule_count;
+#define SH4_DECODE_UNDEF sh4_decode_rule_count
+
+static inline int32_t sh4_decode_operand( const struct sh4_decode_operand *op, uint16_t ir )
+{
+    int32_t val = (ir >> op->bit_shift) & ((1<<op->bit_count)-1);
+    if( op->is_signed ) {
+        val = (val ^ (1<<(op->bit_count-1))) - (1<<(op->bit_count-1));
+    }
+    return val << op->left_shift;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !lxdream_sh4decode_H */
@@ -0,0 +1,68 @@
+/**
+ * $Id$
+ *
+ * SH4 vector FPU support (FSCA, FTRV) shared by the interpreter and the
+ * translator.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <math.h>
+#include "lxdream.h"
+#include "sh4/sh4core.h"
+
+#ifndef M_PI
+#define M_PI        3.14159265358979323846264338327950288
+#endif
+
+float sh4_fsca_table[65536][2];
+static gboolean sh4_fsca_table_valid = FALSE;
+
+void FASTCALL sh4_fsca( uint32_t anglei, float *fr )
+{
+    float angle = (((float)(anglei&0xFFFF))/65536.0) * 2 * M_PI;
+    *fr++ = cosf(angle);
+    *fr = sinf(angle);
+}
+
+/**
+ * Fill in sh4_fsca_table from sh4_fsca, so that a lookup gives exactly the
+ * same result as the interpreter.
+ */
+void sh4_fsca_init_table( void )
+{
+    uint32_t i;
+    if( !sh4_fsca_table_valid ) {
+        for( i=0; i<65536; i++ ) {
+            sh4_fsca( i, sh4_fsca_table[i] );
+        }
+        sh4_fsca_table_valid = TRUE;
+    }
+}
+
+/**
+ * Compute the matrix tranform of fv given the matrix xf.
+ * Both fv and xf are word-swapped as per the sh4r.fr banks
+ */
+void FASTCALL sh4_ftrv( float *target )
+{
+    float fv[4] = { target[1], target[0], target[3], target[2] };
+    target[1] = sh4r.fr[1][1] * fv[0] + sh4r.fr[1][5]*fv[1] +
+    sh4r.fr[1][9]*fv[2] + sh4r.fr[1][13]*fv[3];
+    target[0] = sh4r.fr[1][0] * fv[0] + sh4r.fr[1][4]*fv[1] +
+    sh4r.fr[1][8]*fv[2] + sh4r.fr[1][12]*fv[3];
+    target[3] = sh4r.fr[1][3] * fv[0] + sh4r.fr[1][7]*fv[1] +
+    sh4r.fr[1][11]*fv[2] + sh4r.fr[1][15]*fv[3];
+    target[2] = sh4r.fr[1][2] * fv[0] + sh4r.fr[1][6]*fv[1] +
+    sh4r.fr[1][10]*fv[2] + sh4r.fr[1][14]*fv[3];
+}
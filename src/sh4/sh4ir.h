@@ -0,0 +1,170 @@
+/**
+ * $Id$
+ *
+ * Lightweight block-level intermediate representation for the SH4 translator.
+ * A straight-line run of SH4 instructions is decoded into one record per
+ * instruction (registers read and written, side effects), and a few simple
+ * passes annotate the records for the code generator:
+ *   - Constant propagation: results that can be computed at translation time
+ *     (including PC-relative literal loads) are emitted as immediates.
+ *   - Dead T elimination: updates of the T flag that are overwritten before
+ *     they can be observed are dropped.
+ *   - Redundant store elimination: instructions whose results are all
+ *     overwritten before they can be observed are dropped.
+ * Every instruction that may raise an exception, call out of the translated
+ * code or leave the block is a barrier at which all state is considered
+ * live, so sh4r is exact at any point where it may be examined.
+ * The analysis also recognizes idle loops (see sh4_ir_is_idle_loop), which
+ * the translator can fast-forward to the next event.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef lxdream_sh4ir_H
+#define lxdream_sh4ir_H 1
+
+#include <stdio.h>
+#include "lxdream.h"
+#include "mem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of instructions analysed in one go */
+#define SH4_IR_MAX_INSTRUCTIONS 256
+
+/** Maximum length of an idle loop, including the branch and delay slot */
+#define SH4_IR_IDLE_MAX_INSTRUCTIONS 16
+
+/* Register masks for uses/defs - bits 0..15 are R0..R15 */
+#define SH4_IR_REGS     0x0000FFFF
+#define SH4_IR_T        0x00010000
+#define SH4_IR_ALL      0x0001FFFF
+
+/* Instruction flags */
+#define SH4_IR_BARRIER  0x0001 /* May raise an exception, call out or leave the block */
+#define SH4_IR_PURE     0x0002 /* No effects other than the registers in defs */
+#define SH4_IR_DELAYED  0x0004 /* Delayed branch - the next instruction is a delay slot */
+#define SH4_IR_END      0x0008 /* Ends the block (after the delay slot, if any) */
+#define SH4_IR_PCREL    0x0010 /* PC-relative, so illegal in a delay slot */
+#define SH4_IR_CONST    0x0020 /* The result (rn) is the constant value */
+#define SH4_IR_LITERAL  0x0040 /* ...which came from a PC-relative literal load */
+#define SH4_IR_DEAD     0x0080 /* No result is ever read - drop the instruction */
+#define SH4_IR_DEAD_T   0x0100 /* The T result is never read */
+#define SH4_IR_LOAD     0x0200 /* Memory load with no other effects (uses is exact) */
+
+/* Operations the passes know how to evaluate */
+enum sh4_ir_op {
+    SH4_IR_OP_OTHER,
+    SH4_IR_OP_MOV, SH4_IR_OP_MOVI, SH4_IR_OP_MOVLPC, SH4_IR_OP_MOVWPC,
+    SH4_IR_OP_ADD, SH4_IR_OP_ADDI, SH4_IR_OP_SUB, SH4_IR_OP_NEG, SH4_IR_OP_NOT,
+    SH4_IR_OP_AND, SH4_IR_OP_ANDI, SH4_IR_OP_OR, SH4_IR_OP_ORI,
+    SH4_IR_OP_XOR, SH4_IR_OP_XORI,
+    SH4_IR_OP_EXTSB, SH4_IR_OP_EXTSW, SH4_IR_OP_EXTUB, SH4_IR_OP_EXTUW,
+    SH4_IR_OP_SWAPB, SH4_IR_OP_SWAPW, SH4_IR_OP_XTRCT,
+    SH4_IR_OP_SHLL2, SH4_IR_OP_SHLL8, SH4_IR_OP_SHLL16,
+    SH4_IR_OP_SHLR2, SH4_IR_OP_SHLR8, SH4_IR_OP_SHLR16,
+    /* The following also write T, so the result is tracked but not folded */
+    SH4_IR_OP_DT, SH4_IR_OP_SHLL, SH4_IR_OP_SHLR, SH4_IR_OP_SHAR,
+    SH4_IR_OP_ROTL, SH4_IR_OP_ROTR
+};
+
+typedef struct sh4_ir_inst {
+    uint16_t op;
+    uint16_t flags;
+    int8_t rn, rm;
+    int32_t imm;
+    uint32_t uses;  /* Registers read */
+    uint32_t defs;  /* Registers written */
+    uint32_t value; /* Result, if SH4_IR_CONST */
+    sh4addr_t literal; /* Physical address of the literal, if SH4_IR_LITERAL */
+} *sh4_ir_inst_t;
+
+/**
+ * Per-pass statistics. The analysis counts are updated by sh4_ir_build, the
+ * rest by the code generator as it acts on the annotations.
+ */
+struct sh4_ir_stats {
+    uint64_t instructions;   /* Instructions analysed */
+    uint64_t const_folded;   /* Results emitted as immediates */
+    uint64_t literal_folded; /* ...of which were PC-relative literal loads */
+    uint64_t dead_t;         /* T updates dropped */
+    uint64_t dead_insts;     /* Instructions dropped entirely */
+    uint64_t loads_forwarded; /* Register loads satisfied from a preceding store */
+    uint64_t idle_loops;     /* Idle loops found */
+};
+
+extern struct sh4_ir_stats sh4_ir_stats;
+
+/**
+ * Start a new block. Discards the current analysis and the list of literals.
+ */
+void sh4_ir_begin_block( void );
+
+/**
+ * Decode and analyse up to max_insts instructions from pc (which must be
+ * available to the translator - see xlat_source), stopping at the end of the
+ * page or the end of the block.
+ * Replaces the previous analysis, if any. The analysis assumes that the
+ * instructions are translated in order from pc, and that nothing branches
+ * into the middle of them.
+ * @param fold_literals TRUE if PC-relative loads from the icache page may be
+ * replaced with immediates.
+ */
+void sh4_ir_build( sh4vma_t pc, unsigned int max_insts, gboolean fold_literals );
+
+/**
+ * Discard the current analysis
+ */
+void sh4_ir_clear( void );
+
+/**
+ * @return the analysis of the instruction at pc, or NULL if it isn't
+ * covered by the current analysis.
+ */
+sh4_ir_inst_t sh4_ir_get( sh4vma_t pc );
+
+/**
+ * Check whether the branch at pc closes an idle loop - a short straight-line
+ * run from target to the branch (and its delay slot, if any) that only loads
+ * from memory and computes on registers, with no register carried from one
+ * iteration to the next. Every iteration then computes the same result until
+ * something else changes the memory it reads, which can only happen at an
+ * event.
+ * @return TRUE if the loop is idle, FALSE if it isn't (or isn't entirely
+ * covered by the current analysis).
+ */
+gboolean sh4_ir_is_idle_loop( sh4vma_t pc, sh4vma_t target );
+
+/**
+ * Record that the code generator has folded the literal at the given
+ * physical address into the current block.
+ */
+void sh4_ir_add_literal( sh4addr_t addr );
+
+/**
+ * Mark the source of every literal folded into the current block as belonging
+ * to the block, so that writes to them invalidate it. Must be called after
+ * the block has reached its final size (as extending it may flush the cache).
+ */
+void sh4_ir_mark_literals( void );
+
+void sh4_ir_reset_stats( void );
+void sh4_ir_print_stats( FILE *out );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !lxdream_sh4ir_H */
@@ -28,15 +28,40 @@
 #include "sh4/sh4core.h"
 #include "sh4/sh4mmio.h"
 #include "sh4/mmu.h"
+#include "aica/aica.h"
+#include "aica/armxlat.h"
 #include "pvr2/pvr2.h"
 #include "xlat/xltcache.h"
 
+/**
+ * DMA to/from the AICA memory has to wait for the AICA thread, if any
+ */
+static inline void mem_sync_aica( sh4addr_t addr )
+{
+    addr &= 0x1FFFFFFF;
+    if( addr >= 0x00700000 && addr < 0x00A00000 ) {
+        aica_sync();
+    }
+}
+
+/**
+ * DMA into wave RAM has to discard any ARM code translated from it
+ */
+static inline void mem_invalidate_aica( sh4addr_t addr, size_t count )
+{
+    addr &= 0x1FFFFFFF;
+    if( addr >= 0x00800000 && addr < 0x00A00000 ) {
+        arm_xlat_invalidate_range( addr - 0x00800000, count );
+    }
+}
+
 /************** Obsolete methods ***************/
 
 /* FIXME: Handle all the many special cases when the range doesn't fall cleanly
  * into the same memory block
  */
 void mem_copy_from_sh4( sh4ptr_t dest, sh4addr_t srcaddr, size_t count ) {
+    mem_sync_aica( srcaddr );
     if( srcaddr >= 0x04000000 && srcaddr < 0x05000000 ) {
         pvr2_vram64_read( dest, srcaddr, count );
     } else {
@@ -50,6 +75,7 @@ void mem_copy_from_sh4( sh4ptr_t dest, sh4addr_t srcaddr, size_t count ) {
 }
 
 void mem_copy_to_sh4( sh4addr_t destaddr, sh4ptr_t src, size_t count ) {
+    mem_sync_aica( destaddr );
     if( destaddr >= 0x10000000 && destaddr < 0x14000000 ) {
         pvr2_dma_write( destaddr, src, count );
         return;
@@ -64,6 +90,7 @@ void mem_copy_to_sh4( sh4addr_t destaddr, sh4ptr_t src, size_t count ) {
         WARN( "Attempted block write to unknown address %08X", destaddr );
     else {
         xlat_invalidate_block( destaddr, count );
+        mem_invalidate_aica( destaddr, count );
         memcpy( dest, src, count );
     }
 }
@@ -17,22 +17,112 @@
  * GNU General Public License for more details.
  */
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include "eventq.h"
 #include "syscall.h"
 #include "clock.h"
 #include "dreamcast.h"
 #include "sh4/sh4core.h"
 #include "sh4/sh4trans.h"
+#include "sh4/sh4ir.h"
 #include "sh4/sh4mmio.h"
 #include "sh4/sh4dasm.h"
 #include "sh4/mmu.h"
 #include "xlat/xltcache.h"
+#include "xlat/xltpersist.h"
+#include "xlat/xltperf.h"
 #include "xlat/xlatdasm.h"
 
 //#define SINGLESTEP 1
 
 static void * FASTCALL xlat_get_code_by_vma_cached( sh4vma_t vma );
+static void *sh4_translate_block( sh4addr_t start, gboolean trace );
+static void sh4_translate_emulate_block( void );
+static void sh4_translate_async_install( void );
+static void sh4_translate_select_traces( void );
 
+/** Default number of timeslices between scans for hot blocks */
+#define DEFAULT_TRACE_INTERVAL 64
+/** Default minimum number of executions for a block to start a trace */
+#define DEFAULT_TRACE_THRESHOLD 1000
+/** Maximum number of blocks waiting to be turned into traces */
+#define MAX_TRACE_CANDIDATES 16
+
+static gboolean xlat_trace_enabled = FALSE;
+static uint32_t xlat_trace_interval = DEFAULT_TRACE_INTERVAL;
+static int xlat_trace_threshold = DEFAULT_TRACE_THRESHOLD;
+static uint32_t xlat_trace_slices = 0;
+static void *xlat_trace_candidates[MAX_TRACE_CANDIDATES];
+static unsigned int xlat_trace_candidate_count = 0;
+void *xlat_active_trace = NULL;
+
+/**
+ * Number of times a block is interpreted before it's translated, or 0 to
+ * translate every block the first time it's seen
+ */
+static uint32_t xlat_tier_threshold = 0;
+
+static struct {
+    uint32_t cold;        /* Block executions interpreted while below the threshold */
+    uint32_t promoted;    /* Blocks translated after reaching the threshold */
+} xlat_tier_stats;
+
+/** Maximum number of blocks queued for (or undergoing) background translation */
+#define XLAT_ASYNC_QUEUE_SIZE 64
+/** Largest source range of a background translation - the rest of the page
+ * from the start of the block, plus the delay slot of a branch at the end */
+#define XLAT_ASYNC_MAX_SOURCE (0x1000+2)
+/** Number of blocks remembered as not translatable in the background */
+#define XLAT_ASYNC_REJECT_SIZE 64
+
+#define XLAT_JOB_FREE 0
+#define XLAT_JOB_QUEUED 1
+#define XLAT_JOB_RUNNING 2
+#define XLAT_JOB_DONE 3
+
+/**
+ * A block queued for background translation. The job owns a copy of the
+ * source code, taken when it was queued, so the worker never looks at SH4
+ * memory (or any other emulator state) while translating. Job state changes
+ * are protected by xlat_async_mutex.
+ */
+struct xlat_async_job {
+    int state;
+    uint32_t seq;         /* Queue order */
+    sh4vma_t start;
+    sh4addr_t phys;       /* Physical address of start */
+    uint32_t variant;     /* sh4_translate_get_variant() when queued */
+    struct xlat_source source;
+    /* Results */
+    xlat_cache_block_t block; /* Staged translation, or NULL if it failed */
+    uint32_t size;        /* Size of the code and tables in block */
+    uint32_t src_size;    /* Bytes of source code covered by the block */
+    uint8_t src[XLAT_ASYNC_MAX_SOURCE];
+};
+
+static struct {
+    uint32_t queued;      /* Blocks queued */
+    uint32_t installed;   /* Translations added to the cache */
+    uint32_t stale;       /* Translations dropped as the source had changed */
+    uint32_t superseded;  /* Translations dropped as the block was already translated */
+    uint32_t rejected;    /* Blocks that couldn't be translated in the background */
+    uint32_t full;        /* Requests turned away with the queue full */
+    uint64_t emulated;    /* Instructions interpreted (while waiting, or while cold) */
+} xlat_async_stats;
+
+static gboolean xlat_async_enabled = FALSE;
+static struct xlat_async_job xlat_async_jobs[XLAT_ASYNC_QUEUE_SIZE];
+static uint32_t xlat_async_seq = 0;
+static sh4addr_t xlat_async_reject[XLAT_ASYNC_REJECT_SIZE];
+static pthread_mutex_t xlat_async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t xlat_async_cond = PTHREAD_COND_INITIALIZER;
+/* Number of finished background translations waiting to be installed */
+static volatile uint32_t xlat_async_done_count = 0;
+
+static void *sh4_translate_source( sh4addr_t start, gboolean trace, gboolean relocatable,
+                                   struct xlat_async_job *job );
 
 /**
  * Execute a timeslice using translated code only (ie translate/execute loop)
@@ -40,6 +130,11 @@ static void * FASTCALL xlat_get_code_by_vma_cached( sh4vma_t vma );
 uint32_t sh4_translate_run_slice( uint32_t nanosecs ) 
 {
     event_schedule( EVENT_ENDTIMESLICE, nanosecs );
+    xlat_cache_tick();
+    if( xlat_trace_enabled && ++xlat_trace_slices >= xlat_trace_interval ) {
+        xlat_trace_slices = 0;
+        sh4_translate_select_traces();
+    }
     for(;;) {
         if( sh4r.event_pending <= sh4r.slice_cycle ) {
             sh4_handle_pending_events();
@@ -54,26 +149,37 @@ uint32_t sh4_translate_run_slice( uint32_t nanosecs )
             syscall_invoke( pc );
         }
 
+        if( __atomic_load_n( &xlat_async_done_count, __ATOMIC_ACQUIRE ) != 0 ) {
+            sh4_translate_async_install();
+        }
+
         void * (*code)() = xlat_get_code_by_vma( sh4r.pc );
-        if( code != NULL ) {
-            while( sh4r.xlat_sh4_mode != XLAT_BLOCK_MODE(code) ) {
-                code = XLAT_BLOCK_CHAIN(code);
-                if( code == NULL ) {
-                    code = sh4_translate_basic_block( sh4r.pc );
-                    break;
-                }
+        while( code != NULL && sh4r.xlat_sh4_mode != XLAT_BLOCK_MODE(code) ) {
+            code = XLAT_BLOCK_CHAIN(code);
+        }
+        if( code == NULL ) {
+            code = sh4_translate_request_block( sh4r.pc );
+            if( code == NULL ) {
+                /* Not hot enough yet, or still being translated */
+                sh4_translate_emulate_block();
+                continue;
             }
-        } else {
-            code = sh4_translate_basic_block( sh4r.pc );
+        }
+        if( xlat_trace_candidate_count != 0 ) {
+            code = sh4_translate_check_trace( sh4r.pc, code );
         }
         sh4_translate_enter(code);
     }
 }
 
 uint8_t *xlat_output;
+struct xlat_source xlat_source;
 xlat_cache_block_t xlat_current_block;
 struct xlat_recovery_record xlat_recovery[MAX_RECOVERY_SIZE];
 uint32_t xlat_recovery_posn;
+static xlat_reloc_record_t xlat_reloc[MAX_RELOC_SIZE];
+static uint32_t xlat_reloc_posn;
+static gboolean xlat_reloc_valid;
 
 void sh4_translate_add_recovery( uint32_t icount )
 {
@@ -83,6 +189,212 @@ void sh4_translate_add_recovery( uint32_t icount )
     xlat_recovery_posn++;
 }
 
+void sh4_translate_add_reloc( uint8_t *site, gboolean is_link )
+{
+    /* Ignore sites outside the current block (eg entry stubs, unlinking) */
+    if( xlat_current_block == NULL || site < xlat_current_block->code ||
+        site >= xlat_current_block->code + xlat_current_block->size ) {
+        return;
+    }
+    if( xlat_reloc_posn == MAX_RELOC_SIZE ) {
+        xlat_reloc_valid = FALSE;
+    } else {
+        xlat_reloc[xlat_reloc_posn++] = ((site - xlat_current_block->code)<<1) |
+                (is_link ? XLAT_RELOC_LINK : 0);
+    }
+}
+
+void sh4_translate_init_persistent_cache( const char *filename )
+{
+#if SIZEOF_VOID_P == 8
+    void *objects[3] = { sh4_address_space, sh4_user_address_space, sdram_get_window() };
+    xlat_persist_init( filename, objects, 3 );
+#else
+    WARN( "Persistent translation cache is not supported on 32-bit hosts" );
+#endif
+}
+
+void sh4_translate_save_persistent_cache( void )
+{
+    if( xlat_persist_is_enabled() ) {
+        xlat_persist_capture( sh4_translate_get_variant() );
+        xlat_persist_save();
+        xlat_persist_print_stats( stderr );
+    }
+}
+
+/**
+ * Blocks may be committed under their physical address, while symbols are
+ * normally linked in P1 (or occasionally P2), so try each of those in turn.
+ */
+static const char *sh4_translate_perf_symbol( sh4addr_t addr, uint32_t *offset )
+{
+    const char *sym = sh4_disasm_find_symbol( addr, offset );
+    if( sym == NULL && addr < 0xE0000000 ) {
+        sym = sh4_disasm_find_symbol( (addr&0x1FFFFFFF)|0x80000000, offset );
+        if( sym == NULL ) {
+            sym = sh4_disasm_find_symbol( (addr&0x1FFFFFFF)|0xA0000000, offset );
+        }
+    }
+    return sym;
+}
+
+void sh4_translate_init_perf( gboolean perf_map, const char *jitdump_dir )
+{
+    xlat_perf_init( perf_map, jitdump_dir, sh4_translate_perf_symbol );
+}
+
+void sh4_translate_shutdown( void )
+{
+    xlat_perf_shutdown();
+}
+
+/**
+ * Trace formation state, only valid while translating a trace. Each segment
+ * is a linear run of instructions, entered by a branch from the end of the
+ * previous segment. Segment 0 starts at the trace head.
+ */
+static struct xlat_trace_segment {
+    sh4vma_t start;
+    sh4vma_t end;
+    uint32_t offset; /* offset from the start of the trace code */
+} xlat_trace_segment[MAX_TRACE_SEGMENTS];
+static unsigned int xlat_trace_segment_count;
+static gboolean xlat_trace_forming = FALSE;
+static int xlat_trace_head_activity;
+static gboolean xlat_trace_redirect;
+static sh4vma_t xlat_trace_next_pc;
+
+void sh4_translate_set_traces( gboolean flag )
+{
+    const char *env;
+    xlat_trace_enabled = flag;
+    xlat_trace_candidate_count = 0;
+    xlat_trace_slices = 0;
+    if( (env = getenv("LXDREAM_JIT_TRACE_INTERVAL")) != NULL && atoi(env) > 0 ) {
+        xlat_trace_interval = atoi(env);
+    }
+    if( (env = getenv("LXDREAM_JIT_TRACE_THRESHOLD")) != NULL && atoi(env) > 0 ) {
+        xlat_trace_threshold = atoi(env);
+    }
+}
+
+gboolean sh4_translate_get_traces( void )
+{
+    return xlat_trace_enabled;
+}
+
+/**
+ * Choose the hottest blocks (that aren't already traces) as candidates for
+ * trace formation. Traces are actually formed the next time a candidate is
+ * entered, when its VMA is known - any direct links to the candidates are
+ * removed so that entries go through the dispatcher/linker.
+ */
+static void sh4_translate_select_traces( void )
+{
+    struct xlat_block_ref blocks[MAX_TRACE_CANDIDATES*2];
+    unsigned int count = xlat_get_cache_blocks_by_activity( blocks, MAX_TRACE_CANDIDATES*2 );
+    unsigned int i;
+
+    xlat_trace_candidate_count = 0;
+    for( i=0; i<count && xlat_trace_candidate_count < MAX_TRACE_CANDIDATES; i++ ) {
+        xlat_cache_block_t block = blocks[i].block;
+        if( block->active < xlat_trace_threshold ) {
+            break;
+        }
+        if( !(block->flags & XLAT_BLOCK_FLAG_TRACE) ) {
+            xlat_unlink_block( block );
+            xlat_trace_candidates[xlat_trace_candidate_count++] = block->code;
+        }
+    }
+}
+
+void *sh4_translate_check_trace( sh4vma_t pc, void *code )
+{
+    unsigned int i;
+    for( i=0; i<xlat_trace_candidate_count; i++ ) {
+        if( xlat_trace_candidates[i] == code ) {
+            xlat_cache_block_t block = XLAT_BLOCK_FOR_CODE(code);
+            xlat_trace_candidates[i] = xlat_trace_candidates[--xlat_trace_candidate_count];
+            if( sh4_breakpoint_count != 0 || (block->flags & XLAT_BLOCK_FLAG_TRACE) ||
+                sh4_translate_get_variant() == XLAT_VARIANT_NONE ) {
+                return code;
+            }
+            /* The trace goes in front of the old block in the lookup table,
+             * and takes over any links to it */
+            xlat_trace_head_activity = block->active;
+            block->flags |= XLAT_BLOCK_FLAG_TRACE;
+            xlat_unlink_block( block );
+            return sh4_translate_block( pc, TRUE );
+        }
+    }
+    return code;
+}
+
+/**
+ * @return the execution count of the block (in the current mode) at the given
+ * vma, or -1 if the trace can't continue to the vma.
+ */
+static int sh4_translate_trace_activity( sh4vma_t vma )
+{
+    if( !XLAT_IN_ICACHE(vma) ||
+        ((XLAT_ICACHE_PHYS(vma) ^ XLAT_ICACHE_PHYS(xlat_trace_segment[0].start)) & ~(XLAT_SOURCE_PAGE_SIZE-1)) != 0 ) {
+        return -1;
+    }
+    if( vma == xlat_trace_segment[0].start ) {
+        return xlat_trace_head_activity;
+    }
+    void *code = xlat_get_code( XLAT_ICACHE_PHYS(vma) );
+    while( code != NULL && XLAT_BLOCK_MODE(code) != xlat_source.sh4_mode ) {
+        code = XLAT_BLOCK_CHAIN(code);
+    }
+    return code == NULL ? 0 : XLAT_BLOCK_FOR_CODE(code)->active;
+}
+
+int sh4_translate_trace_branch( sh4vma_t taken, sh4vma_t not_taken )
+{
+    if( !xlat_trace_forming || xlat_trace_segment_count >= MAX_TRACE_SEGMENTS ||
+        xlat_recovery_posn >= MAX_TRACE_INSTRUCTIONS ) {
+        return TRACE_BRANCH_NONE;
+    }
+    int taken_count = sh4_translate_trace_activity( taken );
+    if( taken == not_taken ) {
+        return taken_count < 0 ? TRACE_BRANCH_NONE : TRACE_BRANCH_TAKEN;
+    }
+    int not_taken_count = sh4_translate_trace_activity( not_taken );
+    if( taken_count > 0 && taken_count > not_taken_count ) {
+        return TRACE_BRANCH_TAKEN;
+    } else if( not_taken_count > 0 && not_taken_count > taken_count ) {
+        return TRACE_BRANCH_NOT_TAKEN;
+    }
+    return TRACE_BRANCH_NONE;
+}
+
+int32_t sh4_translate_trace_find_segment( sh4vma_t pc )
+{
+    unsigned int i;
+    for( i=0; i<xlat_trace_segment_count; i++ ) {
+        if( xlat_trace_segment[i].start == pc ) {
+            return xlat_trace_segment[i].offset;
+        }
+    }
+    return -1;
+}
+
+void sh4_translate_trace_continue( sh4vma_t endpc, sh4vma_t pc, gboolean new_segment )
+{
+    assert( xlat_trace_forming );
+    if( new_segment ) {
+        assert( xlat_trace_segment_count < MAX_TRACE_SEGMENTS );
+        xlat_trace_segment[xlat_trace_segment_count-1].end = endpc;
+        xlat_trace_segment[xlat_trace_segment_count].start = pc;
+        xlat_trace_segment[xlat_trace_segment_count].offset = xlat_output - xlat_current_block->code;
+        xlat_trace_segment_count++;
+    }
+    xlat_trace_redirect = TRUE;
+    xlat_trace_next_pc = pc;
+}
+
 /**
  * Translate a linear basic block, ie all instructions from the start address
  * (inclusive) until the next branch/jump instruction or the end of the page
@@ -92,17 +404,142 @@ void sh4_translate_add_recovery( uint32_t icount )
  * eg due to lack of buffer space.
  */
 void * sh4_translate_basic_block( sh4addr_t start )
+{
+    return sh4_translate_block( start, FALSE );
+}
+
+/**
+ * Look for the block starting at the given address in the persistent cache.
+ * @return the restored code, or NULL if there isn't a usable copy.
+ */
+static void *sh4_translate_restore_block( sh4vma_t start, uint32_t variant )
+{
+    void *code = NULL;
+    if( variant != XLAT_VARIANT_NONE && sh4_breakpoint_count == 0 && xlat_persist_is_enabled() ) {
+        sh4_translate_lock();
+        code = xlat_persist_restore( GET_ICACHE_PHYS(start), sh4r.xlat_sh4_mode, variant );
+        if( code != NULL ) {
+            xlat_current_block = XLAT_BLOCK_FOR_CODE(code);
+        }
+        sh4_translate_unlock();
+    }
+    return code;
+}
+
+/**
+ * Set up the given source for translating directly from the current icache
+ * entry, in the current CPU mode.
+ */
+static void xlat_source_init( struct xlat_source *source )
+{
+    source->icache = sh4_icache;
+    source->fetch = sh4_icache.page;
+    source->fetch_vma = sh4_icache.page_vma;
+    source->fetch_end = GET_ICACHE_END();
+    source->sh4_mode = sh4r.xlat_sh4_mode;
+    source->fpscr = sh4r.fpscr;
+    source->tlb_on = IS_TLB_ENABLED();
+    source->breakpoints = (sh4_breakpoint_count != 0);
+    source->background = FALSE;
+}
+
+/**
+ * Background translations are built in a private buffer (with the same layout
+ * as a cache block), as the translation cache belongs to the emulation thread.
+ */
+#define XLAT_STAGING_INITIAL_SIZE 4096
+
+static xlat_cache_block_t sh4_translate_start_output( sh4addr_t address )
+{
+    if( !xlat_source.background ) {
+        return xlat_start_block( address );
+    }
+    xlat_cache_block_t block = malloc( sizeof(struct xlat_cache_block) + XLAT_STAGING_INITIAL_SIZE );
+    assert( block != NULL );
+    memset( block, 0, sizeof(struct xlat_cache_block) );
+    block->active = 1;
+    block->size = XLAT_STAGING_INITIAL_SIZE;
+    return block;
+}
+
+static xlat_cache_block_t sh4_translate_extend_output( uint32_t newSize )
+{
+    if( !xlat_source.background ) {
+        return xlat_extend_block( newSize );
+    }
+    xlat_cache_block_t block = xlat_current_block;
+    if( block->size < newSize ) {
+        uint32_t size = block->size * 2;
+        if( size < newSize ) {
+            size = newSize;
+        }
+        block = realloc( block, sizeof(struct xlat_cache_block) + size );
+        assert( block != NULL );
+        block->size = size;
+    }
+    return block;
+}
+
+/**
+ * Translate a block starting at the given address. If trace is FALSE, this is
+ * a basic block as above. Otherwise translation may continue through branches
+ * (see sh4_translate_trace_branch), for as long as the code generator keeps
+ * requesting it.
+ */
+static void *sh4_translate_block( sh4addr_t start, gboolean trace )
+{
+    uint32_t variant = sh4_translate_get_variant();
+    void *code = NULL;
+
+    if( !trace ) {
+        code = sh4_translate_restore_block( start, variant );
+        if( code != NULL ) {
+            return code;
+        }
+    }
+
+    sh4_translate_lock();
+    xlat_source_init( &xlat_source );
+    /* Blocks containing breakpoints are never relocated, as they don't reflect
+     * the actual source code. Traces depend on the block profile at the time,
+     * so aren't kept either */
+    code = sh4_translate_source( start, trace,
+            variant != XLAT_VARIANT_NONE && sh4_breakpoint_count == 0 && !trace, NULL );
+    sh4_translate_unlock();
+    return code;
+}
+
+/**
+ * Translate the block at start from xlat_source, with the translation lock
+ * held. Background translations (job != NULL) are left in a staging buffer
+ * for sh4_translate_async_install, rather than being added to the cache.
+ * @param relocatable TRUE to build the relocation table (see xltpersist.h)
+ */
+static void *sh4_translate_source( sh4addr_t start, gboolean trace, gboolean relocatable,
+                                   struct xlat_async_job *job )
 {
     sh4addr_t pc = start;
     sh4addr_t lastpc = (pc&0xFFFFF000)+0x1000;
     int done;
-    xlat_current_block = xlat_start_block( GET_ICACHE_PHYS(start) );
+
+    xlat_current_block = sh4_translate_start_output( XLAT_ICACHE_PHYS(start) );
     xlat_output = (uint8_t *)xlat_current_block->code;
     xlat_recovery_posn = 0;
+    xlat_reloc_posn = 0;
+    xlat_reloc_valid = relocatable;
     uint8_t *eob = xlat_output + xlat_current_block->size;
 
-    if( GET_ICACHE_END() < lastpc ) {
-        lastpc = GET_ICACHE_END();
+    xlat_trace_forming = trace;
+    xlat_trace_redirect = FALSE;
+    xlat_trace_segment[0].start = start;
+    xlat_trace_segment[0].offset = 0;
+    xlat_trace_segment_count = 1;
+    if( trace ) {
+        xlat_current_block->flags |= XLAT_BLOCK_FLAG_TRACE;
+    }
+
+    if( XLAT_ICACHE_END() < lastpc ) {
+        lastpc = XLAT_ICACHE_END();
     }
 
     sh4_translate_begin_block(pc);
@@ -110,45 +547,406 @@ void * sh4_translate_basic_block( sh4addr_t start )
     do {
         if( eob - xlat_output < MAX_INSTRUCTION_SIZE ) {
             uint8_t *oldstart = xlat_current_block->code;
-            xlat_current_block = xlat_extend_block( xlat_output - oldstart + MAX_INSTRUCTION_SIZE );
+            xlat_current_block = sh4_translate_extend_output( xlat_output - oldstart + MAX_INSTRUCTION_SIZE );
             xlat_output = xlat_current_block->code + (xlat_output - oldstart);
             eob = xlat_current_block->code + xlat_current_block->size;
         }
         done = sh4_translate_instruction( pc ); 
         assert( xlat_output <= eob );
         pc += 2;
+        if( xlat_trace_redirect ) {
+            xlat_trace_redirect = FALSE;
+            pc = xlat_trace_next_pc;
+            lastpc = (pc&0xFFFFF000)+0x1000;
+            if( XLAT_ICACHE_END() < lastpc ) {
+                lastpc = XLAT_ICACHE_END();
+            }
+        }
         if ( pc >= lastpc && done == 0 ) {
             done = 2;
         }
+        if( trace && xlat_recovery_posn >= MAX_RECOVERY_SIZE - 2 && done == 0 ) {
+            done = 2;
+        }
 #ifdef SINGLESTEP
         if( !done ) done = 2;
 #endif
     } while( !done );
     pc += (done - 2);
+    xlat_trace_forming = FALSE;
+    xlat_trace_segment[xlat_trace_segment_count-1].end = pc;
 
     // Add end-of-block recovery for post-instruction checks
-    sh4_translate_add_recovery( (pc - start)>>1 ); 
+    sh4_translate_add_recovery( (pc - xlat_trace_segment[xlat_trace_segment_count-1].start)>>1 ); 
 
     int epilogue_size = sh4_translate_end_block_size();
     uint32_t recovery_size = sizeof(struct xlat_recovery_record)*xlat_recovery_posn;
-    uint32_t finalsize = (xlat_output - xlat_current_block->code) + epilogue_size + recovery_size;
+    /* Each pointer site takes at least MIN_RELOC_SPACING bytes of code, which
+     * bounds the number of sites the epilogue can add */
+    uint32_t reloc_reserve = sizeof(xlat_reloc_record_t)*(xlat_reloc_posn + epilogue_size/MIN_RELOC_SPACING + 1);
+    uint32_t finalsize = (xlat_output - xlat_current_block->code) + epilogue_size + recovery_size + reloc_reserve;
     if( xlat_current_block->size < finalsize ) {
         uint8_t *oldstart = xlat_current_block->code;
-        xlat_current_block = xlat_extend_block( finalsize );
+        xlat_current_block = sh4_translate_extend_output( finalsize );
         xlat_output = xlat_current_block->code + (xlat_output - oldstart);
     }	
     sh4_translate_end_block(pc);
-    assert( xlat_output <= (xlat_current_block->code + xlat_current_block->size - recovery_size) );
+    uint32_t reloc_size = xlat_reloc_valid ? sizeof(xlat_reloc_record_t)*xlat_reloc_posn : 0;
+    assert( xlat_output <= (xlat_current_block->code + xlat_current_block->size - recovery_size - reloc_size) );
+    assert( reloc_size <= reloc_reserve );
 
-    /* Write the recovery records onto the end of the code block */
+    /* Write the recovery and relocation records onto the end of the code block */
     memcpy( xlat_output, xlat_recovery, recovery_size);
+    memcpy( xlat_output + recovery_size, xlat_reloc, reloc_size );
     xlat_current_block->recover_table_offset = xlat_output - (uint8_t *)xlat_current_block->code;
     xlat_current_block->recover_table_size = xlat_recovery_posn;
-    xlat_current_block->xlat_sh4_mode = sh4r.xlat_sh4_mode;
-    xlat_commit_block( finalsize, start, pc );
+    xlat_current_block->reloc_table_size = reloc_size / sizeof(xlat_reloc_record_t);
+    xlat_current_block->xlat_sh4_mode = xlat_source.sh4_mode;
+    if( job != NULL ) {
+        /* The block has to be moved into the cache, so is no use without the
+         * relocation table */
+        if( xlat_reloc_valid ) {
+            job->block = xlat_current_block;
+            job->size = finalsize;
+            job->src_size = pc - start;
+        } else {
+            free( xlat_current_block );
+            job->block = NULL;
+        }
+        xlat_current_block = NULL;
+        return NULL;
+    }
+    for( unsigned int i=1; i<xlat_trace_segment_count; i++ ) {
+        xlat_add_block_range( xlat_trace_segment[i].start, xlat_trace_segment[i].end );
+    }
+    sh4_ir_mark_literals();
+    xlat_commit_block( finalsize, start, xlat_trace_segment[0].end );
     return xlat_current_block->code;
 }
 
+/******************************** Background translation ******************************/
+
+static pthread_once_t xlat_lock_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t xlat_lock;
+
+static void xlat_lock_init( void )
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init( &attr );
+    pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE );
+    pthread_mutex_init( &xlat_lock, &attr );
+    pthread_mutexattr_destroy( &attr );
+}
+
+void sh4_translate_lock( void )
+{
+    pthread_once( &xlat_lock_once, xlat_lock_init );
+    pthread_mutex_lock( &xlat_lock );
+}
+
+static gboolean sh4_translate_trylock( void )
+{
+    pthread_once( &xlat_lock_once, xlat_lock_init );
+    return pthread_mutex_trylock( &xlat_lock ) == 0;
+}
+
+void sh4_translate_unlock( void )
+{
+    pthread_mutex_unlock( &xlat_lock );
+}
+
+/**
+ * @return the oldest queued job, or NULL if there isn't one. Called with
+ * xlat_async_mutex held.
+ */
+static struct xlat_async_job *sh4_translate_async_next( void )
+{
+    struct xlat_async_job *job = NULL;
+    for( unsigned int i=0; i<XLAT_ASYNC_QUEUE_SIZE; i++ ) {
+        if( xlat_async_jobs[i].state == XLAT_JOB_QUEUED &&
+            (job == NULL || (int32_t)(xlat_async_jobs[i].seq - job->seq) < 0) ) {
+            job = &xlat_async_jobs[i];
+        }
+    }
+    return job;
+}
+
+static void *sh4_translate_async_worker( void *arg )
+{
+    for(;;) {
+        struct xlat_async_job *job;
+        pthread_mutex_lock( &xlat_async_mutex );
+        while( (job = sh4_translate_async_next()) == NULL ) {
+            pthread_cond_wait( &xlat_async_cond, &xlat_async_mutex );
+        }
+        job->state = XLAT_JOB_RUNNING;
+        pthread_mutex_unlock( &xlat_async_mutex );
+
+        sh4_translate_lock();
+        xlat_source = job->source;
+        sh4_translate_source( job->start, FALSE, TRUE, job );
+        sh4_translate_unlock();
+
+        pthread_mutex_lock( &xlat_async_mutex );
+        job->state = XLAT_JOB_DONE;
+        __atomic_add_fetch( &xlat_async_done_count, 1, __ATOMIC_RELEASE );
+        pthread_mutex_unlock( &xlat_async_mutex );
+    }
+    return NULL;
+}
+
+void sh4_translate_set_async( gboolean flag )
+{
+#if SIZEOF_VOID_P == 8
+    static gboolean worker_started = FALSE;
+    if( flag && !worker_started ) {
+        pthread_t thread;
+        memset( xlat_async_reject, 0xFF, sizeof(xlat_async_reject) );
+        if( pthread_create( &thread, NULL, sh4_translate_async_worker, NULL ) != 0 ) {
+            WARN( "Unable to start the background translation thread" );
+            return;
+        }
+        pthread_detach( thread );
+        worker_started = TRUE;
+    }
+    xlat_async_enabled = flag;
+#else
+    if( flag ) {
+        /* Relies on the relocation tables to move blocks into the cache */
+        WARN( "Background translation is not supported on 32-bit hosts" );
+    }
+#endif
+}
+
+gboolean sh4_translate_get_async( void )
+{
+    return xlat_async_enabled;
+}
+
+/**
+ * Queue the block at start (which must be in the icache) for translation in
+ * the current mode, unless it's already queued (or the queue is full).
+ */
+static void sh4_translate_async_queue( sh4vma_t start, uint32_t variant )
+{
+    sh4addr_t phys = GET_ICACHE_PHYS(start);
+    struct xlat_async_job *job = NULL;
+
+    pthread_mutex_lock( &xlat_async_mutex );
+    for( unsigned int i=0; i<XLAT_ASYNC_QUEUE_SIZE; i++ ) {
+        if( xlat_async_jobs[i].state == XLAT_JOB_FREE ) {
+            if( job == NULL ) {
+                job = &xlat_async_jobs[i];
+            }
+        } else if( xlat_async_jobs[i].phys == phys &&
+                   xlat_async_jobs[i].source.sh4_mode == sh4r.xlat_sh4_mode ) {
+            pthread_mutex_unlock( &xlat_async_mutex );
+            return;
+        }
+    }
+    if( job == NULL ) {
+        xlat_async_stats.full++;
+        pthread_mutex_unlock( &xlat_async_mutex );
+        return;
+    }
+
+    job->start = start;
+    job->phys = phys;
+    job->variant = variant;
+    xlat_source_init( &job->source );
+    sh4vma_t end = (start & 0xFFFFF000) + XLAT_ASYNC_MAX_SOURCE;
+    if( end > job->source.fetch_end ) {
+        end = job->source.fetch_end;
+    }
+    memcpy( job->src, GET_ICACHE_PTR(start), end - start );
+    job->source.fetch = job->src;
+    job->source.fetch_vma = start;
+    job->source.fetch_end = end;
+    job->source.breakpoints = FALSE;
+    job->source.background = TRUE;
+    job->block = NULL;
+    job->seq = xlat_async_seq++;
+    job->state = XLAT_JOB_QUEUED;
+    xlat_async_stats.queued++;
+    pthread_cond_signal( &xlat_async_cond );
+    pthread_mutex_unlock( &xlat_async_mutex );
+}
+
+/**
+ * Copy a finished background translation into the translation cache, provided
+ * that it's still valid: the source code must be unchanged since the job was
+ * queued (any write to it would have invalidated the block had it been in the
+ * cache at the time), and the translator configuration must be the same.
+ * Called on the emulation thread with the translation lock held.
+ */
+static void sh4_translate_async_install_job( struct xlat_async_job *job )
+{
+    xlat_cache_block_t staged = job->block;
+    unsigned int i;
+
+    if( staged == NULL ) {
+        xlat_async_stats.rejected++;
+        xlat_async_reject[(job->phys>>1) % XLAT_ASYNC_REJECT_SIZE] = job->phys;
+        return;
+    }
+    job->block = NULL;
+    if( job->variant != sh4_translate_get_variant() || sh4_breakpoint_count != 0 ||
+        memcmp( job->src, job->source.icache.page + (job->start - job->source.icache.page_vma),
+                job->src_size ) != 0 ) {
+        xlat_async_stats.stale++;
+        free( staged );
+        return;
+    }
+    void *code = xlat_get_code( job->phys );
+    while( code != NULL && XLAT_BLOCK_MODE(code) != job->source.sh4_mode ) {
+        code = XLAT_BLOCK_CHAIN(code);
+    }
+    if( code != NULL ) {
+        xlat_async_stats.superseded++;
+        free( staged );
+        return;
+    }
+
+    xlat_cache_block_t block = xlat_start_block( job->phys );
+    if( block->size < job->size ) {
+        block = xlat_extend_block( job->size );
+    }
+    memcpy( block->code, staged->code, job->size );
+    /* Pointers into the block itself have to move with it */
+    xlat_reloc_record_t *reloc = (xlat_reloc_record_t *)(block->code + staged->recover_table_offset +
+            staged->recover_table_size * sizeof(struct xlat_recovery_record));
+    for( i=0; i<staged->reloc_table_size; i++ ) {
+        if( !XLAT_RELOC_IS_LINK(reloc[i]) ) {
+            uint8_t **site = (uint8_t **)(block->code + XLAT_RELOC_OFFSET(reloc[i]));
+            if( *site >= (uint8_t *)staged && *site <= staged->code + staged->size ) {
+                *site = block->code + (*site - staged->code);
+            }
+        }
+    }
+    block->recover_table_offset = staged->recover_table_offset;
+    block->recover_table_size = staged->recover_table_size;
+    block->reloc_table_size = staged->reloc_table_size;
+    block->xlat_sh4_mode = job->source.sh4_mode;
+    xlat_commit_block( job->size, job->phys, job->phys + job->src_size );
+    xlat_async_stats.installed++;
+    free( staged );
+}
+
+/**
+ * Install all finished background translations. If the worker is busy (ie
+ * holds the translation lock), they're left for the next time around.
+ */
+static void sh4_translate_async_install( void )
+{
+    if( !sh4_translate_trylock() ) {
+        return;
+    }
+    pthread_mutex_lock( &xlat_async_mutex );
+    for( unsigned int i=0; i<XLAT_ASYNC_QUEUE_SIZE; i++ ) {
+        if( xlat_async_jobs[i].state == XLAT_JOB_DONE ) {
+            sh4_translate_async_install_job( &xlat_async_jobs[i] );
+            xlat_async_jobs[i].state = XLAT_JOB_FREE;
+            __atomic_sub_fetch( &xlat_async_done_count, 1, __ATOMIC_RELAXED );
+        }
+    }
+    pthread_mutex_unlock( &xlat_async_mutex );
+    sh4_translate_unlock();
+}
+
+void sh4_translate_set_tier_threshold( uint32_t count )
+{
+    if( count >= XLAT_MAX_EXECUTION_COUNT ) {
+        WARN( "Tier threshold %u is too large, using %u", count, XLAT_MAX_EXECUTION_COUNT-1 );
+        count = XLAT_MAX_EXECUTION_COUNT-1;
+    }
+    xlat_tier_threshold = count;
+}
+
+uint32_t sh4_translate_get_tier_threshold( void )
+{
+    return xlat_tier_threshold;
+}
+
+gboolean sh4_translate_is_cold( sh4vma_t pc )
+{
+    return xlat_tier_threshold != 0 &&
+        xlat_get_execution_count( GET_ICACHE_PHYS(pc) ) < xlat_tier_threshold;
+}
+
+void sh4_translate_print_tier_stats( FILE *out )
+{
+    fprintf( out, "[JIT] tiered execution: threshold %u, %u block executions interpreted, "
+             "%u blocks translated\n", xlat_tier_threshold, xlat_tier_stats.cold,
+             xlat_tier_stats.promoted );
+}
+
+void *sh4_translate_request_block( sh4vma_t pc )
+{
+    if( xlat_tier_threshold != 0 ) {
+        if( xlat_count_execution( GET_ICACHE_PHYS(pc) ) <= xlat_tier_threshold ) {
+            /* A block from the persistent cache was hot last time, so it's
+             * worth having straight away - otherwise keep interpreting */
+            void *code = sh4_translate_restore_block( pc, sh4_translate_get_variant() );
+            if( code == NULL ) {
+                xlat_tier_stats.cold++;
+            }
+            return code;
+        }
+        xlat_tier_stats.promoted++;
+    }
+    if( xlat_async_enabled ) {
+        uint32_t variant = sh4_translate_get_variant();
+        sh4addr_t phys = GET_ICACHE_PHYS(pc);
+        if( variant != XLAT_VARIANT_NONE && sh4_breakpoint_count == 0 &&
+            xlat_async_reject[(phys>>1) % XLAT_ASYNC_REJECT_SIZE] != phys ) {
+            void *code = sh4_translate_restore_block( pc, variant );
+            if( code == NULL ) {
+                sh4_translate_async_queue( pc, variant );
+            }
+            return code;
+        }
+    }
+    return sh4_translate_basic_block( pc );
+}
+
+/**
+ * Run the code at sh4r.pc in the interpreter, while it's cold or its
+ * translation is in progress. Stops at the end of the basic block (after the delay slot, if
+ * any), at the end of the page, or when an event is due, so that it's always
+ * safe to go back to translated code afterwards.
+ */
+static void sh4_translate_emulate_block( void )
+{
+    sh4r.new_pc = sh4r.pc + 2;
+    sh4r.in_delay_slot = FALSE;
+    for(;;) {
+        sh4vma_t pc = sh4r.pc;
+        if( !sh4_execute_instruction() ) {
+            if( sh4r.sh4_state != SH4_STATE_RUNNING ) {
+                /* SLEEP - exit the same way as the translated instruction */
+                sh4r.sh4_state = SH4_STATE_RUNNING;
+                sh4_sleep();
+            }
+            sh4_core_exit( CORE_EXIT_HALT );
+        }
+        sh4r.slice_cycle += sh4_cpu_period;
+        xlat_async_stats.emulated++;
+        if( !sh4r.in_delay_slot &&
+            (sh4r.pc != pc + 2 || (sh4r.pc & 0xFFF) == 0 || sh4r.event_pending <= sh4r.slice_cycle) ) {
+            break;
+        }
+    }
+}
+
+void sh4_translate_print_async_stats( FILE *out )
+{
+    fprintf( out, "[JIT] background translation: %u queued, %u installed, %u stale, %u superseded, "
+             "%u rejected, %u queue full; %lld instructions interpreted\n",
+             xlat_async_stats.queued, xlat_async_stats.installed, xlat_async_stats.stale,
+             xlat_async_stats.superseded, xlat_async_stats.rejected, xlat_async_stats.full,
+             (long long int)xlat_async_stats.emulated );
+}
+
 /**
  * "Execute" the supplied recovery record. Currently this only updates
  * sh4r.pc and sh4r.slice_cycle according to the currently executing
@@ -171,39 +969,68 @@ void sh4_translate_run_exception_recovery( xlat_recovery_record_t recovery )
     sh4r.spc += (recovery->sh4_icount<<1);
 }    
 
+/**
+ * Find the translated code that is currently executing on behalf of the given
+ * vma (which is the start of the block, or of the trace segment, that is
+ * running), along with the native pc within it.
+ * @return the code block, or NULL if we're not running inside the translator
+ */
+static gboolean xlat_find_native_pc( void *code, void **native_pc )
+{
+    uint32_t size = xlat_get_code_size( code );
+    uint8_t *pc = xlat_get_native_pc( code, size );
+    /* Not all implementations of xlat_get_native_pc check the bounds */
+    if( pc != NULL && pc >= (uint8_t *)code && pc < ((uint8_t *)code) + size ) {
+        *native_pc = pc;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static void *xlat_get_running_code( sh4vma_t vma, void **native_pc )
+{
+    void *code = xlat_get_code_by_vma_cached( vma );
+    while( code != NULL ) {
+        if( xlat_find_native_pc( code, native_pc ) ) {
+            return code;
+        }
+        code = XLAT_BLOCK_CHAIN(code);
+    }
+
+    /* May be in a later segment of a trace */
+    code = xlat_active_trace;
+    if( code != NULL && XLAT_BLOCK_FOR_CODE(code)->active != 0 &&
+        (XLAT_BLOCK_FOR_CODE(code)->flags & XLAT_BLOCK_FLAG_TRACE) &&
+        xlat_find_native_pc( code, native_pc ) ) {
+        return code;
+    }
+    return NULL;
+}
+
 void sh4_translate_exit_recover( )
 {
-    void *code = xlat_get_code_by_vma_cached( sh4r.pc );
+    void *pc;
+    void *code = xlat_get_running_code( sh4r.pc, &pc );
     if( code != NULL ) {
-        uint32_t size = xlat_get_code_size( code );
-        void *pc = xlat_get_native_pc( code, size );
-        if( pc != NULL ) {
-            // could be null if we're not actually running inside the translator
-            xlat_recovery_record_t recover = xlat_get_pre_recovery(code, pc);
-            if( recover != NULL ) {
-                // Can be null if there is no recovery necessary
-                sh4_translate_run_recovery(recover);
-            }
+        xlat_recovery_record_t recover = xlat_get_pre_recovery(code, pc);
+        if( recover != NULL ) {
+            // Can be null if there is no recovery necessary
+            sh4_translate_run_recovery(recover);
         }
     }
 }
 
 void sh4_translate_exception_exit_recover( )
 {
-    void *code = xlat_get_code_by_vma_cached( sh4r.spc );
+    void *pc;
+    void *code = xlat_get_running_code( sh4r.spc, &pc );
     if( code != NULL ) {
-        uint32_t size = xlat_get_code_size( code );
-        void *pc = xlat_get_native_pc( code, size );
-        if( pc != NULL ) {
-            // could be null if we're not actually running inside the translator
-            xlat_recovery_record_t recover = xlat_get_pre_recovery(code, pc);
-            if( recover != NULL ) {
-                // Can be null if there is no recovery necessary
-                sh4_translate_run_exception_recovery(recover);
-            }
+        xlat_recovery_record_t recover = xlat_get_pre_recovery(code, pc);
+        if( recover != NULL ) {
+            // Can be null if there is no recovery necessary
+            sh4_translate_run_exception_recovery(recover);
         }
     }
-    
 }
 
 void FASTCALL sh4_translate_breakpoint_hit(uint32_t pc)
@@ -19,9 +19,11 @@
 #ifndef lxdream_sh4trans_H
 #define lxdream_sh4trans_H 1
 
+#include <stdio.h>
 #include "xlat/xltcache.h"
 #include "dream.h"
 #include "mem.h"
+#include "sh4/sh4core.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -41,6 +43,16 @@ extern "C" {
  */
 #define MAX_RECOVERY_SIZE 2049
 
+/** Maximum number of relocation records for a translated block. Blocks with
+ * more than this are simply not relocatable.
+ */
+#define MAX_RELOC_SIZE 8192
+
+/** Minimum number of code bytes occupied by a single relocation site (ie
+ * an instruction with a pointer-sized immediate)
+ */
+#define MIN_RELOC_SPACING 10
+
 typedef void (*xlat_block_begin_callback_t)();
 typedef void (*xlat_block_end_callback_t)();
 
@@ -60,12 +72,172 @@ void sh4_translate_init( void);
  */
 void *sh4_translate_basic_block( sh4addr_t start );
 
+/**
+ * Find or create a translation of the block at start (which must be in the
+ * icache) in the current mode, for the dispatcher or the block linker, when
+ * it isn't in the translation cache.
+ * @return the translated code, or NULL if the block hasn't run often enough to
+ * be translated yet (see sh4_translate_set_tier_threshold) or is being
+ * translated in the background (see sh4_translate_set_async), in which case it
+ * should be interpreted for now.
+ */
+void *sh4_translate_request_block( sh4vma_t start );
+
 /**
  * Add a recovery record for the current code generation position, with the
  * specified instruction count
  */
 void sh4_translate_add_recovery( uint32_t icount );
 
+/**
+ * Add a relocation record for the absolute pointer (or block-link site, if
+ * is_link is true) at the given output position. Sites outside of the
+ * current block are ignored.
+ */
+void sh4_translate_add_reloc( uint8_t *site, gboolean is_link );
+
+/**
+ * Enable the persistent translation cache, loading any existing cache from
+ * the given file.
+ */
+void sh4_translate_init_persistent_cache( const char *filename );
+
+/**
+ * Write the current translations out to the persistent cache (if enabled)
+ */
+void sh4_translate_save_persistent_cache( void );
+
+/**
+ * Describe each new block to host profilers, labelled with its SH4 address
+ * and the containing symbol (if a symbol table has been loaded).
+ * @param perf_map TRUE to write a perf map to /tmp/perf-<pid>.map
+ * @param jitdump_dir directory for a jitdump file (with code), or NULL.
+ */
+void sh4_translate_init_perf( gboolean perf_map, const char *jitdump_dir );
+
+/**
+ * Close down the translator on exit, finishing off the profiler output
+ * (see sh4_translate_init_perf).
+ */
+void sh4_translate_shutdown( void );
+
+/**
+ * Enable/disable trace formation. When enabled, blocks count their executions
+ * and the hottest blocks are periodically retranslated as traces, which follow
+ * the most frequently taken direction of each branch into the next block
+ * (leaving side exits for the other direction), rather than returning to the
+ * dispatcher or a block link at every branch.
+ */
+void sh4_translate_set_traces( gboolean flag );
+
+/**
+ * @return TRUE if trace formation is enabled
+ */
+gboolean sh4_translate_get_traces( void );
+
+/**
+ * Called on entry to the given code block from the dispatcher (or when linking
+ * to it). If the block has been selected as the head of a hot path, translate
+ * a trace in its place.
+ * @param pc VMA of the block, which must be in the icache.
+ * @return the code to execute, ie either the trace or the original code.
+ */
+void *sh4_translate_check_trace( sh4vma_t pc, void *code );
+
+/** Maximum number of linear segments joined together in a single trace */
+#define MAX_TRACE_SEGMENTS 16
+
+/** Instruction limit for a trace (checked at segment boundaries, so the real
+ * limit is this plus a single page)
+ */
+#define MAX_TRACE_INSTRUCTIONS 512
+
+#define TRACE_BRANCH_NONE 0
+#define TRACE_BRANCH_TAKEN 1
+#define TRACE_BRANCH_NOT_TAKEN 2
+
+/**
+ * Called by the code generator at a direct branch, to determine the direction
+ * (if any) in which the trace currently being translated should continue.
+ * @param taken the branch target
+ * @param not_taken the fall-through address. For unconditional branches this
+ * should be the same as taken.
+ * @return TRACE_BRANCH_NONE if the block should end at the branch (including
+ * when not forming a trace), otherwise the direction to follow.
+ */
+int sh4_translate_trace_branch( sh4vma_t taken, sh4vma_t not_taken );
+
+/**
+ * @return the offset from the start of the current trace of the segment
+ * beginning at the given pc, or -1 if there is no such segment.
+ */
+int32_t sh4_translate_trace_find_segment( sh4vma_t pc );
+
+/**
+ * Called by the code generator to continue the current trace at pc rather
+ * than at the instruction following the current one. If new_segment is TRUE,
+ * the current segment ends at endpc, and a new one starts at pc at the current
+ * output position; otherwise endpc is ignored.
+ */
+void sh4_translate_trace_continue( sh4vma_t endpc, sh4vma_t pc, gboolean new_segment );
+
+/**
+ * Set the number of times a block is interpreted before it's translated (for
+ * tiered execution), or 0 to translate blocks the first time they're run. Code
+ * that only runs a handful of times (eg initialization) is then never
+ * translated, which leaves more of the translation cache for the code that
+ * matters. Executions are counted per block start address by the dispatcher.
+ */
+void sh4_translate_set_tier_threshold( uint32_t count );
+
+/**
+ * @return the current tier threshold (see sh4_translate_set_tier_threshold)
+ */
+uint32_t sh4_translate_get_tier_threshold( void );
+
+/**
+ * @return TRUE if the block at pc (which must be in the icache) is still being
+ * interpreted, ie hasn't yet reached the tier threshold. Doesn't count an
+ * execution.
+ */
+gboolean sh4_translate_is_cold( sh4vma_t pc );
+
+/**
+ * Print the tiered execution statistics
+ */
+void sh4_translate_print_tier_stats( FILE *out );
+
+/**
+ * Enable/disable background translation. When enabled, basic blocks that miss
+ * in the translation cache are queued for a worker thread, and executed by the
+ * interpreter until the translation is ready. Finished blocks are installed
+ * into the cache by the emulation thread (see sh4_translate_run_slice), after
+ * checking that their source code hasn't changed in the meantime. Traces, and
+ * blocks that can't be relocated (eg with breakpoints or instrumentation), are
+ * still translated immediately.
+ */
+void sh4_translate_set_async( gboolean flag );
+
+/**
+ * @return TRUE if background translation is enabled
+ */
+gboolean sh4_translate_get_async( void );
+
+/**
+ * Print the background translation statistics
+ */
+void sh4_translate_print_async_stats( FILE *out );
+
+/**
+ * Serialize access to the code generator (xlat_output and the translation
+ * state) and to the translation cache between the emulation thread and the
+ * background translator. Anything that emits code outside of a translation
+ * (eg TLB stubs) must hold the lock. The lock is recursive. Unlinking blocks
+ * doesn't emit code, and so doesn't need the lock.
+ */
+void sh4_translate_lock( void );
+void sh4_translate_unlock( void );
+
 /**
  * Enter the VM at the given translated entry point
  */
@@ -82,10 +254,41 @@ void sh4_shadow_init( void );
 void sh4_shadow_block_begin( void );
 void sh4_shadow_block_end( void );
 
+/**
+ * The translator's view of the code being translated, and of the CPU state it
+ * depends on, set up at the start of each translation. Background translations
+ * read their instructions from a copy of the source taken when the block was
+ * queued, so the code generator must use these rather than sh4_icache and sh4r.
+ */
+struct xlat_source {
+    struct sh4_icache_struct icache; /* Icache entry containing the block */
+    sh4ptr_t fetch;        /* Instruction words from fetch_vma to fetch_end */
+    sh4vma_t fetch_vma;
+    sh4vma_t fetch_end;
+    uint32_t sh4_mode;     /* sh4r.xlat_sh4_mode */
+    uint32_t fpscr;
+    gboolean tlb_on;
+    gboolean breakpoints;  /* TRUE if there may be breakpoints in the block */
+    gboolean background;   /* TRUE when translating on the worker thread */
+};
+extern struct xlat_source xlat_source;
+
+/* Equivalents of the IS_IN_ICACHE() etc macros for the source being translated */
+#define XLAT_IN_ICACHE(addr) (xlat_source.icache.page_vma == ((addr) & xlat_source.icache.mask))
+#define XLAT_ICACHE_PTR(addr) (xlat_source.icache.page + ((addr)-xlat_source.icache.page_vma))
+#define XLAT_ICACHE_PHYS(addr) (xlat_source.icache.page_ppa + ((addr)-xlat_source.icache.page_vma))
+#define XLAT_ICACHE_END() (xlat_source.icache.page_vma + (~xlat_source.icache.mask) + 1)
+/** Test if the instruction at addr is available to the translator */
+#define XLAT_CAN_FETCH(addr) ((addr) >= xlat_source.fetch_vma && (addr) < xlat_source.fetch_end)
+#define XLAT_FETCH(addr) (*(uint16_t *)(xlat_source.fetch + ((addr)-xlat_source.fetch_vma)))
+
 extern uint8_t *xlat_output;
 extern struct xlat_recovery_record xlat_recovery[MAX_RECOVERY_SIZE];
 extern xlat_cache_block_t xlat_current_block;
 extern uint32_t xlat_recovery_posn;
+/* Most recently entered trace (written by the trace itself), used to find the
+ * running code when recovering from inside a later segment of the trace */
+extern void *xlat_active_trace;
 
 /******************************************************************************
  * Code generation - these methods must be provided by the
@@ -101,6 +304,17 @@ uint32_t sh4_translate_end_block_size();
 void sh4_translate_emit_breakpoint( sh4vma_t pc );
 void sh4_translate_crashdump();
 
+/** Variant returned when the current translator configuration produces
+ * blocks that cannot be persisted (eg shadow-mode instrumentation).
+ */
+#define XLAT_VARIANT_NONE 0xFFFFFFFF
+
+/**
+ * Return a code identifying the translator configuration that affects the
+ * generated code (beyond the SH4 mode), or XLAT_VARIANT_NONE.
+ */
+uint32_t sh4_translate_get_variant( void );
+
 typedef void (*unwind_thunk_t)(void);
 
 /**
@@ -113,6 +327,43 @@ void sh4_translate_set_callbacks( xlat_block_begin_callback_t begin, xlat_block_
  */
 void sh4_translate_set_fastmem( gboolean flag );
 
+/**
+ * Enable/disable caching of the most used SH4 registers in host registers
+ * within each translated block (enabled by default)
+ */
+void sh4_translate_set_reg_cache( gboolean flag );
+
+/**
+ * Enable/disable the IR passes (constant propagation, dead T and dead store
+ * elimination - see sh4ir.h) in the translator (enabled by default)
+ */
+void sh4_translate_set_ir( gboolean flag );
+
+/**
+ * Enable/disable fast-forwarding idle loops (eg polling a status register)
+ * to the next event (enabled by default, requires the IR)
+ */
+void sh4_translate_set_idle_skip( gboolean flag );
+
+/**
+ * Print the number of idle loop skips, and the total emulated time skipped
+ */
+void sh4_translate_print_idle_stats( FILE *out );
+
+/**
+ * Enable translating privileged, non-TLB loads and stores to direct accesses
+ * through a host mapping of the SH4 address space (see sdram_init_window).
+ * Accesses that turn out not to be to main RAM fault, and the faulting site
+ * is then patched to go through the normal memory functions.
+ * @return FALSE if this isn't supported by the host.
+ */
+gboolean sh4_translate_set_mem_window( gboolean flag );
+
+/**
+ * Print the number of direct memory access sites translated and patched
+ */
+void sh4_translate_print_mem_window_stats( FILE *out );
+
 /**
  * Set the address spaces for the translated code.
  */
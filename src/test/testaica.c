@@ -0,0 +1,192 @@
+/**
+ * $Id$
+ *
+ * Checks that running the AICA on its own thread (see aica_set_max_lag)
+ * gives exactly the same results as running it in lockstep with the SH4: the
+ * ARM runs a program that folds values written by the "SH4" into wave RAM,
+ * while the SH4 side reads back the ARM's output between slices. Also checks
+ * that an ARM halt on the AICA thread stops the emulator from the SH4 thread.
+ * The ARM translator is stubbed out (as disabled), so this runs the
+ * interpreter.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dreamcast.h"
+#include "mem.h"
+#include "aica/aica.h"
+#include "aica/armcore.h"
+#include "aica/armxlat.h"
+#include "aica/audio.h"
+
+#define TEST_SLICES 2000
+#define TEST_SLICE_NANOS 1000000
+#define TEST_OUTPUT 0x1000
+#define TEST_OUTPUT_SIZE 0x400
+#define TEST_INPUT 0x1800
+
+extern unsigned char aica_main_ram[];
+extern struct mem_region_fn mem_region_audioram;
+uint32_t aica_run_slice( uint32_t nanosecs );
+
+static int stop_count = 0;
+static pthread_t main_thread;
+
+/**
+ * r2 = (r2*3) ^ input ^ r0, stored at TEST_OUTPUT[r0], with r0 counting
+ * through 256 words.
+ */
+static const uint32_t test_prog[] = {
+        0xE3A00000,   /* 00: mov r0, #0 */
+        0xE3A01A01,   /* 04: mov r1, #0x1000 */
+        0xE3A02001,   /* 08: mov r2, #1 */
+        0xE0822082,   /* 0C: add r2, r2, r2, lsl #1 */
+        0xE5913800,   /* 10: ldr r3, [r1, #0x800] */
+        0xE0222003,   /* 14: eor r2, r2, r3 */
+        0xE0222000,   /* 18: eor r2, r2, r0 */
+        0xE7812100,   /* 1C: str r2, [r1, r0, lsl #2] */
+        0xE2800001,   /* 20: add r0, r0, #1 */
+        0xE20000FF,   /* 24: and r0, r0, #0xFF */
+        0xEAFFFFF7 }; /* 28: b 0C */
+
+struct test_result {
+    uint32_t sh4_checksum;
+    struct arm_registers armr;
+    unsigned char output[TEST_OUTPUT_SIZE];
+};
+
+void log_message( void *ptr, int level, const gchar *source, const char *msg, ... ) { }
+void FASTCALL unmapped_prefetch( sh4addr_t addr ) { }
+void asic_g2_write_word() { }
+gboolean dreamcast_is_running( void ) { return TRUE; }
+
+/* Stopping the emulator longjmps out of the SH4 core, so it may only be done
+ * from the SH4 (ie main) thread */
+void dreamcast_stop( void )
+{
+    assert( pthread_equal( pthread_self(), main_thread ) );
+    stop_count++;
+}
+
+void register_io_region( struct mmio_region *io )
+{
+    int i;
+    io->mem = calloc( 2, LXDREAM_PAGE_SIZE );
+    io->save_mem = io->mem + LXDREAM_PAGE_SIZE;
+    io->index = calloc( 1024, sizeof(struct mmio_port *) );
+    for( i=0; io->ports[i].id != NULL; i++ ) {
+        io->ports[i].val = (uint32_t *)(io->mem + io->ports[i].offset);
+        *io->ports[i].val = io->ports[i].def_val;
+        io->index[io->ports[i].offset>>2] = &io->ports[i];
+    }
+}
+
+void register_io_regions( struct mmio_region **io )
+{
+    while( *io ) register_io_region( *io++ );
+}
+
+#ifdef ARM_TRANSLATOR
+void **arm_xlat_lut[ARM_XLAT_PAGES];
+void arm_xlat_enable( gboolean enable, gboolean checking ) { }
+gboolean arm_xlat_is_enabled( void ) { return FALSE; }
+int arm_xlat_execute_block( void ) { return 0; }
+void arm_xlat_flush( void ) { }
+void arm_xlat_invalidate_range( uint32_t addr, uint32_t length ) { }
+#endif
+
+static void run_program( uint32_t lag, struct test_result *result )
+{
+    int i;
+
+    aica_set_max_lag( lag );
+    assert( aica_get_max_lag() == lag );
+    memset( aica_main_ram, 0, 2 MB );
+    memcpy( aica_main_ram, test_prog, sizeof(test_prog) );
+    aica_reset();
+    MMIO_WRITE( AICA2, AICA_RESET, 1 );
+    aica_enable();
+
+    result->sh4_checksum = 0;
+    for( i=0; i<TEST_SLICES; i++ ) {
+        aica_run_slice( TEST_SLICE_NANOS );
+        if( (i % 7) == 0 ) {
+            uint32_t addr = 0x00800000 + TEST_OUTPUT + ((i*13) & 0xFF)*4;
+            result->sh4_checksum = result->sh4_checksum * 31 + mem_region_audioram.read_long( addr );
+            mem_region_audioram.write_long( 0x00800000 + TEST_INPUT, i * 0x9E3779B9 );
+        }
+    }
+    aica_sync();
+    memcpy( &result->armr, &armr, sizeof(armr) );
+    memcpy( result->output, aica_main_ram + TEST_OUTPUT, TEST_OUTPUT_SIZE );
+}
+
+static void compare_results( const char *mode, struct test_result *lockstep, struct test_result *threaded )
+{
+    if( lockstep->sh4_checksum != threaded->sh4_checksum ||
+        memcmp( &lockstep->armr, &threaded->armr, sizeof(struct arm_registers) ) != 0 ||
+        memcmp( lockstep->output, threaded->output, TEST_OUTPUT_SIZE ) != 0 ) {
+        fprintf( stderr, "AICA %s run differs from lockstep (checksum %08X vs %08X, PC %08X vs %08X)\n",
+                 mode, lockstep->sh4_checksum, threaded->sh4_checksum,
+                 lockstep->armr.r[15], threaded->armr.r[15] );
+        exit( 1 );
+    }
+}
+
+int main()
+{
+    static struct test_result lockstep, threaded, short_lag;
+
+    main_thread = pthread_self();
+    aica_init();
+    audio_set_driver( NULL );
+
+    run_program( 0, &lockstep );
+    /* Make sure the program actually ran, and saw the SH4's writes */
+    assert( lockstep.armr.icount > TEST_SLICES );
+    assert( lockstep.sh4_checksum != 0 );
+    assert( *(uint32_t *)(aica_main_ram + TEST_INPUT) != 0 );
+
+    run_program( 50000000, &threaded );
+    compare_results( "threaded", &lockstep, &threaded );
+    run_program( TEST_SLICE_NANOS/2, &short_lag );
+    compare_results( "threaded (short lag)", &lockstep, &short_lag );
+
+    /* And back to lockstep */
+    run_program( 0, &threaded );
+    compare_results( "lockstep", &lockstep, &threaded );
+    assert( stop_count == 0 );
+
+    /* An unimplemented instruction (UMULL) on the AICA thread stops the
+     * emulator from the SH4 thread */
+    static const uint32_t unimp_prog[] = { 0xE3A00000, 0xE0810392, 0xEAFFFFFE };
+    aica_set_max_lag( 50000000 );
+    memset( aica_main_ram, 0, 2 MB );
+    memcpy( aica_main_ram, unimp_prog, sizeof(unimp_prog) );
+    MMIO_WRITE( AICA2, AICA_RESET, 1 );
+    aica_enable();
+    aica_run_slice( TEST_SLICE_NANOS );
+    aica_sync();
+    aica_run_slice( TEST_SLICE_NANOS );
+    assert( stop_count != 0 );
+    assert( armr.r[15] == 4 );
+    aica_set_max_lag( 0 );
+
+    printf( "AICA lockstep/threaded: OK\n" );
+    return 0;
+}
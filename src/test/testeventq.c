@@ -0,0 +1,317 @@
+/**
+ * $Id$
+ *
+ * Event queue tests: ordering, cancellation, long-duration events and save
+ * state compatibility with the original linked-list queue. With
+ * -b [slices [events]], also benchmarks a schedule/cancel/execute churn
+ * similar to a running system.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "eventq.h"
+#include "sh4/sh4.h"
+
+#define SLICE_NANOS 1000000
+#define MAX_FIRED 1024
+#define CHURN_EVENTS 24
+
+struct sh4_registers sh4r;
+
+uint32_t event_run_slice( uint32_t nanosecs );
+void event_save_state( FILE *f );
+int event_load_state( FILE *f );
+
+static uint64_t current_time; /* Time at the start of the slice */
+static int fired_ids[MAX_FIRED];
+static uint64_t fired_times[MAX_FIRED];
+static int fired_count;
+
+void sh4_set_event_pending( uint32_t cycles )
+{
+    sh4r.event_pending = cycles;
+}
+
+void asic_event( int eventid )
+{
+}
+
+static void record_event( int eventid )
+{
+    assert( fired_count < MAX_FIRED );
+    fired_ids[fired_count] = eventid;
+    fired_times[fired_count++] = current_time + sh4r.slice_cycle;
+}
+
+/**
+ * Run a slice the same way the SH4 core does, stepping the clock forward to
+ * each pending event.
+ */
+static void run_slice( uint32_t nanosecs )
+{
+    sh4r.slice_cycle = 0;
+    while( sh4r.event_pending < nanosecs ) {
+        sh4r.slice_cycle = sh4r.event_pending;
+        event_execute();
+    }
+    sh4r.slice_cycle = nanosecs;
+    event_run_slice( nanosecs );
+    current_time += nanosecs;
+    sh4r.slice_cycle = 0;
+}
+
+static void reset_queue()
+{
+    int i;
+    event_init();
+    for( i=0; i<MAX_EVENT_ID; i++ ) {
+        register_event_callback( i, record_event );
+    }
+    memset( &sh4r, 0, sizeof(sh4r) );
+    sh4r.event_pending = NOT_SCHEDULED;
+    current_time = 0;
+    fired_count = 0;
+}
+
+static void test_ordering()
+{
+    reset_queue();
+    event_schedule( 5, 300 );
+    event_schedule( 3, 100 );
+    event_schedule( 9, 200 );
+    event_schedule( 7, 200 ); /* Same time as 9 - must run after it */
+    event_schedule( 8, 50 );
+    event_cancel( 8 );
+    event_schedule( 3, 400 ); /* Reschedule replaces the earlier time */
+    assert( event_get_next_time() == 200 );
+    run_slice( SLICE_NANOS );
+    assert( fired_count == 4 );
+    assert( fired_ids[0] == 9 && fired_times[0] == 200 );
+    assert( fired_ids[1] == 7 && fired_times[1] == 200 );
+    assert( fired_ids[2] == 5 && fired_times[2] == 300 );
+    assert( fired_ids[3] == 3 && fired_times[3] == 400 );
+    assert( event_get_next_time() == NOT_SCHEDULED );
+}
+
+static void test_cross_slice()
+{
+    reset_queue();
+    event_schedule( 1, SLICE_NANOS*2 + 10 );
+    event_schedule_long( 2, 3, 500 );
+    event_schedule_long( 4, 0, 20 );
+    run_slice( SLICE_NANOS );
+    assert( fired_count == 1 && fired_ids[0] == 4 && fired_times[0] == 20 );
+    assert( event_get_next_time() == SLICE_NANOS + 10 );
+    while( current_time < 4000000000ULL ) {
+        run_slice( SLICE_NANOS );
+    }
+    assert( fired_count == 3 );
+    assert( fired_ids[1] == 1 && fired_times[1] == SLICE_NANOS*2 + 10 );
+    assert( fired_ids[2] == 2 && fired_times[2] == 3000000500ULL );
+}
+
+/**
+ * Reschedule and cancel events many times without them firing, behind some
+ * (later) background events.
+ */
+static void test_reschedule()
+{
+    int i;
+    reset_queue();
+    for( i=0; i<40; i++ ) {
+        event_schedule( 64+i, SLICE_NANOS + 500 );
+    }
+    for( i=0; i<100000; i++ ) {
+        event_schedule( i % 7, 1000 + (i % 13) );
+        if( (i % 5) == 0 ) {
+            event_cancel( (i+3) % 7 );
+        }
+    }
+    run_slice( SLICE_NANOS );
+    for( i=1; i<fired_count; i++ ) {
+        assert( fired_times[i-1] <= fired_times[i] );
+    }
+    assert( event_get_next_time() == 500 );
+    run_slice( SLICE_NANOS );
+    assert( event_get_next_time() == NOT_SCHEDULED );
+}
+
+/**
+ * Grow the queue to many events and shrink it again, checking that events
+ * still run in time and scheduling order throughout.
+ */
+static void test_grow_shrink()
+{
+    int i, round;
+    reset_queue();
+    for( round=0; round<3; round++ ) {
+        int count = round == 1 ? 8 : 100;
+        for( i=0; i<count; i++ ) {
+            event_schedule( i, 100 + (i*37 % 50) );
+        }
+        for( i=0; i<count; i+=3 ) {
+            event_cancel( i );
+        }
+        for( i=0; i<count; i+=9 ) {
+            event_schedule( i, 60 );
+        }
+        fired_count = 0;
+        run_slice( SLICE_NANOS );
+        assert( event_get_next_time() == NOT_SCHEDULED );
+        int expect = 0;
+        for( i=0; i<count; i++ ) {
+            expect += (i % 9) == 0 || (i % 3) != 0;
+        }
+        assert( fired_count == expect );
+        for( i=1; i<fired_count; i++ ) {
+            assert( fired_times[i-1] < fired_times[i] ||
+                    (fired_times[i-1] == fired_times[i] && fired_ids[i-1] < fired_ids[i]) );
+        }
+    }
+}
+
+static void test_save_load()
+{
+    FILE *f = tmpfile();
+    int i;
+
+    reset_queue();
+    event_schedule( 10, SLICE_NANOS );
+    event_schedule( 11, SLICE_NANOS );
+    event_schedule( 12, 1500000000 ); /* Beyond the first long-queue scan */
+    event_schedule_long( 13, 2, 250 );
+    run_slice( SLICE_NANOS/2 );
+    event_save_state( f );
+
+    reset_queue();
+    current_time = SLICE_NANOS/2;
+    rewind( f );
+    event_load_state( f );
+    fclose( f );
+    while( current_time < 3000000000ULL ) {
+        run_slice( SLICE_NANOS );
+    }
+    assert( fired_count == 4 );
+    assert( fired_ids[0] == 10 && fired_times[0] == SLICE_NANOS );
+    assert( fired_ids[1] == 11 && fired_times[1] == SLICE_NANOS );
+    assert( fired_ids[2] == 12 && fired_times[2] == 1500000000 );
+    assert( fired_ids[3] == 13 && fired_times[3] == 2000000250 );
+
+    /* A state written by the linked-list queue: short queue 20 -> 21, long
+     * queue 22 (due at the second scan, 400ms from now, plus 7ns) */
+    f = tmpfile();
+    int32_t id = 20;
+    fwrite( &id, sizeof(id), 1, f );
+    id = 22;
+    fwrite( &id, sizeof(id), 1, f );
+    int remaining = 400000000;
+    fwrite( &remaining, sizeof(remaining), 1, f );
+    for( i=0; i<MAX_EVENT_ID; i++ ) {
+        uint32_t words[3] = { i, 0, NOT_SCHEDULED };
+        int32_t next = -1;
+        if( i == 20 ) {
+            words[2] = 900;
+            next = 21;
+        } else if( i == 21 ) {
+            words[2] = 900;
+        } else if( i == 22 ) {
+            words[1] = 2;
+            words[2] = 7;
+        }
+        fwrite( words, sizeof(uint32_t), 3, f );
+        fwrite( &next, sizeof(next), 1, f );
+    }
+    reset_queue();
+    rewind( f );
+    event_load_state( f );
+    fclose( f );
+    while( current_time < 2000000000ULL ) {
+        run_slice( SLICE_NANOS );
+    }
+    assert( fired_count == 3 );
+    assert( fired_ids[0] == 20 && fired_times[0] == 900 );
+    assert( fired_ids[1] == 21 && fired_times[1] == 900 );
+    assert( fired_ids[2] == 22 && fired_times[2] == 1400000007 );
+}
+
+static int churn_events = CHURN_EVENTS;
+static uint32_t churn_random_state = 1;
+
+/* xorshift - cheap enough not to swamp the queue operations */
+static uint32_t churn_random()
+{
+    churn_random_state ^= churn_random_state << 13;
+    churn_random_state ^= churn_random_state >> 17;
+    churn_random_state ^= churn_random_state << 5;
+    return churn_random_state;
+}
+
+/**
+ * Each event reschedules itself, and a quarter of the time also cancels and
+ * reschedules another (as eg a register write restarting a timer would).
+ */
+static void churn_event( int eventid )
+{
+    uint32_t r = churn_random();
+    event_schedule( eventid, 1000 + (r % 200000) );
+    if( (r >> 30) == 0 ) {
+        int other = (r >> 18) % churn_events;
+        event_cancel( other );
+        event_schedule( other, 1000 + ((r >> 8) % 400000) );
+    }
+}
+
+static void benchmark_churn( int slices, int nevents )
+{
+    struct timespec start, end;
+    int i;
+
+    churn_events = nevents;
+    reset_queue();
+    for( i=0; i<churn_events; i++ ) {
+        register_event_callback( i, churn_event );
+        event_schedule( i, churn_random() % SLICE_NANOS );
+    }
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for( i=0; i<slices; i++ ) {
+        run_slice( SLICE_NANOS );
+    }
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1000000000.0;
+    printf( "Event churn: %d slices of %d events in %.3fs (%.1f emulated seconds/s)\n",
+            slices, churn_events, secs, slices * (SLICE_NANOS/1000000000.0) / secs );
+}
+
+int main( int argc, char *argv[] )
+{
+    test_ordering();
+    test_cross_slice();
+    test_reschedule();
+    test_grow_shrink();
+    test_save_load();
+
+    if( argc > 1 && strcmp(argv[1], "-b") == 0 ) {
+        int slices = argc > 2 ? atoi(argv[2]) : 20000;
+        int nevents = argc > 3 ? atoi(argv[3]) : CHURN_EVENTS;
+        if( nevents < 1 || nevents > MAX_EVENT_ID ) {
+            nevents = CHURN_EVENTS;
+        }
+        benchmark_churn( slices, nevents );
+    }
+    return 0;
+}
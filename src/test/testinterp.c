@@ -0,0 +1,271 @@
+/**
+ * $Id$
+ *
+ * Compare the threaded-code SH4 interpreter against the plain (switch)
+ * interpreter: both must leave the CPU in exactly the same state after
+ * running the same program, including code that modifies itself. With -b,
+ * also report the speed of each.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <sys/time.h>
+
+#include "dream.h"
+#include "mem.h"
+#include "mmio.h"
+#include "sh4/sh4core.h"
+#include "sh4/mmu.h"
+#include "xlat/xltcache.h"
+
+#define RAM_BASE 0x0C000000
+#define RAM_SIZE (64*1024)
+#define CODE_ADDR 0x8C001000
+#define DATA_ADDR 0x8C008000
+#define EVENT_PERIOD 10007
+
+struct dreamcast_module sh4_module;
+struct mmio_region mmio_region_CPG;
+struct sh4_registers sh4r;
+struct sh4_icache_struct sh4_icache = { NULL, -1, -1, 0 };
+struct breakpoint_struct sh4_breakpoints[MAX_BREAKPOINTS];
+int sh4_breakpoint_count = 0;
+uint32_t sh4_cpu_period = 5;
+mem_region_fn_t *ext_address_space; /* For sh4stat.c */
+static mem_region_fn_t ram_address_space[0x20000];
+
+static unsigned char ram[RAM_SIZE];
+static char cpg_regs[4096];
+static uint32_t events;
+
+/* Stubs */
+void log_message( void *ptr, int level, const char *source, const char *msg, ... )
+{
+    va_list ap;
+    va_start( ap, msg );
+    vfprintf( stderr, msg, ap );
+    fprintf( stderr, "\n" );
+    va_end( ap );
+}
+void sh4_core_exit( int exit_code ) { fprintf( stderr, "Unexpected core exit %d\n", exit_code ); abort(); }
+void FASTCALL sh4_raise_exception( int exc ) { fprintf( stderr, "Unexpected exception %03X at %08X\n", exc, sh4r.pc ); abort(); }
+void FASTCALL sh4_raise_trap( int trap ) { fprintf( stderr, "Unexpected trap %d\n", trap ); abort(); }
+void syscall_invoke( uint32_t addr ) { }
+void MMU_ldtlb() { }
+void TMU_run_slice( uint32_t nanos ) { }
+void SCIF_run_slice( uint32_t nanos ) { }
+uint32_t FASTCALL sh4_read_sr( void ) { return sh4r.sr; }
+void FASTCALL sh4_write_sr( uint32_t val ) { sh4r.sr = val; }
+void FASTCALL sh4_write_fpscr( uint32_t val ) { sh4r.fpscr = val; }
+void FASTCALL sh4_switch_fr_banks( void ) { }
+sh4addr_t FASTCALL mmu_vma_to_phys_disasm( sh4vma_t vma ) { return vma & 0x1FFFFFFF; }
+void sh4_handle_pending_events( void )
+{
+    events++;
+    sh4r.event_pending = sh4r.slice_cycle + EVENT_PERIOD;
+}
+
+/* Flat RAM, which reports writes to the translation cache like main RAM */
+static int32_t FASTCALL ram_read_long( sh4addr_t addr ) { return *(int32_t *)(ram + (addr & (RAM_SIZE-1))); }
+static int32_t FASTCALL ram_read_word( sh4addr_t addr ) { return *(int16_t *)(ram + (addr & (RAM_SIZE-1))); }
+static int32_t FASTCALL ram_read_byte( sh4addr_t addr ) { return *(int8_t *)(ram + (addr & (RAM_SIZE-1))); }
+static void FASTCALL ram_write_long( sh4addr_t addr, uint32_t val )
+{
+    *(uint32_t *)(ram + (addr & (RAM_SIZE-1))) = val;
+    xlat_invalidate_long( addr );
+}
+static void FASTCALL ram_write_word( sh4addr_t addr, uint32_t val )
+{
+    *(uint16_t *)(ram + (addr & (RAM_SIZE-1))) = (uint16_t)val;
+    xlat_invalidate_word( addr );
+}
+static void FASTCALL ram_write_byte( sh4addr_t addr, uint32_t val )
+{
+    *(uint8_t *)(ram + (addr & (RAM_SIZE-1))) = (uint8_t)val;
+    xlat_invalidate_word( addr );
+}
+static void FASTCALL ram_prefetch( sh4addr_t addr ) { }
+
+static struct mem_region_fn ram_region = {
+        ram_read_long, ram_write_long, ram_read_word, ram_write_word,
+        ram_read_byte, ram_write_byte, NULL, NULL, ram_prefetch, ram_read_byte };
+
+mem_region_fn_t FASTCALL mmu_get_region_for_vma_read( sh4vma_t *addr )
+{
+    *addr &= 0x1FFFFFFF;
+    return &ram_region;
+}
+mem_region_fn_t FASTCALL mmu_get_region_for_vma_write( sh4vma_t *addr )
+{
+    *addr &= 0x1FFFFFFF;
+    return &ram_region;
+}
+mem_region_fn_t FASTCALL mmu_get_region_for_vma_prefetch( sh4vma_t *addr )
+{
+    *addr &= 0x1FFFFFFF;
+    return &ram_region;
+}
+gboolean FASTCALL mmu_update_icache( sh4vma_t addr )
+{
+    sh4_icache.mask = ~(RAM_SIZE-1);
+    sh4_icache.page_vma = addr & sh4_icache.mask;
+    sh4_icache.page_ppa = RAM_BASE;
+    sh4_icache.page = ram;
+    return TRUE;
+}
+
+/* Opcodes */
+#define MOVL_PC(d,n) (0xD000|((n)<<8)|(d))
+#define MOVI(i,n)    (0xE000|((n)<<8)|((i)&0xFF))
+#define MOV(m,n)     (0x6003|((n)<<8)|((m)<<4))
+#define MOVL_LD(m,n) (0x6002|((n)<<8)|((m)<<4))
+#define MOVL_ST(m,n) (0x2002|((n)<<8)|((m)<<4))
+#define MOVW_ST(m,n) (0x2001|((n)<<8)|((m)<<4))
+#define ADD(m,n)     (0x300C|((n)<<8)|((m)<<4))
+#define ADDI(i,n)    (0x7000|((n)<<8)|((i)&0xFF))
+#define XOR(m,n)     (0x200A|((n)<<8)|((m)<<4))
+#define SHLR(n)      (0x4001|((n)<<8))
+#define DT(n)        (0x4010|((n)<<8))
+#define BF(d)        (0x8B00|((d)&0xFF))
+#define BRA(d)       (0xA000|((d)&0xFFF))
+#define BSR(d)       (0xB000|((d)&0xFFF))
+#define RTS          0x000B
+#define NOP          0x0009
+#define SLEEP        0x001B
+
+/**
+ * Load the test program: a loop that reads and writes memory, calls a
+ * subroutine, and rewrites one of its own instructions every iteration
+ * (alternating between adding 5 and 1 to r7).
+ */
+static void load_program( uint32_t iterations )
+{
+    static const uint16_t code[] = {
+        MOVL_PC(4,1),       /* 00: r1 = DATA_ADDR */
+        MOVL_PC(5,2),       /* 02: r2 = iterations */
+        MOVL_PC(5,9),       /* 04: r9 = patch address */
+        MOVL_PC(6,8),       /* 06: r8 = patch opcode */
+        MOVL_PC(6,10),      /* 08: r10 = patch toggle */
+        MOVI(0,3),          /* 0A */
+        MOVI(0,4),          /* 0C */
+        MOVI(0,7),          /* 0E */
+        BRA(0x0C),          /* 10: to loop */
+        NOP,                /* 12 */
+        DATA_ADDR & 0xFFFF, DATA_ADDR >> 16, /* 14 */
+        0, 0,               /* 18: iterations */
+        (CODE_ADDR+0x46) & 0xFFFF, (CODE_ADDR+0x46) >> 16, /* 1C */
+        ADDI(1,7), 0,       /* 20 */
+        ADDI(1,7)^ADDI(5,7), 0, /* 24 */
+        NOP,                /* 28 */
+        NOP,                /* 2A */
+        MOVL_LD(1,5),       /* 2C: loop */
+        ADD(5,3),           /* 2E */
+        ADDI(1,5),          /* 30 */
+        MOVL_ST(5,1),       /* 32 */
+        XOR(3,4),           /* 34 */
+        MOV(3,6),           /* 36 */
+        SHLR(6),            /* 38 */
+        ADD(6,4),           /* 3A */
+        BSR(0x08),          /* 3C: call 50 */
+        NOP,                /* 3E */
+        XOR(10,8),          /* 40 */
+        MOVW_ST(8,9),       /* 42: rewrite the patch below */
+        NOP,                /* 44 */
+        ADDI(1,7),          /* 46: patch */
+        DT(2),              /* 48 */
+        BF(-17),            /* 4A: loop */
+        SLEEP,              /* 4C */
+        NOP,                /* 4E */
+        ADDI(3,3),          /* 50: subroutine */
+        RTS,                /* 52 */
+        ADD(3,4)            /* 54 */
+    };
+    memset( ram, 0, sizeof(ram) );
+    memcpy( ram + (CODE_ADDR & (RAM_SIZE-1)), code, sizeof(code) );
+    *(uint32_t *)(ram + ((CODE_ADDR+0x18) & (RAM_SIZE-1))) = iterations;
+}
+
+static double run_program( gboolean threaded, uint32_t iterations, struct sh4_registers *result )
+{
+    struct timeval start, end;
+
+    load_program( iterations );
+    sh4_set_threaded_interpreter( threaded );
+    sh4_predecode_flush();
+    memset( &sh4r, 0, sizeof(sh4r) );
+    sh4r.pc = CODE_ADDR;
+    sh4r.new_pc = CODE_ADDR + 2;
+    sh4r.sr = SR_MD;
+    sh4r.sh4_state = SH4_STATE_RUNNING;
+    sh4r.event_pending = EVENT_PERIOD;
+    sh4_icache.page_vma = -1;
+    events = 0;
+
+    gettimeofday( &start, NULL );
+    while( sh4r.sh4_state == SH4_STATE_RUNNING ) {
+        sh4r.slice_cycle = 0;
+        sh4r.event_pending = EVENT_PERIOD;
+        sh4_emulate_run_slice( 1000000 );
+    }
+    gettimeofday( &end, NULL );
+    memcpy( result, &sh4r, sizeof(sh4r) );
+    return (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec)/1000000.0;
+}
+
+int main( int argc, char *argv[] )
+{
+    struct sh4_registers plain, threaded;
+    uint32_t plain_events, threaded_events;
+    uint32_t plain_data, iterations = 1000;
+    double plain_time, threaded_time;
+    gboolean bench = FALSE;
+    int i;
+
+    if( argc > 1 && strcmp(argv[1], "-b") == 0 ) {
+        bench = TRUE;
+        iterations = argc > 2 ? strtoul(argv[2], NULL, 0) : 2000000;
+    }
+    mmio_region_CPG.mem = cpg_regs;
+    for( i=0; i<0x20000; i++ ) {
+        ram_address_space[i] = &ram_region;
+    }
+    ext_address_space = ram_address_space;
+
+    plain_time = run_program( FALSE, iterations, &plain );
+    plain_events = events;
+    plain_data = *(uint32_t *)(ram + (DATA_ADDR & (RAM_SIZE-1)));
+    threaded_time = run_program( TRUE, iterations, &threaded );
+    threaded_events = events;
+
+    assert( plain.r[2] == 0 && plain.r[5] == iterations && plain.sh4_state == SH4_STATE_SLEEP );
+    /* The patched instruction alternates between adding 5 and 1 */
+    assert( plain.r[7] == (iterations/2)*6 + (iterations&1)*5 );
+    assert( memcmp( plain.r, threaded.r, sizeof(plain.r) ) == 0 );
+    assert( plain.pc == threaded.pc && plain.new_pc == threaded.new_pc );
+    assert( plain.pr == threaded.pr && plain.t == threaded.t );
+    assert( plain.slice_cycle == threaded.slice_cycle );
+    assert( plain_events == threaded_events );
+    assert( plain_data == *(uint32_t *)(ram + (DATA_ADDR & (RAM_SIZE-1))) );
+
+    if( bench ) {
+        double instructions = (double)iterations * 19;
+        printf( "Plain interpreter:    %.3fs (%.1f MIPS)\n", plain_time, instructions / plain_time / 1000000 );
+        printf( "Threaded interpreter: %.3fs (%.1f MIPS)\n", threaded_time, instructions / threaded_time / 1000000 );
+    }
+    return 0;
+}
@@ -0,0 +1,224 @@
+/**
+ * $Id$
+ *
+ * UTLB lookup index tests. Checks the hashed lookup against a straight
+ * linear scan of the UTLB, and with -b, benchmarks the two against each
+ * other.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mem.h"
+#include "sh4/mmu.h"
+
+#define LOOKUP_COUNT 4096
+
+static struct utlb_entry utlb[UTLB_ENTRY_COUNT];
+static struct utlb_hash hash;
+static sh4vma_t lookups[LOOKUP_COUNT];
+
+/**
+ * Reference lookup - this is the linear scan that the index replaces.
+ */
+static int utlb_linear_lookup( sh4vma_t vpn, uint32_t asid, gboolean match_asid )
+{
+    int result = -1;
+    unsigned int i;
+
+    for( i = 0; i < UTLB_ENTRY_COUNT; i++ ) {
+        if( (utlb[i].flags & TLB_VALID) &&
+                (!match_asid || (utlb[i].flags & TLB_SHARE) || asid == utlb[i].asid) &&
+                ((utlb[i].vpn ^ vpn) & utlb[i].mask) == 0 ) {
+            if( result != -1 ) {
+                return -2;
+            }
+            result = i;
+        }
+    }
+    return result;
+}
+
+static uint32_t random_size( int large )
+{
+    static const uint32_t sizes[4] = { TLB_SIZE_1K, TLB_SIZE_4K, TLB_SIZE_64K, TLB_SIZE_1M };
+    int r = rand() % 100;
+    if( r < large ) {
+        return sizes[2 + (r&1)];
+    } else {
+        return sizes[r&1];
+    }
+}
+
+static uint32_t size_mask( uint32_t flags )
+{
+    switch( flags & TLB_SIZE_MASK ) {
+    case TLB_SIZE_1K: return MASK_1K;
+    case TLB_SIZE_4K: return MASK_4K;
+    case TLB_SIZE_64K: return MASK_64K;
+    default: return MASK_1M;
+    }
+}
+
+/**
+ * Equivalent of LDTLB into the given entry: remove the old entry from the
+ * index if present, then load a random new one. Addresses are confined to a
+ * small region so that overlaps (and so multi-hits) actually occur.
+ */
+static void load_entry( int entry, int large )
+{
+    struct utlb_entry *ent = &utlb[entry];
+    if( ent->flags & TLB_VALID ) {
+        utlb_hash_remove( &hash, entry );
+    }
+    ent->flags = random_size(large) | (rand() & (TLB_SHARE|TLB_DIRTY)) |
+        ((rand() % 8) ? TLB_VALID : 0);
+    ent->mask = size_mask(ent->flags);
+    ent->vpn = (0x10000000 + (rand() % 0x01000000)) & 0xFFFFFC00;
+    ent->asid = rand() % 4;
+    ent->ppn = 0;
+    if( ent->flags & TLB_VALID ) {
+        utlb_hash_insert( &hash, utlb, entry );
+    }
+}
+
+/**
+ * Choose lookup addresses - mostly in mapped pages, with some misses.
+ */
+static void load_lookups( void )
+{
+    int i;
+    for( i=0; i<LOOKUP_COUNT; i++ ) {
+        if( rand() % 4 ) {
+            struct utlb_entry *ent = &utlb[rand() % UTLB_ENTRY_COUNT];
+            lookups[i] = (ent->vpn & ent->mask) | (rand() & ~ent->mask);
+        } else {
+            lookups[i] = 0x10000000 + (rand() % 0x01100000);
+        }
+    }
+}
+
+static int check_lookups( void )
+{
+    int i, asid, errors = 0;
+    for( i=0; i<LOOKUP_COUNT; i++ ) {
+        for( asid = 0; asid < 4; asid++ ) {
+            int expect = utlb_linear_lookup( lookups[i], asid, TRUE );
+            int result = utlb_hash_lookup( &hash, utlb, lookups[i], asid, TRUE );
+            if( result != expect ) {
+                fprintf( stderr, "Mismatch at %08X asid %d: expected %d but was %d\n", 
+                        lookups[i], asid, expect, result );
+                errors++;
+            }
+        }
+        int expect = utlb_linear_lookup( lookups[i], 0, FALSE );
+        int result = utlb_hash_lookup( &hash, utlb, lookups[i], 0, FALSE );
+        if( result != expect ) {
+            fprintf( stderr, "Mismatch at %08X (no asid): expected %d but was %d\n", 
+                    lookups[i], expect, result );
+            errors++;
+        }
+    }
+    return errors;
+}
+
+static int test_lookups( int large )
+{
+    int i, round, errors = 0;
+
+    utlb_hash_init( &hash );
+    memset( utlb, 0, sizeof(utlb) );
+    for( round = 0; round < 64; round++ ) {
+        for( i=0; i<UTLB_ENTRY_COUNT; i++ ) {
+            if( round == 0 || rand() % 8 == 0 ) {
+                load_entry( i, large );
+            }
+        }
+        load_lookups();
+        errors += check_lookups();
+    }
+    return errors;
+}
+
+static double elapsed_ns( struct timespec *start, struct timespec *end )
+{
+    return (end->tv_sec - start->tv_sec) * 1000000000.0 + (end->tv_nsec - start->tv_nsec);
+}
+
+/**
+ * Time both lookups over a full UTLB of non-overlapping entries (the normal
+ * case for a running title), with the given percentage of large pages.
+ */
+static void benchmark_lookups( int large, int iterations )
+{
+    struct timespec start, end;
+    int i, n;
+    volatile int sink = 0;
+
+    utlb_hash_init( &hash );
+    for( i=0; i<UTLB_ENTRY_COUNT; i++ ) {
+        utlb[i].flags = random_size(large) | TLB_VALID;
+        utlb[i].mask = size_mask(utlb[i].flags);
+        utlb[i].vpn = 0x10000000 + (i<<20);
+        utlb[i].asid = 0;
+        utlb_hash_insert( &hash, utlb, i );
+    }
+    load_lookups();
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for( n=0; n<iterations; n++ ) {
+        for( i=0; i<LOOKUP_COUNT; i++ ) {
+            sink += utlb_linear_lookup( lookups[i], 0, TRUE );
+        }
+    }
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    double linear = elapsed_ns( &start, &end ) / ((double)iterations * LOOKUP_COUNT);
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for( n=0; n<iterations; n++ ) {
+        for( i=0; i<LOOKUP_COUNT; i++ ) {
+            sink += utlb_hash_lookup( &hash, utlb, lookups[i], 0, TRUE );
+        }
+    }
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    double hashed = elapsed_ns( &start, &end ) / ((double)iterations * LOOKUP_COUNT);
+
+    printf( "%3d%% large pages: linear %.1fns, hashed %.1fns per lookup (%.1fx)\n", 
+            large, linear, hashed, linear / hashed );
+}
+
+int main( int argc, char *argv[] )
+{
+    int errors = 0;
+
+    srand(1);
+    errors += test_lookups( 0 );
+    errors += test_lookups( 10 );
+    errors += test_lookups( 50 );
+    if( errors != 0 ) {
+        printf( "testmmu: %d lookup mismatches\n", errors );
+        return 1;
+    }
+
+    if( argc > 1 && strcmp(argv[1], "-b") == 0 ) {
+        int iterations = argc > 2 ? atoi(argv[2]) : 1000;
+        benchmark_lookups( 0, iterations );
+        benchmark_lookups( 10, iterations );
+        benchmark_lookups( 100, iterations );
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+/**
+ * $Id$
+ *
+ * Tests for the SH4 sampling profiler's stack reconstruction and output.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lxdream.h"
+#include "mem.h"
+#include "eventq.h"
+#include "sh4/sh4core.h"
+#include "sh4/sh4dasm.h"
+#include "sh4/mmu.h"
+#include "sh4/sampler.h"
+
+#define TEST_RAM_BASE 0x0C000000
+#define TEST_RAM_SIZE 0x10000
+#define TEST_STACK    0x0C00F000
+
+struct sh4_registers sh4r;
+static unsigned char test_ram[TEST_RAM_SIZE];
+static int scheduled = 0;
+
+/* Functions in the test symbol table */
+#define FN_MAIN  0x0C001000
+#define FN_OUTER 0x0C002000
+#define FN_INNER 0x0C003000
+#define FN_END   0x0C004000
+
+void log_message( void *ptr, int level, const gchar *source, const char *msg, ... ) { }
+void register_event_callback( int eventid, event_func_t func ) { }
+void event_schedule( int eventid, uint32_t nanosecs ) { scheduled++; }
+void event_cancel( int eventid ) { scheduled = 0; }
+
+sh4addr_t FASTCALL mmu_vma_to_phys_disasm( sh4vma_t vma )
+{
+    return vma & 0x1FFFFFFF;
+}
+
+sh4ptr_t mem_get_region( uint32_t addr )
+{
+    if( addr >= TEST_RAM_BASE && addr < TEST_RAM_BASE + TEST_RAM_SIZE ) {
+        return &test_ram[addr - TEST_RAM_BASE];
+    }
+    return NULL;
+}
+
+const char *sh4_disasm_find_symbol( sh4addr_t addr, uint32_t *offset )
+{
+    static const struct { sh4addr_t start; const char *name; } syms[] = {
+            { FN_MAIN, "main" }, { FN_OUTER, "outer" }, { FN_INNER, "inner" } };
+    int i;
+    for( i=2; i>=0; i-- ) {
+        if( addr >= syms[i].start && addr < FN_END ) {
+            *offset = addr - syms[i].start;
+            return syms[i].name;
+        }
+    }
+    return NULL;
+}
+
+static void test_write_word( sh4addr_t addr, uint16_t value )
+{
+    memcpy( &test_ram[addr - TEST_RAM_BASE], &value, sizeof(value) );
+}
+
+static void test_write_long( sh4addr_t addr, uint32_t value )
+{
+    memcpy( &test_ram[addr - TEST_RAM_BASE], &value, sizeof(value) );
+}
+
+/**
+ * Put a call instruction in memory, returning the return address
+ */
+static sh4addr_t test_call_site( sh4addr_t addr, uint16_t op )
+{
+    test_write_word( addr, op );
+    test_write_word( addr + 2, 0x0009 ); /* NOP */
+    return addr + 4;
+}
+
+/**
+ * Check the profile output (as written by sh4_sampler_write)
+ */
+static void test_output( const char *expect )
+{
+    char buf[1024];
+    FILE *f = tmpfile();
+    assert( f != NULL );
+    sh4_sampler_write( f );
+    size_t len = ftell( f );
+    assert( len < sizeof(buf) );
+    rewind( f );
+    assert( fread( buf, 1, len, f ) == len );
+    buf[len] = '\0';
+    fclose( f );
+    if( strcmp( buf, expect ) != 0 ) {
+        fprintf( stderr, "Sampler output mismatch, expected:\n%sbut got:\n%s", expect, buf );
+        exit( 1 );
+    }
+}
+
+int main()
+{
+    sh4addr_t ret_main = test_call_site( FN_MAIN + 0x10, 0x400B );   /* JSR @R0 */
+    sh4addr_t ret_outer = test_call_site( FN_OUTER + 0x20, 0xB123 ); /* BSR */
+    sh4addr_t stale = test_call_site( FN_MAIN + 0x40, 0x0203 );      /* BSRF R2 */
+    sh4addr_t not_call = FN_OUTER + 0x54;                            /* Follows a NOP */
+    test_write_word( FN_OUTER + 0x50, 0x0009 );
+
+    assert( !sh4_sampler_is_enabled() );
+    sh4_sampler_start();
+    assert( scheduled == 0 );
+    sh4_sampler_init( "unused.prof", 0, 4 );
+    assert( sh4_sampler_is_enabled() );
+    sh4_sampler_start();
+    assert( scheduled == 1 );
+
+    /* In inner, called from outer (PR), called from main (on the stack).
+     * The stale return address into main and the non-return address are
+     * skipped. */
+    sh4r.sh4_state = SH4_STATE_RUNNING;
+    sh4r.pc = FN_INNER + 0x08;
+    sh4r.pr = ret_outer;
+    sh4r.r[15] = TEST_STACK;
+    test_write_long( TEST_STACK, not_call );
+    test_write_long( TEST_STACK + 4, ret_main );
+    test_write_long( TEST_STACK + 8, stale );
+    sh4_sampler_sample();
+    sh4_sampler_sample();
+
+    /* Leaf call from main with PR still pointing into main */
+    sh4r.pc = FN_MAIN + 0x80;
+    sh4r.pr = stale;
+    test_write_long( TEST_STACK, 0 );
+    test_write_long( TEST_STACK + 4, 0 );
+    test_write_long( TEST_STACK + 8, 0 );
+    sh4_sampler_sample();
+
+    /* Sleeping in unnamed code, with an unmapped stack */
+    sh4r.sh4_state = SH4_STATE_SLEEP;
+    sh4r.pc = 0x0C008000;
+    sh4r.pr = 0;
+    sh4r.r[15] = 0x08000000;
+    sh4_sampler_sample();
+
+    test_output( "0c008000;[sleep] 1\n"
+                 "main 1\n"
+                 "main;outer;inner 2\n" );
+
+    /* The depth limit counts the current function */
+    sh4_sampler_init( "unused.prof", 0, 2 );
+    sh4r.sh4_state = SH4_STATE_RUNNING;
+    sh4r.pc = FN_INNER + 0x08;
+    sh4r.pr = ret_outer;
+    sh4r.r[15] = TEST_STACK;
+    test_write_long( TEST_STACK, ret_main );
+    sh4_sampler_sample();
+    test_output( "0c008000;[sleep] 1\n"
+                 "main 1\n"
+                 "main;outer;inner 2\n"
+                 "outer;inner 1\n" );
+
+    printf( "Sampler: OK\n" );
+    return 0;
+}
@@ -0,0 +1,149 @@
+/**
+ * $Id$
+ *
+ * Tests for the write-protection of main RAM pages holding translated code
+ * (see sdram_set_code_protection): every write to translated code, whether
+ * it faults or goes through the invalidation functions, must discard the
+ * translations.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "dreamcast.h"
+#include "mem.h"
+#include "mmio.h"
+#include "xlat/xltcache.h"
+
+unsigned char dc_main_ram[16 MB] __attribute__((aligned(LXDREAM_PAGE_SIZE)));
+extern struct mem_region_fn mem_region_sdram;
+
+void log_message( void *ptr, int level, const gchar *source, const char *msg, ... ) { }
+
+static void test_unlink_block( void *use_list )
+{
+}
+
+static void test_unlink_site( uint8_t *site )
+{
+}
+
+static struct xlat_target_fns test_target_fns = { test_unlink_block, test_unlink_site };
+
+/**
+ * Translate a dummy block covering the given range
+ */
+static void *test_block( sh4addr_t startpc, sh4addr_t endpc )
+{
+    xlat_cache_block_t block = xlat_start_block( startpc );
+    memset( block->code, 0xC3, 64 );
+    xlat_commit_block( 64, startpc, endpc );
+    return block->code;
+}
+
+/**
+ * Write to the RAM behind a block directly (as translated code or a DMA
+ * would), and check that the block has gone.
+ */
+static void test_patch( sh4addr_t addr, sh4addr_t block_pc )
+{
+    dc_main_ram[addr & 0x00FFFFFF] ^= 0xFF;
+    assert( xlat_get_code( block_pc ) == NULL );
+}
+
+/**
+ * A write to the protected page faults and discards its translations
+ */
+void test_fault()
+{
+    test_block( 0x0C010000, 0x0C010010 );
+    test_block( 0x0C010800, 0x0C010810 );
+    test_patch( 0x0C010804, 0x0C010000 );
+    assert( xlat_get_code( 0x0C010800 ) == NULL );
+
+    /* Translating again re-protects the page */
+    test_block( 0x0C010000, 0x0C010010 );
+    test_patch( 0x0C010002, 0x0C010000 );
+}
+
+/**
+ * Invalidating part of a page that has no translations in that part (eg a
+ * loader writing data next to code) must not leave the rest of the page's
+ * translations live on a writable page.
+ */
+void test_partial_invalidate()
+{
+    void *code = test_block( 0x0C020000, 0x0C020010 );
+    xlat_invalidate_block( 0x0C020F00, 0x100 );
+    memset( &dc_main_ram[0x20F00], 0x09, 0x100 );
+    if( xlat_get_code( 0x0C020000 ) == code ) {
+        /* Still translated, so must still be protected */
+        test_patch( 0x0C020004, 0x0C020000 );
+    }
+
+    /* Likewise at a mirror address */
+    code = test_block( 0x0C020000, 0x0C020010 );
+    xlat_invalidate_block( 0x0D020F00, 0x100 );
+    if( xlat_get_code( 0x0C020000 ) == code ) {
+        test_patch( 0x0C020004, 0x0C020000 );
+    }
+
+    /* Then patch the code through the (unchecked) write functions */
+    code = test_block( 0x0C020000, 0x0C020010 );
+    xlat_invalidate_block( 0x0C020F00, 0x100 );
+    mem_region_sdram.write_long( 0x0C020004, 0x00090009 );
+    if( xlat_get_code( 0x0C020000 ) == code ) {
+        test_patch( 0x0C020004, 0x0C020000 );
+    }
+
+    /* A write spanning two pages */
+    test_block( 0x0C030FF0, 0x0C031000 );
+    test_block( 0x0C031100, 0x0C031110 );
+    xlat_invalidate_block( 0x0C030FFC, 8 );
+    assert( xlat_get_code( 0x0C030FF0 ) == NULL );
+    test_patch( 0x0C031104, 0x0C031100 );
+}
+
+/**
+ * Writes to pages without code don't touch the translations elsewhere
+ */
+void test_unrelated()
+{
+    void *code = test_block( 0x0C040000, 0x0C040010 );
+    dc_main_ram[0x41000] = 1;
+    mem_region_sdram.write_long( 0x0C042000, 1 );
+    xlat_invalidate_block( 0x0C043000, 0x1000 );
+    assert( xlat_get_code( 0x0C040000 ) == code );
+    test_patch( 0x0C040000, 0x0C040000 );
+}
+
+int main()
+{
+    xlat_cache_init();
+    xlat_set_target_fns( &test_target_fns );
+    if( !sdram_set_code_protection( TRUE ) ) {
+        fprintf( stderr, "Code page protection not supported, skipping\n" );
+        return 0;
+    }
+
+    test_fault();
+    test_partial_invalidate();
+    test_unrelated();
+    xlat_check_integrity();
+
+    assert( sdram_set_code_protection( FALSE ) );
+    printf( "SDRAM code protection: OK\n" );
+    return 0;
+}
@@ -4,6 +4,11 @@
  * Test cases for the SH4 => x86 translator core. Takes as
  * input a binary SH4 object (and VMA), generates the
  * corresponding x86 code, and outputs the disassembly.
+ * With -f, instead checks that the inline vector FPU
+ * sequences (FTRV, FIPR, FSCA) are bit-exact with the
+ * interpreter, and with -r that a short integer program
+ * gives the same results under each combination of
+ * register caching, IR passes and trace formation.
  *
  * Copyright (c) 2005 Nathan Keynes.
  *
@@ -23,8 +28,10 @@
 #include <getopt.h>
 #include <sys/stat.h>
 #include <string.h>
+#include <stdlib.h>
 
 #include "xlat/xlatdasm.h"
+#include "dreamcast.h"
 #include "sh4/sh4trans.h"
 #include "sh4/sh4core.h"
 #include "sh4/sh4mmio.h"
@@ -42,7 +49,7 @@ gboolean sh4_profile_blocks = FALSE;
 
 struct mem_region_fn **sh4_address_space = (void *)0x12345432;
 struct mem_region_fn **sh4_user_address_space = (void *)0x12345678;
-char *option_list = "s:o:d:h";
+char *option_list = "s:o:d:frh";
 struct option longopts[1] = { { NULL, 0, 0, 0 } };
 
 char *input_file = NULL;
@@ -67,6 +74,7 @@ struct xlat_symbol local_symbols[] = {
     { "sh4_read_sr", sh4_read_sr },
     { "sh4_sleep", sh4_sleep },
     { "sh4_fsca", sh4_fsca },
+    { "sh4_fsca_table", sh4_fsca_table },
     { "sh4_ftrv", sh4_ftrv },
     { "sh4_switch_fr_banks", sh4_switch_fr_banks },
     { "sh4_execute_instruction", sh4_execute_instruction },
@@ -94,8 +102,6 @@ void FASTCALL sh4_write_fpscr( uint32_t val ) { }
 void FASTCALL sh4_write_sr( uint32_t val ) { }
 uint32_t FASTCALL sh4_read_sr( void ) { return 0; }
 void FASTCALL sh4_sleep() { }
-void FASTCALL sh4_fsca( uint32_t angle, float *fr ) { }
-void FASTCALL sh4_ftrv( float *fv ) { }
 void FASTCALL signsat48(void) { }
 void sh4_switch_fr_banks() { }
 void mem_copy_to_sh4( sh4addr_t addr, sh4ptr_t src, size_t size ) { }
@@ -117,6 +123,10 @@ uint32_t sh4_sleep_run_slice(uint32_t nanosecs) { return nanosecs; }
 gboolean gui_error_dialog( const char *fmt, ... ) { return TRUE; }
 gboolean FASTCALL mmu_update_icache( sh4vma_t addr ) { return TRUE; }
 void MMU_ldtlb() { }
+void *sdram_init_window( sdram_window_fault_fn_t fault_fn ) { return NULL; }
+void *sdram_get_window( void ) { return NULL; }
+gboolean mmu_is_window_fault_transient( sh4vma_t addr ) { return FALSE; }
+gboolean sdram_get_code_protection( void ) { return FALSE; }
 void event_schedule(int event, uint32_t nanos) { }
 struct sh4_icache_struct sh4_icache;
 struct mem_region_fn mem_region_unmapped;
@@ -128,7 +138,9 @@ void usage()
     fprintf( stderr, "Usage: testsh4x86 [options] <input bin file>\n");
     fprintf( stderr, "Options:\n");
     fprintf( stderr, "  -d <filename>  Diff results against contents of file\n" );
+    fprintf( stderr, "  -f             Test the vector FPU instructions against the interpreter\n" );
     fprintf( stderr, "  -h             Display this help message\n" );
+    fprintf( stderr, "  -r             Test the translator options (register cache, IR, traces)\n" );
     fprintf( stderr, "  -o <filename>  Output disassembly to file [stdout]\n" );
     fprintf( stderr, "  -s <addr>      Specify start address of binary [8C010000]\n" );
 }
@@ -145,11 +157,184 @@ void emit( void *ptr, int level, const gchar *source, const char *msg, ... )
 
 struct sh4_registers sh4r;
 
+gboolean is_sse3_supported();
+
+#define FPU_TEST_ITERATIONS 100000
+
+/* FTRV XMTRX, FV4; FIPR FV0, FV8; FSCA FPUL, DR12; BRA $; NOP */
+static uint16_t fpu_test_prog[2048] = { 0xF5FD, 0xF8ED, 0xFCFD, 0xAFFE, 0x0009 };
+
+/**
+ * A random, finite float with a moderate exponent (so that the products
+ * and sums neither overflow nor underflow).
+ */
+static float random_float()
+{
+    union { uint32_t i; float f; } v;
+    v.i = (random() & 0x807FFFFF) | ((127 - 20 + (random() % 41)) << 23);
+    return v.f;
+}
+
+/**
+ * Translate the test program once, then run it repeatedly on random inputs,
+ * comparing the results bit for bit against the interpreter's implementation
+ * of the same instructions.
+ * @return the number of failed comparisons.
+ */
+int test_vector_fpu()
+{
+    struct sh4_registers input, expect;
+    int i, j, fails = 0;
+    gboolean check_fipr = is_sse3_supported();
+
+    mmio_region_MMU.mem = malloc(4096);
+    memset( mmio_region_MMU.mem, 0, 4096 );
+    sh4_icache.mask = 0xFFFFF000;
+    sh4_icache.page_vma = start_addr & 0xFFFFF000;
+    sh4_icache.page = (unsigned char *)fpu_test_prog;
+    sh4_icache.page_ppa = 0x0C010000;
+    xlat_cache_init();
+    sh4_translate_init();
+    if( !check_fipr ) {
+        fprintf( stderr, "SSE3 not available, skipping FIPR\n" );
+    }
+
+    srandom(1);
+    for( i=0; i<FPU_TEST_ITERATIONS; i++ ) {
+        memset( &input, 0, sizeof(input) );
+        for( j=0; j<16; j++ ) {
+            input.fr[0][j] = random_float();
+            input.fr[1][j] = random_float();
+        }
+        input.fpul.i = random();
+        input.pc = start_addr;
+        input.new_pc = start_addr + 2;
+
+        /* Reference results, exactly as per sh4core.in */
+        sh4r = input;
+        sh4_ftrv( &sh4r.fr[0][4] );
+        FR(11) = FR(0)*FR(8) + FR(1)*FR(9) + FR(2)*FR(10) + FR(3)*FR(11);
+        sh4_fsca( FPULi, &sh4r.fr[0][12] );
+        expect = sh4r;
+
+        sh4r = input;
+        sh4_translate_run_slice( 1 );
+        for( j=0; j<16; j++ ) {
+            if( j == 10 && !check_fipr ) {
+                continue;
+            }
+            if( memcmp( &sh4r.fr[0][j], &expect.fr[0][j], sizeof(float) ) != 0 ) {
+                fprintf( stderr, "FR%d mismatch: expected %.9g (%08X), got %.9g (%08X)\n",
+                         j^1, expect.fr[0][j], *((uint32_t *)&expect.fr[0][j]),
+                         sh4r.fr[0][j], *((uint32_t *)&sh4r.fr[0][j]) );
+                fails++;
+            }
+        }
+    }
+    fprintf( stdout, "Vector FPU: %d iterations, %d mismatches\n", FPU_TEST_ITERATIONS, fails );
+    return fails;
+}
+
+/**
+ * Two counted loops (so blocks branch back into themselves and to each other)
+ * around constant building, a PC-relative literal load, a dead T update and
+ * GBR, finishing in an idle BRA $.
+ */
+static uint16_t options_test_prog[2048] = {
+    0xE164, 0xE000, 0xE201,         /* MOV #100, R1; MOV #0, R0; MOV #1, R2 */
+    0x301C, 0x221A, 0x4110, 0x8BFB, /* loop: ADD R1, R0; XOR R1, R2; DT R1; BF loop */
+    0xE312, 0x4318, 0x7334, 0x4328, /* MOV #0x12, R3; SHLL8 R3; ADD #0x34, R3; SHLL16 R3 */
+    0xD407, 0x6543, 0x253A,         /* MOV.L @(28, PC), R4; MOV R4, R5; XOR R3, R5 */
+    0x3530, 0x3437, 0x0629,         /* CMP/EQ R3, R5; CMP/GT R3, R4; MOVT R6 */
+    0x401E, 0x0712, 0xE80A,         /* LDC R0, GBR; STC GBR, R7; MOV #10, R8 */
+    0x7901, 0x6A93, 0x4810, 0x8BFB, /* loop: ADD #1, R9; MOV R9, R10; DT R8; BF loop */
+    0xAFFE, 0x0009,                 /* BRA $; NOP */
+    0xBEEF, 0xDEAD };
+
+static const uint32_t options_test_expect[16] = {
+    5050, 0, 101, 0x12340000, 0xDEADBEEF, 0xCC99BEEF, 0, 5050,
+    0, 10, 10, 0xB0B0000B, 0xB0B0000C, 0xB0B0000D, 0xB0B0000E, 0xB0B0000F };
+
+#define OPTIONS_TEST_RUNS 16
+#define OPTIONS_TEST_NANOS 100000
+
+/**
+ * Run the options test program under each combination of register caching,
+ * the IR passes and trace formation, several times each so that the traces
+ * have a chance to form, and check the final state against the expected
+ * results.
+ * @return the number of failed runs.
+ */
+int test_translator_options()
+{
+    int i, j, config, fails = 0;
+
+    mmio_region_MMU.mem = malloc(4096);
+    memset( mmio_region_MMU.mem, 0, 4096 );
+    sh4_icache.mask = 0xFFFFF000;
+    sh4_icache.page_vma = start_addr & 0xFFFFF000;
+    sh4_icache.page = (unsigned char *)options_test_prog;
+    sh4_icache.page_ppa = 0x0C010000;
+    setenv( "LXDREAM_JIT_TRACE_INTERVAL", "1", 1 );
+    setenv( "LXDREAM_JIT_TRACE_THRESHOLD", "2", 1 );
+    xlat_cache_init();
+    sh4_translate_init();
+
+    for( config = 0; config < 8; config++ ) {
+        gboolean traced = FALSE;
+        sh4_translate_set_reg_cache( config & 1 );
+        sh4_translate_set_ir( (config & 2) != 0 );
+        sh4_translate_set_traces( (config & 4) != 0 );
+        xlat_flush_cache();
+        for( i=0; i<OPTIONS_TEST_RUNS; i++ ) {
+            memset( &sh4r, 0, sizeof(sh4r) );
+            for( j=11; j<16; j++ ) {
+                sh4r.r[j] = 0xB0B00000 + j;
+            }
+            sh4r.pc = start_addr;
+            sh4r.new_pc = start_addr + 2;
+            sh4r.event_pending = OPTIONS_TEST_NANOS;
+            sh4_translate_run_slice( OPTIONS_TEST_NANOS );
+            for( j=0; j<16; j++ ) {
+                if( sh4r.r[j] != options_test_expect[j] ) {
+                    fprintf( stderr, "Config %d run %d: R%d expected %08X, got %08X\n",
+                             config, i, j, options_test_expect[j], sh4r.r[j] );
+                    fails++;
+                }
+            }
+            if( sh4r.gbr != 5050 || sh4r.t != 1 || sh4r.pc != start_addr + 0x30 ) {
+                fprintf( stderr, "Config %d run %d: GBR=%d T=%d PC=%08X\n",
+                         config, i, sh4r.gbr, sh4r.t, sh4r.pc );
+                fails++;
+            }
+        }
+
+        /* Check that the traces really did form */
+        if( config & 4 ) {
+            struct xlat_block_ref blocks[64];
+            unsigned int count = xlat_get_blocks_by_address( blocks, 64 );
+            for( j=0; j<count; j++ ) {
+                if( blocks[j].block->active && (blocks[j].block->flags & XLAT_BLOCK_FLAG_TRACE) ) {
+                    traced = TRUE;
+                }
+            }
+            if( !traced ) {
+                fprintf( stderr, "Config %d: no trace formed\n", config );
+                fails++;
+            }
+        }
+    }
+    fprintf( stdout, "Translator options: %d configurations, %d failures\n", config, fails );
+    return fails;
+}
+
 
 int main( int argc, char *argv[] )
 {
     struct stat st;
     int opt;
+    gboolean fpu_test = FALSE;
+    gboolean options_test = FALSE;
     while( (opt = getopt_long( argc, argv, option_list, longopts, NULL )) != -1 ) {
 	switch( opt ) {
 	case 'd':
@@ -161,11 +346,23 @@ int main( int argc, char *argv[] )
 	case 's':
 	    start_addr = strtoul(optarg, NULL, 0);
 	    break;
+	case 'f':
+	    fpu_test = TRUE;
+	    break;
+	case 'r':
+	    options_test = TRUE;
+	    break;
 	case 'h':
 	    usage();
 	    exit(0);
 	}
     }
+    if( fpu_test ) {
+        return test_vector_fpu() == 0 ? 0 : 1;
+    }
+    if( options_test ) {
+        return test_translator_options() == 0 ? 0 : 1;
+    }
     if( optind < argc ) {
 	input_file = argv[optind++];
     } else {
@@ -0,0 +1,321 @@
+/**
+ * $Id$
+ *
+ * Checks that the software renderer produces exactly the same framebuffer
+ * whatever the number of worker threads (LXDREAM_SOFT_THREADS), for a scene
+ * of random opaque, punch-through and translucent triangles spread over
+ * several tiles and two passes. Also checks that rendering leaves the
+ * polygons' GL texture ids alone. Texture decoding is stubbed out with a
+ * pattern generated from the texture word.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lxdream.h"
+#include "display.h"
+#include "pvr2/pvr2.h"
+#include "pvr2/pvr2mmio.h"
+#include "pvr2/scene.h"
+
+#define TEST_WIDTH 160
+#define TEST_HEIGHT 96
+#define TEST_TILES_X (TEST_WIDTH/32)
+#define TEST_TILES_Y (TEST_HEIGHT/32)
+
+#define TEST_POLYBASE 0x100000
+#define TEST_TILEBASE 0x200000
+#define TEST_LISTBASE 0x210000
+
+#define TEST_OPAQUE 60
+#define TEST_PUNCHOUT 20
+#define TEST_TRANS 40
+#define TEST_TRIANGLES (TEST_OPAQUE+TEST_PUNCHOUT+TEST_TRANS)
+
+#define TEST_TEX_ID 0xDEADBEEF
+
+unsigned char pvr2_main_ram[8 MB];
+struct mmio_region mmio_region_PVR2;
+
+static uint32_t test_seed = 1;
+static uint32_t test_random( void )
+{
+    test_seed = test_seed * 1103515245 + 12345;
+    return test_seed >> 8;
+}
+
+static float test_random_float( float min, float max )
+{
+    return min + (max - min) * (test_random() & 0xFFFF) / 65536.0f;
+}
+
+void log_message( void *ptr, int level, const gchar *source, const char *msg, ... ) { }
+int pvr2_get_internal_scale_percent( void ) { return 100; }
+void gl_render_triangle( struct polygon_struct *poly, int index ) { }
+void gl_render_tilelist( pvraddr_t tile_entry, gboolean set_depth ) { }
+
+gboolean texcache_decode_texture_argb( uint32_t *out, uint32_t texture_word, int width, int height,
+                                       uint32_t palette_mode, uint32_t stride_width )
+{
+    int i;
+    for( i=0; i<width*height; i++ ) {
+        uint32_t h = (texture_word + i) * 0x9E3779B1;
+        out[i] = h ^ (h >> 13);
+    }
+    return TRUE;
+}
+
+static void *test_vbuf_map( vertex_buffer_t buf, uint32_t size )
+{
+    if( size > buf->capacity ) {
+        buf->data = g_realloc( buf->data, size );
+        buf->capacity = size;
+    }
+    buf->mapped_size = size;
+    return buf->data;
+}
+
+static void *test_vbuf_unmap( vertex_buffer_t buf )
+{
+    return buf->data;
+}
+
+static void test_vbuf_finished( vertex_buffer_t buf )
+{
+}
+
+static void test_vbuf_destroy( vertex_buffer_t buf )
+{
+    g_free( buf->data );
+    g_free( buf );
+}
+
+static vertex_buffer_t test_create_vertex_buffer( )
+{
+    vertex_buffer_t buf = g_malloc0( sizeof(struct vertex_buffer) );
+    buf->map = test_vbuf_map;
+    buf->unmap = test_vbuf_unmap;
+    buf->finished = test_vbuf_finished;
+    buf->destroy = test_vbuf_destroy;
+    return buf;
+}
+
+static struct display_driver test_display_driver = {
+        .name = "test",
+        .create_vertex_buffer = test_create_vertex_buffer };
+display_driver_t display_driver = &test_display_driver;
+
+struct test_triangle {
+    uint32_t entry;   /* Tile list entry */
+    float x1, x2, y1, y2;
+};
+
+static struct test_triangle triangles[TEST_TRIANGLES];
+
+static uint32_t *test_vram( uint32_t addr )
+{
+    return (uint32_t *)(pvr2_main_ram + addr);
+}
+
+static void test_put_float( uint32_t **ptr, float f )
+{
+    memcpy( *ptr, &f, sizeof(f) );
+    (*ptr)++;
+}
+
+/**
+ * Write a random triangle into the polygon buffer at the given word index.
+ * @return the number of words used
+ */
+static uint32_t test_build_triangle( struct test_triangle *tri, uint32_t poly_idx,
+                                     gboolean translucent )
+{
+    uint32_t *ptr = test_vram( TEST_POLYBASE ) + poly_idx;
+    gboolean textured = (test_random() & 1);
+    uint32_t poly1 = (6u<<29) | 0x00800000;  /* GEQUAL, gouraud */
+    uint32_t poly2 = PVR2_POLY_FOG_DISABLED | 0x09; /* 16x16 textures */
+    float cx = test_random_float( -16, TEST_WIDTH+16 );
+    float cy = test_random_float( -16, TEST_HEIGHT+16 );
+    int i;
+
+    if( textured ) {
+        poly1 |= 0x02000000;
+        poly2 |= (2<<6); /* Decal, to keep the vertex colours */
+    }
+    if( translucent ) {
+        poly2 |= (4u<<29) | (5<<26) | PVR2_POLY_MODE_ALPHA;
+    }
+    *ptr++ = poly1;
+    *ptr++ = poly2;
+    *ptr++ = (test_random() & 3) << 10; /* One of 4 textures */
+
+    tri->x1 = tri->y1 = 1e9;
+    tri->x2 = tri->y2 = -1e9;
+    for( i=0; i<3; i++ ) {
+        float x = cx + test_random_float( -40, 40 );
+        float y = cy + test_random_float( -40, 40 );
+        if( x < tri->x1 ) tri->x1 = x;
+        if( x > tri->x2 ) tri->x2 = x;
+        if( y < tri->y1 ) tri->y1 = y;
+        if( y > tri->y2 ) tri->y2 = y;
+        test_put_float( &ptr, x );
+        test_put_float( &ptr, y );
+        test_put_float( &ptr, test_random_float( 0.5, 100 ) );
+        if( textured ) {
+            test_put_float( &ptr, test_random_float( -1, 2 ) );
+            test_put_float( &ptr, test_random_float( -1, 2 ) );
+        }
+        *ptr++ = test_random();  /* ARGB colour */
+    }
+    tri->entry = 0x80000000 | ((textured ? 3 : 1) << 21) | poly_idx;
+    return 3 + 3 * (textured ? 6 : 4);
+}
+
+/**
+ * Write a tile list of the triangles in [first,first+count) that overlap the
+ * tile.
+ * @return the address following the list
+ */
+static uint32_t test_build_tilelist( uint32_t addr, int tile_x, int tile_y, int first, int count )
+{
+    uint32_t *ptr = test_vram( addr );
+    int i;
+    for( i=first; i<first+count; i++ ) {
+        if( triangles[i].x2 >= tile_x*32 && triangles[i].x1 < (tile_x+1)*32 &&
+            triangles[i].y2 >= tile_y*32 && triangles[i].y1 < (tile_y+1)*32 ) {
+            *ptr++ = triangles[i].entry;
+        }
+    }
+    *ptr++ = 0xF0000000;
+    return ((unsigned char *)ptr) - pvr2_main_ram;
+}
+
+/**
+ * Build the scene in VRAM: a background, then two passes over every tile,
+ * the first with opaque and translucent lists, and the second with
+ * punch-through and translucent lists.
+ */
+static void test_build_scene( void )
+{
+    uint32_t *ptr = test_vram( TEST_POLYBASE );
+    uint32_t poly_idx = 0, list = TEST_LISTBASE;
+    uint32_t *segment = test_vram( TEST_TILEBASE );
+    int i, pass, x, y;
+
+    /* Background, flat-shaded */
+    *ptr++ = 7u<<29;
+    *ptr++ = PVR2_POLY_FOG_DISABLED;
+    *ptr++ = 0;
+    for( i=0; i<3; i++ ) {
+        test_put_float( &ptr, i == 1 ? TEST_WIDTH : 0 );
+        test_put_float( &ptr, i == 2 ? TEST_HEIGHT : 0 );
+        test_put_float( &ptr, 0.01 );
+        *ptr++ = 0xFF203040;
+    }
+    poly_idx = 32;
+
+    for( i=0; i<TEST_TRIANGLES; i++ ) {
+        poly_idx += test_build_triangle( &triangles[i], poly_idx, i >= TEST_OPAQUE+TEST_PUNCHOUT );
+    }
+
+    for( pass=0; pass<2; pass++ ) {
+        for( y=0; y<TEST_TILES_Y; y++ ) {
+            for( x=0; x<TEST_TILES_X; x++ ) {
+                gboolean last = pass == 1 && x == TEST_TILES_X-1 && y == TEST_TILES_Y-1;
+                segment[0] = (x<<2) | (y<<8) | (last ? SEGMENT_END : 0);
+                segment[2] = NO_POINTER;
+                segment[4] = NO_POINTER;
+                if( pass == 0 ) {
+                    segment[1] = list;
+                    list = test_build_tilelist( list, x, y, 0, TEST_OPAQUE );
+                    segment[5] = NO_POINTER;
+                    segment[3] = list;
+                    list = test_build_tilelist( list, x, y, TEST_OPAQUE+TEST_PUNCHOUT, TEST_TRANS/2 );
+                } else {
+                    segment[1] = NO_POINTER;
+                    segment[5] = list;
+                    list = test_build_tilelist( list, x, y, TEST_OPAQUE, TEST_PUNCHOUT );
+                    segment[3] = list;
+                    list = test_build_tilelist( list, x, y, TEST_OPAQUE+TEST_PUNCHOUT+TEST_TRANS/2, TEST_TRANS/2 );
+                }
+                segment += 6;
+            }
+        }
+    }
+
+    MMIO_WRITE( PVR2, RENDER_POLYBASE, TEST_POLYBASE );
+    MMIO_WRITE( PVR2, RENDER_TILEBASE, TEST_TILEBASE );
+    MMIO_WRITE( PVR2, RENDER_HCLIP, (TEST_WIDTH-1) << 16 );
+    MMIO_WRITE( PVR2, RENDER_VCLIP, (TEST_HEIGHT-1) << 16 );
+    MMIO_WRITE( PVR2, RENDER_BGPLANE, 0x01000000 ); /* Polygon 0, 1 word colour */
+    MMIO_WRITE( PVR2, RENDER_ALPHA_REF, 0x80 );
+}
+
+/**
+ * Read and render the scene with the given number of threads
+ */
+static void test_render( const char *threads, uint32_t *pixels )
+{
+    int i;
+
+    setenv( "LXDREAM_SOFT_THREADS", threads, 1 );
+    memset( pixels, 0, TEST_WIDTH*TEST_HEIGHT*sizeof(uint32_t) );
+    pvr2_scene_read();
+    assert( pvr2_scene.buffer_width == TEST_WIDTH && pvr2_scene.buffer_height == TEST_HEIGHT );
+    for( i=0; i<pvr2_scene.poly_count; i++ ) {
+        pvr2_scene.poly_array[i].tex_id = TEST_TEX_ID;
+        pvr2_scene.poly_array[i].mod_tex_id = TEST_TEX_ID;
+    }
+    pvr2_scene_render_soft( pixels, TEST_WIDTH, TEST_HEIGHT );
+    pvr2_scene_render_soft_shutdown();
+    for( i=0; i<pvr2_scene.poly_count; i++ ) {
+        assert( pvr2_scene.poly_array[i].tex_id == TEST_TEX_ID );
+        assert( pvr2_scene.poly_array[i].mod_tex_id == TEST_TEX_ID );
+    }
+}
+
+int main()
+{
+    static uint32_t expect[TEST_WIDTH*TEST_HEIGHT], result[TEST_WIDTH*TEST_HEIGHT];
+    static const char *thread_counts[] = { "2", "3", "4", "8", NULL };
+    int i, colours = 0;
+
+    mmio_region_PVR2.mem = g_malloc0( LXDREAM_PAGE_SIZE );
+    test_build_scene();
+
+    test_render( "1", expect );
+    /* Make sure the scene actually drew a variety of things */
+    for( i=1; i<TEST_WIDTH*TEST_HEIGHT; i++ ) {
+        if( expect[i] != expect[i-1] ) {
+            colours++;
+        }
+    }
+    assert( colours > TEST_WIDTH*TEST_HEIGHT/8 );
+
+    for( i=0; thread_counts[i] != NULL; i++ ) {
+        test_render( thread_counts[i], result );
+        if( memcmp( expect, result, sizeof(expect) ) != 0 ) {
+            int p;
+            for( p=0; expect[p] == result[p]; p++ );
+            fprintf( stderr, "Software render with %s threads differs from 1 thread at (%d,%d): %08X vs %08X\n",
+                     thread_counts[i], p % TEST_WIDTH, p / TEST_WIDTH, result[p], expect[p] );
+            return 1;
+        }
+    }
+
+    printf( "Software renderer threads: OK\n" );
+    return 0;
+}
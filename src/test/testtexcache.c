@@ -0,0 +1,379 @@
+/**
+ * $Id$
+ *
+ * Tests for the texture cache's VRAM hashing and revalidation: the hash of
+ * a region of the 64-bit address space must change whenever any byte in
+ * either bank changes, and a texture whose pages are rewritten with the same
+ * contents must be kept rather than reloaded. Also checks that the cache
+ * stays within its memory budget (and consistent) as textures are loaded,
+ * evicted and flushed, and that the software renderer's ARGB8888 decode
+ * converts each of the upload formats correctly. GL is stubbed out, counting
+ * texture uploads and deletions.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lxdream.h"
+#include "dream.h"
+#include "mem.h"
+#include "display.h"
+#include "profiler.h"
+#include "pvr2/pvr2.h"
+#include "pvr2/pvr2mmio.h"
+#include "pvr2/glutil.h"
+#include "drivers/gl_state.h"
+
+/* 64x64 RGB565, twiddled */
+#define TEST_POLY2 0x0000001B
+#define TEST_TEXTURE_FORMAT PVR2_TEX_FORMAT_RGB565
+#define TEST_TEXTURE_SIZE (64*64*2)
+
+/* 512x512 RGB565 (512KB), against a 1MB budget */
+#define TEST_BUDGET_MB "1"
+#define TEST_LARGE_POLY2 0x00000036
+#define TEST_LARGE_SIZE (512*512*2)
+#define TEST_LARGE_TEXTURES 8
+
+void texcache_integrity_check( void );
+
+struct mmio_region mmio_region_ASIC, mmio_region_PVR2PAL;
+struct colour_format colour_formats[8];
+static struct display_driver test_display_driver = { .name = "test" };
+display_driver_t display_driver = &test_display_driver;
+
+static GLuint next_texture_id = 1;
+static int upload_count = 0;
+static GLuint deleted_ids[64];
+static int deleted_count = 0;
+
+static uint32_t test_seed = 1;
+static uint32_t test_random( void )
+{
+    test_seed = test_seed * 1103515245 + 12345;
+    return test_seed >> 8;
+}
+
+void log_message( void *ptr, int level, const gchar *source, const char *msg, ... ) { }
+void fwrite_dump( unsigned char *buf, unsigned int length, FILE *f ) { }
+os_signpost_id_t profiler_begin( const char *name ) { return 0; }
+void profiler_end( const char *name, os_signpost_id_t sid ) { }
+gboolean pvr2_render_buffer_invalidate( sh4addr_t addr, gboolean isWrite ) { return FALSE; }
+void pvr2_destroy_render_buffer( render_buffer_t buffer ) { }
+void pvr2_ta_write( unsigned char *buf, uint32_t length ) { }
+void FASTCALL pvr2_ta_write_burst( sh4addr_t addr, unsigned char *buf ) { }
+void pvr2_yuv_write( unsigned char *buf, uint32_t length ) { }
+int32_t FASTCALL unmapped_read_long( sh4addr_t addr ) { return 0; }
+void FASTCALL unmapped_write_long( sh4addr_t addr, uint32_t val ) { }
+void FASTCALL unmapped_read_burst( unsigned char *dest, sh4addr_t addr ) { }
+
+void gl_state_cache_active_texture( GLenum texture ) { }
+void gl_state_cache_bind_texture( GLenum target, GLuint tex ) { }
+void gl_state_cache_tex_parameter_i( GLenum target, GLenum pname, GLint param ) { }
+GLenum glGetError( void ) { return GL_NO_ERROR; }
+void glGetIntegerv( GLenum pname, GLint *params ) { *params = 4; }
+void glPixelStorei( GLenum pname, GLint param ) { }
+GLboolean glAreTexturesResident( GLsizei n, const GLuint *textures, GLboolean *residences ) { return GL_TRUE; }
+void glTexSubImage2DBGRA( int level, int xoff, int yoff, int width, int height, GLint format,
+                          GLint type, unsigned char *data, int preserveData ) { }
+
+void glGenTextures( GLsizei n, GLuint *textures )
+{
+    while( n-- > 0 ) {
+        *textures++ = next_texture_id++;
+    }
+}
+
+void glDeleteTextures( GLsizei n, const GLuint *textures )
+{
+    while( n-- > 0 ) {
+        assert( deleted_count < 64 );
+        deleted_ids[deleted_count++] = *textures++;
+    }
+}
+
+void glTexImage2DBGRA( int level, GLint intFormat, int width, int height, GLint format,
+                       GLint type, unsigned char *data, int preserveData )
+{
+    upload_count++;
+}
+
+/**
+ * Flip one byte of the 64-bit address space, through the VRAM write path
+ */
+static void test_flip( sh4addr_t addr )
+{
+    unsigned char byte;
+    pvr2_vram64_read( &byte, addr, 1 );
+    byte ^= 0x5A;
+    pvr2_vram64_write( addr, &byte, 1 );
+}
+
+static void test_hash( void )
+{
+    static const uint32_t lengths[] = { 1, 3, 4, 7, 8, 15, 16, 17, 31, 32, 33, 100, 4096, 5000 };
+    sh4addr_t base = 0x123400;
+    uint32_t i, j;
+
+    for( i=0; i<0x10000; i++ ) {
+        pvr2_main_ram[(base>>1) + i] = test_random();
+        pvr2_main_ram[(base>>1) + 0x400000 + i] = test_random();
+    }
+
+    for( i=0; i<sizeof(lengths)/sizeof(lengths[0]); i++ ) {
+        for( j=0; j<8; j++ ) {
+            sh4addr_t addr = base + j;
+            uint32_t length = lengths[i];
+            sh4addr_t first = addr & ~7, last = (addr + length - 1) | 7;
+            sh4addr_t flip[] = { addr, addr + length - 1, addr + length/2, first, last,
+                                 (addr + length/2) ^ 4 };
+            uint64_t hash = pvr2_vram64_hash( addr, length );
+            int k;
+
+            /* Same bytes, same hash */
+            assert( pvr2_vram64_hash( addr, length ) == hash );
+            /* Unaligned regions are rounded out to 64-bit alignment */
+            assert( pvr2_vram64_hash( first, last + 1 - first ) == hash );
+
+            /* Any change in either bank (addr bit 2) within the region is seen */
+            for( k=0; k<6; k++ ) {
+                if( flip[k] < first || flip[k] > last ) {
+                    continue;
+                }
+                test_flip( flip[k] );
+                if( pvr2_vram64_hash( addr, length ) == hash ) {
+                    fprintf( stderr, "Hash of %06X+%d unchanged by write to %06X\n", addr, length, flip[k] );
+                    exit( 1 );
+                }
+                test_flip( flip[k] );
+                assert( pvr2_vram64_hash( addr, length ) == hash );
+            }
+
+            /* Changes outside it aren't */
+            test_flip( first - 1 );
+            test_flip( last + 1 );
+            assert( pvr2_vram64_hash( addr, length ) == hash );
+            test_flip( first - 1 );
+            test_flip( last + 1 );
+        }
+    }
+}
+
+/**
+ * Rewriting a texture's pages with the same data keeps the loaded texture,
+ * and changing the data reloads it into the same texture id.
+ */
+static void test_revalidate( void )
+{
+    static unsigned char data[TEST_TEXTURE_SIZE];
+    uint32_t texture_addr = 0x200800;
+    uint32_t texture_word = TEST_TEXTURE_FORMAT | (texture_addr >> 3);
+    uint32_t hits, misses;
+    GLuint id;
+    int i;
+
+    for( i=0; i<TEST_TEXTURE_SIZE; i++ ) {
+        data[i] = test_random();
+    }
+    pvr2_vram64_write( texture_addr, data, TEST_TEXTURE_SIZE );
+    texcache_begin_scene( 0, 0 );
+    upload_count = 0;
+    id = texcache_get_texture( TEST_POLY2, texture_word );
+    assert( upload_count == 1 );
+    assert( texcache_get_texture( TEST_POLY2, texture_word ) == id );
+    assert( upload_count == 1 );
+    pvr2_texcache_revalidate_consume( &hits, &misses );
+    assert( hits == 0 && misses == 0 );
+
+    /* Same bytes rewritten */
+    pvr2_vram64_write( texture_addr, data, TEST_TEXTURE_SIZE );
+    texcache_begin_scene( 0, 0 );
+    assert( texcache_get_texture( TEST_POLY2, texture_word ) == id );
+    assert( upload_count == 1 );
+    pvr2_texcache_revalidate_consume( &hits, &misses );
+    assert( hits == 1 && misses == 0 );
+
+    /* Write to the same page, outside the texture */
+    test_flip( texture_addr - 1 );
+    assert( texcache_get_texture( TEST_POLY2, texture_word ) == id );
+    assert( upload_count == 1 );
+    pvr2_texcache_revalidate_consume( &hits, &misses );
+    assert( hits == 1 && misses == 0 );
+
+    /* Changed */
+    test_flip( texture_addr + 1000 );
+    assert( texcache_get_texture( TEST_POLY2, texture_word ) == id );
+    assert( upload_count == 2 );
+    pvr2_texcache_revalidate_consume( &hits, &misses );
+    assert( hits == 0 && misses == 1 );
+
+    /* Back to the original contents, which still needs a reload */
+    test_flip( texture_addr + 1000 );
+    texcache_begin_scene( 0, 0 );
+    assert( texcache_get_texture( TEST_POLY2, texture_word ) == id );
+    assert( upload_count == 3 );
+}
+
+static uint32_t test_large_texture( int i )
+{
+    return TEST_TEXTURE_FORMAT | ((0x400000 + i*TEST_LARGE_SIZE) >> 3);
+}
+
+/**
+ * Start a new scene, and check that exactly the given textures were
+ * released since the last one.
+ */
+static void test_check_deleted( int count, ... )
+{
+    va_list ap;
+    int i, j;
+
+    deleted_count = 0;
+    texcache_begin_scene( 0, 0 );
+    texcache_integrity_check();
+    if( deleted_count != count ) {
+        fprintf( stderr, "Expected %d textures to be deleted, but %d were\n", count, deleted_count );
+        exit( 1 );
+    }
+    va_start( ap, count );
+    for( i=0; i<count; i++ ) {
+        GLuint id = va_arg( ap, GLuint );
+        for( j=0; j<deleted_count && deleted_ids[j] != id; j++ );
+        if( j == deleted_count ) {
+            fprintf( stderr, "Expected texture %d to be deleted\n", id );
+            exit( 1 );
+        }
+    }
+    va_end( ap );
+}
+
+static void test_budget( void )
+{
+    GLuint id[TEST_LARGE_TEXTURES];
+    int i;
+
+    texcache_flush();
+    test_check_deleted( 1, 1 ); /* From test_revalidate */
+    upload_count = 0;
+
+    /* Filling the budget evicts nothing */
+    id[0] = texcache_get_texture( TEST_LARGE_POLY2, test_large_texture(0) );
+    id[1] = texcache_get_texture( TEST_LARGE_POLY2, test_large_texture(1) );
+    texcache_integrity_check();
+    test_check_deleted( 0 );
+
+    /* Going over it evicts the least recently used texture, as soon as the
+     * new one is loaded */
+    id[2] = texcache_get_texture( TEST_LARGE_POLY2, test_large_texture(2) );
+    texcache_integrity_check();
+    assert( texcache_get_texture( TEST_LARGE_POLY2, test_large_texture(1) ) == id[1] );
+    assert( upload_count == 3 );
+    test_check_deleted( 1, id[0] );
+
+    /* Deferred loads are only sized at upload, and must be evicted for too */
+    id[3] = texcache_get_texture_deferred( TEST_LARGE_POLY2, test_large_texture(3) );
+    id[4] = texcache_get_texture_deferred( TEST_LARGE_POLY2, test_large_texture(4) );
+    texcache_load_deferred();
+    texcache_integrity_check();
+    test_check_deleted( 2, id[1], id[2] );
+
+    /* But textures used in the current scene are kept, even over budget */
+    for( i=5; i<8; i++ ) {
+        id[i] = texcache_get_texture( TEST_LARGE_POLY2, test_large_texture(i) );
+        texcache_integrity_check();
+    }
+    for( i=5; i<8; i++ ) {
+        assert( texcache_get_texture( TEST_LARGE_POLY2, test_large_texture(i) ) == id[i] );
+    }
+    assert( upload_count == 8 );
+    test_check_deleted( 2, id[3], id[4] );
+
+    /* Until the next scene loads something */
+    assert( texcache_get_texture( TEST_LARGE_POLY2, test_large_texture(7) ) == id[7] );
+    id[0] = texcache_get_texture( TEST_LARGE_POLY2, test_large_texture(0) );
+    texcache_integrity_check();
+    test_check_deleted( 2, id[5], id[6] );
+
+    /* Reloading a changed texture keeps its entry, and the budget */
+    test_flip( (test_large_texture(7) & 0x000FFFFF) << 3 );
+    assert( texcache_get_texture( TEST_LARGE_POLY2, test_large_texture(7) ) == id[7] );
+    id[1] = texcache_get_texture( TEST_LARGE_POLY2, test_large_texture(1) );
+    assert( upload_count == 11 );
+    texcache_integrity_check();
+    test_check_deleted( 1, id[0] );
+
+    texcache_flush();
+    texcache_integrity_check();
+    test_check_deleted( 2, id[1], id[7] );
+    assert( texcache_get_texture( TEST_LARGE_POLY2, test_large_texture(7) ) != id[7] );
+    texcache_integrity_check();
+}
+
+static void test_check_argb( uint32_t texture_word, uint32_t palette_mode, uint32_t expect )
+{
+    uint32_t out[64];
+    int i;
+    assert( texcache_decode_texture_argb( out, texture_word, 8, 8, palette_mode, 0 ) );
+    for( i=0; i<64; i++ ) {
+        assert( out[i] == expect );
+    }
+}
+
+/**
+ * Decode uniform 8x8 textures (so twiddling doesn't matter) in each format
+ * to ARGB8888.
+ */
+static void test_decode_argb( void )
+{
+    static uint32_t palette[1024];
+    uint32_t texture_addr = 0x300000, yuv_addr = 0x300800;
+    uint16_t texels[64];
+    uint32_t yuv[32], out[64];
+    int i;
+
+    for( i=0; i<64; i++ ) {
+        texels[i] = 0x9234;
+    }
+    for( i=0; i<32; i++ ) {
+        yuv[i] = 0x80C08080; /* Y1 V Y0 U */
+    }
+    pvr2_vram64_write( texture_addr, (unsigned char *)texels, sizeof(texels) );
+    pvr2_vram64_write( yuv_addr, (unsigned char *)yuv, sizeof(yuv) );
+    palette[0x34] = palette[0x92] = 0x12345678;
+    mmio_region_PVR2PAL.mem = (char *)palette;
+
+    test_check_argb( PVR2_TEX_FORMAT_ARGB1555 | (texture_addr >> 3), 0, 0xFF218CA5 );
+    test_check_argb( PVR2_TEX_FORMAT_RGB565 | (texture_addr >> 3), 0, 0xFF9445A5 );
+    test_check_argb( PVR2_TEX_FORMAT_ARGB4444 | (texture_addr >> 3), 0, 0x99223344 );
+    test_check_argb( PVR2_TEX_FORMAT_IDX8 | (texture_addr >> 3), 1, 0xFF52CFC6 );
+    test_check_argb( PVR2_TEX_FORMAT_IDX8 | (texture_addr >> 3), 3, 0x12345678 );
+    test_check_argb( PVR2_TEX_FORMAT_YUV422 | PVR2_TEX_UNTWIDDLED | (yuv_addr >> 3), 0, 0xFFD85480 );
+    assert( !texcache_decode_texture_argb( out, PVR2_TEX_FORMAT_BUMPMAP | (texture_addr >> 3),
+            8, 8, 0, 0 ) );
+}
+
+int main()
+{
+    setenv( "LXDREAM_TEX_BUDGET_MB", TEST_BUDGET_MB, 1 );
+    texcache_init();
+    test_hash();
+    test_revalidate();
+    test_budget();
+    test_decode_argb();
+    printf( "Texture cache: OK\n" );
+    return 0;
+}
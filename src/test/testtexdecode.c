@@ -0,0 +1,239 @@
+/**
+ * $Id$
+ *
+ * Texture decoding kernel tests. Checks every implementation supported by
+ * the host against the reference versions, bit for bit, over a range of
+ * sizes, shapes and source alignments. With -b [iterations], also
+ * benchmarks each kernel.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pvr2/texdecode.h"
+
+#define VRAM_SIZE (8*1024*1024)
+#define MAX_PIXELS (1024*1024)
+
+static const char *impl_names[] = { "scalar", "sse2", "avx2", "neon", NULL };
+
+static uint8_t vram[VRAM_SIZE];
+static uint32_t palette[1024];
+static struct vq_codebook codebook;
+static uint8_t input[MAX_PIXELS];
+static uint8_t expect[MAX_PIXELS*4];
+static uint8_t result[MAX_PIXELS*4];
+
+static uint32_t test_seed = 1;
+static uint32_t test_random( void )
+{
+    test_seed = test_seed * 1103515245 + 12345;
+    return test_seed >> 8;
+}
+
+static void fill_random( uint8_t *buf, uint32_t length )
+{
+    uint32_t i;
+    for( i=0; i<length; i++ ) {
+        buf[i] = test_random();
+    }
+}
+
+static int failures = 0;
+
+static void check( const char *impl, const char *kernel, int width, int height,
+                   uint32_t addr, uint32_t bytes )
+{
+    if( memcmp( expect, result, bytes ) != 0 ) {
+        uint32_t i;
+        for( i=0; expect[i] == result[i]; i++ );
+        printf( "FAIL: %s %s %dx%d @%06X: byte %d is %02X, expected %02X\n",
+                impl, kernel, width, height, addr, i, result[i], expect[i] );
+        failures++;
+    }
+}
+
+static void test_twiddled( const struct texdecode_ops *ref, const struct texdecode_ops *ops )
+{
+    static const uint32_t offsets[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    int wbits, hbits, i;
+
+    for( wbits=0; wbits<=10; wbits++ ) {
+        for( hbits=0; hbits<=10; hbits++ ) {
+            int width = 1<<wbits, height = 1<<hbits;
+            if( width != height && (width == 1 || height == 1) ) {
+                continue; /* Not supported by the reference versions */
+            }
+            for( i=0; i<8; i++ ) {
+                uint32_t addr = ((test_random() % (VRAM_SIZE - MAX_PIXELS*2 - 16)) & ~7) + offsets[i];
+                uint32_t bytes;
+
+                bytes = (width*height + 1) >> 1;
+                memset( expect, 0xA5, bytes + 64 );
+                memcpy( result, expect, bytes + 64 );
+                memset( result, 0x5A, bytes );
+                ref->read_twiddled_4( expect, vram, addr, width, height );
+                ops->read_twiddled_4( result, vram, addr, width, height );
+                check( ops->name, "read_twiddled_4", width, height, addr, bytes + 64 );
+
+                bytes = width*height;
+                memset( expect, 0xA5, bytes + 64 );
+                memcpy( result, expect, bytes + 64 );
+                memset( result, 0x5A, bytes );
+                ref->read_twiddled_8( expect, vram, addr, width, height );
+                ops->read_twiddled_8( result, vram, addr, width, height );
+                check( ops->name, "read_twiddled_8", width, height, addr, bytes + 64 );
+
+                addr &= ~1; /* 16-bit textures are always 16-bit aligned */
+                bytes = width*height*2;
+                memset( expect, 0xA5, bytes + 64 );
+                memcpy( result, expect, bytes + 64 );
+                memset( result, 0x5A, bytes );
+                ref->read_twiddled_16( expect, vram, addr, width, height );
+                ops->read_twiddled_16( result, vram, addr, width, height );
+                check( ops->name, "read_twiddled_16", width, height, addr, bytes + 64 );
+            }
+        }
+    }
+}
+
+static void test_vq( const struct texdecode_ops *ref, const struct texdecode_ops *ops )
+{
+    int bits;
+    for( bits=1; bits<=10; bits++ ) {
+        int size = 1<<bits;
+        uint32_t bytes = size*size*2;
+        fill_random( input, (size*size)>>2 );
+        memset( expect, 0xA5, bytes + 64 );
+        memcpy( result, expect, bytes + 64 );
+        memset( result, 0x5A, bytes );
+        ref->vq_decode( (uint16_t *)expect, input, size, size, &codebook );
+        ops->vq_decode( (uint16_t *)result, input, size, size, &codebook );
+        check( ops->name, "vq_decode", size, size, 0, bytes + 64 );
+    }
+}
+
+static void test_palette( const struct texdecode_ops *ref, const struct texdecode_ops *ops )
+{
+    static const int lengths[] = { 0, 1, 7, 8, 15, 16, 17, 31, 33, 100, 4096, 65536 };
+    int i;
+    for( i=0; i<sizeof(lengths)/sizeof(lengths[0]); i++ ) {
+        int n = lengths[i];
+        uint32_t *pal = palette + (test_random() & 0x3F0);
+        uint32_t *pal8 = palette + (test_random() & 0x300);
+        fill_random( input, n );
+
+#define CHECK_PAL( kernel, bytes, table ) \
+        memset( expect, 0xA5, (bytes) + 64 ); \
+        memcpy( result, expect, (bytes) + 64 ); \
+        memset( result, 0x5A, (bytes) ); \
+        ref->kernel( (void *)expect, input, n, table ); \
+        ops->kernel( (void *)result, input, n, table ); \
+        check( ops->name, #kernel, n, 1, 0, (bytes) + 64 )
+
+        CHECK_PAL( pal8_to_32, n*4, pal8 );
+        CHECK_PAL( pal8_to_16, n*2, pal8 );
+        CHECK_PAL( pal4_to_32, n*8, pal );
+        CHECK_PAL( pal4_to_16, n*4, pal );
+
+        memset( expect, 0xA5, n*2 + 64 );
+        memcpy( result, expect, n*2 + 64 );
+        memset( result, 0x5A, n*2 );
+        ref->pal4_to_pal8( expect, input, n );
+        ops->pal4_to_pal8( result, input, n );
+        check( ops->name, "pal4_to_pal8", n, 1, 0, n*2 + 64 );
+    }
+}
+
+static double elapsed( struct timespec *start )
+{
+    struct timespec end;
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec)/1000000000.0;
+}
+
+/**
+ * Decode a mix of texture sizes typical of a scene, and report throughput
+ * in output megapixels/second.
+ */
+static void benchmark( const struct texdecode_ops *ops, int iterations )
+{
+    static const int sizes[] = { 64, 256, 1024 };
+    struct timespec start;
+    int s, i;
+
+    for( s=0; s<3; s++ ) {
+        int size = sizes[s];
+        double mpix = (double)size*size*iterations / 1000000.0;
+        double t4, t8, t16, tvq, tp8, tp4;
+        uint32_t addr = 0x100008;
+
+#define TIME( var, stmt ) \
+        clock_gettime( CLOCK_MONOTONIC, &start ); \
+        for( i=0; i<iterations; i++ ) { stmt; } \
+        var = mpix / elapsed( &start )
+
+        TIME( t4, ops->read_twiddled_4( result, vram, addr, size, size ) );
+        TIME( t8, ops->read_twiddled_8( result, vram, addr, size, size ) );
+        TIME( t16, ops->read_twiddled_16( result, vram, addr, size, size ) );
+        TIME( tvq, ops->vq_decode( (uint16_t *)result, input, size, size, &codebook ) );
+        TIME( tp8, ops->pal8_to_32( (uint32_t *)result, input, size*size, palette ) );
+        TIME( tp4, ops->pal4_to_16( (uint16_t *)result, input, (size*size)>>1, palette ) );
+        printf( "%-6s %4dx%-4d  tw4 %7.1f  tw8 %7.1f  tw16 %7.1f  vq %7.1f  pal8_32 %7.1f  pal4_16 %7.1f Mpix/s\n",
+                ops->name, size, size, t4, t8, t16, tvq, tp8, tp4 );
+    }
+}
+
+int main( int argc, char *argv[] )
+{
+    const struct texdecode_ops *ref = texdecode_get_impl( "scalar" );
+    int i;
+
+    fill_random( vram, VRAM_SIZE );
+    fill_random( (uint8_t *)palette, sizeof(palette) );
+    fill_random( (uint8_t *)&codebook, sizeof(codebook) );
+    fill_random( input, MAX_PIXELS );
+
+    for( i=0; impl_names[i] != NULL; i++ ) {
+        const struct texdecode_ops *ops = texdecode_get_impl( impl_names[i] );
+        if( ops == NULL ) {
+            printf( "%s: not supported\n", impl_names[i] );
+            continue;
+        }
+        test_twiddled( ref, ops );
+        test_vq( ref, ops );
+        test_palette( ref, ops );
+        printf( "%s: tested\n", ops->name );
+    }
+    printf( "Selected: %s\n", texdecode_init()->name );
+
+    if( argc > 1 && strcmp(argv[1], "-b") == 0 ) {
+        int iterations = argc > 2 ? atoi(argv[2]) : 100;
+        fill_random( input, MAX_PIXELS );
+        for( i=0; impl_names[i] != NULL; i++ ) {
+            const struct texdecode_ops *ops = texdecode_get_impl( impl_names[i] );
+            if( ops != NULL ) {
+                benchmark( ops, iterations );
+            }
+        }
+    }
+
+    if( failures != 0 ) {
+        printf( "%d failures\n", failures );
+        return 1;
+    }
+    return 0;
+}
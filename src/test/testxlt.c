@@ -17,16 +17,77 @@
  */
 
 #include <assert.h>
+#include <unistd.h>
 #include "xlat/xltcache.h"
+#include "xlat/xltpersist.h"
 #include "dreamcast.h"
 
 extern xlat_cache_block_t xlat_new_cache;
 extern xlat_cache_block_t xlat_new_cache_ptr;
 
-void sh4_translate_unlink_block( void *use_list )
+#define TEST_RAM_BASE 0x0C010000
+#define TEST_RAM_SIZE 0x2000
+#define TEST_LINK_STUB 0xE9
+
+static unsigned char test_ram[TEST_RAM_SIZE];
+
+void log_message( void *ptr, int level, const gchar *source, const char *msg, ... ) { }
+
+sh4ptr_t mem_get_region( uint32_t addr )
+{
+    if( addr >= TEST_RAM_BASE && addr < TEST_RAM_BASE + TEST_RAM_SIZE ) {
+        return &test_ram[addr - TEST_RAM_BASE];
+    }
+    return NULL;
+}
+
+gboolean mem_get_phys_address( void *ptr, sh4addr_t *addr )
+{
+    if( (unsigned char *)ptr >= test_ram && (unsigned char *)ptr < test_ram + TEST_RAM_SIZE ) {
+        *addr = TEST_RAM_BASE + ((unsigned char *)ptr - test_ram);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static void test_unlink_block( void *use_list )
+{
+}
+
+static void test_unlink_site( uint8_t *site )
+{
+    memset( site, TEST_LINK_STUB, 8 );
+}
+
+static struct xlat_target_fns test_target_fns = { test_unlink_block, test_unlink_site };
+
+static struct {
+    int add_range, invalidate_range, flush;
+    sh4addr_t start, end;
+} watched;
+
+static void test_watch_add_range( sh4addr_t start, sh4addr_t end )
 {
+    watched.add_range++;
+    if( start < watched.start )
+        watched.start = start;
+    if( end > watched.end )
+        watched.end = end;
 }
 
+static void test_watch_invalidate_range( sh4addr_t start, size_t bytes )
+{
+    watched.invalidate_range++;
+}
+
+static void test_watch_flush( void )
+{
+    watched.flush++;
+}
+
+static struct xlat_source_watch test_watch = { test_watch_add_range,
+        test_watch_invalidate_range, test_watch_flush };
+
 /**
  * Test initial allocations from the new cache
  */
@@ -79,11 +140,215 @@ void test_initial()
     assert( addr == &block3a->code );
 }
 
+/**
+ * Translate a dummy block of the given size
+ */
+static xlat_cache_block_t test_block( sh4addr_t startpc, sh4addr_t endpc, uint32_t size )
+{
+    xlat_cache_block_t block = xlat_start_block( startpc );
+    if( block->size < size ) {
+        block = xlat_extend_block( size );
+    }
+    memset( block->code, 0xC3, size );
+    xlat_commit_block( size, startpc, endpc );
+    return block;
+}
+
+/**
+ * Test that every range of a multi-range block (ie a trace) is covered by
+ * invalidation, and that a block can be deleted from behind the block that
+ * superseded it.
+ */
+void test_block_ranges()
+{
+    xlat_flush_cache();
+    xlat_cache_block_t block = xlat_start_block( 0x0C010000 );
+    memset( block->code, 0xC3, 256 );
+    xlat_add_block_range( 0x0C010100, 0x0C010120 );
+    xlat_commit_block( 256, 0x0C010000, 0x0C010010 );
+    assert( xlat_get_code( 0x0C010000 ) == block->code );
+    assert( xlat_get_code( 0x0C010100 ) == NULL );
+    assert( xlat_get_code( 0x0C010008 ) == NULL );
+
+    /* Outside every range (but in the same page) */
+    xlat_invalidate_word( 0x0C010080 );
+    xlat_invalidate_long( 0x0C010120 );
+    assert( xlat_get_code( 0x0C010000 ) == block->code );
+    assert( block->active );
+
+    /* Inside the second range */
+    xlat_invalidate_word( 0x0C01011E );
+    assert( xlat_get_code( 0x0C010000 ) == NULL );
+    assert( !block->active );
+
+    /* Supersede a block with a trace, then delete the original */
+    xlat_cache_block_t orig = test_block( 0x0C010200, 0x0C010210, 128 );
+    orig->flags |= XLAT_BLOCK_FLAG_TRACE;
+    xlat_cache_block_t trace = xlat_start_block( 0x0C010200 );
+    memset( trace->code, 0xC3, 256 );
+    xlat_add_block_range( 0x0C010400, 0x0C010410 );
+    trace->flags |= XLAT_BLOCK_FLAG_TRACE;
+    xlat_commit_block( 256, 0x0C010200, 0x0C010210 );
+    assert( xlat_get_code( 0x0C010200 ) == trace->code );
+    assert( trace->chain == orig->code );
+    xlat_delete_block( orig );
+    assert( xlat_get_code( 0x0C010200 ) == trace->code );
+    assert( trace->chain == NULL );
+    assert( trace->active );
+
+    /* A write covering just the trace's second range */
+    xlat_invalidate_block( 0x0C010408, 8 );
+    assert( xlat_get_code( 0x0C010200 ) == NULL );
+    xlat_check_integrity();
+}
+
+/**
+ * Test the execution counters and the activity ordering used to pick trace
+ * candidates
+ */
+void test_activity()
+{
+    struct xlat_block_ref refs[4];
+    int i;
+
+    for( i=0; i<300; i++ ) {
+        assert( xlat_count_execution( 0x0C011000 ) == (i < XLAT_MAX_EXECUTION_COUNT ? i+1 : XLAT_MAX_EXECUTION_COUNT) );
+    }
+    xlat_count_execution( 0x0C011002 );
+    xlat_flush_cache();
+    assert( xlat_get_execution_count( 0x0C011000 ) == XLAT_MAX_EXECUTION_COUNT );
+    assert( xlat_get_execution_count( 0x0C011002 ) == 1 );
+    assert( xlat_get_execution_count( 0x0C011004 ) == 0 );
+    assert( xlat_get_execution_count( 0x0D000000 ) == 0 );
+
+    xlat_cache_block_t a = test_block( 0x0C011000, 0x0C011010, 64 );
+    xlat_cache_block_t b = test_block( 0x0C011020, 0x0C011030, 64 );
+    xlat_cache_block_t c = test_block( 0x0C011040, 0x0C011050, 64 );
+    a->active = 10;
+    b->active = 50;
+    c->active = 30;
+    assert( xlat_get_active_block_count() == 3 );
+    assert( xlat_get_cache_blocks_by_activity( refs, 4 ) == 3 );
+    assert( refs[0].block == b && refs[0].pc == 0x0C011020 );
+    assert( refs[1].block == c && refs[1].pc == 0x0C011040 );
+    assert( refs[2].block == a && refs[2].pc == 0x0C011000 );
+    assert( xlat_get_cache_blocks_by_activity( refs, 1 ) == 1 );
+    assert( refs[0].block == b );
+    a->active = b->active = c->active = 1;
+    xlat_flush_cache();
+}
+
+/**
+ * Test that the source watch sees every range, invalidation and flush
+ */
+void test_source_watch()
+{
+    xlat_set_source_watch( &test_watch );
+    memset( &watched, 0, sizeof(watched) );
+    watched.start = 0xFFFFFFFF;
+
+    xlat_cache_block_t block = xlat_start_block( 0x0C012000 );
+    memset( block->code, 0xC3, 64 );
+    xlat_add_block_range( 0x0C012100, 0x0C012110 );
+    xlat_commit_block( 64, 0x0C012000, 0x0C012020 );
+    assert( watched.add_range >= 2 );
+    assert( watched.start == 0x0C012000 && watched.end == 0x0C012110 );
+
+    xlat_invalidate_block( 0x0C012100, 4 );
+    assert( watched.invalidate_range == 1 );
+    assert( xlat_get_code( 0x0C012000 ) == NULL );
+
+    xlat_flush_cache();
+    assert( watched.flush == 1 );
+
+    xlat_set_source_watch( NULL );
+}
+
+/**
+ * Test that a block saved to the persistent cache comes back with its
+ * pointers relocated, and is rejected once the source changes.
+ */
+void test_persist()
+{
+    char filename[] = "/tmp/testxltXXXXXX";
+    static int object1, object2;
+    void *objects[1] = { &object1 };
+    struct xlat_recovery_record recovery[2] = { { 0, 0 }, { 32, 3 } };
+    xlat_reloc_record_t reloc[5] = { 8<<1, 16<<1, (24<<1)|XLAT_RELOC_LINK, 40<<1, 48<<1 };
+    sh4addr_t pc = TEST_RAM_BASE + 0x100;
+    uint32_t total = 64 + sizeof(recovery) + sizeof(reloc);
+    int fd = mkstemp( filename );
+    assert( fd != -1 );
+    close( fd );
+    unlink( filename );
+
+    xlat_flush_cache();
+    memset( test_ram, 0x09, sizeof(test_ram) );
+    xlat_persist_init( filename, objects, 1 );
+    assert( xlat_persist_is_enabled() );
+
+    xlat_cache_block_t block = xlat_start_block( pc );
+    memset( block->code, 0x90, 64 );
+    memcpy( block->code + 64, recovery, sizeof(recovery) );
+    memcpy( block->code + 64 + sizeof(recovery), reloc, sizeof(reloc) );
+    *(void **)(block->code + 8) = block->code + 60;
+    *(void **)(block->code + 16) = &test_ram[0x10];
+    memset( block->code + 24, 0x55, 8 ); /* Linked */
+    *(void **)(block->code + 40) = &object1;
+    *(void **)(block->code + 48) = xlat_get_lut_entry( pc + 0x200 );
+    block->recover_table_offset = 64;
+    block->recover_table_size = 2;
+    block->reloc_table_size = 5;
+    block->xlat_sh4_mode = 1;
+    xlat_commit_block( total, pc, pc + 6 );
+
+    xlat_persist_capture( 7 );
+    assert( xlat_persist_save() );
+    assert( access( filename, R_OK ) == 0 );
+
+    /* Load it back, with a different object table */
+    objects[0] = &object2;
+    xlat_persist_init( filename, objects, 1 );
+    xlat_flush_cache();
+    assert( xlat_get_code( pc ) == NULL );
+    assert( xlat_persist_restore( pc, 1, 8 ) == NULL );
+    assert( xlat_persist_restore( pc, 0, 7 ) == NULL );
+    unsigned char *code = xlat_persist_restore( pc, 1, 7 );
+    assert( code != NULL );
+    assert( xlat_get_code( pc ) == code );
+    block = XLAT_BLOCK_FOR_CODE(code);
+    assert( block->xlat_sh4_mode == 1 );
+    assert( block->recover_table_offset == 64 );
+    assert( block->reloc_table_size == 5 );
+    assert( memcmp( XLAT_RELOC_TABLE(code), reloc, sizeof(reloc) ) == 0 );
+    assert( *(void **)(code + 8) == code + 60 );
+    assert( *(void **)(code + 16) == &test_ram[0x10] );
+    assert( code[24] == TEST_LINK_STUB && code[31] == TEST_LINK_STUB );
+    assert( *(void **)(code + 40) == &object2 );
+    assert( *(void **)(code + 48) == xlat_get_lut_entry( pc + 0x200 ) );
+    assert( code[0] == 0x90 && code[32] == 0x90 && code[63] == 0x90 );
+
+    /* Changing the source code (within the block) invalidates the entry */
+    xlat_flush_cache();
+    test_ram[0x104] = 0x0B;
+    assert( xlat_persist_restore( pc, 1, 7 ) == NULL );
+    test_ram[0x104] = 0x09;
+    assert( xlat_persist_restore( pc, 1, 7 ) == NULL );
+    xlat_flush_cache();
+    unlink( filename );
+}
+
 int main()
 {
     xlat_cache_init();
+    xlat_set_target_fns( &test_target_fns );
     xlat_check_integrity();
     
     test_initial();
+    test_block_ranges();
+    test_activity();
+    test_source_watch();
+    test_persist();
+    xlat_check_integrity();
     return 0;
 }
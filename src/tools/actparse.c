@@ -134,6 +134,21 @@ actiontoken_t action_file_next( actionfile_t af )
         af->token.symbol = ACTIONS;
         memset( af->token.actions, 0, sizeof(af->token.actions) );
 
+        /* Optional block mode on the rest of the %% line */
+        int modelen = 0;
+        while( af->yyposn < af->length && af->text[af->yyposn] != '\n' ) {
+            if( !isspace(af->text[af->yyposn]) ) {
+                if( modelen == MAX_BLOCK_MODE ) {
+                    fprintf( stderr, "gendec:%d: Block mode too long\n", af->yyline );
+                    af->token.symbol = ERROR;
+                    return &af->token;
+                }
+                af->token.mode[modelen++] = af->text[af->yyposn];
+            }
+            af->yyposn++;
+        }
+        af->token.mode[modelen] = '\0';
+
         char *operation = &af->text[af->yyposn];
         while( af->yyposn < af->length ) {
             if( af->text[af->yyposn] == '\n' ) {
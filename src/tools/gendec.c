@@ -36,6 +36,15 @@ const char *out_filename = NULL;
 #define GEN_SOURCE 1
 #define GEN_TEMPLATE 2
 
+/* Action block modes (the word following the opening %%) */
+#define BLOCK_SWITCH 0   /* Default: nested switch running the actions in place */
+#define BLOCK_DECODE 1   /* "decode": switch returning the index of the matching rule */
+#define BLOCK_THREADED 2 /* "threaded": one label per rule, for computed-goto dispatch */
+#define BLOCK_TABLE 3    /* "table": opcode-to-rule table and rule descriptors */
+#define BLOCK_INDEXED 4  /* "indexed": flat switch on the rule from the opcode table */
+
+#define TABLE_SIZE 65536
+
 FILE *ins_file, *act_file, *out_file;
 
 char *option_list = "tmho:w";
@@ -61,12 +70,13 @@ static void usage() {
 /**
  * Check that rules are provided for all actions
  */
-static void check_actions( struct ruleset *rules, const actiontoken_t token )
+static void check_actions( struct ruleset *rules, const actiontoken_t token,
+                           const struct action *actions )
 {
     int i;
     int warnings = 0;
     for( i=0; i<rules->rule_count; i++ ) {
-        if( token->actions[i].text == NULL ) {
+        if( actions[i].text == NULL ) {
             if( warnings == 0 ) {
                 fprintf( stderr, "In action block starting at line %d of file %s:\n",
                          token->lineno, token->filename );
@@ -74,7 +84,7 @@ static void check_actions( struct ruleset *rules, const actiontoken_t token )
             fprintf( stderr, "Warning: No action matches rule %d %s\n", i, rules->rules[i]->format );
             warnings++;
         } else {
-            const char *s = token->actions[i].text;
+            const char *s = actions[i].text;
             while( *s ) {
                 if( !isspace(*s) )
                     break;
@@ -86,7 +96,7 @@ static void check_actions( struct ruleset *rules, const actiontoken_t token )
                          token->lineno, token->filename );
                 }
                 fprintf( stderr, "Warning: Empty action for rule %d %s at line %d\n", i, rules->rules[i]->format,
-                    token->actions[i].lineno );
+                    actions[i].lineno );
                 warnings++;
             }
         }
@@ -209,16 +219,30 @@ static void fprint_action( struct rule *rule, const struct action *action, int d
     }
 }
 
+static void fprint_undef( struct ruleset *rules, int block_mode, int depth, FILE *f )
+{
+    if( block_mode == BLOCK_DECODE ) {
+        fprintf( f, "%*creturn %d;\n", depth*8, ' ', rules->rule_count );
+    } else {
+        fprintf( f, "%*cUNDEF(ir);\n", depth*8, ' ' );
+    }
+}
+
 static void split_and_generate( struct ruleset *rules, const struct action *actions, 
                          int ruleidx[], int rule_count, int input_mask, 
-                         int depth, FILE *f ) {
+                         int depth, int block_mode, FILE *f ) {
     uint32_t mask;
     int i,j;
 
     if( rule_count == 0 ) {
-        fprintf( f, "%*cUNDEF(ir);\n", depth*8, ' ' );
+        fprint_undef( rules, block_mode, depth, f );
     } else if( rule_count == 1 ) {
-        fprint_action( rules->rules[ruleidx[0]], &actions[ruleidx[0]], depth, f );
+        if( block_mode == BLOCK_DECODE ) {
+            fprintf( f, "%*creturn %d; /* %s */\n", depth*8, ' ', ruleidx[0],
+                     rules->rules[ruleidx[0]]->format );
+        } else {
+            fprint_action( rules->rules[ruleidx[0]], &actions[ruleidx[0]], depth, f );
+        }
     } else {
 
         mask = find_mask(rules, ruleidx, rule_count, input_mask);
@@ -259,21 +283,169 @@ static void split_and_generate( struct ruleset *rules, const struct action *acti
             } else {
                 fprintf( f, "%*ccase 0x%X:\n", depth*8+4, ' ', options[i]>>mask_shift );
                 split_and_generate( rules, actions, subruleidx, subrule_count,
-                                    mask|input_mask, depth+1, f );
+                                    mask|input_mask, depth+1, block_mode, f );
                 fprintf( f, "%*cbreak;\n", depth*8+8, ' ' );
             }
         }
         if( has_empty_options ) {
-            fprintf( f, "%*cdefault:\n%*cUNDEF(ir);\n%*cbreak;\n",
-                    depth*8+4, ' ', depth*8+8, ' ', depth*8 + 8, ' ' );
+            fprintf( f, "%*cdefault:\n", depth*8+4, ' ' );
+            fprint_undef( rules, block_mode, depth+1, f );
+            fprintf( f, "%*cbreak;\n", depth*8+8, ' ' );
         }
         fprintf( f, "%*c}\n", depth*8, ' ' );
     }
 }
 
+/**
+ * Generate the threaded form of an action block: a table of label addresses
+ * gendec_handlers[], indexed by rule number (as given by a decode or table
+ * block) with the undefined-instruction handler last, followed by a label for
+ * each rule that extracts the operands from ir and runs the action. Each handler
+ * finishes with GENDEC_NEXT(), which the surrounding text must define to
+ * dispatch the next instruction.
+ */
+static void generate_threaded( struct ruleset *rules, const struct action *actions, FILE *f )
+{
+    int i;
+
+    fprintf( f, "    static void * const gendec_handlers[%d] = {\n", rules->rule_count+1 );
+    for( i=0; i<rules->rule_count; i++ ) {
+        fprintf( f, "        &&gendec_op_%d,\n", i );
+    }
+    fprintf( f, "        &&gendec_undef };\n" );
+    for( i=0; i<rules->rule_count; i++ ) {
+        fprintf( f, "gendec_op_%d:\n", i );
+        fprint_action( rules->rules[i], &actions[i], 1, f );
+        fprintf( f, "        GENDEC_NEXT();\n" );
+    }
+    fprintf( f, "gendec_undef:\n" );
+    fprint_undef( rules, BLOCK_THREADED, 1, f );
+    fprintf( f, "        GENDEC_NEXT();\n" );
+}
+
+/**
+ * Return the rule that the generated switch would select for the given
+ * opcode (which isn't necessarily an exact match for the rule's bits), or
+ * the rule count if it would be undefined.
+ */
+static int decode_by_tree( struct ruleset *rules, int ruleidx[], int rule_count,
+                           uint32_t input_mask, uint32_t ir )
+{
+    uint32_t mask;
+    int subruleidx[rule_count];
+    int subrule_count = 0;
+    int i;
+
+    if( rule_count == 0 ) {
+        return rules->rule_count;
+    } else if( rule_count == 1 ) {
+        return ruleidx[0];
+    }
+    mask = find_mask( rules, ruleidx, rule_count, input_mask );
+    if( mask == 0 ) {
+        return rules->rule_count;
+    }
+    for( i=0; i<rule_count; i++ ) {
+        if( (rules->rules[ruleidx[i]]->bits & mask) == (ir & mask) ) {
+            subruleidx[subrule_count++] = ruleidx[i];
+        }
+    }
+    return decode_by_tree( rules, subruleidx, subrule_count, mask|input_mask, ir );
+}
+
+/**
+ * Generate the table form of the decoder at file scope: GENDEC_TABLE[], giving
+ * the rule index for each 16-bit opcode (the rule count for undefined
+ * opcodes), and GENDEC_RULES[], a descriptor for each rule and for the
+ * undefined instruction. The surrounding text must define GENDEC_TABLE and
+ * GENDEC_RULES to the names to use, and GENDEC_RULE_TYPE to a struct laid out
+ * as { format, operand_count, { { name, bit_shift, bit_count, left_shift,
+ * is_signed } x MAX_OPERANDS } }.
+ */
+static int generate_table( struct ruleset *rules, int ruleidx[], FILE *f )
+{
+    static uint16_t table[TABLE_SIZE];
+    uint32_t ir, start;
+    int i, j;
+
+    for( i=0; i<rules->rule_count; i++ ) {
+        if( rules->rules[i]->bit_count > 16 ) {
+            fprintf( stderr, "Error: table mode only supports 16-bit instructions (%s)\n",
+                     rules->rules[i]->format );
+            return -1;
+        }
+    }
+    for( ir=0; ir<TABLE_SIZE; ir++ ) {
+        table[ir] = decode_by_tree( rules, ruleidx, rules->rule_count, 0, ir );
+    }
+
+    /* Long runs of the same rule are common (eg immediate operands), so write
+     * those as ranges, and everything else as lines of up to 16 entries */
+    fprintf( f, "const uint16_t GENDEC_TABLE[%d] = {", TABLE_SIZE );
+    j = 0;
+    for( start=0; start<TABLE_SIZE; start=ir ) {
+        for( ir=start+1; ir<TABLE_SIZE && table[ir] == table[start]; ir++ );
+        if( ir - start >= 16 ) {
+            fprintf( f, "\n    [0x%04X ... 0x%04X] = %d,", start, ir-1, table[start] );
+            j = 0;
+        } else {
+            for( ir=start; ir<TABLE_SIZE && ir<start+16; ir++ ) {
+                uint32_t end;
+                for( end=ir+1; end<TABLE_SIZE && table[end] == table[ir]; end++ );
+                if( end - ir >= 16 ) {
+                    break;
+                }
+                if( j == 0 ) {
+                    fprintf( f, "\n    /* %04X */", ir );
+                }
+                fprintf( f, " %d,", table[ir] );
+                j = (j+1) & 15;
+            }
+        }
+    }
+    fprintf( f, "\n};\n\n" );
+
+    fprintf( f, "const GENDEC_RULE_TYPE GENDEC_RULES[%d] = {\n", rules->rule_count+1 );
+    for( i=0; i<rules->rule_count; i++ ) {
+        struct rule *rule = rules->rules[i];
+        fprintf( f, "    { \"%s\", %d, {", rule->format, rule->operand_count );
+        for( j=0; j<rule->operand_count; j++ ) {
+            fprintf( f, "%s { \"%s\", %d, %d, %d, %d }", j == 0 ? "" : ",",
+                     rule->operands[j].name, rule->operands[j].bit_shift,
+                     rule->operands[j].bit_count, rule->operands[j].left_shift,
+                     rule->operands[j].is_signed );
+        }
+        fprintf( f, " } },\n" );
+    }
+    fprintf( f, "    { \"UNDEF\", 0, { } } };\n" );
+    return 0;
+}
+
+/**
+ * Generate the indexed form of an action block: a single flat switch on
+ * GENDEC_TABLE[ir], so that decoding is one table load and one jump.
+ */
+static void generate_indexed( struct ruleset *rules, const struct action *actions, FILE *f )
+{
+    int i;
+
+    fprintf( f, "        switch( GENDEC_TABLE[ir] ) {\n" );
+    for( i=0; i<rules->rule_count; i++ ) {
+        fprintf( f, "            case %d:\n", i );
+        fprint_action( rules->rules[i], &actions[i], 2, f );
+        fprintf( f, "                break;\n" );
+    }
+    fprintf( f, "            default:\n" );
+    fprint_undef( rules, BLOCK_INDEXED, 2, f );
+    fprintf( f, "                break;\n" );
+    fprintf( f, "        }\n" );
+}
+
 static int generate_decoder( struct ruleset *rules, actionfile_t af, FILE *out )
 {
     int ruleidx[rules->rule_count];
+    struct action last_actions[MAX_RULES];
+    int have_last_actions = 0;
     int i;
 
     for( i=0; i<rules->rule_count; i++ ) {
@@ -289,11 +461,60 @@ static int generate_decoder( struct ruleset *rules, actionfile_t af, FILE *out )
             fprintf( stderr, "Error parsing action file" );
             return -1;
         } else {
-            if( emit_warnings ) {
-                check_actions( rules, token );
+            int block_mode = BLOCK_SWITCH;
+            const struct action *actions = token->actions;
+            int has_actions = 0;
+
+            for( i=0; i<rules->rule_count; i++ ) {
+                if( token->actions[i].text != NULL ) {
+                    has_actions = 1;
+                    break;
+                }
+            }
+            if( strcmp( token->mode, "decode" ) == 0 ) {
+                block_mode = BLOCK_DECODE;
+            } else if( strcmp( token->mode, "table" ) == 0 ) {
+                block_mode = BLOCK_TABLE;
+            } else if( strcmp( token->mode, "indexed" ) == 0 ) {
+                block_mode = BLOCK_INDEXED;
+            } else if( strcmp( token->mode, "threaded" ) == 0 ) {
+                block_mode = BLOCK_THREADED;
+                /* An empty threaded block shares the actions of the previous block */
+                if( !has_actions && have_last_actions ) {
+                    actions = last_actions;
+                    has_actions = 1;
+                }
+            } else if( token->mode[0] != '\0' ) {
+                fprintf( stderr, "%s:%d: Unknown action block mode '%s'\n", token->filename,
+                         token->lineno, token->mode );
+                return -1;
+            }
+
+            if( has_actions && actions == token->actions ) {
+                memcpy( last_actions, token->actions, sizeof(last_actions) );
+                have_last_actions = 1;
+            }
+            if( block_mode == BLOCK_TABLE ) {
+                if( generate_table( rules, ruleidx, out ) != 0 ) {
+                    return -1;
+                }
+                token = action_file_next(af);
+                continue;
+            }
+            if( emit_warnings && block_mode != BLOCK_DECODE ) {
+                check_actions( rules, token, actions );
             }
             fprintf( out, "#pragma clang diagnostic push\n#pragma clang diagnostic ignored \"-Wunused-variable\"\n" );
-            split_and_generate( rules, token->actions, ruleidx, rules->rule_count, 0, 1, out );
+            if( block_mode == BLOCK_THREADED ) {
+                generate_threaded( rules, actions, out );
+            } else if( block_mode == BLOCK_INDEXED ) {
+                generate_indexed( rules, actions, out );
+            } else {
+                split_and_generate( rules, actions, ruleidx, rules->rule_count, 0, 1, block_mode, out );
+                if( block_mode == BLOCK_DECODE ) {
+                    fprint_undef( rules, block_mode, 1, out );
+                }
+            }
             fprintf( out, "#pragma clang diagnostic pop\n" );
         }
         token = action_file_next(af);
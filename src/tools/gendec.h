@@ -72,11 +72,16 @@ struct action {
 
 typedef struct actionfile *actionfile_t;
 
+#define MAX_BLOCK_MODE 16
+
 typedef struct actiontoken {
     enum { NONE, TEXT, ACTIONS, END, ERROR } symbol;
     const char *filename;
     int lineno;
     char *text;
+    /* For ACTIONS, the word following the opening %% if any (eg "threaded"),
+     * otherwise the empty string */
+    char mode[MAX_BLOCK_MODE+1];
     struct action actions[MAX_RULES];
 } *actiontoken_t;
 
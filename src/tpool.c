@@ -0,0 +1,153 @@
+/**
+ * $Id$
+ *
+ * Fixed-size pool of worker threads for data-parallel jobs.
+ *
+ * Indexes are handed out one at a time from a shared counter, so a job with
+ * uneven work per index still balances across the threads. Workers sleep on
+ * a condition variable between jobs.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "lxdream.h"
+#include "tpool.h"
+
+struct tpool {
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    unsigned num_workers;
+    pthread_t *workers;
+
+    /* Current job. Written by tpool_run under the mutex */
+    tpool_fn_t fn;
+    void *data;
+    unsigned count;
+    unsigned next;       /* Next index to hand out (atomic) */
+    unsigned active;     /* Workers still running the current job */
+    unsigned generation; /* Incremented for each new job */
+    gboolean shutdown;
+};
+
+static void tpool_do_work( struct tpool *pool )
+{
+    unsigned i;
+    while( (i = __atomic_fetch_add( &pool->next, 1, __ATOMIC_RELAXED )) < pool->count ) {
+        pool->fn( pool->data, i );
+    }
+}
+
+static void *tpool_worker_main( void *arg )
+{
+    struct tpool *pool = (struct tpool *)arg;
+    unsigned seen = 0;
+
+    pthread_mutex_lock( &pool->mutex );
+    for(;;) {
+        while( !pool->shutdown && pool->generation == seen ) {
+            pthread_cond_wait( &pool->work_cond, &pool->mutex );
+        }
+        if( pool->shutdown ) {
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock( &pool->mutex );
+
+        tpool_do_work( pool );
+
+        pthread_mutex_lock( &pool->mutex );
+        if( --pool->active == 0 ) {
+            pthread_cond_signal( &pool->done_cond );
+        }
+    }
+    pthread_mutex_unlock( &pool->mutex );
+    return NULL;
+}
+
+tpool_t tpool_new( unsigned threads )
+{
+    struct tpool *pool = g_malloc0( sizeof(struct tpool) );
+    unsigned i;
+
+    if( threads == 0 ) {
+        long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+        threads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    pthread_mutex_init( &pool->mutex, NULL );
+    pthread_cond_init( &pool->work_cond, NULL );
+    pthread_cond_init( &pool->done_cond, NULL );
+    pool->workers = g_malloc0( sizeof(pthread_t) * threads );
+    for( i=0; i+1 < threads; i++ ) {
+        if( pthread_create( &pool->workers[i], NULL, tpool_worker_main, pool ) != 0 ) {
+            WARN( "Unable to create worker thread, continuing with %d threads", i+1 );
+            break;
+        }
+    }
+    pool->num_workers = i;
+    return pool;
+}
+
+void tpool_run( tpool_t pool, unsigned count, tpool_fn_t fn, void *data )
+{
+    if( pool->num_workers == 0 || count <= 1 ) {
+        unsigned i;
+        for( i=0; i<count; i++ ) {
+            fn( data, i );
+        }
+        return;
+    }
+
+    pthread_mutex_lock( &pool->mutex );
+    pool->fn = fn;
+    pool->data = data;
+    pool->count = count;
+    pool->next = 0;
+    pool->active = pool->num_workers;
+    pool->generation++;
+    pthread_cond_broadcast( &pool->work_cond );
+    pthread_mutex_unlock( &pool->mutex );
+
+    tpool_do_work( pool );
+
+    pthread_mutex_lock( &pool->mutex );
+    while( pool->active != 0 ) {
+        pthread_cond_wait( &pool->done_cond, &pool->mutex );
+    }
+    pthread_mutex_unlock( &pool->mutex );
+}
+
+unsigned tpool_get_threads( tpool_t pool )
+{
+    return pool->num_workers + 1;
+}
+
+void tpool_destroy( tpool_t pool )
+{
+    unsigned i;
+    pthread_mutex_lock( &pool->mutex );
+    pool->shutdown = TRUE;
+    pthread_cond_broadcast( &pool->work_cond );
+    pthread_mutex_unlock( &pool->mutex );
+    for( i=0; i<pool->num_workers; i++ ) {
+        pthread_join( pool->workers[i], NULL );
+    }
+    pthread_cond_destroy( &pool->done_cond );
+    pthread_cond_destroy( &pool->work_cond );
+    pthread_mutex_destroy( &pool->mutex );
+    g_free( pool->workers );
+    g_free( pool );
+}
@@ -0,0 +1,65 @@
+/**
+ * $Id$
+ *
+ * Fixed-size pool of worker threads for data-parallel jobs. Each job is a
+ * parallel for-loop over [0, count): the calling thread takes part in the
+ * work, and tpool_run() returns once every index has been processed.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef lxdream_tpool_H
+#define lxdream_tpool_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tpool *tpool_t;
+
+/**
+ * Work function, called once for each index of the job. Calls for different
+ * indexes may run concurrently, in any order.
+ */
+typedef void (*tpool_fn_t)( void *data, unsigned index );
+
+/**
+ * Create a new pool.
+ * @param threads the total number of threads to run jobs on, including the
+ * caller (so 1 creates no workers and runs everything inline). 0 means one
+ * per online CPU.
+ */
+tpool_t tpool_new( unsigned threads );
+
+/**
+ * Run fn(data, i) for every i in [0, count), and wait for all of them to
+ * complete. Not re-entrant: only one thread may run jobs on a given pool at
+ * a time.
+ */
+void tpool_run( tpool_t pool, unsigned count, tpool_fn_t fn, void *data );
+
+/**
+ * @return the total number of threads in the pool (including the caller)
+ */
+unsigned tpool_get_threads( tpool_t pool );
+
+/**
+ * Stop the pool's worker threads and free it.
+ */
+void tpool_destroy( tpool_t pool );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !lxdream_tpool_H */
@@ -143,7 +143,12 @@ extern unsigned char *xlat_output;
 #define OP16(x) *((uint16_t *)xlat_output) = (x); xlat_output+=2
 #define OP32(x) *((uint32_t *)xlat_output) = (x); xlat_output+=4
 #define OP64(x) *((uint64_t *)xlat_output) = (x); xlat_output+=8
-#define OPPTR(x) *((void **)xlat_output) = ((void *)x); xlat_output+=(sizeof(void*))
+/* Hook called with the output position of every absolute host pointer that
+ * is emitted, so that the client can record relocation sites. */
+#ifndef OPPTR_NOTE
+#define OPPTR_NOTE(p)
+#endif
+#define OPPTR(x) OPPTR_NOTE(xlat_output); *((void **)xlat_output) = ((void *)x); xlat_output+=(sizeof(void*))
 
 /* Primary opcode emitter, eg OPCODE(0x0FBE) for MOVSX */
 #define OPCODE(x) if( (x) > 0xFFFF ) { OP((x)>>16); OP(((x)>>8)&0xFF); OP((x)&0xFF); } else if( (x) > 0xFF ) { OP((x)>>8); OP((x)&0xFF); } else { OP(x); }
@@ -359,6 +364,7 @@ static inline void x86_encode_modrm_rip(int rexw, uint32_t opcode, int rr, int32
 #define ADCB_r8_r8(r1,r2)            x86_encode_r32_rm32(0x10, r1, r2)
 #define ADCL_imms_r32(imm,r1)        x86_encode_imms_rm32(0x83, 0x81, 2, imm, r1)
 #define ADCL_imms_rbpdisp(imm,disp)  x86_encode_imms_rbpdisp32(0x83, 0x81, 2, imm, disp)
+#define ADCL_imms_r32disp(imm,rb,d)  x86_encode_imms_r32disp32(0x83, 0x81, 2, imm, rb, d)
 #define ADCL_r32_r32(r1,r2)          x86_encode_r32_rm32(0x11, r1, r2)
 #define ADCL_r32_rbpdisp(r1,disp)    x86_encode_r32_rbpdisp32(0x11, r1, disp)
 #define ADCL_rbpdisp_r32(disp,r1)    x86_encode_r32_rbpdisp32(0x13, r1, disp)
@@ -434,6 +440,7 @@ static inline void x86_encode_modrm_rip(int rexw, uint32_t opcode, int rr, int32
 #define LEAP_sib_rptr(ss,ii,bb,d,r1) x86_encode_rptr_memptr(0x8D, r1, bb, ii, ss, d)
 
 #define MOVB_r8_r8(r1,r2)            x86_encode_r32_rm32(0x88, r1, r2)
+#define MOVB_r8_sib(r1,ss,ii,bb,d)   x86_encode_r32_mem32(0x88, r1, bb, ii, ss, d)
 #define MOVL_imm32_r32(i32,r1)       x86_encode_opcode32(0xB8, r1); OP32(i32)
 #define MOVL_imm32_rbpdisp(i,disp)   x86_encode_r32_rbpdisp32(0xC7,0,disp); OP32(i)
 #define MOVL_imm32_rspdisp(i,disp)   x86_encode_r32_rspdisp32(0xC7,0,disp); OP32(i)
@@ -456,6 +463,7 @@ static inline void x86_encode_modrm_rip(int rexw, uint32_t opcode, int rr, int32
 #define MOVQ_rspdisp_r64(disp,r1)    x86_encode_r64_rspdisp64(0x8B, r1, disp)
 #define MOVP_immptr_rptr(p,r1)       x86_encode_opcodereg( PREF_PTR, 0xB8, r1); OPPTR(p)
 #define MOVP_moffptr_rax(p)          if( sizeof(void*)==8 ) { OP(PREF_REXW); } OP(0xA1); OPPTR(p)
+#define MOVP_rax_moffptr(p)          if( sizeof(void*)==8 ) { OP(PREF_REXW); } OP(0xA3); OPPTR(p)
 #define MOVP_rptr_rptr(r1,r2)        x86_encode_reg_rm(PREF_PTR, 0x89, r1, r2)
 #define MOVP_sib_rptr(ss,ii,bb,d,r1) x86_encode_rptr_memptr(0x8B, r1, bb, ii, ss, d)
 #define MOVP_rptrdisp_rptr(r1,dsp,r2) x86_encode_rptr_memptrdisp(0x8B, r2, r1, dsp)
@@ -464,6 +472,8 @@ static inline void x86_encode_modrm_rip(int rexw, uint32_t opcode, int rr, int32
 #define MOVSXL_r16_r32(r1,r2)        x86_encode_r32_rm32(0x0FBF, r2, r1)
 #define MOVSXL_rbpdisp8_r32(disp,r1) x86_encode_r32_rbpdisp32(0x0FBE, r1, disp) 
 #define MOVSXL_rbpdisp16_r32(dsp,r1) x86_encode_r32_rbpdisp32(0x0FBF, r1, dsp) 
+#define MOVSXL_sib8_r32(ss,ii,bb,d,r1)  x86_encode_r32_mem32(0x0FBE, r1, bb, ii, ss, d)
+#define MOVSXL_sib16_r32(ss,ii,bb,d,r1) x86_encode_r32_mem32(0x0FBF, r1, bb, ii, ss, d)
 #define MOVSXQ_imm32_r64(i32,r1)     x86_encode_r64_rm64(0xC7, 0, r1); OP32(i32) /* Technically a MOV */
 #define MOVSXQ_r8_r64(r1,r2)         x86_encode_r64_rm64(0x0FBE, r2, r1)
 #define MOVSXQ_r16_r64(r1,r2)        x86_encode_r64_rm64(0x0FBF, r2, r1)
@@ -475,6 +485,8 @@ static inline void x86_encode_modrm_rip(int rexw, uint32_t opcode, int rr, int32
 #define MOVZXL_rbpdisp8_r32(disp,r1) x86_encode_r32_rbpdisp32(0x0FB6, r1, disp)
 #define MOVZXL_rbpdisp16_r32(dsp,r1) x86_encode_r32_rbpdisp32(0x0FB7, r1, dsp)
 
+#define MOVW_r16_sib(r1,ss,ii,bb,d)  OP(0x66); x86_encode_r32_mem32(0x89, r1, bb, ii, ss, d)
+
 #define MULL_r32(r1)                 x86_encode_r32_rm32(0xF7, 4, r1)
 #define MULL_rbpdisp(disp)           x86_encode_r32_rbpdisp32(0xF7,4,disp)
 #define MULL_rspdisp(disp)           x86_encode_r32_rspdisp32(0xF7,4,disp)
@@ -486,6 +498,7 @@ static inline void x86_encode_modrm_rip(int rexw, uint32_t opcode, int rr, int32
 
 #define NOP()                        OP(0x90)
 #define NOP2()                       OP(0x66); OP(0x90)
+#define NOPL_disp32(disp)            OP(0x0F); OP(0x1F); OP(0x80); OP32(disp) /* 7-byte NOP */
 
 #define NOTB_r8(r1)                  x86_encode_r32_rm32(0xF6, 2, r1)
 #define NOTL_r32(r1)                 x86_encode_r32_rm32(0xF7, 2, r1)
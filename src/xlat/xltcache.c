@@ -20,6 +20,8 @@
 #include <sys/mman.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "dreamcast.h"
 #include "sh4/sh4core.h"
@@ -56,6 +58,15 @@
 #define BLOCK_ACTIVE 1
 #define BLOCK_USED 2
 
+/** Timeslices between checks of the new space size */
+#define XLAT_POLICY_INTERVAL 256
+/** Grow the new space if it wraps around more often than this (timeslices) */
+#define XLAT_GROW_WRAP_TICKS 8192
+/** Consider shrinking the new space after this long without wrapping */
+#define XLAT_SHRINK_IDLE_TICKS (1<<17)
+/** Seconds between metrics reports */
+#define XLAT_METRICS_PERIOD 5
+
 xlat_cache_block_t xlat_new_cache;
 xlat_cache_block_t xlat_new_cache_ptr;
 xlat_cache_block_t xlat_new_create_ptr;
@@ -68,15 +79,37 @@ xlat_cache_block_t xlat_old_cache_ptr;
 #endif
 
 static void **xlat_lut[XLAT_LUT_PAGES];
+/* Execution counters, one byte per LUT entry, allocated with the first count
+ * in the page. Only touched by the emulation thread */
+static uint8_t *xlat_count_lut[XLAT_LUT_PAGES];
 static gboolean xlat_initialized = FALSE;
 static xlat_target_fns_t xlat_target = NULL;
+static xlat_source_watch_t xlat_source_watch = NULL;
+static xlat_invalidate_hook_t xlat_invalidate_hook = NULL;
+static xlat_commit_hook_t xlat_commit_hook = NULL;
 
 static size_t xlat_new_cache_size = XLAT_NEW_CACHE_SIZE;
+/* Adaptive sizing limits for the new space. The maximum is reserved up front,
+ * but only the current size is ever touched */
+static size_t xlat_new_cache_min_size = XLAT_NEW_CACHE_SIZE;
+static size_t xlat_new_cache_max_size = XLAT_NEW_CACHE_SIZE;
+
+static struct xlat_cache_stats xlat_stats;
+static gboolean xlat_metrics_enabled = FALSE;
+static uint32_t xlat_ticks = 0;
+static uint32_t xlat_last_wrap_tick = 0;
+static uint32_t xlat_policy_wraps = 0; /* Wraps at the last policy check */
+/* Counters and host time at the previous xlat_print_cache_stats */
+static struct xlat_cache_stats xlat_last_stats;
+static double xlat_last_stats_time = 0;
+static double xlat_last_metrics_time = 0;
 #ifdef XLAT_GENERATIONAL_CACHE
 static size_t xlat_temp_cache_size = XLAT_TEMP_CACHE_SIZE;
 static size_t xlat_old_cache_size = XLAT_OLD_CACHE_SIZE;
 #endif
 
+static double xlat_get_host_time( void );
+
 static inline size_t parse_mb_env(const char *name, size_t fallback_bytes)
 {
     const char *env = getenv(name);
@@ -95,15 +128,29 @@ void xlat_cache_init(void)
         const char *metrics = getenv("LXDREAM_JIT_METRICS");
         if( metrics && *metrics ) {
             fprintf(stderr, "[JIT] metrics enabled (env LXDREAM_JIT_METRICS)\n");
+            xlat_metrics_enabled = TRUE;
         }
+        xlat_last_stats_time = xlat_last_metrics_time = xlat_get_host_time();
         /* Allow env overrides */
         xlat_new_cache_size = parse_mb_env("LXDREAM_JIT_NEW_MB", XLAT_NEW_CACHE_SIZE);
+        xlat_new_cache_min_size = xlat_new_cache_max_size = xlat_new_cache_size;
+        const char *adaptive = getenv("LXDREAM_JIT_ADAPTIVE");
+        if( adaptive == NULL || strcmp(adaptive, "0") != 0 ) {
+            xlat_new_cache_min_size = parse_mb_env("LXDREAM_JIT_MIN_MB", XLAT_NEW_CACHE_MIN_SIZE);
+            xlat_new_cache_max_size = parse_mb_env("LXDREAM_JIT_MAX_MB", XLAT_NEW_CACHE_MAX_SIZE);
+            if( xlat_new_cache_min_size > xlat_new_cache_size ) {
+                xlat_new_cache_min_size = xlat_new_cache_size;
+            }
+            if( xlat_new_cache_max_size < xlat_new_cache_size ) {
+                xlat_new_cache_max_size = xlat_new_cache_size;
+            }
+        }
 #ifdef XLAT_GENERATIONAL_CACHE
         xlat_temp_cache_size = parse_mb_env("LXDREAM_JIT_TEMP_MB", XLAT_TEMP_CACHE_SIZE);
         xlat_old_cache_size = parse_mb_env("LXDREAM_JIT_OLD_MB", XLAT_OLD_CACHE_SIZE);
 #endif
-        xlat_new_cache = (xlat_cache_block_t)mmap( NULL, xlat_new_cache_size, PROT_EXEC|PROT_READ|PROT_WRITE,
-                MAP_PRIVATE|MAP_ANON, -1, 0 );
+        xlat_new_cache = (xlat_cache_block_t)mmap( NULL, xlat_new_cache_max_size, PROT_EXEC|PROT_READ|PROT_WRITE,
+                MAP_PRIVATE|MAP_ANON|MAP_NORESERVE, -1, 0 );
         xlat_new_cache_ptr = xlat_new_cache;
         xlat_new_create_ptr = xlat_new_cache;
 #ifdef XLAT_GENERATIONAL_CACHE
@@ -117,6 +164,7 @@ void xlat_cache_init(void)
 //        xlat_lut = mmap( NULL, XLAT_LUT_PAGES*sizeof(void *), PROT_READ|PROT_WRITE,
 //                MAP_PRIVATE|MAP_ANON, -1, 0);
         memset( xlat_lut, 0, XLAT_LUT_PAGES*sizeof(void *) );
+        memset( xlat_count_lut, 0, XLAT_LUT_PAGES*sizeof(uint8_t *) );
     }
     xlat_flush_cache();
 }
@@ -126,6 +174,35 @@ void xlat_set_target_fns( xlat_target_fns_t target )
     xlat_target = target;
 }
 
+void xlat_set_source_watch( xlat_source_watch_t watch )
+{
+    xlat_source_watch = watch;
+}
+
+void xlat_set_invalidate_hook( xlat_invalidate_hook_t hook )
+{
+    xlat_invalidate_hook = hook;
+}
+
+void xlat_set_commit_hook( xlat_commit_hook_t hook )
+{
+    xlat_commit_hook = hook;
+}
+
+void xlat_unlink_site( uint8_t *site )
+{
+    assert( xlat_target != NULL && xlat_target->unlink_site != NULL );
+    xlat_target->unlink_site( site );
+}
+
+void xlat_unlink_block( xlat_cache_block_t block )
+{
+    if( block->use_list != NULL ) {
+        xlat_target->unlink_block( block->use_list );
+        block->use_list = NULL;
+    }
+}
+
 /**
  * Reset the cache structure to its default state
  */
@@ -133,6 +210,7 @@ void xlat_flush_cache()
 {
     xlat_cache_block_t tmp;
     int i;
+    xlat_stats.flushes++;
     xlat_new_cache_ptr = xlat_new_cache;
     xlat_new_cache_ptr->active = 0;
     xlat_new_cache_ptr->size = (int)(xlat_new_cache_size - 2*sizeof(struct xlat_cache_block));
@@ -158,12 +236,26 @@ void xlat_flush_cache()
             memset( xlat_lut[i], 0, XLAT_LUT_PAGE_SIZE );
         }
     }
+    if( xlat_source_watch != NULL ) {
+        xlat_source_watch->flush();
+    }
 }
 
 void xlat_delete_block( xlat_cache_block_t block )
 {
     block->active = 0;
-    *block->lut_entry = block->chain;
+    void *code = XLAT_CODE_ADDR(*block->lut_entry);
+    if( code == block->code ) {
+        *block->lut_entry = block->chain;
+    } else {
+        /* Not the head of the chain (eg superseded by a trace) - unlink it */
+        while( code != NULL && XLAT_BLOCK_CHAIN(code) != block->code ) {
+            code = XLAT_BLOCK_CHAIN(code);
+        }
+        if( code != NULL ) {
+            XLAT_BLOCK_CHAIN(code) = block->chain;
+        }
+    }
     if( block->use_list != NULL )
         xlat_target->unlink_block(block->use_list);
 }
@@ -177,6 +269,7 @@ static void xlat_flush_page_by_lut( void **page )
             do {
                 xlat_cache_block_t block = XLAT_BLOCK_FOR_CODE(p);
                 xlat_delete_block(block);
+                xlat_stats.invalidations++;
                 p = block->chain;
             } while( p != NULL );
         }
@@ -187,6 +280,9 @@ static void xlat_flush_page_by_lut( void **page )
 void FASTCALL xlat_invalidate_word( sh4addr_t addr )
 {
     void **page = xlat_lut[XLAT_LUT_PAGE(addr)];
+    if( xlat_invalidate_hook != NULL ) {
+        xlat_invalidate_hook( addr, 2 );
+    }
     if( page != NULL ) {
         int entry = XLAT_LUT_ENTRY(addr);
         if( entry == 0 && IS_ENTRY_CONTINUATION(page[entry]) ) {
@@ -202,6 +298,9 @@ void FASTCALL xlat_invalidate_word( sh4addr_t addr )
 void FASTCALL xlat_invalidate_long( sh4addr_t addr )
 {
     void **page = xlat_lut[XLAT_LUT_PAGE(addr)];
+    if( xlat_invalidate_hook != NULL ) {
+        xlat_invalidate_hook( addr, 4 );
+    }
     if( page != NULL ) {
         int entry = XLAT_LUT_ENTRY(addr);
         if( entry == 0 && IS_ENTRY_CONTINUATION(page[entry]) ) {
@@ -221,6 +320,12 @@ void FASTCALL xlat_invalidate_block( sh4addr_t address, size_t size )
     uint32_t page_no = XLAT_LUT_PAGE(address);
     int entry = XLAT_LUT_ENTRY(address);
 
+    if( xlat_source_watch != NULL ) {
+        xlat_source_watch->invalidate_range( address, size );
+    }
+    if( xlat_invalidate_hook != NULL ) {
+        xlat_invalidate_hook( address, size );
+    }
     if( entry == 0 && xlat_lut[page_no] != NULL && IS_ENTRY_CONTINUATION(xlat_lut[page_no][entry])) {
         /* First entry may be a delay-slot for the previous page */
         xlat_flush_page_by_lut(xlat_lut[XLAT_LUT_PAGE(address-2)]);
@@ -254,6 +359,9 @@ void FASTCALL xlat_invalidate_block( sh4addr_t address, size_t size )
 void FASTCALL xlat_flush_page( sh4addr_t address )
 {
     void **page = xlat_lut[XLAT_LUT_PAGE(address)];
+    if( xlat_invalidate_hook != NULL ) {
+        xlat_invalidate_hook( address & ~(XLAT_SOURCE_PAGE_SIZE-1), XLAT_SOURCE_PAGE_SIZE );
+    }
     if( page != NULL ) {
         xlat_flush_page_by_lut(page);
     }
@@ -266,6 +374,10 @@ void * FASTCALL xlat_get_code( sh4addr_t address )
     if( page != NULL ) {
         result = XLAT_CODE_ADDR(page[XLAT_LUT_ENTRY(address)]);
     }
+    xlat_stats.lookups++;
+    if( result == NULL ) {
+        xlat_stats.misses++;
+    }
     return result;
 }
 
@@ -291,17 +403,44 @@ static void **xlat_get_lut_page( sh4addr_t address )
 {
     void **page = xlat_lut[XLAT_LUT_PAGE(address)];
 
-     /* Add the LUT entry for the block */
+     /* Add the LUT entry for the block. The page may be allocated by the
+      * background translator (with the translation lock held) while the
+      * emulation thread is reading the table, so fill it in before publishing */
      if( page == NULL ) {
-         xlat_lut[XLAT_LUT_PAGE(address)] = page =
-             (void **)mmap( NULL, XLAT_LUT_PAGE_SIZE, PROT_READ|PROT_WRITE,
+         page = (void **)mmap( NULL, XLAT_LUT_PAGE_SIZE, PROT_READ|PROT_WRITE,
                      MAP_PRIVATE|MAP_ANON, -1, 0 );
          memset( page, 0, XLAT_LUT_PAGE_SIZE );
+         __atomic_store_n( &xlat_lut[XLAT_LUT_PAGE(address)], page, __ATOMIC_RELEASE );
      }
 
      return page;
 }
 
+uint32_t FASTCALL xlat_count_execution( sh4addr_t address )
+{
+    uint8_t *page = xlat_count_lut[XLAT_LUT_PAGE(address)];
+    if( page == NULL ) {
+        page = (uint8_t *)mmap( NULL, XLAT_LUT_PAGE_ENTRIES, PROT_READ|PROT_WRITE,
+                MAP_PRIVATE|MAP_ANON, -1, 0 );
+        memset( page, 0, XLAT_LUT_PAGE_ENTRIES );
+        xlat_count_lut[XLAT_LUT_PAGE(address)] = page;
+    }
+    uint8_t *count = &page[XLAT_LUT_ENTRY(address)];
+    if( *count != XLAT_MAX_EXECUTION_COUNT ) {
+        (*count)++;
+    }
+    return *count;
+}
+
+uint32_t FASTCALL xlat_get_execution_count( sh4addr_t address )
+{
+    uint8_t *page = xlat_count_lut[XLAT_LUT_PAGE(address)];
+    if( page == NULL ) {
+        return 0;
+    }
+    return page[XLAT_LUT_ENTRY(address)];
+}
+
 void ** FASTCALL xlat_get_lut_entry( sh4addr_t address )
 {
     void **page = xlat_get_lut_page(address);
@@ -386,6 +525,7 @@ static void xlat_promote_to_old_space( xlat_cache_block_t block )
     start_block->recover_table_size = block->recover_table_size;
     *block->lut_entry = &start_block->code;
     memcpy( start_block->code, block->code, block->size );
+    xlat_stats.promotions_old++;
     xlat_old_cache_ptr = xlat_cut_block(start_block, size );
     if( xlat_old_cache_ptr->size == 0 ) {
         xlat_old_cache_ptr = xlat_old_cache;
@@ -408,6 +548,7 @@ void xlat_promote_to_temp_space( xlat_cache_block_t block )
         } else if( curr->active == BLOCK_ACTIVE ) {
             // Active but not used, release block
             *((uintptr_t *)curr->lut_entry) &= ((uintptr_t)0x03);
+            xlat_stats.evictions++;
         }
         allocation += curr->size + sizeof(struct xlat_cache_block);
         curr = NEXT(curr);
@@ -434,6 +575,7 @@ void xlat_promote_to_temp_space( xlat_cache_block_t block )
     start_block->recover_table_size = block->recover_table_size;
     *block->lut_entry = &start_block->code;
     memcpy( start_block->code, block->code, block->size );
+    xlat_stats.promotions_temp++;
     xlat_temp_cache_ptr = xlat_cut_block(start_block, size );
     if( xlat_temp_cache_ptr->size == 0 ) {
         xlat_temp_cache_ptr = xlat_temp_cache;
@@ -445,6 +587,7 @@ void xlat_promote_to_temp_space( xlat_cache_block_t block )
 {
     *block->lut_entry = block->chain;
     xlat_delete_block(block);
+    xlat_stats.evictions++;
 }
 #endif
 
@@ -456,6 +599,7 @@ xlat_cache_block_t xlat_start_block( sh4addr_t address )
 {
     if( xlat_new_cache_ptr->size == 0 ) {
         xlat_new_cache_ptr = xlat_new_cache;
+        xlat_stats.wraps++;
     }
 
     if( xlat_new_cache_ptr->active ) {
@@ -476,6 +620,7 @@ xlat_cache_block_t xlat_start_block( sh4addr_t address )
         xlat_new_create_ptr->chain = NULL;
     }
     xlat_new_create_ptr->use_list = NULL;
+    xlat_new_create_ptr->flags = 0;
 
     *p = &xlat_new_create_ptr->code;
     if( IS_ENTRY_CONTINUATION(entry) ) {
@@ -498,8 +643,10 @@ xlat_cache_block_t xlat_extend_block( uint32_t newSize )
             int size = oldsize + MIN_BLOCK_SIZE; /* minimum expansion */
             void **lut_entry = xlat_new_create_ptr->lut_entry;
             void *chain = xlat_new_create_ptr->chain;
+            uint32_t flags = xlat_new_create_ptr->flags;
             int allocation = (int)-sizeof(struct xlat_cache_block);
             xlat_new_cache_ptr = xlat_new_cache;
+            xlat_stats.wraps++;
             do {
                 if( xlat_new_cache_ptr->active ) {
                     xlat_promote_to_temp_space( xlat_new_cache_ptr );
@@ -513,6 +660,7 @@ xlat_cache_block_t xlat_extend_block( uint32_t newSize )
             xlat_new_create_ptr->lut_entry = lut_entry;
             xlat_new_create_ptr->chain = chain;
             xlat_new_create_ptr->use_list = NULL;
+            xlat_new_create_ptr->flags = flags;
             *lut_entry = &xlat_new_create_ptr->code;
             memmove( xlat_new_create_ptr->code, olddata, oldsize );
         } else {
@@ -527,19 +675,36 @@ xlat_cache_block_t xlat_extend_block( uint32_t newSize )
 
 }
 
-void xlat_commit_block( uint32_t destsize, sh4addr_t startpc, sh4addr_t endpc )
+void xlat_add_block_range( sh4addr_t startpc, sh4addr_t endpc )
 {
-    void **entry = xlat_get_lut_entry(startpc+2);
-    /* assume main entry has already been set at this point */
+    void **entry = xlat_get_lut_entry(startpc);
 
-    for( sh4addr_t pc = startpc+2; pc < endpc; pc += 2 ) {
+    for( sh4addr_t pc = startpc; pc < endpc; pc += 2 ) {
         if( XLAT_LUT_ENTRY(pc) == 0 )
             entry = xlat_get_lut_entry(pc);
         *((uintptr_t *)entry) |= (uintptr_t)XLAT_LUT_ENTRY_USED;
         entry++;
     }
+    if( xlat_source_watch != NULL ) {
+        xlat_source_watch->add_range( startpc, endpc );
+    }
+}
+
+void xlat_commit_block( uint32_t destsize, sh4addr_t startpc, sh4addr_t endpc )
+{
+    /* assume main entry has already been set at this point */
+    xlat_add_block_range( startpc+2, endpc );
+    if( xlat_source_watch != NULL ) {
+        xlat_source_watch->add_range( startpc, startpc+2 );
+    }
 
     xlat_new_cache_ptr = xlat_cut_block( xlat_new_create_ptr, destsize );
+    xlat_stats.translations++;
+    xlat_stats.translated_bytes += destsize;
+    if( xlat_commit_hook != NULL ) {
+        xlat_commit_hook( startpc, endpc, xlat_new_create_ptr->code,
+                          xlat_get_code_size(xlat_new_create_ptr->code) );
+    }
 }
 
 void xlat_check_cache_integrity( xlat_cache_block_t cache, xlat_cache_block_t ptr, int size )
@@ -591,6 +756,18 @@ sh4addr_t xlat_get_address( unsigned char *ptr )
     return -1;
 }
 
+sh4addr_t xlat_get_lut_entry_address( void **entry )
+{
+    int i;
+    for( i=0; i<XLAT_LUT_PAGES; i++ ) {
+        void **page = xlat_lut[i];
+        if( page != NULL && entry >= page && entry < page + XLAT_LUT_PAGE_ENTRIES ) {
+            return XLAT_ADDR_FROM_ENTRY(i, entry - page);
+        }
+    }
+    return -1;
+}
+
 /**
  * Sanity check that the given pointer is at least contained in one of cache
  * regions, and has a sane-ish size. We don't do a full region walk atm.
@@ -629,6 +806,20 @@ gboolean xlat_is_code_pointer( void *p )
     return TRUE;
 }
 
+gboolean xlat_is_code_address( void *p )
+{
+    if( (uintptr_t)(((char *)p) - (char *)xlat_new_cache) < xlat_new_cache_max_size ) {
+        return TRUE;
+    }
+#ifdef XLAT_GENERATIONAL_CACHE
+    if( (uintptr_t)(((char *)p) - (char *)xlat_temp_cache) < xlat_temp_cache_size ||
+        (uintptr_t)(((char *)p) - (char *)xlat_old_cache) < xlat_old_cache_size ) {
+        return TRUE;
+    }
+#endif
+    return FALSE;
+}
+
 void xlat_check_integrity( )
 {
     xlat_check_cache_integrity( xlat_new_cache, xlat_new_cache_ptr, (int)xlat_new_cache_size );
@@ -638,6 +829,166 @@ void xlat_check_integrity( )
 #endif
 }
 
+static double xlat_get_host_time( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void xlat_get_cache_stats( struct xlat_cache_stats *stats )
+{
+    xlat_cache_block_t ptr = xlat_new_cache;
+    size_t run = 0;
+    *stats = xlat_stats;
+    stats->size = xlat_new_cache_size;
+    stats->live_bytes = stats->free_bytes = stats->largest_free = 0;
+    stats->free_fragments = 0;
+    while( ptr->size != 0 ) {
+        size_t bytes = ptr->size + sizeof(struct xlat_cache_block);
+        if( ptr->active != 0 ) {
+            stats->live_bytes += bytes;
+            run = 0;
+        } else {
+            if( run == 0 ) {
+                stats->free_fragments++;
+            }
+            run += bytes;
+            stats->free_bytes += bytes;
+            if( run > stats->largest_free ) {
+                stats->largest_free = run;
+            }
+        }
+        ptr = NEXT(ptr);
+    }
+}
+
+void xlat_print_cache_stats( FILE *out )
+{
+    struct xlat_cache_stats stats;
+    double now = xlat_get_host_time();
+    double elapsed = now - xlat_last_stats_time;
+    xlat_get_cache_stats( &stats );
+
+    uint64_t lookups = stats.lookups - xlat_last_stats.lookups;
+    uint64_t misses = stats.misses - xlat_last_stats.misses;
+    fprintf( out, "[JIT] cache: %lld translations (%.1f/s, %lld bytes), %u flushes, %u wraps, "
+             "%lld evictions, %lld invalidations, %lld/%lld promotions to temp/old; "
+             "%.2f%% lookup misses\n",
+             (long long int)stats.translations,
+             elapsed > 0 ? (stats.translations - xlat_last_stats.translations) / elapsed : 0.0,
+             (long long int)stats.translated_bytes, stats.flushes, stats.wraps,
+             (long long int)stats.evictions, (long long int)stats.invalidations,
+             (long long int)stats.promotions_temp, (long long int)stats.promotions_old,
+             lookups == 0 ? 0.0 : (100.0 * misses) / lookups );
+    fprintf( out, "[JIT] new space: %lldKB (%u grows, %u shrinks), %lldKB live, %lldKB free/wasted "
+             "in %u fragments (largest %lldKB, %.0f%% fragmentation)\n",
+             (long long int)(stats.size>>10), stats.grows, stats.shrinks,
+             (long long int)(stats.live_bytes>>10), (long long int)(stats.free_bytes>>10),
+             stats.free_fragments, (long long int)(stats.largest_free>>10),
+             stats.free_bytes == 0 ? 0.0 : 100.0 - (100.0 * stats.largest_free) / stats.free_bytes );
+    xlat_last_stats = stats;
+    xlat_last_stats_time = now;
+}
+
+/**
+ * Grow the new space to the given size. The end-of-cache sentinel becomes a
+ * free block covering the extra space.
+ */
+static void xlat_grow_new_cache( size_t size )
+{
+    xlat_cache_block_t sentinel = (xlat_cache_block_t)(((char *)xlat_new_cache) +
+            xlat_new_cache_size - sizeof(struct xlat_cache_block));
+    xlat_cache_block_t tail = (xlat_cache_block_t)(((char *)xlat_new_cache) +
+            size - sizeof(struct xlat_cache_block));
+    assert( sentinel->size == 0 );
+    tail->active = 1;
+    tail->size = 0;
+    sentinel->active = 0;
+    sentinel->size = (uint32_t)(size - xlat_new_cache_size - sizeof(struct xlat_cache_block));
+    xlat_new_cache_size = size;
+    xlat_stats.grows++;
+}
+
+/**
+ * Shrink the new space to (approximately) the given size, discarding any
+ * blocks past the new end, and release the memory beyond it.
+ */
+static void xlat_shrink_new_cache( size_t size )
+{
+    char *limit = ((char *)xlat_new_cache) + size - sizeof(struct xlat_cache_block);
+    xlat_cache_block_t ptr = xlat_new_cache, tail;
+    while( ((char *)NEXT(ptr)) <= limit ) {
+        ptr = NEXT(ptr);
+    }
+    /* ptr is the block containing the new end - either cut it there, or if
+     * the end falls within its header, make it the new sentinel */
+    if( ((char *)ptr->code) < limit ) {
+        tail = (xlat_cache_block_t)limit;
+    } else {
+        tail = ptr;
+    }
+    for( ; ptr->size != 0; ptr = NEXT(ptr) ) {
+        if( ptr->active ) {
+            xlat_delete_block( ptr );
+            xlat_stats.evictions++;
+        }
+    }
+    if( ((char *)xlat_new_cache_ptr) >= (char *)tail ) {
+        xlat_new_cache_ptr = xlat_new_cache;
+    }
+    /* Re-find the block before the sentinel, and cut it to fit */
+    for( ptr = xlat_new_cache; NEXT(ptr) < tail; ptr = NEXT(ptr) );
+    if( ptr != tail ) {
+        ptr->size = (uint32_t)(((char *)tail) - (char *)ptr->code);
+    }
+    tail->active = 1;
+    tail->size = 0;
+    xlat_new_cache_size = ((char *)tail) - (char *)xlat_new_cache + sizeof(struct xlat_cache_block);
+
+    uintptr_t release = (((uintptr_t)tail) + sizeof(struct xlat_cache_block) + 4095) & ~((uintptr_t)4095);
+    uintptr_t end = ((uintptr_t)xlat_new_cache) + xlat_new_cache_max_size;
+    if( release < end ) {
+        madvise( (void *)release, end - release, MADV_DONTNEED );
+    }
+    xlat_stats.shrinks++;
+}
+
+void xlat_cache_tick( void )
+{
+    if( ++xlat_ticks % XLAT_POLICY_INTERVAL != 0 ) {
+        return;
+    }
+
+    if( xlat_stats.wraps != xlat_policy_wraps ) {
+        uint32_t since_wrap = xlat_ticks - xlat_last_wrap_tick;
+        xlat_policy_wraps = xlat_stats.wraps;
+        xlat_last_wrap_tick = xlat_ticks;
+        if( since_wrap < XLAT_GROW_WRAP_TICKS && xlat_new_cache_size < xlat_new_cache_max_size ) {
+            /* Recycling live code too fast - give it more room */
+            size_t size = xlat_new_cache_size * 2;
+            xlat_grow_new_cache( size > xlat_new_cache_max_size ? xlat_new_cache_max_size : size );
+        }
+    } else if( xlat_ticks - xlat_last_wrap_tick >= XLAT_SHRINK_IDLE_TICKS &&
+               xlat_new_cache_size > xlat_new_cache_min_size ) {
+        struct xlat_cache_stats stats;
+        xlat_get_cache_stats( &stats );
+        xlat_last_wrap_tick = xlat_ticks;
+        if( stats.live_bytes < xlat_new_cache_size / 4 ) {
+            size_t size = xlat_new_cache_size / 2;
+            xlat_shrink_new_cache( size < xlat_new_cache_min_size ? xlat_new_cache_min_size : size );
+        }
+    }
+
+    if( xlat_metrics_enabled ) {
+        double now = xlat_get_host_time();
+        if( now - xlat_last_metrics_time >= XLAT_METRICS_PERIOD ) {
+            xlat_last_metrics_time = now;
+            xlat_print_cache_stats( stderr );
+        }
+    }
+}
+
 unsigned int xlat_get_active_block_count()
 {
     unsigned int count = 0;
@@ -668,33 +1019,29 @@ unsigned int xlat_get_active_blocks( struct xlat_block_ref *blocks, unsigned int
     return count;
 }
 
-static void xlat_get_block_pcs( struct xlat_block_ref *blocks, unsigned int size )
+unsigned int xlat_get_blocks_by_address( xlat_block_ref_t blocks, unsigned int size )
 {
-    unsigned i;
-    for( i=0; i<XLAT_LUT_PAGES;i ++ ) {
+    unsigned int count = 0;
+    unsigned i, j;
+    for( i=0; i<XLAT_LUT_PAGES; i++ ) {
         void **page = xlat_lut[i];
         if( page != NULL ) {
-            for( unsigned j=0; j < XLAT_LUT_PAGE_ENTRIES; j++ ) {
-                void *code = XLAT_CODE_ADDR(page[j]);
-                if( code != NULL ) {
-                    xlat_cache_block_t ptr = XLAT_BLOCK_FOR_CODE(code);
-                    sh4addr_t pc = XLAT_ADDR_FROM_ENTRY(i,j);
-                    for( unsigned k=0; k<size; k++ ) {
-                        if( blocks[k].block == ptr ) {
-                            blocks[k].pc = pc;
-                            ptr = ptr->chain;
-                            if( ptr == NULL )
-                                break;
-                            else {
-                                ptr = XLAT_BLOCK_FOR_CODE(ptr);
-                                k = 0;
-                            }
-                        }
+            for( j=0; j<XLAT_LUT_PAGE_ENTRIES; j++ ) {
+                if( IS_ENTRY_POINT(page[j]) ) {
+                    void *code = XLAT_CODE_ADDR(page[j]);
+                    while( code != NULL ) {
+                        if( count >= size )
+                            return count;
+                        blocks[count].block = XLAT_BLOCK_FOR_CODE(code);
+                        blocks[count].pc = XLAT_ADDR_FROM_ENTRY(i,j);
+                        count++;
+                        code = XLAT_BLOCK_CHAIN(code);
                     }
                 }
             }
         }
     }
+    return count;
 }
 
 static int xlat_compare_active_field( const void *a, const void *b )
@@ -708,13 +1055,13 @@ unsigned int xlat_get_cache_blocks_by_activity( xlat_block_ref_t outblocks, size
 {
     int count = xlat_get_active_block_count();
 
-    struct xlat_block_ref blocks[count];
-    xlat_get_active_blocks(blocks, count);
-    xlat_get_block_pcs(blocks,count);
+    struct xlat_block_ref *blocks = g_malloc( (count+1) * sizeof(struct xlat_block_ref) );
+    count = xlat_get_blocks_by_address(blocks, count);
     qsort(blocks, count, sizeof(struct xlat_block_ref), xlat_compare_active_field);
 
     if( topN > count )
         topN = count;
     memcpy(outblocks, blocks, topN*sizeof(struct xlat_block_ref));
+    g_free(blocks);
     return topN;
 }
@@ -16,6 +16,7 @@
  * GNU General Public License for more details.
  */
 
+#include <stdio.h>
 #include "dream.h"
 #include "mem.h"
 
@@ -44,15 +45,70 @@ struct xlat_cache_block {
     void *chain;
     void *use_list;
     uint32_t xlat_sh4_mode; /* comparison with sh4r.xlat_sh4_mode */
+    uint32_t flags; /* XLAT_BLOCK_FLAG_* */
     uint32_t recover_table_offset; // Offset from code[0] of the recovery table;
     uint32_t recover_table_size;
+    uint32_t reloc_table_size; // Number of relocation records following the recovery table
     unsigned char code[0];
 } __attribute__((packed));
 
+/** Block is a trace, or has been superseded by one - either way it is not
+ * considered again for trace formation */
+#define XLAT_BLOCK_FLAG_TRACE 1
+
+/**
+ * Size in bytes of the source page covered by one lookup table page. A write
+ * to translated code anywhere within a page flushes every block that starts in
+ * that page, so a block may only span discontiguous code within its own page.
+ */
+#define XLAT_SOURCE_PAGE_SIZE 0x2000
+
+/**
+ * Relocation records identify every location in the block that holds an
+ * absolute host pointer, or a patchable link to another block, so that the
+ * block can be moved between processes (see xltpersist.h). Each record is the
+ * code offset of the site shifted left by one, with the low bit set for
+ * block-link sites. A block with no relocation table cannot be relocated.
+ */
+typedef uint32_t xlat_reloc_record_t;
+#define XLAT_RELOC_LINK 1
+#define XLAT_RELOC_OFFSET(rec) ((rec)>>1)
+#define XLAT_RELOC_IS_LINK(rec) ((rec)&XLAT_RELOC_LINK)
+
 typedef struct xlat_target_fns {
     void (*unlink_block)(void *use_list);
+    /* Rewrite the (possibly linked) block-link site at the given address
+     * back to its unlinked form */
+    void (*unlink_site)(uint8_t *site);
 } *xlat_target_fns_t;
 
+/**
+ * Optional observer of the SH4 memory that translated code is built from, eg
+ * to write-protect it. The cache reports each source range as it's added to a
+ * block, each range passed to xlat_invalidate_block, and each flush of the
+ * entire cache.
+ */
+typedef struct xlat_source_watch {
+    void (*add_range)( sh4addr_t start, sh4addr_t end );
+    void (*invalidate_range)( sh4addr_t start, size_t bytes );
+    void (*flush)( void );
+} *xlat_source_watch_t;
+
+/**
+ * Optional hook for other caches of decoded SH4 code (eg the interpreter's
+ * pre-decoded pages), called with each range of code invalidated through the
+ * xlat_invalidate_* and xlat_flush_page functions.
+ */
+typedef void (*xlat_invalidate_hook_t)( sh4addr_t start, size_t bytes );
+
+/**
+ * Optional observer of newly committed blocks (eg to publish them to an
+ * external profiler), called from xlat_commit_block with the source range and
+ * the generated code, not including the recovery and relocation tables.
+ */
+typedef void (*xlat_commit_hook_t)( sh4addr_t startpc, sh4addr_t endpc,
+                                    const unsigned char *code, uint32_t code_size );
+
 typedef struct xlat_cache_block *xlat_cache_block_t;
 
 #define XLAT_BLOCK_FOR_CODE(code) (((xlat_cache_block_t)code)-1)
@@ -60,6 +116,7 @@ typedef struct xlat_cache_block *xlat_cache_block_t;
 #define XLAT_BLOCK_MODE(code) (XLAT_BLOCK_FOR_CODE(code)->xlat_sh4_mode)
 #define XLAT_BLOCK_CHAIN(code) (XLAT_BLOCK_FOR_CODE(code)->chain)
 #define XLAT_RECOVERY_TABLE(code) ((xlat_recovery_record_t)(((char *)code) + XLAT_BLOCK_FOR_CODE(code)->recover_table_offset))
+#define XLAT_RELOC_TABLE(code) ((xlat_reloc_record_t *)(XLAT_RECOVERY_TABLE(code) + XLAT_BLOCK_FOR_CODE(code)->recover_table_size))
 
 /**
  * Initialize the translation cache
@@ -71,6 +128,34 @@ void xlat_cache_init(void);
  */
 void xlat_set_target_fns( xlat_target_fns_t target_fns );
 
+/**
+ * Set the source watch, or NULL for none.
+ */
+void xlat_set_source_watch( xlat_source_watch_t watch );
+
+/**
+ * Set the invalidation hook, or NULL for none.
+ */
+void xlat_set_invalidate_hook( xlat_invalidate_hook_t hook );
+
+/**
+ * Set the commit hook, or NULL for none.
+ */
+void xlat_set_commit_hook( xlat_commit_hook_t hook );
+
+/**
+ * Restore the block-link site at the given address to its unlinked form, using
+ * the target support functions.
+ */
+void xlat_unlink_site( uint8_t *site );
+
+/**
+ * Remove all direct links to the given block from other blocks, so that they
+ * will be resolved again (through the lookup table) the next time they're
+ * taken.
+ */
+void xlat_unlink_block( xlat_cache_block_t block );
+
 /**
  * Returns the next block in the new cache list that can be written to by the
  * translator.
@@ -93,6 +178,15 @@ xlat_cache_block_t xlat_extend_block( uint32_t newSize );
  */
 void xlat_commit_block( uint32_t destsize, sh4addr_t startpc, sh4addr_t endpc );
 
+/**
+ * Mark an additional range of source code as belonging to the current block,
+ * for blocks that are not a single linear run of instructions (ie traces). The
+ * range must be within the same source page as the block start.
+ * @param startpc PC of the first instruction in the range
+ * @param endpc PC of the next instruction after the range
+ */
+void xlat_add_block_range( sh4addr_t startpc, sh4addr_t endpc );
+
 /**
  * Delete (deactivate) the specified block from the cache. Caller is responsible
  * for ensuring that there really is a block there.
@@ -130,6 +224,24 @@ void * FASTCALL xlat_get_code_by_vma( sh4vma_t address );
  */
 void ** FASTCALL xlat_get_lut_entry( sh4addr_t address );
 
+/** Execution counts saturate at this value */
+#define XLAT_MAX_EXECUTION_COUNT 255
+
+/**
+ * Count an execution of the (untranslated) code at the given SH4 address, in
+ * a table of small saturating counters that shadows the lookup table. The
+ * counters are never reset (not even by xlat_flush_cache), so code that was
+ * hot before a flush doesn't have to warm up again.
+ * @return the new count, up to XLAT_MAX_EXECUTION_COUNT.
+ */
+uint32_t FASTCALL xlat_count_execution( sh4addr_t address );
+
+/**
+ * @return the execution count for the given SH4 address (see
+ * xlat_count_execution)
+ */
+uint32_t FASTCALL xlat_get_execution_count( sh4addr_t address );
+
 /**
  * Retrieve the current host address of the running translated code block.
  * @return the host PC, or null if there is no currently executing translated
@@ -179,6 +291,19 @@ void xlat_flush_cache();
  */
 gboolean xlat_is_code_pointer( void *p );
 
+/**
+ * Test if the given pointer is anywhere within the translation cache (eg the
+ * host PC of a fault in translated code)
+ */
+gboolean xlat_is_code_address( void *p );
+
+/**
+ * Perform a reverse lookup to find the SH4 address corresponding to the given
+ * lookup table entry pointer (as returned by xlat_get_lut_entry). This is slow.
+ * @return the address, or -1 if the pointer is not within the lookup table.
+ */
+sh4addr_t xlat_get_lut_entry_address( void **entry );
+
 /**
  * Check the internal integrity of the cache
  */
@@ -202,4 +327,62 @@ unsigned int xlat_get_cache_blocks_by_activity( xlat_block_ref_t records, size_t
 
 void xlat_dump_cache_by_activity( unsigned int topN );
 
+/**
+ * Translation cache statistics. The counters run from xlat_cache_init; the
+ * space figures describe the new space at the time of the call.
+ */
+struct xlat_cache_stats {
+    uint64_t translations;    /* Blocks committed */
+    uint64_t translated_bytes; /* ...and their total size */
+    uint64_t lookups;         /* Calls to xlat_get_code */
+    uint64_t misses;          /* ...that found no code */
+    uint64_t evictions;       /* Live blocks discarded to make room */
+    uint64_t invalidations;   /* Blocks discarded because their source changed */
+    uint64_t promotions_temp; /* Blocks moved from new to temp space */
+    uint64_t promotions_old;  /* Blocks moved from temp to old space */
+    uint32_t flushes;         /* Flushes of the entire cache */
+    uint32_t wraps;           /* Times the new space allocator wrapped around */
+    uint32_t grows, shrinks;  /* Adaptive resizes of the new space */
+    size_t size;              /* Current size of the new space */
+    size_t live_bytes;        /* Bytes in live blocks (including headers) */
+    size_t free_bytes;        /* Bytes in free or discarded blocks */
+    uint32_t free_fragments;  /* Number of runs of free space */
+    size_t largest_free;      /* Largest run of free space */
+};
+
+/**
+ * Retrieve the current cache statistics. Walks the whole cache.
+ */
+void xlat_get_cache_stats( struct xlat_cache_stats *stats );
+
+/**
+ * Print the cache statistics. Rates are given per second of host time since
+ * the previous call.
+ */
+void xlat_print_cache_stats( FILE *out );
+
+/**
+ * Called by the dispatcher once per timeslice. Periodically resizes the new
+ * space according to how fast it's being recycled: it's doubled (up to
+ * LXDREAM_JIT_MAX_MB) if the allocator wraps around too frequently, ie live
+ * code is being evicted and retranslated, and halved (down to
+ * LXDREAM_JIT_MIN_MB) after a long period without wrapping in which less
+ * than a quarter of it is in use. Set LXDREAM_JIT_ADAPTIVE=0 to keep the size
+ * fixed. When LXDREAM_JIT_METRICS is set, the statistics are also printed
+ * every few seconds.
+ */
+void xlat_cache_tick( void );
+
+/**
+ * Retrieve the number of active blocks in the cache
+ */
+unsigned int xlat_get_active_block_count();
+
+/**
+ * Fetch up to size blocks reachable from the lookup table (including chained
+ * mode variants), along with the SH4 address of each block.
+ * @return the number of records retrieved
+ */
+unsigned int xlat_get_blocks_by_address( xlat_block_ref_t blocks, unsigned int size );
+
 #endif /* lxdream_xltcache_H */
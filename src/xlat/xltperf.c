@@ -0,0 +1,269 @@
+/**
+ * $Id$
+ *
+ * Export translated blocks to host profilers, as a perf map and/or a jitdump
+ * file. The jitdump layout follows tools/perf/Documentation/
+ * jitdump-specification.txt in the Linux source tree: a fixed header followed
+ * by timestamped records, of which we only use CODE_LOAD and CODE_CLOSE.
+ * perf only picks up the jitdump file if the process has it mapped
+ * executable, so the first page is kept mapped for as long as it's open.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for syscall */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "lxdream.h"
+#include "xlat/xltcache.h"
+#include "xlat/xltperf.h"
+
+#define JITDUMP_MAGIC 0x4A695444
+#define JITDUMP_VERSION 1
+#define JIT_CODE_LOAD 0
+#define JIT_CODE_CLOSE 3
+
+#if defined(__x86_64__)
+#define JITDUMP_ELF_MACH 62 /* EM_X86_64 */
+#elif defined(__i386__)
+#define JITDUMP_ELF_MACH 3 /* EM_386 */
+#else
+#define JITDUMP_ELF_MACH 0
+#endif
+
+/** Nanoseconds between automatic flushes */
+#define XLAT_PERF_FLUSH_PERIOD 1000000000ULL
+#define XLAT_PERF_BUFFER_SIZE 65536
+#define XLAT_PERF_MAX_LABEL 256
+
+struct jitdump_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t elf_mach;
+    uint32_t pad1;
+    uint32_t pid;
+    uint64_t timestamp;
+    uint64_t flags;
+};
+
+struct jitdump_record_header {
+    uint32_t id;
+    uint32_t total_size;
+    uint64_t timestamp;
+};
+
+struct jitdump_code_load {
+    struct jitdump_record_header header;
+    uint32_t pid;
+    uint32_t tid;
+    uint64_t vma;
+    uint64_t code_addr;
+    uint64_t code_size;
+    uint64_t code_index;
+    /* Followed by the nul-terminated name, then the code bytes */
+};
+
+static FILE *xlat_perf_map = NULL;
+static FILE *xlat_perf_jitdump = NULL;
+static void *xlat_perf_jitdump_marker = NULL;
+static size_t xlat_perf_jitdump_marker_size = 0;
+static xlat_perf_symbol_fn_t xlat_perf_lookup = NULL;
+static uint64_t xlat_perf_code_index = 0;
+static uint64_t xlat_perf_last_flush = 0;
+static uint32_t xlat_perf_pid, xlat_perf_tid;
+
+/**
+ * Timestamps have to come from the same clock perf uses for its samples
+ * ("perf record -k mono").
+ */
+static uint64_t xlat_perf_timestamp( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ((uint64_t)ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+static void xlat_perf_label( char *buf, size_t len, sh4addr_t startpc )
+{
+    const char *sym = NULL;
+    uint32_t offset = 0;
+    if( xlat_perf_lookup != NULL ) {
+        sym = xlat_perf_lookup( startpc, &offset );
+    }
+    if( sym == NULL ) {
+        snprintf( buf, len, "sh4:%08x", startpc );
+    } else if( offset == 0 ) {
+        snprintf( buf, len, "sh4:%08x %s", startpc, sym );
+    } else {
+        snprintf( buf, len, "sh4:%08x %s+0x%x", startpc, sym, offset );
+    }
+}
+
+static void xlat_perf_commit( sh4addr_t startpc, sh4addr_t endpc,
+                              const unsigned char *code, uint32_t code_size )
+{
+    char label[XLAT_PERF_MAX_LABEL];
+    uint64_t now = xlat_perf_timestamp();
+
+    xlat_perf_label( label, sizeof(label), startpc );
+    if( xlat_perf_map != NULL ) {
+        fprintf( xlat_perf_map, "%" PRIxPTR " %x %s\n", (uintptr_t)code, code_size, label );
+    }
+    if( xlat_perf_jitdump != NULL ) {
+        struct jitdump_code_load rec;
+        size_t label_size = strlen(label) + 1;
+        rec.header.id = JIT_CODE_LOAD;
+        rec.header.total_size = sizeof(rec) + label_size + code_size;
+        rec.header.timestamp = now;
+        rec.pid = xlat_perf_pid;
+        rec.tid = xlat_perf_tid;
+        rec.vma = (uintptr_t)code;
+        rec.code_addr = (uintptr_t)code;
+        rec.code_size = code_size;
+        rec.code_index = xlat_perf_code_index++;
+        fwrite( &rec, sizeof(rec), 1, xlat_perf_jitdump );
+        fwrite( label, label_size, 1, xlat_perf_jitdump );
+        fwrite( code, code_size, 1, xlat_perf_jitdump );
+    }
+    if( now - xlat_perf_last_flush >= XLAT_PERF_FLUSH_PERIOD ) {
+        xlat_perf_flush();
+        xlat_perf_last_flush = now;
+    }
+}
+
+static FILE *xlat_perf_open_map( void )
+{
+    char filename[64];
+    snprintf( filename, sizeof(filename), "/tmp/perf-%d.map", (int)xlat_perf_pid );
+    FILE *f = fopen( filename, "w" );
+    if( f == NULL ) {
+        WARN( "Unable to open perf map %s: %s", filename, strerror(errno) );
+    } else {
+        setvbuf( f, NULL, _IOFBF, XLAT_PERF_BUFFER_SIZE );
+        INFO( "Writing perf map to %s", filename );
+    }
+    return f;
+}
+
+static FILE *xlat_perf_open_jitdump( const char *dir )
+{
+    char *filename = g_strdup_printf( "%s/jit-%d.dump", dir, (int)xlat_perf_pid );
+    FILE *f = NULL;
+    int fd = open( filename, O_CREAT|O_TRUNC|O_RDWR, 0666 );
+    if( fd == -1 ) {
+        WARN( "Unable to open jitdump file %s: %s", filename, strerror(errno) );
+        g_free( filename );
+        return NULL;
+    }
+
+    xlat_perf_jitdump_marker_size = sysconf(_SC_PAGESIZE);
+    xlat_perf_jitdump_marker = mmap( NULL, xlat_perf_jitdump_marker_size,
+                                     PROT_READ|PROT_EXEC, MAP_PRIVATE, fd, 0 );
+    if( xlat_perf_jitdump_marker == MAP_FAILED ) {
+        WARN( "Unable to map jitdump file %s: %s", filename, strerror(errno) );
+        xlat_perf_jitdump_marker = NULL;
+        close( fd );
+    } else {
+        struct jitdump_header head;
+        f = fdopen( fd, "w" );
+        setvbuf( f, NULL, _IOFBF, XLAT_PERF_BUFFER_SIZE );
+        memset( &head, 0, sizeof(head) );
+        head.magic = JITDUMP_MAGIC;
+        head.version = JITDUMP_VERSION;
+        head.total_size = sizeof(head);
+        head.elf_mach = JITDUMP_ELF_MACH;
+        head.pid = xlat_perf_pid;
+        head.timestamp = xlat_perf_timestamp();
+        fwrite( &head, sizeof(head), 1, f );
+        INFO( "Writing jitdump to %s", filename );
+    }
+    g_free( filename );
+    return f;
+}
+
+gboolean xlat_perf_init( gboolean perf_map, const char *jitdump_dir, xlat_perf_symbol_fn_t lookup )
+{
+    xlat_perf_shutdown();
+    xlat_perf_pid = getpid();
+#ifdef __linux__
+    xlat_perf_tid = syscall( SYS_gettid );
+#else
+    xlat_perf_tid = xlat_perf_pid;
+#endif
+    xlat_perf_lookup = lookup;
+    xlat_perf_code_index = 0;
+    xlat_perf_last_flush = xlat_perf_timestamp();
+    if( perf_map ) {
+        xlat_perf_map = xlat_perf_open_map();
+    }
+    if( jitdump_dir != NULL ) {
+        xlat_perf_jitdump = xlat_perf_open_jitdump( jitdump_dir );
+    }
+    if( xlat_perf_is_enabled() ) {
+        xlat_set_commit_hook( xlat_perf_commit );
+        return TRUE;
+    }
+    return FALSE;
+}
+
+gboolean xlat_perf_is_enabled( void )
+{
+    return xlat_perf_map != NULL || xlat_perf_jitdump != NULL;
+}
+
+void xlat_perf_flush( void )
+{
+    if( xlat_perf_map != NULL ) {
+        fflush( xlat_perf_map );
+    }
+    if( xlat_perf_jitdump != NULL ) {
+        fflush( xlat_perf_jitdump );
+    }
+}
+
+void xlat_perf_shutdown( void )
+{
+    if( !xlat_perf_is_enabled() ) {
+        return;
+    }
+    xlat_set_commit_hook( NULL );
+    if( xlat_perf_map != NULL ) {
+        fclose( xlat_perf_map );
+        xlat_perf_map = NULL;
+    }
+    if( xlat_perf_jitdump != NULL ) {
+        struct jitdump_record_header rec;
+        rec.id = JIT_CODE_CLOSE;
+        rec.total_size = sizeof(rec);
+        rec.timestamp = xlat_perf_timestamp();
+        fwrite( &rec, sizeof(rec), 1, xlat_perf_jitdump );
+        fclose( xlat_perf_jitdump );
+        xlat_perf_jitdump = NULL;
+        munmap( xlat_perf_jitdump_marker, xlat_perf_jitdump_marker_size );
+        xlat_perf_jitdump_marker = NULL;
+    }
+}
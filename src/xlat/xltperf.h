@@ -0,0 +1,71 @@
+/**
+ * $Id$
+ *
+ * Export translated blocks to host profilers. Each block is described as it's
+ * committed to the translation cache, either as a line in a perf map
+ * (/tmp/perf-<pid>.map), which perf uses directly to symbolize samples, or as
+ * a record in a jitdump file (jit-<pid>.dump) which also carries the code
+ * bytes, for use with "perf inject --jit".
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef lxdream_xltperf_H
+#define lxdream_xltperf_H 1
+
+#include "xlat/xltcache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Look up the guest symbol containing the given address.
+ * @param addr source address of a block
+ * @param offset receives the offset of addr from the start of the symbol
+ * @return the symbol name, or NULL if there is none.
+ */
+typedef const char *(*xlat_perf_symbol_fn_t)( sh4addr_t addr, uint32_t *offset );
+
+/**
+ * Start exporting blocks. Blocks already in the cache are not described, so
+ * this should be called before any translation takes place.
+ * @param perf_map TRUE to write /tmp/perf-<pid>.map
+ * @param jitdump_dir directory to write jit-<pid>.dump to, or NULL for none
+ * @param lookup symbol lookup used to label blocks, or NULL to label them by
+ * address alone.
+ * @return TRUE if at least one output was opened.
+ */
+gboolean xlat_perf_init( gboolean perf_map, const char *jitdump_dir, xlat_perf_symbol_fn_t lookup );
+
+/**
+ * @return TRUE if blocks are being exported.
+ */
+gboolean xlat_perf_is_enabled( void );
+
+/**
+ * Write out any buffered entries. This also happens automatically when a
+ * block is committed more than a second after the last flush.
+ */
+void xlat_perf_flush( void );
+
+/**
+ * Flush and close the output files, and stop exporting blocks.
+ */
+void xlat_perf_shutdown( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !lxdream_xltperf_H */
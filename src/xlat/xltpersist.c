@@ -0,0 +1,542 @@
+/**
+ * $Id$
+ *
+ * Persistent (on-disk) translation cache.
+ *
+ * Saved blocks are keyed by physical address, xlat_sh4_mode and translator
+ * variant, and carry a hash of the SH4 code they were translated from. Every
+ * absolute pointer in a saved block (as listed in the block's relocation
+ * table) is stored in a position-independent form - relative to the block
+ * itself, the executable image, SH4 physical memory, the lookup table, or one
+ * of a small set of client-supplied heap objects - and is rebased when the
+ * block is restored. Block-link sites are saved in their unlinked form.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for dladdr */
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+#include "lxdream.h"
+#include "mem.h"
+#include "xlat/xltcache.h"
+#include "xlat/xltpersist.h"
+
+#define XLAT_PERSIST_MAGIC "LXDXLAT"
+#define XLAT_PERSIST_VERSION 1
+#define XLAT_PERSIST_BUCKETS 4096
+#define XLAT_PERSIST_MAX_OBJECTS 8
+/* Sanity limit on a single saved block, to reject corrupt files */
+#define XLAT_PERSIST_MAX_BLOCK (1024*1024)
+
+#define XLAT_PTR_SELF   0 /* Offset relative to the block's code */
+#define XLAT_PTR_NULL   1
+#define XLAT_PTR_IMAGE  2 /* Offset relative to the executable image base */
+#define XLAT_PTR_RAM    3 /* SH4 physical address */
+#define XLAT_PTR_LUT    4 /* Lookup table entry for an SH4 address */
+#define XLAT_PTR_OBJECT 5 /* Index into the client object table */
+
+struct xlat_persist_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t ptr_size;
+    uint64_t image_size;
+    uint64_t image_mtime;
+    uint32_t num_objects;
+    uint32_t num_records;
+};
+
+struct xlat_persist_record {
+    uint32_t address;
+    uint32_t mode;
+    uint32_t variant;
+    uint32_t src_size;
+    uint64_t src_hash;
+    uint32_t code_size;
+    uint32_t recover_count;
+    uint32_t reloc_count;
+    uint32_t ptr_count;
+};
+
+struct xlat_persist_ptr {
+    uint32_t kind;
+    uint32_t pad;
+    int64_t value;
+};
+
+/**
+ * In-memory copy of a saved block. Data holds the code, the recovery table,
+ * the relocation table, and the pointer values in that order.
+ */
+typedef struct xlat_persist_entry {
+    struct xlat_persist_entry *next;
+    struct xlat_persist_record rec;
+    uint8_t data[0];
+} *xlat_persist_entry_t;
+
+#define ENTRY_CODE(ent) ((ent)->data)
+#define ENTRY_RECOVERY(ent) ((xlat_recovery_record_t)((ent)->data + (ent)->rec.code_size))
+#define ENTRY_RELOC(ent) ((xlat_reloc_record_t *)(ENTRY_RECOVERY(ent) + (ent)->rec.recover_count))
+#define ENTRY_PTRS(ent) ((struct xlat_persist_ptr *)(ENTRY_RELOC(ent) + (ent)->rec.reloc_count))
+#define RECORD_DATA_SIZE(rec) ((rec)->code_size + (rec)->recover_count*sizeof(struct xlat_recovery_record) + \
+        (rec)->reloc_count*sizeof(xlat_reloc_record_t) + (rec)->ptr_count*sizeof(struct xlat_persist_ptr))
+
+static gboolean xlat_persist_enabled = FALSE;
+static gchar *xlat_persist_filename = NULL;
+static xlat_persist_entry_t xlat_persist_table[XLAT_PERSIST_BUCKETS];
+static unsigned int xlat_persist_count = 0;
+static void *xlat_persist_objects[XLAT_PERSIST_MAX_OBJECTS];
+static unsigned int xlat_persist_num_objects = 0;
+static struct xlat_persist_header xlat_persist_image;
+static uintptr_t xlat_persist_image_base = 0;
+
+static struct {
+    unsigned int loaded;
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int stale;
+    unsigned int captured;
+    unsigned int rejected;
+} xlat_persist_stats;
+
+static uint64_t xlat_persist_hash( const uint8_t *data, uint32_t size )
+{
+    uint64_t hash = 0xCBF29CE484222325ULL; /* FNV-1a */
+    uint32_t i;
+    for( i=0; i<size; i++ ) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static inline unsigned int xlat_persist_bucket( sh4addr_t address, uint32_t mode )
+{
+    return ((address>>1) ^ (address>>13) ^ (mode>>19)) & (XLAT_PERSIST_BUCKETS-1);
+}
+
+/**
+ * Compute the hash of the current source code for the block at address,
+ * clipped to the containing page.
+ * @return FALSE if the address is not backed by memory.
+ */
+static gboolean xlat_persist_source_hash( sh4addr_t address, uint32_t size, uint64_t *hash )
+{
+    sh4ptr_t src = mem_get_region(address);
+    if( src == NULL )
+        return FALSE;
+    if( size > 0x1000 - (address & 0xFFF) )
+        size = 0x1000 - (address & 0xFFF);
+    *hash = xlat_persist_hash( src, size );
+    return TRUE;
+}
+
+static xlat_persist_entry_t *xlat_persist_find( sh4addr_t address, uint32_t mode, uint32_t variant )
+{
+    xlat_persist_entry_t *p = &xlat_persist_table[xlat_persist_bucket(address,mode)];
+    while( *p != NULL ) {
+        if( (*p)->rec.address == address && (*p)->rec.mode == mode &&
+            (*p)->rec.variant == variant ) {
+            break;
+        }
+        p = &(*p)->next;
+    }
+    return p;
+}
+
+/**
+ * Add the entry to the table, replacing any existing entry with the same key
+ */
+static void xlat_persist_insert( xlat_persist_entry_t ent )
+{
+    xlat_persist_entry_t *p = xlat_persist_find( ent->rec.address, ent->rec.mode, ent->rec.variant );
+    if( *p != NULL ) {
+        ent->next = (*p)->next;
+        free( *p );
+    } else {
+        ent->next = NULL;
+        xlat_persist_count++;
+    }
+    *p = ent;
+}
+
+/**
+ * Identify the executable image, so that a cache written by a different build
+ * is rejected.
+ */
+static void xlat_persist_init_image( struct xlat_persist_header *hdr )
+{
+    Dl_info dli;
+    struct stat st;
+
+    memset( hdr, 0, sizeof(struct xlat_persist_header) );
+    memcpy( hdr->magic, XLAT_PERSIST_MAGIC, sizeof(hdr->magic) );
+    hdr->version = XLAT_PERSIST_VERSION;
+    hdr->ptr_size = sizeof(void *);
+    if( dladdr( (void *)xlat_persist_init, &dli ) ) {
+        xlat_persist_image_base = (uintptr_t)dli.dli_fbase;
+        if( dli.dli_fname != NULL && stat( dli.dli_fname, &st ) == 0 ) {
+            hdr->image_size = st.st_size;
+            hdr->image_mtime = st.st_mtime;
+        }
+    }
+    hdr->num_objects = xlat_persist_num_objects;
+}
+
+/**
+ * Convert a pointer found in a live block into position-independent form.
+ * @return FALSE if the pointer cannot be classified.
+ */
+static gboolean xlat_persist_encode_ptr( xlat_cache_block_t block, void *ptr, struct xlat_persist_ptr *out )
+{
+    unsigned int i;
+    sh4addr_t addr;
+    Dl_info dli;
+
+    out->pad = 0;
+    if( ptr == NULL ) {
+        out->kind = XLAT_PTR_NULL;
+        out->value = 0;
+        return TRUE;
+    }
+    if( (uint8_t *)ptr >= (uint8_t *)block && (uint8_t *)ptr <= block->code + block->size ) {
+        out->kind = XLAT_PTR_SELF;
+        out->value = ((uint8_t *)ptr) - block->code;
+        return TRUE;
+    }
+    for( i=0; i<xlat_persist_num_objects; i++ ) {
+        if( ptr == xlat_persist_objects[i] ) {
+            out->kind = XLAT_PTR_OBJECT;
+            out->value = i;
+            return TRUE;
+        }
+    }
+    if( mem_get_phys_address( ptr, &addr ) ) {
+        out->kind = XLAT_PTR_RAM;
+        out->value = addr;
+        return TRUE;
+    }
+    if( dladdr( ptr, &dli ) && (uintptr_t)dli.dli_fbase == xlat_persist_image_base ) {
+        out->kind = XLAT_PTR_IMAGE;
+        out->value = ((uintptr_t)ptr) - xlat_persist_image_base;
+        return TRUE;
+    }
+    addr = xlat_get_lut_entry_address( (void **)ptr );
+    if( addr != (sh4addr_t)-1 && xlat_get_lut_entry(addr) == ptr ) {
+        out->kind = XLAT_PTR_LUT;
+        out->value = addr;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * Resolve a saved pointer (other than block-relative ones) for the current
+ * process.
+ */
+static gboolean xlat_persist_decode_ptr( struct xlat_persist_ptr *ptr, void **out )
+{
+    switch( ptr->kind ) {
+    case XLAT_PTR_NULL:
+        *out = NULL;
+        return TRUE;
+    case XLAT_PTR_IMAGE:
+        *out = (void *)(xlat_persist_image_base + ptr->value);
+        return TRUE;
+    case XLAT_PTR_RAM:
+        *out = mem_get_region( (sh4addr_t)ptr->value );
+        return *out != NULL;
+    case XLAT_PTR_LUT:
+        *out = xlat_get_lut_entry( (sh4addr_t)ptr->value );
+        return TRUE;
+    case XLAT_PTR_OBJECT:
+        if( ptr->value < 0 || ptr->value >= xlat_persist_num_objects )
+            return FALSE;
+        *out = xlat_persist_objects[ptr->value];
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * Create a persistent copy of the given live block.
+ * @return the new entry, or NULL if the block cannot be relocated.
+ */
+static xlat_persist_entry_t xlat_persist_pack( xlat_cache_block_t block, sh4addr_t address, uint32_t variant )
+{
+    struct xlat_persist_record rec;
+    unsigned int i, ptr_count = 0;
+    xlat_reloc_record_t *reloc;
+
+    if( block->reloc_table_size == 0 || block->recover_table_size == 0 ||
+        block->recover_table_offset == 0 ) {
+        return NULL;
+    }
+    reloc = XLAT_RELOC_TABLE(block->code);
+    for( i=0; i<block->reloc_table_size; i++ ) {
+        if( !XLAT_RELOC_IS_LINK(reloc[i]) )
+            ptr_count++;
+    }
+
+    rec.address = address;
+    rec.mode = block->xlat_sh4_mode;
+    rec.variant = variant;
+    rec.src_size = XLAT_RECOVERY_TABLE(block->code)[block->recover_table_size-1].sh4_icount << 1;
+    rec.code_size = block->recover_table_offset;
+    rec.recover_count = block->recover_table_size;
+    rec.reloc_count = block->reloc_table_size;
+    rec.ptr_count = ptr_count;
+    if( !xlat_persist_source_hash( address, rec.src_size, &rec.src_hash ) ) {
+        return NULL;
+    }
+
+    xlat_persist_entry_t ent = malloc( sizeof(struct xlat_persist_entry) + RECORD_DATA_SIZE(&rec) );
+    if( ent == NULL )
+        return NULL;
+    ent->rec = rec;
+    memcpy( ENTRY_CODE(ent), block->code, rec.code_size );
+    memcpy( ENTRY_RECOVERY(ent), XLAT_RECOVERY_TABLE(block->code), rec.recover_count*sizeof(struct xlat_recovery_record) );
+    memcpy( ENTRY_RELOC(ent), reloc, rec.reloc_count*sizeof(xlat_reloc_record_t) );
+
+    /* Restore link sites first, as linking overwrites the stub's own pointer */
+    for( i=0; i<rec.reloc_count; i++ ) {
+        if( XLAT_RELOC_IS_LINK(reloc[i]) ) {
+            xlat_unlink_site( ENTRY_CODE(ent) + XLAT_RELOC_OFFSET(reloc[i]) );
+        }
+    }
+
+    struct xlat_persist_ptr *ptrs = ENTRY_PTRS(ent);
+    for( i=0; i<rec.reloc_count; i++ ) {
+        if( !XLAT_RELOC_IS_LINK(reloc[i]) ) {
+            uint32_t offset = XLAT_RELOC_OFFSET(reloc[i]);
+            if( offset + sizeof(void *) > rec.code_size ||
+                !xlat_persist_encode_ptr( block, *(void **)(ENTRY_CODE(ent)+offset), ptrs ) ) {
+                free(ent);
+                return NULL;
+            }
+            *(void **)(ENTRY_CODE(ent)+offset) = NULL;
+            ptrs++;
+        }
+    }
+    return ent;
+}
+
+void xlat_persist_init( const char *filename, void **objects, unsigned int num_objects )
+{
+    struct xlat_persist_header hdr;
+    unsigned int i;
+
+    if( num_objects > XLAT_PERSIST_MAX_OBJECTS ) {
+        num_objects = XLAT_PERSIST_MAX_OBJECTS;
+    }
+    memcpy( xlat_persist_objects, objects, num_objects*sizeof(void *) );
+    xlat_persist_num_objects = num_objects;
+    xlat_persist_init_image( &xlat_persist_image );
+    g_free( xlat_persist_filename );
+    xlat_persist_filename = g_strdup(filename);
+    xlat_persist_enabled = TRUE;
+
+    FILE *f = fopen( filename, "rb" );
+    if( f == NULL ) {
+        if( errno != ENOENT ) {
+            WARN( "Unable to open translation cache %s: %s", filename, strerror(errno) );
+        }
+        return;
+    }
+    if( fread( &hdr, sizeof(hdr), 1, f ) != 1 ||
+        memcmp( hdr.magic, xlat_persist_image.magic, sizeof(hdr.magic) ) != 0 ||
+        hdr.version != XLAT_PERSIST_VERSION || hdr.ptr_size != sizeof(void *) ||
+        hdr.image_size != xlat_persist_image.image_size ||
+        hdr.image_mtime != xlat_persist_image.image_mtime ||
+        hdr.num_objects != xlat_persist_num_objects ) {
+        INFO( "Translation cache %s is from a different build, ignoring", filename );
+        fclose(f);
+        return;
+    }
+
+    for( i=0; i<hdr.num_records; i++ ) {
+        struct xlat_persist_record rec;
+        if( fread( &rec, sizeof(rec), 1, f ) != 1 ||
+            rec.code_size > XLAT_PERSIST_MAX_BLOCK || rec.recover_count > XLAT_PERSIST_MAX_BLOCK ||
+            rec.reloc_count > XLAT_PERSIST_MAX_BLOCK || rec.ptr_count > rec.reloc_count ) {
+            break;
+        }
+        xlat_persist_entry_t ent = malloc( sizeof(struct xlat_persist_entry) + RECORD_DATA_SIZE(&rec) );
+        if( ent == NULL )
+            break;
+        ent->rec = rec;
+        if( fread( ent->data, RECORD_DATA_SIZE(&rec), 1, f ) != 1 ) {
+            free(ent);
+            break;
+        }
+        xlat_persist_insert( ent );
+        xlat_persist_stats.loaded++;
+    }
+    fclose(f);
+    if( i != hdr.num_records ) {
+        WARN( "Translation cache %s is truncated or corrupt (%d of %d blocks loaded)",
+              filename, i, hdr.num_records );
+    }
+    INFO( "Loaded %d blocks from translation cache %s", xlat_persist_stats.loaded, filename );
+}
+
+gboolean xlat_persist_is_enabled( void )
+{
+    return xlat_persist_enabled;
+}
+
+void *xlat_persist_restore( sh4addr_t address, uint32_t mode, uint32_t variant )
+{
+    unsigned int i;
+    uint64_t hash;
+
+    xlat_persist_entry_t *p = xlat_persist_find( address, mode, variant );
+    xlat_persist_entry_t ent = *p;
+    if( ent == NULL ) {
+        xlat_persist_stats.misses++;
+        return NULL;
+    }
+    if( !xlat_persist_source_hash( address, ent->rec.src_size, &hash ) ||
+        hash != ent->rec.src_hash ) {
+        /* Code has changed since it was saved - drop the entry */
+        *p = ent->next;
+        free(ent);
+        xlat_persist_count--;
+        xlat_persist_stats.stale++;
+        return NULL;
+    }
+
+    /* Resolve everything before touching the cache, so we can still bail out */
+    struct xlat_persist_ptr *ptrs = ENTRY_PTRS(ent);
+    void *values[ent->rec.ptr_count+1];
+    for( i=0; i<ent->rec.ptr_count; i++ ) {
+        if( ptrs[i].kind != XLAT_PTR_SELF && !xlat_persist_decode_ptr( &ptrs[i], &values[i] ) ) {
+            xlat_persist_stats.misses++;
+            return NULL;
+        }
+    }
+
+    uint32_t recovery_size = ent->rec.recover_count*sizeof(struct xlat_recovery_record);
+    uint32_t reloc_size = ent->rec.reloc_count*sizeof(xlat_reloc_record_t);
+    uint32_t total = ent->rec.code_size + recovery_size + reloc_size;
+    xlat_cache_block_t block = xlat_start_block( address );
+    if( block->size < total ) {
+        block = xlat_extend_block( total );
+    }
+    memcpy( block->code, ENTRY_CODE(ent), ent->rec.code_size );
+    memcpy( block->code + ent->rec.code_size, ENTRY_RECOVERY(ent), recovery_size );
+    memcpy( block->code + ent->rec.code_size + recovery_size, ENTRY_RELOC(ent), reloc_size );
+
+    xlat_reloc_record_t *reloc = ENTRY_RELOC(ent);
+    unsigned int posn = 0;
+    for( i=0; i<ent->rec.reloc_count; i++ ) {
+        if( !XLAT_RELOC_IS_LINK(reloc[i]) ) {
+            void **site = (void **)(block->code + XLAT_RELOC_OFFSET(reloc[i]));
+            if( ptrs[posn].kind == XLAT_PTR_SELF ) {
+                *site = block->code + ptrs[posn].value;
+            } else {
+                *site = values[posn];
+            }
+            posn++;
+        }
+    }
+    block->recover_table_offset = ent->rec.code_size;
+    block->recover_table_size = ent->rec.recover_count;
+    block->reloc_table_size = ent->rec.reloc_count;
+    block->xlat_sh4_mode = mode;
+    xlat_commit_block( total, address, address + ent->rec.src_size );
+    xlat_persist_stats.hits++;
+    return block->code;
+}
+
+void xlat_persist_capture( uint32_t variant )
+{
+    unsigned int i, count;
+
+    if( !xlat_persist_enabled )
+        return;
+    count = xlat_get_active_block_count();
+    if( count == 0 )
+        return;
+    struct xlat_block_ref *blocks = malloc( count * sizeof(struct xlat_block_ref) );
+    if( blocks == NULL )
+        return;
+    count = xlat_get_blocks_by_address( blocks, count );
+    for( i=0; i<count; i++ ) {
+        xlat_persist_entry_t ent = xlat_persist_pack( blocks[i].block, blocks[i].pc, variant );
+        if( ent == NULL ) {
+            xlat_persist_stats.rejected++;
+        } else {
+            xlat_persist_insert( ent );
+            xlat_persist_stats.captured++;
+        }
+    }
+    free( blocks );
+}
+
+gboolean xlat_persist_save( void )
+{
+    unsigned int i;
+
+    if( !xlat_persist_enabled )
+        return FALSE;
+
+    gchar *tmpname = g_strdup_printf( "%s.tmp", xlat_persist_filename );
+    FILE *f = fopen( tmpname, "wb" );
+    if( f == NULL ) {
+        WARN( "Unable to write translation cache %s: %s", tmpname, strerror(errno) );
+        g_free(tmpname);
+        return FALSE;
+    }
+    struct xlat_persist_header hdr = xlat_persist_image;
+    hdr.num_records = xlat_persist_count;
+    gboolean ok = fwrite( &hdr, sizeof(hdr), 1, f ) == 1;
+    for( i=0; i<XLAT_PERSIST_BUCKETS && ok; i++ ) {
+        xlat_persist_entry_t ent;
+        for( ent = xlat_persist_table[i]; ent != NULL && ok; ent = ent->next ) {
+            ok = fwrite( &ent->rec, sizeof(ent->rec), 1, f ) == 1 &&
+                 fwrite( ent->data, RECORD_DATA_SIZE(&ent->rec), 1, f ) == 1;
+        }
+    }
+    if( fclose(f) != 0 )
+        ok = FALSE;
+    if( ok && rename( tmpname, xlat_persist_filename ) != 0 ) {
+        ok = FALSE;
+    }
+    if( !ok ) {
+        WARN( "Unable to write translation cache %s: %s", xlat_persist_filename, strerror(errno) );
+        unlink( tmpname );
+    } else {
+        INFO( "Saved %d blocks to translation cache %s", xlat_persist_count, xlat_persist_filename );
+    }
+    g_free(tmpname);
+    return ok;
+}
+
+void xlat_persist_print_stats( FILE *out )
+{
+    unsigned int lookups = xlat_persist_stats.hits + xlat_persist_stats.misses + xlat_persist_stats.stale;
+    fprintf( out, "[JIT] persistent cache: %u loaded, %u hits, %u misses, %u stale (%.1f%% hit rate); "
+             "%u captured, %u not relocatable\n",
+             xlat_persist_stats.loaded, xlat_persist_stats.hits, xlat_persist_stats.misses,
+             xlat_persist_stats.stale,
+             lookups == 0 ? 0.0 : (100.0 * xlat_persist_stats.hits) / lookups,
+             xlat_persist_stats.captured, xlat_persist_stats.rejected );
+}
@@ -0,0 +1,82 @@
+/**
+ * $Id$
+ *
+ * Persistent (on-disk) translation cache. Translated blocks are written out
+ * at shutdown along with their recovery and relocation tables, and are
+ * relocated back into the live cache on the next run in place of translating
+ * the source block again, provided the source code is unchanged.
+ *
+ * Copyright (c) 2026 Nathan Keynes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef lxdream_xltpersist_H
+#define lxdream_xltpersist_H 1
+
+#include <stdio.h>
+#include "xlat/xltcache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Enable the persistent cache, and load any existing cache contents from the
+ * given file. A missing, corrupt or mismatched file (eg from a different
+ * build) is treated as an empty cache.
+ * @param filename file to load from (and later save to)
+ * @param objects Table of heap-allocated objects that translated code may
+ * embed pointers to (eg address space tables). Pointers to these are saved as
+ * an index into this table, so the order must be stable between runs.
+ * @param num_objects number of entries in objects
+ */
+void xlat_persist_init( const char *filename, void **objects, unsigned int num_objects );
+
+/**
+ * @return TRUE if the persistent cache has been enabled.
+ */
+gboolean xlat_persist_is_enabled( void );
+
+/**
+ * Look for a saved translation of the block starting at the given physical
+ * address, and if one is found whose source code matches the current memory
+ * contents, relocate it into the translation cache.
+ * @param address physical address of the block
+ * @param mode xlat_sh4_mode of the block
+ * @param variant translator configuration the block must have been built with
+ * @return the code pointer of the new block, or NULL on a miss.
+ */
+void *xlat_persist_restore( sh4addr_t address, uint32_t mode, uint32_t variant );
+
+/**
+ * Copy all relocatable blocks currently in the translation cache into the
+ * persistent cache (in memory). Typically called before the cache is flushed.
+ * @param variant translator configuration the live blocks were built with.
+ */
+void xlat_persist_capture( uint32_t variant );
+
+/**
+ * Write the persistent cache out to disk
+ * @return TRUE on success.
+ */
+gboolean xlat_persist_save( void );
+
+/**
+ * Print the cache hit/miss statistics
+ */
+void xlat_persist_print_stats( FILE *out );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !lxdream_xltpersist_H */